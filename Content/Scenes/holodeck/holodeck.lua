@@ -25745,6 +25745,7 @@ MeshList =
 				1.3266699738779e-008,
 			},
 		},
+		Occluder = true,
 		UVSets = 
 		{
 			[1] = 
@@ -56463,6 +56464,7 @@ MeshList =
 				0.0025268017780036,
 			},
 		},
+		Occluder = true,
 		UVSets = 
 		{
 			[1] = 
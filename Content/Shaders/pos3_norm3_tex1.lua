@@ -3,4 +3,5 @@ VertexDeclaration =
         { "POSITION", 0, "DXGI_FORMAT_R32G32B32_FLOAT", 0, 0, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
 		{ "NORMAL",   0, "DXGI_FORMAT_R32G32B32_FLOAT", 0, 12, "D3D11_INPUT_PER_VERTEX_DATA", 0},
         { "TEXCOORD", 0, "DXGI_FORMAT_R32G32_FLOAT", 0, 24, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "OBJECTINDEX", 0, "DXGI_FORMAT_R32_UINT", 1, 0, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
 }
\ No newline at end of file
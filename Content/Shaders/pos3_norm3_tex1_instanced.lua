@@ -0,0 +1,10 @@
+VertexDeclaration = 
+{
+        { "POSITION", 0, "DXGI_FORMAT_R32G32B32_FLOAT", 0, 0, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "NORMAL",   0, "DXGI_FORMAT_R32G32B32_FLOAT", 0, 12, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "TEXCOORD", 0, "DXGI_FORMAT_R32G32_FLOAT", 0, 24, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "WORLDVIEW", 0, "DXGI_FORMAT_R32G32B32A32_FLOAT", 1, 0, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
+        { "WORLDVIEW", 1, "DXGI_FORMAT_R32G32B32A32_FLOAT", 1, 16, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
+        { "WORLDVIEW", 2, "DXGI_FORMAT_R32G32B32A32_FLOAT", 1, 32, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
+        { "WORLDVIEW", 3, "DXGI_FORMAT_R32G32B32A32_FLOAT", 1, 48, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
+}
@@ -0,0 +1,7 @@
+VertexDeclaration = 
+{
+        { "POSITION", 0, "DXGI_FORMAT_R16G16B16A16_UNORM", 0, 0, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "NORMAL",   0, "DXGI_FORMAT_R16G16_SNORM", 0, 8, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "TEXCOORD", 0, "DXGI_FORMAT_R16G16_FLOAT", 0, 12, "D3D11_INPUT_PER_VERTEX_DATA", 0 },
+        { "OBJECTINDEX", 0, "DXGI_FORMAT_R32_UINT", 1, 0, "D3D11_INPUT_PER_INSTANCE_DATA", 1 },
+}
@@ -37,3 +37,21 @@ cbuffer PSPointLight : register(b2)
 	float4	g_pointColor		;
 	float	g_lightRadius		;
 };
+
+// The G-buffer pass's per object constants.  A buffer holds as many objects
+// as fit in 4096 constants and each draw picks its own with OBJECTINDEX,
+// which the renderer feeds in per instance.  OBJECT_BLOCKS has to match
+// MAX_OBJECT_BLOCKS in RenderThread.cpp.
+#define OBJECT_BLOCKS	341
+
+struct ObjectConstants
+{
+	matrix		mWorldView			;
+	matrix		mViewWorldIT		;
+	matrix		mInvWorldViewProj	;
+};
+
+cbuffer VSObjectBlocks : register(b3)
+{
+	ObjectConstants	g_objectBlocks[OBJECT_BLOCKS];
+};
@@ -10,6 +10,43 @@ struct TextureVS_in
 	float3 pos : POSITION;
 	float3 normal : NORMAL;
 	float2 texuv : TEXCOORD0;
+	uint objectIndex : OBJECTINDEX;
+};
+
+// Same vertex with the object's world view matrix from the instance stream.
+// The rows arrive as they sit in memory, the same as the per object constant
+// buffer.
+struct TextureInstancedVS_in
+{
+	float3 pos : POSITION;
+	float3 normal : NORMAL;
+	float2 texuv : TEXCOORD0;
+	float4 worldView0 : WORLDVIEW0;
+	float4 worldView1 : WORLDVIEW1;
+	float4 worldView2 : WORLDVIEW2;
+	float4 worldView3 : WORLDVIEW3;
+};
+
+// Packed vertex.  The input assembler hands over the position as 0..1
+// within the mesh's bounds, which the world view matrix maps back, and the
+// normal still folded onto the octahedron.
+struct TexturePackedVS_in
+{
+	float3 pos : POSITION;
+	float2 normal : NORMAL;
+	float2 texuv : TEXCOORD0;
+	uint objectIndex : OBJECTINDEX;
+};
+
+struct TexturePackedInstancedVS_in
+{
+	float3 pos : POSITION;
+	float2 normal : NORMAL;
+	float2 texuv : TEXCOORD0;
+	float4 worldView0 : WORLDVIEW0;
+	float4 worldView1 : WORLDVIEW1;
+	float4 worldView2 : WORLDVIEW2;
+	float4 worldView3 : WORLDVIEW3;
 };
 
 struct TexturePS_in
@@ -29,18 +66,50 @@ struct TexturePS_out
 
 SamplerState texSampler : register(s0) ;
 	
-TexturePS_in TextureVertexShader(TextureVS_in In)
+TexturePS_in TextureTransform(float3 pos, float3 normal, float2 texuv, matrix worldView)
 {
 	TexturePS_in Out;
 
-	Out.normal = In.normal;
-	Out.texuv = In.texuv;
-	float4 P = mul( float4(In.pos,1), g_mWorldView );
+	Out.normal = normal;
+	Out.texuv = texuv;
+	float4 P = mul( float4(pos,1), worldView );
 	Out.pos = mul( P, g_mProjection );
 	Out.depth.xy = Out.pos.zw;						// Send z and w separately to the pixel shader
 	return Out;
 }
 
+TexturePS_in TextureVertexShader(TextureVS_in In)
+{
+	return TextureTransform(In.pos, In.normal, In.texuv, g_objectBlocks[In.objectIndex].mWorldView);
+}
+
+TexturePS_in TextureInstancedVertexShader(TextureInstancedVS_in In)
+{
+	// Constant buffer matrices are column major, so memory rows are columns
+	matrix worldView = transpose(matrix(In.worldView0, In.worldView1, In.worldView2, In.worldView3));
+	return TextureTransform(In.pos, In.normal, In.texuv, worldView);
+}
+
+// The lower half of the octahedron is folded out over the corners
+float3 OctahedralDecode(float2 e)
+{
+	float3 n = float3(e.xy, 1 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0 ? -t : t;
+	return normalize(n);
+}
+
+TexturePS_in TexturePackedVertexShader(TexturePackedVS_in In)
+{
+	return TextureTransform(In.pos, OctahedralDecode(In.normal), In.texuv, g_objectBlocks[In.objectIndex].mWorldView);
+}
+
+TexturePS_in TexturePackedInstancedVertexShader(TexturePackedInstancedVS_in In)
+{
+	matrix worldView = transpose(matrix(In.worldView0, In.worldView1, In.worldView2, In.worldView3));
+	return TextureTransform(In.pos, OctahedralDecode(In.normal), In.texuv, worldView);
+}
+
 TexturePS_out TexturePixelShader(TexturePS_in In) 
 {
 	TexturePS_out outValue;
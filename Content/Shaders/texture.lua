@@ -1,8 +1,10 @@
 Shader =
 {
-	Declaration = "pos3_norm3_tex1",
-	VSEntry="TextureVertexShader",
+	Declaration = "pos3q_normoct_tex1h",
+	VSEntry="TexturePackedVertexShader",
 	PSEntry="TexturePixelShader",
+	InstancedDeclaration = "pos3q_normoct_tex1h_instanced",
+	InstancedVSEntry="TexturePackedInstancedVertexShader",
 	VSProfile="vs_4_1",
 	PSProfile="ps_4_1",
 	HLSL = "texture.hlsl"
@@ -0,0 +1,608 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#include "ContentDatabase.h"
+#include "ContentFile.h"
+#include "Kernel/JobSystem.h"
+#include "Utility/MappedFile.h"
+#include "Utility/lookup3.h"
+
+namespace Helix {
+
+const unsigned int	MIN_FILE_CAPACITY = 64;
+const unsigned int	HASH_BATCH_SIZE = 4;
+
+// What the runtime's vertex declarations can hold, by the names the Lua
+// uses.  vertexFormat is what mesh packing makes of it, if anything.
+struct DeclFormat
+{
+	const char *	name;
+	unsigned int	size;
+	VertexFormat	vertexFormat;
+};
+
+const DeclFormat	DECL_FORMATS[] =
+{
+	{ "DXGI_FORMAT_R32G32B32A32_FLOAT",		16,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32B32A32_UINT",		16,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32B32A32_SINT",		16,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32B32_FLOAT",		12,	VERTEX_FORMAT_FLOAT32 },
+	{ "DXGI_FORMAT_R32G32B32_UINT",			12,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32B32_SINT",			12,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16B16A16_FLOAT",		8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16B16A16_UNORM",		8,	VERTEX_FORMAT_UNORM16 },
+	{ "DXGI_FORMAT_R16G16B16A16_UINT",		8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16B16A16_SNORM",		8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16B16A16_SINT",		8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32_FLOAT",			8,	VERTEX_FORMAT_FLOAT32 },
+	{ "DXGI_FORMAT_R32G32_UINT",			8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32G32_SINT",			8,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R10G10B10A2_UNORM",		4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R10G10B10A2_UINT",		4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R11G11B10_FLOAT",		4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8B8A8_UNORM",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8B8A8_UNORM_SRGB",	4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8B8A8_UINT",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8B8A8_SNORM",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8B8A8_SINT",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16_FLOAT",			4,	VERTEX_FORMAT_FLOAT16 },
+	{ "DXGI_FORMAT_R16G16_UNORM",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16_UINT",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16G16_SNORM",			4,	VERTEX_FORMAT_OCT_SNORM16 },
+	{ "DXGI_FORMAT_R16G16_SINT",			4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_D32_FLOAT",				4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32_FLOAT",				4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32_UINT",				4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R32_SINT",				4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_D24_UNORM_S8_UINT",		4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R24_UNORM_X8_TYPELESS",	4,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8_UNORM",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8_UINT",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8G8_SNORM",				2,	VERTEX_FORMAT_OCT_SNORM8 },
+	{ "DXGI_FORMAT_R8G8_SINT",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16_FLOAT",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_D16_UNORM",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16_UNORM",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16_UINT",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16_SNORM",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R16_SINT",				2,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8_UNORM",				1,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8_UINT",				1,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8_SNORM",				1,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_R8_SINT",				1,	VERTEX_FORMAT_NONE },
+	{ "DXGI_FORMAT_A8_UNORM",				1,	VERTEX_FORMAT_NONE },
+};
+const unsigned int	NUM_DECL_FORMATS = sizeof(DECL_FORMATS) / sizeof(DECL_FORMATS[0]);
+
+// ****************************************************************************
+// ****************************************************************************
+inline const DeclFormat * FindDeclFormat(const std::string &name)
+{
+	for(unsigned int i=0;i<NUM_DECL_FORMATS;i++)
+	{
+		if(name == DECL_FORMATS[i].name)
+			return &DECL_FORMATS[i];
+	}
+	return NULL;
+}
+
+// ****************************************************************************
+// The runtime matches semantics with _stricmp
+// ****************************************************************************
+inline bool SameSemantic(const std::string &a, const char *b)
+{
+	size_t length = strlen(b);
+	if(a.size() != length)
+		return false;
+
+	for(size_t i=0;i<length;i++)
+	{
+		char ca = a[i] >= 'a' && a[i] <= 'z' ? a[i] - 'a' + 'A' : a[i];
+		char cb = b[i] >= 'a' && b[i] <= 'z' ? b[i] - 'a' + 'A' : b[i];
+		if(ca != cb)
+			return false;
+	}
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool EndsWith(const std::string &str, const char *suffix)
+{
+	size_t length = strlen(suffix);
+	return str.size() >= length && str.compare(str.size() - length, length, suffix) == 0;
+}
+
+// ****************************************************************************
+// Directly in directory, as in "Materials/", and not in a subdirectory
+// ****************************************************************************
+inline bool InDirectory(const std::string &path, const char *directory)
+{
+	size_t length = strlen(directory);
+	return path.compare(0, length, directory) == 0 && path.find('/', length) == std::string::npos;
+}
+
+// ****************************************************************************
+// "Materials/Grid.lua" to "Grid"
+// ****************************************************************************
+inline std::string AssetName(const std::string &path)
+{
+	size_t start = path.rfind('/');
+	start = start == std::string::npos ? 0 : start + 1;
+	size_t end = path.rfind('.');
+	end = end == std::string::npos || end < start ? path.size() : end;
+	return path.substr(start, end - start);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void HashFileRange(void *data, unsigned int begin, unsigned int end)
+{
+	ContentDatabase &database = *static_cast<ContentDatabase *>(data);
+	for(unsigned int index=begin;index < end; index++)
+	{
+		ContentFileInfo &file = const_cast<ContentFileInfo &>(database.GetFile(index));
+		std::string fullPath = database.FullPath(file.path);
+
+		uint32_t primary = 0;
+		uint32_t secondary = 0;
+
+		// Empty files don't map, but are still there
+		MappedFile mapped;
+		if(mapped.Open(fullPath.c_str()))
+		{
+			hashlittle2(mapped.Data(), mapped.Size(), &primary, &secondary);
+			file.readable = true;
+		}
+		else
+		{
+			file.readable = FileWriteTime(fullPath.c_str()) != 0;
+			hashlittle2("", 0, &primary, &secondary);
+		}
+
+		file.hash = (static_cast<uint64_t>(secondary) << 32) | primary;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentDatabase::ContentDatabase()
+: m_files(NULL)
+, m_numFiles(0)
+, m_fileCapacity(0)
+, m_dependencies(NULL)
+, m_numDependencies(0)
+, m_dependencyCapacity(0)
+, m_numErrors(0)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentDatabase::~ContentDatabase()
+{
+	delete [] m_files;
+	delete [] m_dependencies;
+}
+
+// ****************************************************************************
+// Files are kept sorted by path so everything written from them comes out
+// the same from run to run
+// ****************************************************************************
+bool ContentDatabase::Load(const std::string &root)
+{
+	m_root = root;
+	while(m_root.size() > 1 && (m_root[m_root.size() - 1] == '/' || m_root[m_root.size() - 1] == '\\'))
+	{
+		m_root.erase(m_root.size() - 1);
+	}
+
+	Walk("");
+	if(m_numFiles == 0)
+		return false;
+
+	ContentFileInfo *sorted = new ContentFileInfo[m_fileCapacity];
+	unsigned int index = 0;
+	for(FileMap::iterator iter = m_fileMap.begin(); iter != m_fileMap.end(); ++iter)
+	{
+		sorted[index] = m_files[iter->second];
+		iter->second = index++;
+	}
+	delete [] m_files;
+	m_files = sorted;
+
+	for(unsigned int fileIndex=0;fileIndex < m_numFiles; fileIndex++)
+	{
+		const std::string &path = m_files[fileIndex].path;
+		if(InDirectory(path, "Materials/") && EndsWith(path, ".lua"))
+		{
+			LoadMaterial(path);
+		}
+		else if(InDirectory(path, "Shaders/") && EndsWith(path, ".lua"))
+		{
+			LoadShaderFile(path);
+		}
+		else if(InDirectory(path, "Shaders/") && EndsWith(path, ".hlsl"))
+		{
+			LoadHLSLIncludes(path);
+		}
+	}
+
+	// Now everything's loaded, check what they refer to is there
+	for(MaterialMap::const_iterator iter = m_materials.begin(); iter != m_materials.end(); ++iter)
+	{
+		if(FindShader(iter->second.shader) == NULL)
+			Error("%s: no shader %s\n", iter->second.path.c_str(), iter->second.shader.c_str());
+	}
+
+	for(ShaderMap::const_iterator iter = m_shaders.begin(); iter != m_shaders.end(); ++iter)
+	{
+		const ContentShader &shader = iter->second;
+		if(FindVertexDecl(shader.declaration) == NULL)
+			Error("%s: no vertex declaration %s\n", shader.path.c_str(), shader.declaration.c_str());
+
+		if(!shader.instancedDeclaration.empty() && FindVertexDecl(shader.instancedDeclaration) == NULL)
+			Error("%s: no vertex declaration %s\n", shader.path.c_str(), shader.instancedDeclaration.c_str());
+	}
+
+	for(unsigned int depIndex=0;depIndex < m_numDependencies; depIndex++)
+	{
+		if(FindFile(m_dependencies[depIndex].dependency) == NULL)
+			Error("%s: %s is missing\n", m_dependencies[depIndex].asset.c_str(), m_dependencies[depIndex].dependency.c_str());
+	}
+
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentDatabase::HashFiles()
+{
+	ParallelFor(m_numFiles, HASH_BATCH_SIZE, HashFileRange, this);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentFileInfo * ContentDatabase::FindFile(const std::string &path) const
+{
+	FileMap::const_iterator iter = m_fileMap.find(path);
+	return iter != m_fileMap.end() ? &m_files[iter->second] : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentMaterial * ContentDatabase::FindMaterial(const std::string &name) const
+{
+	MaterialMap::const_iterator iter = m_materials.find(name);
+	return iter != m_materials.end() ? &iter->second : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentShader * ContentDatabase::FindShader(const std::string &name) const
+{
+	ShaderMap::const_iterator iter = m_shaders.find(name);
+	return iter != m_shaders.end() ? &iter->second : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentVertexDecl * ContentDatabase::FindVertexDecl(const std::string &name) const
+{
+	VertexDeclMap::const_iterator iter = m_vertexDecls.find(name);
+	return iter != m_vertexDecls.end() ? &iter->second : NULL;
+}
+
+#ifdef _WIN32
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentDatabase::Walk(const std::string &directory)
+{
+	std::string pattern = FullPath(directory) + "*";
+
+	WIN32_FIND_DATA findData;
+	HANDLE find = FindFirstFile(pattern.c_str(), &findData);
+	if(find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if(findData.cFileName[0] == '.')
+			continue;
+
+		std::string path = directory + findData.cFileName;
+		if(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			Walk(path + "/");
+		}
+		else
+		{
+			AddFile(path);
+		}
+	} while(FindNextFile(find, &findData));
+
+	FindClose(find);
+}
+
+#else
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentDatabase::Walk(const std::string &directory)
+{
+	DIR *dir = opendir(FullPath(directory).c_str());
+	if(dir == NULL)
+		return;
+
+	while(dirent *entry = readdir(dir))
+	{
+		if(entry->d_name[0] == '.')
+			continue;
+
+		std::string path = directory + entry->d_name;
+
+		struct stat info;
+		if(stat(FullPath(path).c_str(), &info) != 0)
+			continue;
+
+		if(S_ISDIR(info.st_mode))
+		{
+			Walk(path + "/");
+		}
+		else if(S_ISREG(info.st_mode))
+		{
+			AddFile(path);
+		}
+	}
+
+	closedir(dir);
+}
+
+#endif // _WIN32
+
+// ****************************************************************************
+// Cooked files aren't content
+// ****************************************************************************
+void ContentDatabase::AddFile(const std::string &path)
+{
+	if(EndsWith(path, ".hxmesh") || path == "cook.manifest")
+		return;
+
+	if(m_numFiles == m_fileCapacity)
+	{
+		unsigned int newCapacity = m_fileCapacity > 0 ? m_fileCapacity * 2 : MIN_FILE_CAPACITY;
+		ContentFileInfo *newFiles = new ContentFileInfo[newCapacity];
+		for(unsigned int i=0;i<m_numFiles;i++)
+		{
+			newFiles[i] = m_files[i];
+		}
+		delete [] m_files;
+		m_files = newFiles;
+		m_fileCapacity = newCapacity;
+	}
+
+	ContentFileInfo &file = m_files[m_numFiles];
+	file.path = path;
+	file.hash = 0;
+	file.readable = false;
+	m_fileMap[path] = m_numFiles++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentDatabase::AddDependency(const std::string &asset, const std::string &dependency)
+{
+	if(m_numDependencies == m_dependencyCapacity)
+	{
+		unsigned int newCapacity = m_dependencyCapacity > 0 ? m_dependencyCapacity * 2 : MIN_FILE_CAPACITY;
+		ContentDependency *newDependencies = new ContentDependency[newCapacity];
+		for(unsigned int i=0;i<m_numDependencies;i++)
+		{
+			newDependencies[i] = m_dependencies[i];
+		}
+		delete [] m_dependencies;
+		m_dependencies = newDependencies;
+		m_dependencyCapacity = newCapacity;
+	}
+
+	m_dependencies[m_numDependencies].asset = asset;
+	m_dependencies[m_numDependencies].dependency = dependency;
+	m_numDependencies++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentDatabase::Error(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	m_numErrors++;
+}
+
+// ****************************************************************************
+// Textures in brackets are render targets, which aren't files
+// ****************************************************************************
+void ContentDatabase::LoadMaterial(const std::string &path)
+{
+	ContentFile file;
+	if(!file.Load(FullPath(path).c_str()))
+	{
+		Error("%s(%u): can't read it without Lua\n", path.c_str(), file.ErrorLine());
+		return;
+	}
+
+	const ContentValue &materialObj = file.GetGlobal("Material");
+	if(!materialObj.IsTable() || !materialObj["Shader"].IsString())
+	{
+		Error("%s: no Material with a Shader\n", path.c_str());
+		return;
+	}
+
+	ContentMaterial &material = m_materials[AssetName(path)];
+	material.path = path;
+	material.shader = materialObj["Shader"].GetString();
+	AddDependency(path, "Shaders/" + material.shader + ".lua");
+
+	const ContentValue &textureObj = materialObj["Texture"];
+	if(textureObj.IsString() && textureObj.GetString().compare(0, 1, "[") != 0)
+	{
+		material.texture = textureObj.GetString();
+		AddDependency(path, "Textures/" + material.texture);
+	}
+}
+
+// ****************************************************************************
+// Shaders/ holds both shaders and the vertex declarations they use
+// ****************************************************************************
+void ContentDatabase::LoadShaderFile(const std::string &path)
+{
+	ContentFile file;
+	if(!file.Load(FullPath(path).c_str()))
+	{
+		Error("%s(%u): can't read it without Lua\n", path.c_str(), file.ErrorLine());
+		return;
+	}
+
+	const ContentValue &shaderObj = file.GetGlobal("Shader");
+	if(shaderObj.IsTable())
+	{
+		if(!shaderObj["Declaration"].IsString() || !shaderObj["HLSL"].IsString())
+		{
+			Error("%s: Shader needs a Declaration and HLSL\n", path.c_str());
+			return;
+		}
+
+		ContentShader &shader = m_shaders[AssetName(path)];
+		shader.path = path;
+		shader.declaration = shaderObj["Declaration"].GetString();
+		shader.hlsl = shaderObj["HLSL"].GetString();
+		AddDependency(path, "Shaders/" + shader.declaration + ".lua");
+		AddDependency(path, "Shaders/" + shader.hlsl);
+
+		if(shaderObj["InstancedDeclaration"].IsString())
+		{
+			shader.instancedDeclaration = shaderObj["InstancedDeclaration"].GetString();
+			AddDependency(path, "Shaders/" + shader.instancedDeclaration + ".lua");
+		}
+		return;
+	}
+
+	const ContentValue &declObj = file.GetGlobal("VertexDeclaration");
+	if(!declObj.IsTable())
+		return;
+
+	ContentVertexDecl decl;
+	decl.path = path;
+	memset(&decl.layout, 0, sizeof(decl.layout));
+	decl.packable = true;
+
+	bool havePosition = false;
+	bool haveNormal = false;
+	bool haveUV = false;
+	for(int elementIndex=1;elementIndex <= static_cast<int>(declObj.GetTableCount()); elementIndex++)
+	{
+		const ContentValue &elementObj = declObj[elementIndex];
+		const ContentValue &semanticObj = elementObj[1];
+		const ContentValue &formatObj = elementObj[3];
+		const ContentValue &offsetObj = elementObj[5];
+		const ContentValue &classObj = elementObj[6];
+		if(!semanticObj.IsString() || !formatObj.IsString() || !offsetObj.IsInteger() || !classObj.IsString())
+		{
+			Error("%s: vertex declaration element %d is malformed\n", path.c_str(), elementIndex);
+			return;
+		}
+
+		const DeclFormat *format = FindDeclFormat(formatObj.GetString());
+		if(format == NULL)
+		{
+			Error("%s: unknown format %s\n", path.c_str(), formatObj.GetString().c_str());
+			return;
+		}
+
+		// The per vertex stream is as big as the end of its last element
+		unsigned int offset = static_cast<unsigned int>(offsetObj.GetInteger());
+		if(classObj.GetString() != "D3D11_INPUT_PER_INSTANCE_DATA" && offset + format->size > decl.layout.vertexSize)
+		{
+			decl.layout.vertexSize = offset + format->size;
+		}
+
+		// The first element with a semantic is the one meshes pack to
+		VertexFormat *vertexFormat = NULL;
+		unsigned int *vertexOffset = NULL;
+		if(!havePosition && SameSemantic(semanticObj.GetString(), "POSITION"))
+		{
+			havePosition = true;
+			vertexFormat = &decl.layout.positionFormat;
+			vertexOffset = &decl.layout.positionOffset;
+		}
+		else if(!haveNormal && SameSemantic(semanticObj.GetString(), "NORMAL"))
+		{
+			haveNormal = true;
+			vertexFormat = &decl.layout.normalFormat;
+			vertexOffset = &decl.layout.normalOffset;
+		}
+		else if(!haveUV && SameSemantic(semanticObj.GetString(), "TEXCOORD"))
+		{
+			haveUV = true;
+			vertexFormat = &decl.layout.uvFormat;
+			vertexOffset = &decl.layout.uvOffset;
+		}
+
+		if(vertexFormat != NULL)
+		{
+			*vertexFormat = format->vertexFormat;
+			*vertexOffset = offset;
+			decl.packable = decl.packable && format->vertexFormat != VERTEX_FORMAT_NONE;
+		}
+	}
+
+	m_vertexDecls[AssetName(path)] = decl;
+}
+
+// ****************************************************************************
+// #include "file" is relative to the Shaders directory, as the runtime
+// compiles from there
+// ****************************************************************************
+void ContentDatabase::LoadHLSLIncludes(const std::string &path)
+{
+	MappedFile file;
+	if(!file.Open(FullPath(path).c_str()))
+		return;
+
+	const char *text = reinterpret_cast<const char *>(file.Data());
+	const char *end = text + file.Size();
+	const char DIRECTIVE[] = "#include";
+	const size_t DIRECTIVE_LENGTH = sizeof(DIRECTIVE) - 1;
+
+	for(const char *line = text; line < end; )
+	{
+		const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+		lineEnd = lineEnd != NULL ? lineEnd : end;
+
+		const char *pos = line;
+		while(pos < lineEnd && (*pos == ' ' || *pos == '\t'))
+		{
+			pos++;
+		}
+
+		if(static_cast<size_t>(lineEnd - pos) > DIRECTIVE_LENGTH && memcmp(pos, DIRECTIVE, DIRECTIVE_LENGTH) == 0)
+		{
+			const char *open = static_cast<const char *>(memchr(pos, '"', lineEnd - pos));
+			const char *close = open != NULL ? static_cast<const char *>(memchr(open + 1, '"', lineEnd - open - 1)) : NULL;
+			if(close != NULL)
+			{
+				AddDependency(path, "Shaders/" + std::string(open + 1, close - open - 1));
+			}
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+} // namespace Helix
@@ -0,0 +1,125 @@
+#ifndef CONTENTDATABASE_H
+#define CONTENTDATABASE_H
+
+#include "RenderCore/MeshQuantize.h"
+
+namespace Helix {
+
+// A file under the content root.  Paths are relative to it, with forward
+// slashes, which for everything but scenes is also where the runtime looks.
+struct ContentFileInfo
+{
+	std::string		path;
+	uint64_t		hash;			// 0 until hashed, or if it couldn't be read
+	bool			readable;
+};
+
+// A Shaders/<name>.lua VertexDeclaration, as far as packing meshes goes
+struct ContentVertexDecl
+{
+	std::string		path;
+	VertexLayout	layout;			// numUVSets is left 0; it's per mesh
+	bool			packable;		// Every attribute is in a format meshes pack to
+};
+
+// A Shaders/<name>.lua Shader
+struct ContentShader
+{
+	std::string		path;
+	std::string		declaration;
+	std::string		instancedDeclaration;
+	std::string		hlsl;
+};
+
+// A Materials/<name>.lua Material
+struct ContentMaterial
+{
+	std::string		path;
+	std::string		shader;
+	std::string		texture;		// Empty for render targets
+};
+
+// One edge of the asset graph, path to path
+struct ContentDependency
+{
+	std::string		asset;
+	std::string		dependency;
+};
+
+// ****************************************************************************
+// ContentDatabase
+//
+// Everything under the content root: every file with its content hash, and
+// the materials, shaders and vertex declarations parsed so cooking can work
+// out a mesh's vertex layout without Lua or D3D.  Loaded up front and only
+// read after, so cook jobs can share it across threads.
+// ****************************************************************************
+class ContentDatabase
+{
+public:
+	ContentDatabase();
+	~ContentDatabase();
+
+	// Walks root and parses the materials, shaders and declarations.  Fails
+	// only if root can't be read; broken assets are reported and left out.
+	bool	Load(const std::string &root);
+
+	// Hashes every file with lookup3, in parallel
+	void	HashFiles();
+
+	const std::string &		GetRoot() const		{ return m_root; }
+	std::string				FullPath(const std::string &path) const	{ return m_root + "/" + path; }
+
+	unsigned int				NumFiles() const					{ return m_numFiles; }
+	const ContentFileInfo &		GetFile(unsigned int index) const	{ return m_files[index]; }
+	const ContentFileInfo *		FindFile(const std::string &path) const;
+
+	const ContentMaterial *		FindMaterial(const std::string &name) const;
+	const ContentShader *		FindShader(const std::string &name) const;
+	const ContentVertexDecl *	FindVertexDecl(const std::string &name) const;
+
+	// Material -> shader -> declarations and HLSL, material -> texture and
+	// HLSL -> #includes, for every asset loaded
+	unsigned int				NumDependencies() const						{ return m_numDependencies; }
+	const ContentDependency &	GetDependency(unsigned int index) const		{ return m_dependencies[index]; }
+
+	// How many assets were broken or referred to missing files
+	unsigned int	NumErrors() const	{ return m_numErrors; }
+
+private:
+	ContentDatabase(const ContentDatabase &other);
+	ContentDatabase & operator=(const ContentDatabase &other);
+
+	void	Walk(const std::string &directory);
+	void	AddFile(const std::string &path);
+	void	AddDependency(const std::string &asset, const std::string &dependency);
+	void	LoadMaterial(const std::string &path);
+	void	LoadShaderFile(const std::string &path);
+	void	LoadHLSLIncludes(const std::string &path);
+	void	Error(const char *format, ...);
+
+	typedef std::map<std::string, unsigned int> FileMap;
+	typedef std::map<std::string, ContentMaterial> MaterialMap;
+	typedef std::map<std::string, ContentShader> ShaderMap;
+	typedef std::map<std::string, ContentVertexDecl> VertexDeclMap;
+
+	std::string				m_root;
+
+	ContentFileInfo *		m_files;
+	unsigned int			m_numFiles;
+	unsigned int			m_fileCapacity;
+	FileMap					m_fileMap;
+
+	MaterialMap				m_materials;
+	ShaderMap				m_shaders;
+	VertexDeclMap			m_vertexDecls;
+
+	ContentDependency *		m_dependencies;
+	unsigned int			m_numDependencies;
+	unsigned int			m_dependencyCapacity;
+
+	unsigned int			m_numErrors;
+};
+
+} // namespace Helix
+#endif // CONTENTDATABASE_H
@@ -0,0 +1,459 @@
+#include "ContentFile.h"
+#include "Utility/MappedFile.h"
+
+namespace Helix {
+
+const unsigned int	MIN_ITEM_CAPACITY = 8;
+const size_t		MAX_NUMBER_LENGTH = 64;
+
+const ContentValue	m_nilValue;
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsNameStart(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentValue::ContentValue()
+: m_type(TYPE_NIL)
+, m_boolean(false)
+, m_number(0.0)
+, m_items(NULL)
+, m_numItems(0)
+, m_itemCapacity(0)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentValue::~ContentValue()
+{
+	Clear();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ContentValue::Clear()
+{
+	for(unsigned int i=0;i<m_numItems;i++)
+	{
+		delete m_items[i];
+	}
+	delete [] m_items;
+
+	for(FieldMap::iterator iter = m_fields.begin(); iter != m_fields.end(); ++iter)
+	{
+		delete iter->second;
+	}
+	m_fields.clear();
+
+	m_type = TYPE_NIL;
+	m_boolean = false;
+	m_number = 0.0;
+	m_string.clear();
+	m_items = NULL;
+	m_numItems = 0;
+	m_itemCapacity = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentValue & ContentValue::operator[](int index) const
+{
+	if(index < 1 || static_cast<unsigned int>(index) > m_numItems)
+		return m_nilValue;
+
+	return *m_items[index - 1];
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const ContentValue & ContentValue::operator[](const char *name) const
+{
+	FieldMap::const_iterator iter = m_fields.find(name);
+	if(iter == m_fields.end())
+		return m_nilValue;
+
+	return *iter->second;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentValue & ContentValue::AddItem()
+{
+	if(m_numItems == m_itemCapacity)
+	{
+		unsigned int newCapacity = m_itemCapacity > 0 ? m_itemCapacity * 2 : MIN_ITEM_CAPACITY;
+		ContentValue **newItems = new ContentValue *[newCapacity];
+		if(m_items != NULL)
+		{
+			memcpy(newItems, m_items, m_numItems * sizeof(ContentValue *));
+			delete [] m_items;
+		}
+		m_items = newItems;
+		m_itemCapacity = newCapacity;
+	}
+
+	ContentValue *item = new ContentValue;
+	m_items[m_numItems++] = item;
+	return *item;
+}
+
+// ****************************************************************************
+// Assigning the same name twice keeps the last, as Lua would
+// ****************************************************************************
+ContentValue & ContentValue::AddField(const std::string &name)
+{
+	ContentValue *&field = m_fields[name];
+	if(field == NULL)
+	{
+		field = new ContentValue;
+	}
+	else
+	{
+		field->Clear();
+	}
+	return *field;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentFile::ContentFile()
+: m_text(NULL)
+, m_pos(NULL)
+, m_end(NULL)
+, m_failed(false)
+, m_errorLine(0)
+{
+	m_globals.m_type = ContentValue::TYPE_TABLE;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ContentFile::~ContentFile()
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::Load(const char *filename)
+{
+	MappedFile file;
+	if(!file.Open(filename))
+	{
+		m_globals.Clear();
+		m_globals.m_type = ContentValue::TYPE_TABLE;
+		m_errorLine = 0;
+		return false;
+	}
+
+	return Parse(reinterpret_cast<const char *>(file.Data()), file.Size());
+}
+
+// ****************************************************************************
+// A chunk of Name = value statements
+// ****************************************************************************
+bool ContentFile::Parse(const char *text, size_t size)
+{
+	m_globals.Clear();
+	m_globals.m_type = ContentValue::TYPE_TABLE;
+
+	m_text = text;
+	m_pos = text;
+	m_end = text + size;
+	m_failed = false;
+	m_errorLine = 0;
+
+	for(;;)
+	{
+		Accept(';');
+		SkipWhitespace();
+		if(m_pos >= m_end)
+			break;
+
+		std::string name;
+		if(!ParseName(name) || !Expect('=') || !ParseValue(m_globals.AddField(name)))
+			break;
+	}
+
+	if(m_failed)
+	{
+		m_globals.Clear();
+		m_globals.m_type = ContentValue::TYPE_TABLE;
+		return false;
+	}
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::Fail()
+{
+	if(!m_failed)
+	{
+		m_failed = true;
+		m_errorLine = 1;
+		for(const char *c = m_text; c < m_pos && c < m_end; c++)
+		{
+			if(*c == '\n')
+				m_errorLine++;
+		}
+	}
+	return false;
+}
+
+// ****************************************************************************
+// Whitespace, -- line comments and --[[ ]] block comments
+// ****************************************************************************
+void ContentFile::SkipWhitespace()
+{
+	while(m_pos < m_end)
+	{
+		char c = *m_pos;
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			m_pos++;
+			continue;
+		}
+
+		if(c != '-' || m_end - m_pos < 2 || m_pos[1] != '-')
+			return;
+
+		m_pos += 2;
+		if(m_end - m_pos >= 2 && m_pos[0] == '[' && m_pos[1] == '[')
+		{
+			const char *close = m_pos + 2;
+			while(close + 1 < m_end && (close[0] != ']' || close[1] != ']'))
+			{
+				close++;
+			}
+			m_pos = close + 1 < m_end ? close + 2 : m_end;
+		}
+		else
+		{
+			while(m_pos < m_end && *m_pos != '\n')
+			{
+				m_pos++;
+			}
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::Accept(char c)
+{
+	SkipWhitespace();
+	if(m_pos < m_end && *m_pos == c)
+	{
+		m_pos++;
+		return true;
+	}
+	return false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::Expect(char c)
+{
+	return Accept(c) || Fail();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::ParseName(std::string &name)
+{
+	SkipWhitespace();
+	if(m_pos >= m_end || !IsNameStart(*m_pos))
+		return Fail();
+
+	const char *start = m_pos;
+	while(m_pos < m_end && (IsNameStart(*m_pos) || IsDigit(*m_pos)))
+	{
+		m_pos++;
+	}
+	name.assign(start, m_pos - start);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::ParseValue(ContentValue &value)
+{
+	SkipWhitespace();
+	if(m_pos >= m_end)
+		return Fail();
+
+	char c = *m_pos;
+	if(c == '{')
+	{
+		return ParseTable(value);
+	}
+
+	if(c == '"' || c == '\'')
+	{
+		value.m_type = ContentValue::TYPE_STRING;
+		return ParseString(value.m_string);
+	}
+
+	if(c == '-' || c == '.' || IsDigit(c))
+	{
+		value.m_type = ContentValue::TYPE_NUMBER;
+		return ParseNumber(value.m_number);
+	}
+
+	std::string name;
+	if(!ParseName(name))
+		return false;
+
+	if(name == "true" || name == "false")
+	{
+		value.m_type = ContentValue::TYPE_BOOLEAN;
+		value.m_boolean = name == "true";
+		return true;
+	}
+
+	return name == "nil" || Fail();
+}
+
+// ****************************************************************************
+// Positional, Name = value and [n] = value fields.  [n] has to be the next
+// position; content is written in order.
+// ****************************************************************************
+bool ContentFile::ParseTable(ContentValue &table)
+{
+	if(!Expect('{'))
+		return false;
+
+	table.m_type = ContentValue::TYPE_TABLE;
+	while(!Accept('}'))
+	{
+		if(m_pos >= m_end)
+			return Fail();
+
+		if(*m_pos == '[')
+		{
+			m_pos++;
+
+			double index;
+			if(!ParseNumber(index) || !Expect(']') || !Expect('='))
+				return false;
+
+			if(index != static_cast<double>(table.m_numItems + 1))
+				return Fail();
+
+			if(!ParseValue(table.AddItem()))
+				return false;
+		}
+		else if(IsNameStart(*m_pos))
+		{
+			const char *start = m_pos;
+
+			std::string name;
+			ParseName(name);
+			SkipWhitespace();
+			if(m_pos < m_end && *m_pos == '=' && (m_pos + 1 >= m_end || m_pos[1] != '='))
+			{
+				m_pos++;
+				if(!ParseValue(table.AddField(name)))
+					return false;
+			}
+			else
+			{
+				// A positional true, false or nil
+				m_pos = start;
+				if(!ParseValue(table.AddItem()))
+					return false;
+			}
+		}
+		else if(!ParseValue(table.AddItem()))
+		{
+			return false;
+		}
+
+		if(!Accept(',') && !Accept(';'))
+		{
+			if(!Expect('}'))
+				return false;
+			break;
+		}
+	}
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::ParseString(std::string &value)
+{
+	char quote = *m_pos++;
+	value.clear();
+	while(m_pos < m_end && *m_pos != quote)
+	{
+		char c = *m_pos++;
+		if(c == '\n')
+			return Fail();
+
+		if(c == '\\')
+		{
+			if(m_pos >= m_end)
+				return Fail();
+
+			c = *m_pos++;
+			switch(c)
+			{
+			case 'n':	c = '\n'; break;
+			case 't':	c = '\t'; break;
+			case 'r':	c = '\r'; break;
+			case '\\':
+			case '"':
+			case '\'':
+				break;
+			default:
+				return Fail();
+			}
+		}
+		value += c;
+	}
+
+	if(m_pos >= m_end)
+		return Fail();
+
+	m_pos++;
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ContentFile::ParseNumber(double &value)
+{
+	SkipWhitespace();
+	const char *start = m_pos;
+	while(m_pos < m_end && (IsDigit(*m_pos) || *m_pos == '-' || *m_pos == '+' || *m_pos == '.' || *m_pos == 'e' || *m_pos == 'E'))
+	{
+		m_pos++;
+	}
+
+	size_t length = m_pos - start;
+	if(length == 0 || length >= MAX_NUMBER_LENGTH)
+		return Fail();
+
+	char number[MAX_NUMBER_LENGTH];
+	memcpy(number, start, length);
+	number[length] = 0;
+
+	char *numberEnd;
+	value = strtod(number, &numberEnd);
+	return numberEnd == number + length || Fail();
+}
+
+} // namespace Helix
@@ -0,0 +1,115 @@
+#ifndef CONTENTFILE_H
+#define CONTENTFILE_H
+
+namespace Helix {
+
+// ****************************************************************************
+// ContentValue
+//
+// One value out of a content file, looked up the way LuaPlus::LuaObject is
+// in the runtime: tables index by name or from 1, and anything missing is
+// nil rather than an error.
+// ****************************************************************************
+class ContentValue
+{
+public:
+	enum Type
+	{
+		TYPE_NIL,
+		TYPE_BOOLEAN,
+		TYPE_NUMBER,
+		TYPE_STRING,
+		TYPE_TABLE,
+	};
+
+	ContentValue();
+	~ContentValue();
+
+	Type	GetType() const		{ return m_type; }
+	bool	IsNil() const		{ return m_type == TYPE_NIL; }
+	bool	IsBoolean() const	{ return m_type == TYPE_BOOLEAN; }
+	bool	IsNumber() const	{ return m_type == TYPE_NUMBER; }
+	bool	IsInteger() const	{ return m_type == TYPE_NUMBER && m_number == static_cast<double>(static_cast<int>(m_number)); }
+	bool	IsString() const	{ return m_type == TYPE_STRING; }
+	bool	IsTable() const		{ return m_type == TYPE_TABLE; }
+
+	bool				GetBoolean() const	{ return m_boolean; }
+	double				GetNumber() const	{ return m_number; }
+	int					GetInteger() const	{ return static_cast<int>(m_number); }
+	const std::string &	GetString() const	{ return m_string; }
+
+	// Positional entries, [1] to [GetTableCount()]
+	unsigned int			GetTableCount() const	{ return m_numItems; }
+	const ContentValue &	operator[](int index) const;
+	const ContentValue &	operator[](const char *name) const;
+
+private:
+	friend class ContentFile;
+
+	ContentValue(const ContentValue &other);
+	ContentValue & operator=(const ContentValue &other);
+
+	void	Clear();
+	ContentValue &	AddItem();
+	ContentValue &	AddField(const std::string &name);
+
+	typedef std::map<std::string, ContentValue *> FieldMap;
+
+	Type				m_type;
+	bool				m_boolean;
+	double				m_number;
+	std::string			m_string;
+	ContentValue **		m_items;
+	unsigned int		m_numItems;
+	unsigned int		m_itemCapacity;
+	FieldMap			m_fields;
+};
+
+// ****************************************************************************
+// ContentFile
+//
+// The materials, shaders and vertex declarations under Content/ are Lua files
+// that only assign table constructors to globals.  Tools that can't run Lua
+// read them with this instead, which understands that much: assignments,
+// tables, strings, numbers, booleans, nil and comments.  Anything else fails
+// the load.
+// ****************************************************************************
+class ContentFile
+{
+public:
+	ContentFile();
+	~ContentFile();
+
+	bool	Load(const char *filename);
+	bool	Parse(const char *text, size_t size);
+
+	// nil if the file doesn't set it
+	const ContentValue &	GetGlobal(const char *name) const	{ return m_globals[name]; }
+
+	// Where the last load gave up, 0 if the file couldn't be read
+	unsigned int	ErrorLine() const	{ return m_errorLine; }
+
+private:
+	ContentFile(const ContentFile &other);
+	ContentFile & operator=(const ContentFile &other);
+
+	bool	Fail();
+	void	SkipWhitespace();
+	bool	Accept(char c);
+	bool	Expect(char c);
+	bool	ParseName(std::string &name);
+	bool	ParseValue(ContentValue &value);
+	bool	ParseTable(ContentValue &table);
+	bool	ParseString(std::string &value);
+	bool	ParseNumber(double &value);
+
+	const char *	m_text;
+	const char *	m_pos;
+	const char *	m_end;
+	bool			m_failed;
+	unsigned int	m_errorLine;
+	ContentValue	m_globals;
+};
+
+} // namespace Helix
+#endif // CONTENTFILE_H
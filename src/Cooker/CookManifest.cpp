@@ -0,0 +1,178 @@
+#include "CookManifest.h"
+#include "ContentDatabase.h"
+#include "RenderCore/MeshFile.h"
+#include "Utility/MappedFile.h"
+
+namespace Helix {
+
+// Bump whenever what's recorded for a cook changes
+const unsigned int	COOK_MANIFEST_VERSION = 1;
+const char			COOK_MANIFEST_MAGIC[] = "HXCOOK";
+
+// ****************************************************************************
+// Splits a line at its tabs.  Returns how many fields there were, storing up
+// to maxFields of them.
+// ****************************************************************************
+inline unsigned int SplitFields(const char *line, const char *lineEnd, std::string *fields, unsigned int maxFields)
+{
+	unsigned int numFields = 0;
+	for(;;)
+	{
+		const char *tab = static_cast<const char *>(memchr(line, '\t', lineEnd - line));
+		const char *fieldEnd = tab != NULL ? tab : lineEnd;
+		if(numFields < maxFields)
+		{
+			fields[numFields].assign(line, fieldEnd - line);
+		}
+		numFields++;
+
+		if(tab == NULL)
+			return numFields;
+		line = tab + 1;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+CookManifest::CookManifest()
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+CookManifest::~CookManifest()
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool CookManifest::Load(const char *filename)
+{
+	m_records.clear();
+
+	MappedFile file;
+	if(!file.Open(filename))
+		return false;
+
+	const char *text = reinterpret_cast<const char *>(file.Data());
+	const char *end = text + file.Size();
+
+	const unsigned int MAX_FIELDS = 256;
+	std::string *fields = new std::string[MAX_FIELDS];
+
+	bool versionChecked = false;
+	for(const char *line = text; line < end; )
+	{
+		const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+		lineEnd = lineEnd != NULL ? lineEnd : end;
+
+		const char *next = lineEnd + 1;
+		if(lineEnd > line && lineEnd[-1] == '\r')
+		{
+			lineEnd--;
+		}
+
+		unsigned int numFields = SplitFields(line, lineEnd, fields, MAX_FIELDS);
+		line = next;
+
+		if(!versionChecked)
+		{
+			versionChecked = true;
+			if(numFields != 3 || fields[0] != COOK_MANIFEST_MAGIC ||
+				strtoul(fields[1].c_str(), NULL, 10) != COOK_MANIFEST_VERSION ||
+				strtoul(fields[2].c_str(), NULL, 10) != MESH_FILE_VERSION)
+			{
+				break;
+			}
+			continue;
+		}
+
+		// Input and hash pairs after the output
+		if(fields[0] != "cook" || numFields < 2 || numFields > MAX_FIELDS || (numFields & 1) != 0)
+			continue;
+
+		CookRecord &record = m_records[fields[1]];
+		record.output = fields[1];
+		for(unsigned int field=2;field < numFields; field += 2)
+		{
+			record.inputs[fields[field]] = strtoull(fields[field + 1].c_str(), NULL, 16);
+		}
+	}
+
+	delete [] fields;
+	return !m_records.empty();
+}
+
+// ****************************************************************************
+// Outputs not cooked this run keep what they had, so nothing is forgotten
+// just because it was up to date
+// ****************************************************************************
+bool CookManifest::Write(const char *filename, const ContentDatabase &database) const
+{
+	FILE *file = fopen(filename, "wb");
+	if(file == NULL)
+		return false;
+
+	fprintf(file, "%s\t%u\t%u\n", COOK_MANIFEST_MAGIC, COOK_MANIFEST_VERSION, MESH_FILE_VERSION);
+
+	for(unsigned int index=0;index < database.NumFiles(); index++)
+	{
+		const ContentFileInfo &info = database.GetFile(index);
+		fprintf(file, "file\t%016llx\t%s\n", static_cast<unsigned long long>(info.hash), info.path.c_str());
+	}
+
+	for(unsigned int index=0;index < database.NumDependencies(); index++)
+	{
+		const ContentDependency &dep = database.GetDependency(index);
+		fprintf(file, "dep\t%s\t%s\n", dep.asset.c_str(), dep.dependency.c_str());
+	}
+
+	for(RecordMap::const_iterator iter = m_records.begin(); iter != m_records.end(); ++iter)
+	{
+		const CookRecord &record = iter->second;
+		fprintf(file, "cook\t%s", record.output.c_str());
+		for(CookRecord::InputMap::const_iterator input = record.inputs.begin(); input != record.inputs.end(); ++input)
+		{
+			fprintf(file, "\t%s\t%016llx", input->first.c_str(), static_cast<unsigned long long>(input->second));
+		}
+		fprintf(file, "\n");
+	}
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const CookRecord * CookManifest::FindRecord(const std::string &output) const
+{
+	RecordMap::const_iterator iter = m_records.find(output);
+	return iter != m_records.end() ? &iter->second : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CookManifest::SetRecord(const CookRecord &record)
+{
+	m_records[record.output] = record;
+}
+
+// ****************************************************************************
+// An input that's gone, or unreadable, never matches
+// ****************************************************************************
+bool CookManifest::IsCurrent(const CookRecord &record, const ContentDatabase &database)
+{
+	if(record.inputs.empty())
+		return false;
+
+	for(CookRecord::InputMap::const_iterator input = record.inputs.begin(); input != record.inputs.end(); ++input)
+	{
+		const ContentFileInfo *info = database.FindFile(input->first);
+		if(info == NULL || !info->readable || info->hash != input->second)
+			return false;
+	}
+	return true;
+}
+
+} // namespace Helix
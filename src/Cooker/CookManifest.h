@@ -0,0 +1,59 @@
+#ifndef COOKMANIFEST_H
+#define COOKMANIFEST_H
+
+namespace Helix {
+
+class ContentDatabase;
+
+// What one output was cooked from: every file that went into it, by path
+// relative to the content root, with its hash at the time
+struct CookRecord
+{
+	typedef std::map<std::string, uint64_t> InputMap;
+
+	std::string		output;
+	InputMap		inputs;
+};
+
+// ****************************************************************************
+// CookManifest
+//
+// <output>/cook.manifest, kept between runs so a rerun only cooks outputs
+// whose inputs have changed.  It's a text file of tab separated lines:
+//
+//   HXCOOK <manifest version> <MESH_FILE_VERSION>
+//   file <hash> <path>                     every content file
+//   dep <asset> <dependency>               the content graph
+//   cook <output> <input> <hash> ...       what each output was made from
+//
+// Only the cook lines are read back.  The rest are there for whatever
+// else wants to know what the content refers to.
+// ****************************************************************************
+class CookManifest
+{
+public:
+	CookManifest();
+	~CookManifest();
+
+	// Fails, leaving it empty, if there's no manifest or it was written by
+	// a cooker making different files
+	bool	Load(const char *filename);
+	bool	Write(const char *filename, const ContentDatabase &database) const;
+
+	const CookRecord *	FindRecord(const std::string &output) const;
+	void				SetRecord(const CookRecord &record);
+
+	// True if record's inputs all still hash the same
+	static bool	IsCurrent(const CookRecord &record, const ContentDatabase &database);
+
+private:
+	CookManifest(const CookManifest &other);
+	CookManifest & operator=(const CookManifest &other);
+
+	typedef std::map<std::string, CookRecord> RecordMap;
+
+	RecordMap	m_records;
+};
+
+} // namespace Helix
+#endif // COOKMANIFEST_H
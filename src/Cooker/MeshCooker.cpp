@@ -0,0 +1,177 @@
+#include "MeshCooker.h"
+#include "ContentDatabase.h"
+#include "CookManifest.h"
+#include "RenderCore/MeshBuild.h"
+#include "RenderCore/MeshFile.h"
+#include "RenderCore/MeshListParser.h"
+#include "Utility/MappedFile.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+inline void AppendLog(std::string &log, const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	log += buffer;
+}
+
+// ****************************************************************************
+// Records path with its hash, as long as there's something to hash
+// ****************************************************************************
+inline bool AddInput(const ContentDatabase &database, const std::string &path, CookRecord &record)
+{
+	const ContentFileInfo *info = database.FindFile(path);
+	if(info == NULL || !info->readable)
+		return false;
+
+	record.inputs[path] = info->hash;
+	return true;
+}
+
+// ****************************************************************************
+// Material -> shader -> vertex declaration, recording each as an input
+// ****************************************************************************
+inline const ContentVertexDecl * MeshVertexDecl(const ContentDatabase &database, const MeshSource &source, const ContentShader *&shader, CookRecord &record, std::string &log)
+{
+	const ContentMaterial *material = database.FindMaterial(source.material);
+	if(material == NULL || !AddInput(database, material->path, record))
+	{
+		AppendLog(log, "Mesh %s: no material %s\n", source.name.c_str(), source.material.c_str());
+		return NULL;
+	}
+
+	shader = database.FindShader(material->shader);
+	if(shader == NULL || !AddInput(database, shader->path, record))
+	{
+		AppendLog(log, "Mesh %s: no shader %s\n", source.name.c_str(), material->shader.c_str());
+		return NULL;
+	}
+
+	const ContentVertexDecl *decl = database.FindVertexDecl(shader->declaration);
+	if(decl == NULL || !AddInput(database, decl->path, record))
+	{
+		AppendLog(log, "Mesh %s: no vertex declaration %s\n", source.name.c_str(), shader->declaration.c_str());
+		return NULL;
+	}
+
+	if(!decl->packable || decl->layout.positionFormat == VERTEX_FORMAT_NONE)
+	{
+		AppendLog(log, "Mesh %s: meshes can't be packed into vertex declaration %s\n", source.name.c_str(), shader->declaration.c_str());
+		return NULL;
+	}
+
+	return decl;
+}
+
+// ****************************************************************************
+// What Mesh::CreatePlatformData() writes when it builds from source
+// ****************************************************************************
+inline bool CookMesh(const ContentDatabase &database, const MeshSource &source, MeshFileWriter &writer, CookRecord &record, std::string &log)
+{
+	const ContentShader *shader = NULL;
+	const ContentVertexDecl *decl = MeshVertexDecl(database, source, shader, record, log);
+	if(decl == NULL)
+		return false;
+
+	if(source.numLods == 0 || source.numLods > MESH_FILE_MAX_LODS)
+	{
+		AppendLog(log, "Mesh %s: can't have that many LODs\n", source.name.c_str());
+		return false;
+	}
+
+	// The mesh itself is error 0
+	float previousError = 0.0f;
+	for(unsigned int lodIndex=1;lodIndex < source.numLods; lodIndex++)
+	{
+		if(source.lods[lodIndex].error < previousError)
+		{
+			AppendLog(log, "Mesh %s: LODs have to get coarser\n", source.name.c_str());
+			return false;
+		}
+		previousError = source.lods[lodIndex].error;
+	}
+
+	const MeshSourceLod &meshLod = source.lods[0];
+	float boundsMin[3];
+	float boundsMax[3];
+	MeshSourceBounds(meshLod, boundsMin, boundsMax);
+
+	writer.BeginMesh(source.name.c_str(), source.material.c_str(), shader->declaration.c_str(), decl->layout.vertexSize, boundsMin, boundsMax);
+
+	if(source.occluder)
+	{
+		unsigned int numCorners = meshLod.numTriangles * 3;
+		unsigned int cornerSize = MeshSourceCornerSize(meshLod);
+		uint32_t *indices = new uint32_t[numCorners];
+		for(unsigned int cornerIndex=0;cornerIndex < numCorners; cornerIndex++)
+		{
+			indices[cornerIndex] = meshLod.corners[cornerIndex * cornerSize];
+		}
+
+		writer.SetOccluder(meshLod.positions, meshLod.numPositions, indices, meshLod.numTriangles);
+		delete [] indices;
+	}
+
+	VertexQuantizeError error = { 0.0f, 0.0f, 0.0f };
+	unsigned int numVertices = 0;
+	for(unsigned int lodIndex=0;lodIndex < source.numLods; lodIndex++)
+	{
+		const MeshSourceLod &lodSource = source.lods[lodIndex];
+
+		VertexLayout layout = decl->layout;
+		layout.numUVSets = layout.uvFormat != VERTEX_FORMAT_NONE ? lodSource.numUVSets : 0;
+
+		MeshBuildLod built;
+		BuildMeshLod(lodSource, layout, boundsMin, boundsMax, built, error);
+		writer.AddLod(lodIndex > 0 ? lodSource.error : 0.0f, built.vertices, built.numVertices, built.indices, built.numIndices, built.indices32 ? 4 : 2);
+		numVertices += built.numVertices;
+		ReleaseMeshBuildLod(built);
+	}
+
+	writer.EndMesh();
+
+	AppendLog(log, "Mesh %s: %u LODs, %u vertices of %u bytes, worst error %g units position, %.3f degrees normal, %.3f texels UV at 1024\n", source.name.c_str(), source.numLods, numVertices, decl->layout.vertexSize, error.position, error.normalDegrees, error.uvTexels);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool CookMeshList(const ContentDatabase &database, const std::string &sourcePath, const std::string &outputPath, CookRecord &record, std::string &log)
+{
+	record.inputs.clear();
+	if(!AddInput(database, sourcePath, record))
+	{
+		AppendLog(log, "%s: can't read it\n", sourcePath.c_str());
+		return false;
+	}
+
+	MappedFile file;
+	MeshListParser parser;
+	if(!file.Open(database.FullPath(sourcePath).c_str()) || !parser.Parse(reinterpret_cast<const char *>(file.Data()), file.Size()))
+	{
+		AppendLog(log, "%s(%u): not a MeshList the cooker understands\n", sourcePath.c_str(), parser.ErrorLine());
+		return false;
+	}
+
+	MeshFileWriter writer;
+	for(unsigned int meshIndex=0;meshIndex < parser.NumMeshes(); meshIndex++)
+	{
+		if(!CookMesh(database, parser.GetMesh(meshIndex), writer, record, log))
+			return false;
+	}
+
+	if(writer.NumMeshes() == 0 || !writer.Write(outputPath.c_str()))
+	{
+		AppendLog(log, "%s: couldn't write %s\n", sourcePath.c_str(), outputPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace Helix
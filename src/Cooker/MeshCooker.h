@@ -0,0 +1,22 @@
+#ifndef MESHCOOKER_H
+#define MESHCOOKER_H
+
+namespace Helix {
+
+class ContentDatabase;
+struct CookRecord;
+
+// ****************************************************************************
+// Cooks the MeshList at sourcePath, relative to the content root, into the
+// .hxmesh file at outputPath, through the same MeshBuild the runtime uses
+// when it has no cooked file, so both give the same bytes.  Each mesh's
+// vertex layout comes from its material's shader's declaration.
+//
+// record gets every file that went into the output, and log what there is
+// to say about it; cook jobs run in parallel, so they print once they're all
+// done.  Fails without writing anything if any mesh can't be built.
+// ****************************************************************************
+bool	CookMeshList(const ContentDatabase &database, const std::string &sourcePath, const std::string &outputPath, CookRecord &record, std::string &log);
+
+} // namespace Helix
+#endif // MESHCOOKER_H
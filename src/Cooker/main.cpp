@@ -0,0 +1,280 @@
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+#include "ContentDatabase.h"
+#include "CookManifest.h"
+#include "MeshCooker.h"
+#include "Kernel/JobSystem.h"
+#include "Utility/MappedFile.h"
+
+using namespace Helix;
+
+const char	MANIFEST_NAME[] = "cook.manifest";
+
+// One .lua MeshList to one .hxmesh, paths relative to the content and
+// output directories
+struct CookJob
+{
+	std::string		source;
+	std::string		output;
+	CookRecord		record;
+	std::string		log;
+	bool			cooked;
+	bool			failed;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool EndsWith(const std::string &str, const char *suffix)
+{
+	size_t length = strlen(suffix);
+	return str.size() >= length && str.compare(str.size() - length, length, suffix) == 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void MakeDirectory(const std::string &path)
+{
+#ifdef _WIN32
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0777);
+#endif
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void TouchFile(const std::string &path)
+{
+#ifdef _WIN32
+	_utime(path.c_str(), NULL);
+#else
+	utime(path.c_str(), NULL);
+#endif
+}
+
+// ****************************************************************************
+// Where the runtime looks for what's cooked from path, or empty if it isn't
+// a MeshList.  Meshes/<name>.lua is loaded from Meshes/<name>.hxmesh.  A
+// scene's .lua lives in a directory of its own in Content/, Scenes/<name>/,
+// but is copied up to Scenes/ for the runtime, so that's where it looks.
+// ****************************************************************************
+inline std::string CookedPath(const std::string &path)
+{
+	if(!EndsWith(path, ".lua"))
+		return std::string();
+
+	std::string base = path.substr(0, path.size() - 4);
+	size_t slash = base.find('/');
+	if(slash == std::string::npos)
+		return std::string();
+
+	std::string directory = base.substr(0, slash + 1);
+	std::string rest = base.substr(slash + 1);
+	if(directory == "Meshes/" && rest.find('/') == std::string::npos)
+		return base + ".hxmesh";
+
+	if(directory == "Scenes/")
+	{
+		size_t nameSlash = rest.find('/');
+		if(nameSlash == std::string::npos)
+			return base + ".hxmesh";
+
+		// Scenes/<name>/<name>.lua
+		if(rest.find('/', nameSlash + 1) == std::string::npos && rest.compare(0, nameSlash, rest, nameSlash + 1, std::string::npos) == 0)
+			return directory + rest.substr(nameSlash + 1) + ".hxmesh";
+	}
+
+	return std::string();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+struct CookJobData
+{
+	const ContentDatabase *		database;
+	const std::string *			outputDir;
+	CookJob **					jobs;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+void CookJobRange(void *data, unsigned int begin, unsigned int end)
+{
+	CookJobData &jobData = *static_cast<CookJobData *>(data);
+	for(unsigned int index=begin;index < end; index++)
+	{
+		CookJob &job = *jobData.jobs[index];
+		job.record.output = job.output;
+
+		std::string outputPath = *jobData.outputDir + "/" + job.output;
+		job.cooked = CookMeshList(*jobData.database, job.source, outputPath, job.record, job.log);
+		job.failed = !job.cooked;
+	}
+}
+
+// ****************************************************************************
+// The runtime uses a cooked file as long as it's at least as new as the .lua
+// next to it, which the build copies over from Content/.  Something cooked
+// from the same bytes as that .lua is good however old it is, so bring it
+// forward rather than have the runtime ignore it.
+// ****************************************************************************
+inline void KeepCookedFresh(const std::string &outputDir, const CookJob &job)
+{
+	std::string cookedPath = outputDir + "/" + job.output;
+	std::string luaPath = cookedPath.substr(0, cookedPath.size() - 7) + ".lua";
+
+	uint64_t luaTime = FileWriteTime(luaPath.c_str());
+	uint64_t cookedTime = FileWriteTime(cookedPath.c_str());
+	if(cookedTime != 0 && cookedTime < luaTime)
+	{
+		TouchFile(cookedPath);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	std::string contentDir;
+	std::string outputDir;
+	int numThreads = 0;
+	bool force = false;
+
+	for(int arg=1;arg < argc; arg++)
+	{
+		if(strcmp(argv[arg], "-f") == 0)
+		{
+			force = true;
+		}
+		else if(strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+		{
+			numThreads = atoi(argv[++arg]);
+		}
+		else if(argv[arg][0] != '-' && contentDir.empty())
+		{
+			contentDir = argv[arg];
+		}
+		else if(argv[arg][0] != '-' && outputDir.empty())
+		{
+			outputDir = argv[arg];
+		}
+		else
+		{
+			contentDir.clear();
+			break;
+		}
+	}
+
+	if(contentDir.empty())
+	{
+		fprintf(stderr, "Usage: Cooker <contentDir> [<outputDir>] [-j <threads>] [-f]\n");
+		fprintf(stderr, "Cooks meshes and scenes into .hxmesh files under outputDir, which\n");
+		fprintf(stderr, "defaults to contentDir.  Only what changed since the last run is cooked\n");
+		fprintf(stderr, "again, unless -f.  -j sets the threads, default all of them.\n");
+		return 2;
+	}
+
+	ContentDatabase database;
+	if(!database.Load(contentDir))
+	{
+		fprintf(stderr, "Can't read %s\n", contentDir.c_str());
+		return 1;
+	}
+
+	if(outputDir.empty())
+	{
+		outputDir = database.GetRoot();
+	}
+
+	// The main thread works too
+	InitializeJobSystem(numThreads > 0 ? numThreads - 1 : -1);
+	database.HashFiles();
+
+	std::string manifestPath = outputDir + "/" + MANIFEST_NAME;
+	CookManifest manifest;
+	if(!force)
+	{
+		manifest.Load(manifestPath.c_str());
+	}
+
+	// Everything that cooks, and of that what's out of date
+	unsigned int numJobs = 0;
+	CookJob *jobs = new CookJob[database.NumFiles()];
+	CookJob **pending = new CookJob *[database.NumFiles()];
+	unsigned int numPending = 0;
+	for(unsigned int index=0;index < database.NumFiles(); index++)
+	{
+		const std::string &path = database.GetFile(index).path;
+		std::string output = CookedPath(path);
+		if(output.empty())
+			continue;
+
+		CookJob &job = jobs[numJobs++];
+		job.source = path;
+		job.output = output;
+		job.cooked = false;
+		job.failed = false;
+
+		std::string outputPath = outputDir + "/" + output;
+		const CookRecord *record = manifest.FindRecord(output);
+		if(record != NULL && CookManifest::IsCurrent(*record, database) && FileWriteTime(outputPath.c_str()) != 0)
+		{
+			job.record = *record;
+			continue;
+		}
+
+		pending[numPending++] = &job;
+	}
+
+	MakeDirectory(outputDir);
+	MakeDirectory(outputDir + "/Meshes");
+	MakeDirectory(outputDir + "/Scenes");
+
+	CookJobData jobData = { &database, &outputDir, pending };
+	ParallelFor(numPending, 1, CookJobRange, &jobData);
+
+	unsigned int numCooked = 0;
+	unsigned int numFailed = 0;
+	for(unsigned int index=0;index < numJobs; index++)
+	{
+		CookJob &job = jobs[index];
+		if(!job.log.empty())
+		{
+			fprintf(job.failed ? stderr : stdout, "%s", job.log.c_str());
+		}
+
+		if(job.failed)
+		{
+			numFailed++;
+			continue;
+		}
+
+		if(job.cooked)
+		{
+			printf("Cooked %s -> %s\n", job.source.c_str(), job.output.c_str());
+			numCooked++;
+		}
+
+		manifest.SetRecord(job.record);
+		KeepCookedFresh(outputDir, job);
+	}
+
+	if(!manifest.Write(manifestPath.c_str(), database))
+	{
+		fprintf(stderr, "Couldn't write %s\n", manifestPath.c_str());
+		numFailed++;
+	}
+
+	printf("%u cooked, %u up to date, %u failed, %u content errors, %u files\n", numCooked, numJobs - numCooked - numFailed, numFailed, database.NumErrors(), database.NumFiles());
+
+	delete [] pending;
+	delete [] jobs;
+	ShutdownJobSystem();
+
+	return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+// Win32 builds get the Interlocked functions from windows.h, through the PCH
+#ifndef _WIN32
+#include <xmmintrin.h>
+#endif
+
+namespace Helix {
+
+// ****************************************************************************
+// The few atomics the engine's lock free handoffs need, on Win32 and on
+// anything GCC compatible.  Every read-modify-write is a full barrier, as the
+// Interlocked functions are, so AtomicExchange() can publish or take a record
+// without a separate fence.
+// ****************************************************************************
+
+#ifdef _WIN32
+
+#define HX_THREAD_LOCAL		__declspec(thread)
+
+inline long	AtomicIncrement(volatile long *value)						{ return InterlockedIncrement(value); }
+inline long	AtomicDecrement(volatile long *value)						{ return InterlockedDecrement(value); }
+inline long	AtomicExchange(volatile long *value, long exchange)			{ return InterlockedExchange(value, exchange); }
+inline long	AtomicCompareExchange(volatile long *value, long exchange, long comparand)	{ return InterlockedCompareExchange(value, exchange, comparand); }
+inline void	AtomicStore(volatile long *value, long store)				{ InterlockedExchange(value, store); }
+inline void	AtomicFence()												{ MemoryBarrier(); }
+inline void	SpinPause()													{ YieldProcessor(); }
+
+#else
+
+#define HX_THREAD_LOCAL		__thread
+
+inline long	AtomicIncrement(volatile long *value)						{ return __sync_add_and_fetch(value, 1); }
+inline long	AtomicDecrement(volatile long *value)						{ return __sync_sub_and_fetch(value, 1); }
+inline long	AtomicExchange(volatile long *value, long exchange)			{ long previous = __sync_lock_test_and_set(value, exchange); __sync_synchronize(); return previous; }
+inline long	AtomicCompareExchange(volatile long *value, long exchange, long comparand)	{ return __sync_val_compare_and_swap(value, comparand, exchange); }
+inline void	AtomicStore(volatile long *value, long store)				{ AtomicExchange(value, store); }
+inline void	AtomicFence()												{ __sync_synchronize(); }
+inline void	SpinPause()													{ _mm_pause(); }
+
+#endif // _WIN32
+
+} // namespace Helix
+
+#endif // ATOMIC_H
@@ -0,0 +1,357 @@
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#endif
+#include "JobSystem.h"
+#include "Atomic.h"
+#include "Utility/Profiler.h"
+
+namespace Helix {
+
+const unsigned int	JOB_STACK_SIZE = 64*1024;
+const int			MAX_JOB_WORKERS = 31;
+
+// The ParallelFor currently being run
+struct JobBatches
+{
+	JobRangeFn		fn;
+	void *			data;
+	unsigned int	count;
+	unsigned int	batchSize;
+	unsigned int	numBatches;
+	volatile long	nextBatch;
+};
+
+#ifdef _WIN32
+typedef HANDLE			JobThread;
+typedef HANDLE			JobSemaphore;
+#else
+typedef pthread_t		JobThread;
+typedef sem_t			JobSemaphore;
+#endif
+
+bool						m_jobSystemInitialized = false;
+volatile bool				m_jobSystemShutdown = false;
+int							m_numJobWorkers = 0;
+JobThread					m_jobWorkers[MAX_JOB_WORKERS];
+JobSemaphore				m_jobStart;					// One count per worker wanted
+JobSemaphore				m_jobDone;					// Posted by the last worker to finish
+volatile long				m_jobOwned = 0;				// Someone is inside ParallelFor
+volatile long				m_jobWorkersOut = 0;		// Workers woken that haven't finished
+JobBatches					m_jobBatches;
+HX_THREAD_LOCAL bool		m_inJob = false;
+
+void	RunJobWorker();
+
+#ifdef _WIN32
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int __stdcall JobWorkerFunc(void *data)
+{
+	RunJobWorker();
+	return 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int NumProcessors()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return static_cast<int>(info.dwNumberOfProcessors);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CreateJobSemaphores()
+{
+	m_jobStart = CreateSemaphore(NULL, 0, MAX_JOB_WORKERS, NULL);
+	_ASSERT(m_jobStart != NULL);
+
+	m_jobDone = CreateSemaphore(NULL, 0, 1, NULL);
+	_ASSERT(m_jobDone != NULL);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void DestroyJobSemaphores()
+{
+	CloseHandle(m_jobStart);
+	CloseHandle(m_jobDone);
+	m_jobStart = NULL;
+	m_jobDone = NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void PostJobSemaphore(JobSemaphore &semaphore, int count)
+{
+	ReleaseSemaphore(semaphore, count, NULL);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void WaitJobSemaphore(JobSemaphore &semaphore)
+{
+	DWORD result = WaitForSingleObject(semaphore, INFINITE);
+	_ASSERT(result == WAIT_OBJECT_0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool StartJobWorker(JobThread &thread)
+{
+	thread = (HANDLE)_beginthreadex(NULL, JOB_STACK_SIZE, JobWorkerFunc, NULL, 0, NULL);
+	return thread != NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void JoinJobWorkers()
+{
+	DWORD result = WaitForMultipleObjects(m_numJobWorkers, m_jobWorkers, TRUE, INFINITE);
+	_ASSERT(result != WAIT_FAILED);
+
+	for(int i=0;i<m_numJobWorkers;i++)
+	{
+		CloseHandle(m_jobWorkers[i]);
+	}
+}
+
+#else
+
+// ****************************************************************************
+// ****************************************************************************
+void * JobWorkerFunc(void *data)
+{
+	RunJobWorker();
+	return NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int NumProcessors()
+{
+	long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+	return numProcessors > 0 ? static_cast<int>(numProcessors) : 1;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CreateJobSemaphores()
+{
+	int result = sem_init(&m_jobStart, 0, 0);
+	_ASSERT(result == 0);
+
+	result = sem_init(&m_jobDone, 0, 0);
+	_ASSERT(result == 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void DestroyJobSemaphores()
+{
+	sem_destroy(&m_jobStart);
+	sem_destroy(&m_jobDone);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void PostJobSemaphore(JobSemaphore &semaphore, int count)
+{
+	for(int i=0;i<count;i++)
+	{
+		sem_post(&semaphore);
+	}
+}
+
+// ****************************************************************************
+// Signals interrupt the wait, which isn't the semaphore being posted
+// ****************************************************************************
+void WaitJobSemaphore(JobSemaphore &semaphore)
+{
+	while(sem_wait(&semaphore) != 0)
+	{
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool StartJobWorker(JobThread &thread)
+{
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+	pthread_attr_setstacksize(&attributes, JOB_STACK_SIZE);
+
+	int result = pthread_create(&thread, &attributes, JobWorkerFunc, NULL);
+	pthread_attr_destroy(&attributes);
+	return result == 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void JoinJobWorkers()
+{
+	for(int i=0;i<m_numJobWorkers;i++)
+	{
+		pthread_join(m_jobWorkers[i], NULL);
+	}
+}
+
+#endif // _WIN32
+
+// ****************************************************************************
+// Batches are handed out first come first served, so a slow batch doesn't hold
+// up the rest.
+// ****************************************************************************
+void RunJobBatches()
+{
+	HX_PROFILE_SCOPE("Jobs");
+
+	JobBatches &job = m_jobBatches;
+	for(;;)
+	{
+		unsigned int batch = static_cast<unsigned int>(AtomicIncrement(&job.nextBatch) - 1);
+		if(batch >= job.numBatches)
+			break;
+
+		unsigned int begin = batch * job.batchSize;
+		unsigned int end = begin + job.batchSize;
+		if(end > job.count)
+			end = job.count;
+
+		job.fn(job.data, begin, end);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void InitializeJobSystem(int numWorkers)
+{
+	_ASSERT(m_jobSystemInitialized == false);
+	m_jobSystemInitialized = true;
+	m_jobSystemShutdown = false;
+
+	if(numWorkers < 0)
+	{
+		numWorkers = NumProcessors() - 1;
+	}
+	if(numWorkers > MAX_JOB_WORKERS)
+	{
+		numWorkers = MAX_JOB_WORKERS;
+	}
+
+	CreateJobSemaphores();
+
+	m_numJobWorkers = 0;
+	for(int i=0;i<numWorkers;i++)
+	{
+		bool started = StartJobWorker(m_jobWorkers[m_numJobWorkers]);
+		_ASSERT(started);
+		if(!started)
+			break;
+
+		m_numJobWorkers++;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ShutdownJobSystem()
+{
+	if(!m_jobSystemInitialized)
+		return;
+
+	_ASSERT(m_jobOwned == 0);
+	m_jobSystemShutdown = true;
+	if(m_numJobWorkers > 0)
+	{
+		PostJobSemaphore(m_jobStart, m_numJobWorkers);
+		JoinJobWorkers();
+	}
+
+	DestroyJobSemaphores();
+	m_numJobWorkers = 0;
+	m_jobSystemInitialized = false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int NumJobWorkers()
+{
+	return m_numJobWorkers;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ParallelFor(unsigned int count, unsigned int batchSize, JobRangeFn fn, void *data)
+{
+	if(count == 0)
+		return;
+
+	_ASSERT(batchSize > 0);
+	unsigned int numBatches = (count + batchSize - 1) / batchSize;
+
+	// Nothing to share, or the workers are busy with someone else
+	if(numBatches == 1 || m_numJobWorkers == 0 || m_inJob || AtomicCompareExchange(&m_jobOwned, 1, 0) != 0)
+	{
+		fn(data, 0, count);
+		return;
+	}
+
+	m_jobBatches.fn = fn;
+	m_jobBatches.data = data;
+	m_jobBatches.count = count;
+	m_jobBatches.batchSize = batchSize;
+	m_jobBatches.numBatches = numBatches;
+	m_jobBatches.nextBatch = 0;
+
+	// This thread takes batches too, so one fewer worker is needed
+	long wanted = static_cast<long>(numBatches - 1);
+	if(wanted > m_numJobWorkers)
+	{
+		wanted = m_numJobWorkers;
+	}
+
+	// Posting the semaphore is a full barrier, so the workers see the job
+	m_jobWorkersOut = wanted;
+	PostJobSemaphore(m_jobStart, static_cast<int>(wanted));
+
+	m_inJob = true;
+	RunJobBatches();
+	m_inJob = false;
+
+	// Every woken worker checks out, even one that wakes after the batches
+	// are gone, so the job can't be overwritten under it
+	WaitJobSemaphore(m_jobDone);
+
+	AtomicStore(&m_jobOwned, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RunJobWorker()
+{
+	HX_PROFILE_THREAD("Job worker");
+	m_inJob = true;
+	for(;;)
+	{
+		WaitJobSemaphore(m_jobStart);
+
+		if(m_jobSystemShutdown)
+			break;
+
+		RunJobBatches();
+
+		if(AtomicDecrement(&m_jobWorkersOut) == 0)
+		{
+			PostJobSemaphore(m_jobDone, 1);
+		}
+	}
+}
+
+} // namespace Helix
@@ -0,0 +1,23 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+namespace Helix {
+
+// Runs one batch, [begin, end), of a ParallelFor
+typedef void (*JobRangeFn)(void *data, unsigned int begin, unsigned int end);
+
+// Starts the worker threads.  numWorkers < 0 means one per core, less one for
+// the thread that calls ParallelFor().
+void	InitializeJobSystem(int numWorkers = -1);
+void	ShutdownJobSystem();
+int		NumJobWorkers();
+
+// Splits [0, count) into batches of batchSize and runs them on the workers and
+// the calling thread, returning once every batch is done.  Only one ParallelFor
+// owns the workers at a time; a second caller, or one from inside a job, runs
+// all of its batches itself.  Also runs inline before InitializeJobSystem().
+void	ParallelFor(unsigned int count, unsigned int batchSize, JobRangeFn fn, void *data);
+
+} // namespace Helix
+
+#endif // JOBSYSTEM_H
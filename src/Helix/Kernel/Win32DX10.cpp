@@ -4,6 +4,7 @@
 #include "RenderCore/RenderThread.h"
 #include "RenderCore/RenderMgr.h"
 #include "ThreadLoad/ThreadLoad.h"
+#include "Utility/Profiler.h"
 
 // ****************************************************************************
 // ****************************************************************************
@@ -237,6 +238,8 @@ int WinApp::Run(void)
 {
 	MSG msg;
 	ZeroMemory( &msg, sizeof(msg) );
+
+	HX_PROFILE_THREAD("Main");
 	
 	// Main message loop:
 	while( msg.message!=WM_QUIT )
@@ -248,8 +251,15 @@ int WinApp::Run(void)
 		}
 		else
 		{
-			Update();
-			Render();
+			HX_PROFILE_FRAME();
+			{
+				HX_PROFILE_SCOPE("Update");
+				Update();
+			}
+			{
+				HX_PROFILE_SCOPE("Render");
+				Render();
+			}
 		}
 	}
 
@@ -0,0 +1,168 @@
+#include <math.h>
+#include <float.h>
+#include "AABB.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+AABB::AABB()
+{
+	SetEmpty();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+AABB::AABB(const Vector3 &minPoint, const Vector3 &maxPoint)
+: minPt(minPoint)
+, maxPt(maxPoint)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABB::SetEmpty()
+{
+	minPt = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	maxPt = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool AABB::IsEmpty() const
+{
+	return minPt.x > maxPt.x || minPt.y > maxPt.y || minPt.z > maxPt.z;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABB::Add(const Vector3 &point)
+{
+	minPt.x = point.x < minPt.x ? point.x : minPt.x;
+	minPt.y = point.y < minPt.y ? point.y : minPt.y;
+	minPt.z = point.z < minPt.z ? point.z : minPt.z;
+
+	maxPt.x = point.x > maxPt.x ? point.x : maxPt.x;
+	maxPt.y = point.y > maxPt.y ? point.y : maxPt.y;
+	maxPt.z = point.z > maxPt.z ? point.z : maxPt.z;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABB::Add(const AABB &box)
+{
+	if(box.IsEmpty())
+		return;
+
+	Add(box.minPt);
+	Add(box.maxPt);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+Vector3 AABB::Center() const
+{
+	return Vector3(	(minPt.x + maxPt.x) * 0.5f,
+					(minPt.y + maxPt.y) * 0.5f,
+					(minPt.z + maxPt.z) * 0.5f);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+Vector3 AABB::Extents() const
+{
+	return Vector3(	(maxPt.x - minPt.x) * 0.5f,
+					(maxPt.y - minPt.y) * 0.5f,
+					(maxPt.z - minPt.z) * 0.5f);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool AABB::Contains(const AABB &box) const
+{
+	return	minPt.x <= box.minPt.x && minPt.y <= box.minPt.y && minPt.z <= box.minPt.z &&
+			maxPt.x >= box.maxPt.x && maxPt.y >= box.maxPt.y && maxPt.z >= box.maxPt.z;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool AABB::Overlaps(const AABB &box) const
+{
+	return	minPt.x <= box.maxPt.x && minPt.y <= box.maxPt.y && minPt.z <= box.maxPt.z &&
+			maxPt.x >= box.minPt.x && maxPt.y >= box.minPt.y && maxPt.z >= box.minPt.z;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+float AABB::SurfaceArea() const
+{
+	float dx = maxPt.x - minPt.x;
+	float dy = maxPt.y - minPt.y;
+	float dz = maxPt.z - minPt.z;
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool AABB::IntersectRay(const Vector3 &origin, const Vector3 &invDir, float maxDist, float &dist) const
+{
+	const float *o = &origin.x;
+	const float *inv = &invDir.x;
+	const float *lo = &minPt.x;
+	const float *hi = &maxPt.x;
+
+	float tNear = 0.0f;
+	float tFar = maxDist;
+	for(int axis=0;axis<3;axis++)
+	{
+		float t1 = (lo[axis] - o[axis]) * inv[axis];
+		float t2 = (hi[axis] - o[axis]) * inv[axis];
+		if(t1 > t2)
+		{
+			float tmp = t1;
+			t1 = t2;
+			t2 = tmp;
+		}
+
+		tNear = t1 > tNear ? t1 : tNear;
+		tFar = t2 < tFar ? t2 : tFar;
+		if(tNear > tFar)
+			return false;
+	}
+
+	dist = tNear;
+	return true;
+}
+
+// ****************************************************************************
+// Transforms the center and projects the extents onto the new axes.  The
+// result can be looser than the bounds of the transformed geometry, but never
+// tighter.
+// ****************************************************************************
+AABB AABB::Transform(const Matrix4x4 &mat) const
+{
+	if(IsEmpty())
+		return *this;
+
+	Vector3 center = Center();
+	Vector3 extents = Extents();
+
+	float c[3];
+	float e[3];
+	for(int row=0;row<3;row++)
+	{
+		c[row] =	mat.r[row][0] * center.x +
+					mat.r[row][1] * center.y +
+					mat.r[row][2] * center.z +
+					mat.r[row][3];
+
+		e[row] =	fabsf(mat.r[row][0]) * extents.x +
+					fabsf(mat.r[row][1]) * extents.y +
+					fabsf(mat.r[row][2]) * extents.z;
+	}
+
+	return AABB(Vector3(c[0] - e[0], c[1] - e[1], c[2] - e[2]),
+				Vector3(c[0] + e[0], c[1] + e[1], c[2] + e[2]));
+}
+
+} // namespace Helix
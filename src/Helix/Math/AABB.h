@@ -0,0 +1,41 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace Helix {
+
+// Axis aligned bounding box
+struct AABB
+{
+	AABB();
+	AABB(const Vector3 &minPt, const Vector3 &maxPt);
+
+	// An empty box has min > max, so adding the first point sets both
+	void		SetEmpty();
+	bool		IsEmpty() const;
+
+	void		Add(const Vector3 &point);
+	void		Add(const AABB &box);
+
+	Vector3		Center() const;
+	Vector3		Extents() const;		// Half size along each axis
+
+	// Box enclosing this box after it's been transformed by mat
+	AABB		Transform(const Matrix4x4 &mat) const;
+
+	bool		Contains(const AABB &box) const;
+	bool		Overlaps(const AABB &box) const;
+	float		SurfaceArea() const;
+
+	// Slab test.  invDir is 1/direction per component.  On a hit, dist is the
+	// distance along the ray where it enters the box (0 if it starts inside).
+	bool		IntersectRay(const Vector3 &origin, const Vector3 &invDir, float maxDist, float &dist) const;
+
+	Vector3		minPt;
+	Vector3		maxPt;
+};
+
+} // namespace Helix
+#endif // AABB_H
@@ -0,0 +1,823 @@
+#include <math.h>
+#include <float.h>
+#include <malloc.h>
+#include <string.h>
+#include "AABBTree.h"
+#include "Frustum.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+inline AABB Union(const AABB &a, const AABB &b)
+{
+	return AABB(Vector3(a.minPt.x < b.minPt.x ? a.minPt.x : b.minPt.x,
+						a.minPt.y < b.minPt.y ? a.minPt.y : b.minPt.y,
+						a.minPt.z < b.minPt.z ? a.minPt.z : b.minPt.z),
+				Vector3(a.maxPt.x > b.maxPt.x ? a.maxPt.x : b.maxPt.x,
+						a.maxPt.y > b.maxPt.y ? a.maxPt.y : b.maxPt.y,
+						a.maxPt.z > b.maxPt.z ? a.maxPt.z : b.maxPt.z));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline int MaxHeight(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+// ****************************************************************************
+// Traversal stack for the queries.  Balancing keeps the tree far shallower
+// than the part on the C stack, but a degenerate tree spills to the heap
+// rather than off the end.
+// ****************************************************************************
+template<typename T>
+class QueryStack
+{
+public:
+	QueryStack() : m_entries(m_fixed), m_capacity(FIXED_SIZE), m_top(0)	{}
+	~QueryStack()
+	{
+		if(m_entries != m_fixed)
+			delete [] m_entries;
+	}
+
+	bool	IsEmpty() const		{ return m_top == 0; }
+	T		Pop()				{ return m_entries[--m_top]; }
+
+	void Push(const T &entry)
+	{
+		if(m_top == m_capacity)
+		{
+			T *newEntries = new T[m_capacity * 2];
+			for(int i=0;i<m_top;i++)
+			{
+				newEntries[i] = m_entries[i];
+			}
+			if(m_entries != m_fixed)
+				delete [] m_entries;
+			m_entries = newEntries;
+			m_capacity *= 2;
+		}
+		m_entries[m_top++] = entry;
+	}
+
+private:
+	QueryStack(const QueryStack &) {}
+	QueryStack & operator=(const QueryStack &) { return *this; }
+
+	enum { FIXED_SIZE = 256 };
+
+	T		m_fixed[FIXED_SIZE];
+	T *		m_entries;
+	int		m_capacity;
+	int		m_top;
+};
+
+// A node still to visit, with the planes its box may straddle
+struct FrustumStackEntry
+{
+	int				node;
+	unsigned int	mask;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+AABBTree::AABBTree(float fatMargin)
+: m_nodes(NULL)
+, m_root(NULL_NODE)
+, m_nodeCapacity(0)
+, m_freeList(NULL_NODE)
+, m_numProxies(0)
+, m_fatMargin(fatMargin)
+, m_flatNodes(NULL)
+, m_numFlatNodes(0)
+, m_flatNodeCapacity(0)
+, m_flatBounds(NULL)
+, m_flatUserData(NULL)
+, m_numFlatLeaves(0)
+, m_flatLeafCapacity(0)
+, m_flatDirty(false)
+{
+	_ASSERT(fatMargin >= 0.0f);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+AABBTree::~AABBTree()
+{
+	delete [] m_nodes;
+	delete [] m_flatNodes;
+	delete [] m_flatUserData;
+	if(m_flatBounds != NULL)
+		_aligned_free(m_flatBounds);
+}
+
+// ****************************************************************************
+// Pops a node off the free list, doubling the pool when it runs dry
+// ****************************************************************************
+int AABBTree::AllocateNode()
+{
+	if(m_freeList == NULL_NODE)
+	{
+		int newCapacity = m_nodeCapacity > 0 ? m_nodeCapacity * 2 : 64;
+		Node *newNodes = new Node[newCapacity];
+		for(int i=0;i<m_nodeCapacity;i++)
+		{
+			newNodes[i] = m_nodes[i];
+		}
+
+		// Chain the new nodes onto the free list
+		for(int i=m_nodeCapacity;i<newCapacity;i++)
+		{
+			newNodes[i].parent = i + 1 < newCapacity ? i + 1 : NULL_NODE;
+			newNodes[i].height = -1;
+		}
+
+		delete [] m_nodes;
+		m_nodes = newNodes;
+		m_freeList = m_nodeCapacity;
+		m_nodeCapacity = newCapacity;
+	}
+
+	int node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+
+	Node &n = m_nodes[node];
+	n.userData = NULL;
+	n.parent = NULL_NODE;
+	n.child1 = NULL_NODE;
+	n.child2 = NULL_NODE;
+	n.height = 0;
+	return node;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABBTree::FreeNode(int node)
+{
+	_ASSERT(node >= 0 && node < m_nodeCapacity);
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int AABBTree::CreateProxy(const AABB &box, void *userData)
+{
+	int proxy = AllocateNode();
+
+	Node &n = m_nodes[proxy];
+	n.box = AABB(	Vector3(box.minPt.x - m_fatMargin, box.minPt.y - m_fatMargin, box.minPt.z - m_fatMargin),
+					Vector3(box.maxPt.x + m_fatMargin, box.maxPt.y + m_fatMargin, box.maxPt.z + m_fatMargin));
+	n.userData = userData;
+
+	InsertLeaf(proxy);
+	m_numProxies++;
+	return proxy;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABBTree::DestroyProxy(int proxy)
+{
+	_ASSERT(proxy >= 0 && proxy < m_nodeCapacity);
+	_ASSERT(m_nodes[proxy].IsLeaf() && m_nodes[proxy].height == 0);
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	m_numProxies--;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool AABBTree::MoveProxy(int proxy, const AABB &box)
+{
+	_ASSERT(proxy >= 0 && proxy < m_nodeCapacity);
+	_ASSERT(m_nodes[proxy].IsLeaf() && m_nodes[proxy].height == 0);
+
+	if(m_nodes[proxy].box.Contains(box))
+		return false;
+
+	RemoveLeaf(proxy);
+	m_nodes[proxy].box = AABB(	Vector3(box.minPt.x - m_fatMargin, box.minPt.y - m_fatMargin, box.minPt.z - m_fatMargin),
+								Vector3(box.maxPt.x + m_fatMargin, box.maxPt.y + m_fatMargin, box.maxPt.z + m_fatMargin));
+	InsertLeaf(proxy);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void * AABBTree::GetUserData(int proxy) const
+{
+	_ASSERT(proxy >= 0 && proxy < m_nodeCapacity);
+	return m_nodes[proxy].userData;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+const AABB & AABBTree::GetFatAABB(int proxy) const
+{
+	_ASSERT(proxy >= 0 && proxy < m_nodeCapacity);
+	return m_nodes[proxy].box;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int AABBTree::GetHeight() const
+{
+	return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+}
+
+// ****************************************************************************
+// Walks down from the root taking whichever side grows the total surface
+// area least, stops where pairing with the current node is cheaper than going
+// further, and splices in a new parent there.
+// ****************************************************************************
+void AABBTree::InsertLeaf(int leaf)
+{
+	m_flatDirty = true;
+
+	if(m_root == NULL_NODE)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	const AABB leafBox = m_nodes[leaf].box;
+	int index = m_root;
+	while(!m_nodes[index].IsLeaf())
+	{
+		const Node &node = m_nodes[index];
+		int child1 = node.child1;
+		int child2 = node.child2;
+
+		float area = node.box.SurfaceArea();
+		float combinedArea = Union(node.box, leafBox).SurfaceArea();
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float cost1 = Union(leafBox, m_nodes[child1].box).SurfaceArea() + inheritanceCost;
+		if(!m_nodes[child1].IsLeaf())
+			cost1 -= m_nodes[child1].box.SurfaceArea();
+
+		float cost2 = Union(leafBox, m_nodes[child2].box).SurfaceArea() + inheritanceCost;
+		if(!m_nodes[child2].IsLeaf())
+			cost2 -= m_nodes[child2].box.SurfaceArea();
+
+		if(cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? child1 : child2;
+	}
+
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = AllocateNode();
+
+	Node &parent = m_nodes[newParent];
+	parent.parent = oldParent;
+	parent.box = Union(leafBox, m_nodes[sibling].box);
+	parent.height = m_nodes[sibling].height + 1;
+	parent.child1 = sibling;
+	parent.child2 = leaf;
+
+	if(oldParent != NULL_NODE)
+	{
+		if(m_nodes[oldParent].child1 == sibling)
+			m_nodes[oldParent].child1 = newParent;
+		else
+			m_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	Refit(m_nodes[leaf].parent);
+}
+
+// ****************************************************************************
+// Replaces the leaf's parent with its sibling
+// ****************************************************************************
+void AABBTree::RemoveLeaf(int leaf)
+{
+	m_flatDirty = true;
+
+	if(leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if(grandParent != NULL_NODE)
+	{
+		if(m_nodes[grandParent].child1 == parent)
+			m_nodes[grandParent].child1 = sibling;
+		else
+			m_nodes[grandParent].child2 = sibling;
+
+		m_nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		Refit(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	}
+}
+
+// ****************************************************************************
+// Rebalances and recomputes boxes and heights from node up to the root
+// ****************************************************************************
+void AABBTree::Refit(int node)
+{
+	int index = node;
+	while(index != NULL_NODE)
+	{
+		index = Balance(index);
+
+		Node &n = m_nodes[index];
+		n.height = 1 + MaxHeight(m_nodes[n.child1].height, m_nodes[n.child2].height);
+		n.box = Union(m_nodes[n.child1].box, m_nodes[n.child2].box);
+
+		index = n.parent;
+	}
+}
+
+// ****************************************************************************
+// If one child of A is more than one level taller than the other, rotates it
+// up to take A's place.  Returns the index of whatever is now at A's place.
+// Written as parent(child1, child2), rotating C up when it is the taller:
+//
+//	A(B, C(F, G))  ->  C(A(B, G), F)	if F is the taller of F and G
+//	A(B, C(F, G))  ->  C(A(B, F), G)	otherwise
+//
+// and the same with B and its children D and E when B is the taller.
+// ****************************************************************************
+int AABBTree::Balance(int iA)
+{
+	Node &A = m_nodes[iA];
+	if(A.IsLeaf() || A.height < 2)
+		return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	Node &B = m_nodes[iB];
+	Node &C = m_nodes[iC];
+
+	int balance = C.height - B.height;
+
+	// Rotate C up
+	if(balance > 1)
+	{
+		int iF = C.child1;
+		int iG = C.child2;
+		Node &F = m_nodes[iF];
+		Node &G = m_nodes[iG];
+
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if(C.parent != NULL_NODE)
+		{
+			if(m_nodes[C.parent].child1 == iA)
+				m_nodes[C.parent].child1 = iC;
+			else
+				m_nodes[C.parent].child2 = iC;
+		}
+		else
+		{
+			m_root = iC;
+		}
+
+		// Keep the taller of F and G up with C
+		if(F.height > G.height)
+		{
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.box = Union(B.box, G.box);
+			C.box = Union(A.box, F.box);
+			A.height = 1 + MaxHeight(B.height, G.height);
+			C.height = 1 + MaxHeight(A.height, F.height);
+		}
+		else
+		{
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.box = Union(B.box, F.box);
+			C.box = Union(A.box, G.box);
+			A.height = 1 + MaxHeight(B.height, F.height);
+			C.height = 1 + MaxHeight(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if(balance < -1)
+	{
+		int iD = B.child1;
+		int iE = B.child2;
+		Node &D = m_nodes[iD];
+		Node &E = m_nodes[iE];
+
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if(B.parent != NULL_NODE)
+		{
+			if(m_nodes[B.parent].child1 == iA)
+				m_nodes[B.parent].child1 = iB;
+			else
+				m_nodes[B.parent].child2 = iB;
+		}
+		else
+		{
+			m_root = iB;
+		}
+
+		if(D.height > E.height)
+		{
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.box = Union(C.box, E.box);
+			B.box = Union(A.box, D.box);
+			A.height = 1 + MaxHeight(C.height, E.height);
+			B.height = 1 + MaxHeight(A.height, D.height);
+		}
+		else
+		{
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.box = Union(C.box, D.box);
+			B.box = Union(A.box, E.box);
+			A.height = 1 + MaxHeight(C.height, D.height);
+			B.height = 1 + MaxHeight(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+// ****************************************************************************
+// Makes sure the flat copy has room for the whole tree.  Each internal node
+// gives at most one flat node, or a lone leaf gives one, and the leaf arrays
+// are padded out to FrustumCull()'s width.
+// ****************************************************************************
+void AABBTree::ReserveFlat()
+{
+	int nodeCapacity = m_numProxies > 0 ? static_cast<int>(m_numProxies) : 1;
+	if(nodeCapacity > m_flatNodeCapacity)
+	{
+		delete [] m_flatNodes;
+		m_flatNodeCapacity = nodeCapacity > m_flatNodeCapacity * 2 ? nodeCapacity : m_flatNodeCapacity * 2;
+		m_flatNodes = new FlatNode[m_flatNodeCapacity];
+	}
+
+	unsigned int leafCapacity = (m_numProxies + FRUSTUM_CULL_WIDTH - 1) & ~(FRUSTUM_CULL_WIDTH - 1);
+	if(leafCapacity > m_flatLeafCapacity)
+	{
+		delete [] m_flatUserData;
+		if(m_flatBounds != NULL)
+			_aligned_free(m_flatBounds);
+
+		m_flatLeafCapacity = leafCapacity > m_flatLeafCapacity * 2 ? leafCapacity : m_flatLeafCapacity * 2;
+		m_flatBounds = reinterpret_cast<float *>(_aligned_malloc(6 * m_flatLeafCapacity * sizeof(float), FRUSTUM_CULL_ALIGN));
+		m_flatUserData = new void *[m_flatLeafCapacity];
+	}
+}
+
+// ****************************************************************************
+// Copies the tree out depth first.  The padding after the last leaf is
+// zeroed, since FrustumCull() reads it.
+// ****************************************************************************
+void AABBTree::Flatten()
+{
+	if(!m_flatDirty)
+		return;
+
+	ReserveFlat();
+	m_numFlatNodes = 0;
+	m_numFlatLeaves = 0;
+	if(m_root != NULL_NODE)
+		FlattenNode(m_root);
+	_ASSERT(m_numFlatLeaves == m_numProxies);
+
+	unsigned int paddedLeaves = (m_numFlatLeaves + FRUSTUM_CULL_WIDTH - 1) & ~(FRUSTUM_CULL_WIDTH - 1);
+	for(unsigned int i=0;i<6 && paddedLeaves > m_numFlatLeaves;i++)
+	{
+		float *component = m_flatBounds + i * m_flatLeafCapacity;
+		memset(component + m_numFlatLeaves, 0, (paddedLeaves - m_numFlatLeaves) * sizeof(float));
+	}
+
+	m_flatDirty = false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABBTree::FlattenNode(int node)
+{
+	const Node &n = m_nodes[node];
+	int index = m_numFlatNodes++;
+	unsigned int firstLeaf = m_numFlatLeaves;
+
+	if(n.height <= FLAT_RANGE_HEIGHT)
+	{
+		FlattenLeaves(node);
+	}
+	else
+	{
+		FlattenNode(n.child1);
+		FlattenNode(n.child2);
+	}
+
+	FlatNode &flat = m_flatNodes[index];
+	flat.box = n.box;
+	flat.end = m_numFlatNodes;
+	flat.firstLeaf = firstLeaf;
+	flat.numLeaves = m_numFlatLeaves - firstLeaf;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AABBTree::FlattenLeaves(int node)
+{
+	const Node &n = m_nodes[node];
+	if(!n.IsLeaf())
+	{
+		FlattenLeaves(n.child1);
+		FlattenLeaves(n.child2);
+		return;
+	}
+
+	unsigned int leaf = m_numFlatLeaves++;
+	Vector3 center = n.box.Center();
+	Vector3 extents = n.box.Extents();
+	float *bounds = m_flatBounds + leaf;
+	bounds[0] = center.x;
+	bounds[m_flatLeafCapacity] = center.y;
+	bounds[2 * m_flatLeafCapacity] = center.z;
+	bounds[3 * m_flatLeafCapacity] = extents.x;
+	bounds[4 * m_flatLeafCapacity] = extents.y;
+	bounds[5 * m_flatLeafCapacity] = extents.z;
+	m_flatUserData[leaf] = n.userData;
+}
+
+// ****************************************************************************
+// Only the planes the range straddles are tested.  FrustumCull() wants its
+// arrays aligned, so the range is widened down to a multiple of its width
+// and anything found before the range is dropped.
+// ****************************************************************************
+unsigned int AABBTree::CullFlatLeaves(const Frustum &frustum, const FlatNode &node, unsigned int planeMask, void **results) const
+{
+	unsigned int start = node.firstLeaf & ~(FRUSTUM_CULL_WIDTH - 1);
+
+	BoundsStream bounds;
+	bounds.centerX = m_flatBounds + start;
+	bounds.centerY = m_flatBounds + m_flatLeafCapacity + start;
+	bounds.centerZ = m_flatBounds + 2 * m_flatLeafCapacity + start;
+	bounds.extentX = m_flatBounds + 3 * m_flatLeafCapacity + start;
+	bounds.extentY = m_flatBounds + 4 * m_flatLeafCapacity + start;
+	bounds.extentZ = m_flatBounds + 5 * m_flatLeafCapacity + start;
+	bounds.count = node.firstLeaf + node.numLeaves - start;
+
+	uint32_t visible[(1 << FLAT_RANGE_HEIGHT) + 2 * FRUSTUM_CULL_WIDTH];
+	unsigned int numVisible = FrustumCull(frustum, bounds, visible, planeMask);
+
+	unsigned int numResults = 0;
+	for(unsigned int i=0;i<numVisible;i++)
+	{
+		unsigned int leaf = start + visible[i];
+		if(leaf >= node.firstLeaf)
+			results[numResults++] = m_flatUserData[leaf];
+	}
+
+	return numResults;
+}
+
+// ****************************************************************************
+// Each stack entry carries the planes its box may still straddle.  A subtree
+// inside all of them has its leaves copied out without another test, and a
+// range that straddles goes to the SIMD culler whole, against just the planes
+// it straddles.
+// ****************************************************************************
+unsigned int AABBTree::QueryFrustum(const Frustum &frustum, void **results) const
+{
+	if(m_flatDirty)
+		return QueryFrustumNodes(frustum, results);
+
+	if(m_numFlatNodes == 0)
+		return 0;
+
+	QueryStack<FrustumStackEntry> stack;
+	FrustumStackEntry root = { 0, Frustum::ALL_PLANES };
+	stack.Push(root);
+
+	unsigned int numResults = 0;
+	while(!stack.IsEmpty())
+	{
+		FrustumStackEntry entry = stack.Pop();
+
+		// Go down first children, leaving the second ones for later
+		int index = entry.node;
+		unsigned int mask = entry.mask;
+		for(;;)
+		{
+			const FlatNode &node = m_flatNodes[index];
+			if(frustum.ClassifyAABB(node.box, mask) == Frustum::OUTSIDE)
+				break;
+
+			if(mask == 0)
+			{
+				memcpy(results + numResults, m_flatUserData + node.firstLeaf, node.numLeaves * sizeof(void *));
+				numResults += node.numLeaves;
+				break;
+			}
+
+			if(node.end == index + 1)
+			{
+				numResults += CullFlatLeaves(frustum, node, mask, results + numResults);
+				break;
+			}
+
+			FrustumStackEntry second = { m_flatNodes[index + 1].end, mask };
+			stack.Push(second);
+			index++;
+		}
+	}
+
+	return numResults;
+}
+
+// ****************************************************************************
+// The same query on the tree itself, for when the flat copy is stale
+// ****************************************************************************
+unsigned int AABBTree::QueryFrustumNodes(const Frustum &frustum, void **results) const
+{
+	if(m_root == NULL_NODE)
+		return 0;
+
+	QueryStack<FrustumStackEntry> stack;
+	FrustumStackEntry root = { m_root, Frustum::ALL_PLANES };
+	stack.Push(root);
+
+	unsigned int numResults = 0;
+	while(!stack.IsEmpty())
+	{
+		FrustumStackEntry entry = stack.Pop();
+		const Node &node = m_nodes[entry.node];
+
+		if(entry.mask != 0)
+		{
+			if(frustum.ClassifyAABB(node.box, entry.mask) == Frustum::OUTSIDE)
+				continue;
+		}
+
+		if(node.IsLeaf())
+		{
+			results[numResults++] = node.userData;
+			continue;
+		}
+
+		FrustumStackEntry child1 = { node.child1, entry.mask };
+		FrustumStackEntry child2 = { node.child2, entry.mask };
+		stack.Push(child1);
+		stack.Push(child2);
+	}
+
+	return numResults;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int AABBTree::QueryAABB(const AABB &box, void **results, unsigned int maxResults, AABBTreeOverlapFn leafFn, void *leafData) const
+{
+	if(m_root == NULL_NODE)
+		return 0;
+
+	QueryStack<int> stack;
+	stack.Push(m_root);
+
+	unsigned int numResults = 0;
+	while(!stack.IsEmpty())
+	{
+		const Node &node = m_nodes[stack.Pop()];
+		if(!node.box.Overlaps(box))
+			continue;
+
+		if(node.IsLeaf())
+		{
+			if(leafFn != NULL && !leafFn(leafData, node.userData, box))
+				continue;
+
+			if(numResults < maxResults)
+				results[numResults] = node.userData;
+			numResults++;
+			continue;
+		}
+
+		stack.Push(node.child1);
+		stack.Push(node.child2);
+	}
+
+	return numResults;
+}
+
+// ****************************************************************************
+// Depth first, nearest child first, with the search distance shrinking to the
+// closest hit so far so far away subtrees get skipped.  An object is never hit
+// nearer than its fat box, so the fat boxes can prune against a hit on the
+// object's own bounds.
+// ****************************************************************************
+bool AABBTree::RayCast(const Vector3 &origin, const Vector3 &dir, float maxDist, void **hitUserData, float *hitDist, AABBTreeRayFn leafFn, void *leafData) const
+{
+	if(m_root == NULL_NODE)
+		return false;
+
+	Vector3 invDir(	dir.x != 0.0f ? 1.0f / dir.x : FLT_MAX,
+					dir.y != 0.0f ? 1.0f / dir.y : FLT_MAX,
+					dir.z != 0.0f ? 1.0f / dir.z : FLT_MAX);
+
+	QueryStack<int> stack;
+	stack.Push(m_root);
+
+	float bestDist = maxDist;
+	int bestLeaf = NULL_NODE;
+	while(!stack.IsEmpty())
+	{
+		const Node &node = m_nodes[stack.Pop()];
+
+		float dist;
+		if(!node.box.IntersectRay(origin, invDir, bestDist, dist))
+			continue;
+
+		if(node.IsLeaf())
+		{
+			if(leafFn != NULL && !leafFn(leafData, node.userData, origin, invDir, bestDist, dist))
+				continue;
+
+			if(bestLeaf == NULL_NODE || dist < bestDist)
+			{
+				bestDist = dist;
+				bestLeaf = static_cast<int>(&node - m_nodes);
+			}
+			continue;
+		}
+
+		float dist1 = FLT_MAX;
+		float dist2 = FLT_MAX;
+		bool hit1 = m_nodes[node.child1].box.IntersectRay(origin, invDir, bestDist, dist1);
+		bool hit2 = m_nodes[node.child2].box.IntersectRay(origin, invDir, bestDist, dist2);
+
+		// Push the far child first so the near one is searched first
+		if(hit1 && hit2)
+		{
+			stack.Push(dist1 < dist2 ? node.child2 : node.child1);
+			stack.Push(dist1 < dist2 ? node.child1 : node.child2);
+		}
+		else if(hit1)
+		{
+			stack.Push(node.child1);
+		}
+		else if(hit2)
+		{
+			stack.Push(node.child2);
+		}
+	}
+
+	if(bestLeaf == NULL_NODE)
+		return false;
+
+	if(hitUserData != NULL)
+		*hitUserData = m_nodes[bestLeaf].userData;
+	if(hitDist != NULL)
+		*hitDist = bestDist;
+	return true;
+}
+
+} // namespace Helix
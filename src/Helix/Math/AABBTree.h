@@ -0,0 +1,140 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include "AABB.h"
+
+namespace Helix {
+
+class Frustum;
+
+// Tests an object's own bounds once a query reaches its leaf, since the fat
+// box may reach up to the margin further.  data is whatever the caller passed
+// with the function, userData the proxy's.  The ray version returns the
+// distance along the ray the object is hit at.
+typedef bool (*AABBTreeOverlapFn)(void *data, void *userData, const AABB &box);
+typedef bool (*AABBTreeRayFn)(void *data, void *userData, const Vector3 &origin, const Vector3 &invDir, float maxDist, float &dist);
+
+// ****************************************************************************
+// AABBTree
+//
+// Dynamic bounding volume hierarchy.  Every object is a leaf (a proxy) with a
+// box fattened by a margin, so small moves don't touch the tree at all; a move
+// that leaves the fat box removes and reinserts the leaf.  Insertion picks the
+// sibling with the least surface area growth and the path back to the root is
+// rebalanced with AVL style rotations, so the height stays around 1.5 log2(n).
+//
+// Nodes live in one pool addressed by index, so proxies stay valid as the pool
+// grows.  Queries are const and keep their stack on the C stack unless the
+// tree gets unusually deep, so any number of threads can query at once as
+// long as nothing is modifying the tree.
+//
+// Frustum queries walk a flat copy of the tree instead, made by Flatten().
+// Its nodes are in depth first order with every subtree's leaves in one run
+// of SoA bounds, so a subtree entirely inside the frustum is taken as a range
+// of user data, and a small one that straddles is culled in one go by
+// FrustumCull().  Only changes to the tree itself make it stale; moves that
+// stay inside a proxy's fat box don't.
+// ****************************************************************************
+class AABBTree
+{
+public:
+	static const int	NULL_NODE = -1;
+
+	explicit AABBTree(float fatMargin = 0.1f);
+	~AABBTree();
+
+	// Returns a proxy id for the object
+	int				CreateProxy(const AABB &box, void *userData);
+	void			DestroyProxy(int proxy);
+
+	// Returns true if the leaf had to be reinserted
+	bool			MoveProxy(int proxy, const AABB &box);
+
+	void *			GetUserData(int proxy) const;
+	const AABB &	GetFatAABB(int proxy) const;
+	unsigned int	NumProxies() const		{ return m_numProxies; }
+	int				GetHeight() const;
+
+	// Brings the flat copy QueryFrustum() walks up to date.  Does nothing if
+	// the tree hasn't changed since the last call.
+	void			Flatten();
+
+	// Writes the user data of every proxy whose fat box touches the frustum
+	// to results, which needs room for NumProxies().  Returns the number
+	// written, in no particular order.  If the tree has changed since
+	// Flatten() it's walked node by node instead, which is a lot slower.
+	unsigned int	QueryFrustum(const Frustum &frustum, void **results) const;
+
+	// Writes up to maxResults proxies overlapping box.  Returns the number
+	// that overlapped, which may be more than maxResults.  Without a leafFn
+	// that's every fat box that overlaps.
+	unsigned int	QueryAABB(const AABB &box, void **results, unsigned int maxResults, AABBTreeOverlapFn leafFn = NULL, void *leafData = NULL) const;
+
+	// Nearest proxy the ray hits within maxDist.  dir doesn't need to be
+	// normalized; distances are in multiples of it.  Without a leafFn the fat
+	// boxes are what's hit.
+	bool			RayCast(const Vector3 &origin, const Vector3 &dir, float maxDist, void **hitUserData, float *hitDist, AABBTreeRayFn leafFn = NULL, void *leafData = NULL) const;
+
+private:
+	AABBTree(const AABBTree &other);
+	AABBTree & operator=(const AABBTree &other);
+
+	struct Node
+	{
+		bool	IsLeaf() const	{ return child1 == NULL_NODE; }
+
+		AABB	box;
+		void *	userData;
+		int		parent;			// Next free node while on the free list
+		int		child1;
+		int		child2;
+		int		height;			// 0 for leaves, -1 while free
+	};
+
+	// A subtree of the flat copy.  The first child of a node is the node
+	// after it and the second is where the first one's subtree ends.  Nodes
+	// no taller than FLAT_RANGE_HEIGHT are ranges: their leaves are in the
+	// leaf arrays but their children aren't copied, so end is the next node.
+	struct FlatNode
+	{
+		AABB			box;
+		int				end;			// Index past the subtree
+		unsigned int	firstLeaf;
+		unsigned int	numLeaves;
+	};
+
+	enum { FLAT_RANGE_HEIGHT = 8 };
+
+	int		AllocateNode();
+	void	FreeNode(int node);
+	void	InsertLeaf(int leaf);
+	void	RemoveLeaf(int leaf);
+	int		Balance(int node);
+	void	Refit(int node);
+	void	ReserveFlat();
+	void	FlattenNode(int node);
+	void	FlattenLeaves(int node);
+	unsigned int	CullFlatLeaves(const Frustum &frustum, const FlatNode &node, unsigned int planeMask, void **results) const;
+	unsigned int	QueryFrustumNodes(const Frustum &frustum, void **results) const;
+
+	Node *			m_nodes;
+	int				m_root;
+	int				m_nodeCapacity;
+	int				m_freeList;
+	unsigned int	m_numProxies;
+	float			m_fatMargin;
+
+	// Flat copy.  The leaf bounds are six arrays of centers and extents,
+	// laid out for FrustumCull().
+	FlatNode *		m_flatNodes;
+	int				m_numFlatNodes;
+	int				m_flatNodeCapacity;
+	float *			m_flatBounds;
+	void **			m_flatUserData;
+	unsigned int	m_numFlatLeaves;
+	unsigned int	m_flatLeafCapacity;
+	bool			m_flatDirty;
+};
+
+} // namespace Helix
+#endif // AABBTREE_H
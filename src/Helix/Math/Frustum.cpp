@@ -0,0 +1,248 @@
+#include <math.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+#include "Frustum.h"
+#include "AABB.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+Frustum::Frustum()
+{
+	for(int i=0;i<NUM_PLANES;i++)
+	{
+		m_planes[i] = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+// ****************************************************************************
+// Gribb/Hartmann plane extraction.  With column vectors clip = M * p, so each
+// plane is a sum or difference of the rows of M.  D3D clip space z runs from
+// 0 to w, so the near plane is the third row on its own.
+// ****************************************************************************
+void Frustum::SetFromViewProj(const Matrix4x4 &m)
+{
+	for(int col=0;col<4;col++)
+	{
+		float r0 = m.r[0][col];
+		float r1 = m.r[1][col];
+		float r2 = m.r[2][col];
+		float r3 = m.r[3][col];
+
+		(&m_planes[PLANE_LEFT].x)[col] =	r3 + r0;
+		(&m_planes[PLANE_RIGHT].x)[col] =	r3 - r0;
+		(&m_planes[PLANE_BOTTOM].x)[col] =	r3 + r1;
+		(&m_planes[PLANE_TOP].x)[col] =		r3 - r1;
+		(&m_planes[PLANE_NEAR].x)[col] =	r2;
+		(&m_planes[PLANE_FAR].x)[col] =		r3 - r2;
+	}
+}
+
+// ****************************************************************************
+// A box is outside a plane if its corner furthest along the plane normal is.
+// ****************************************************************************
+bool Frustum::TestAABB(const Vector3 &center, const Vector3 &extents) const
+{
+	for(int i=0;i<NUM_PLANES;i++)
+	{
+		const Vector4 &plane = m_planes[i];
+		float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float r = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if(d + r < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool Frustum::TestAABB(const AABB &box) const
+{
+	return TestAABB(box.Center(), box.Extents());
+}
+
+// ****************************************************************************
+// ****************************************************************************
+Frustum::Containment Frustum::ClassifyAABB(const AABB &box, unsigned int &planeMask) const
+{
+	Vector3 center = box.Center();
+	Vector3 extents = box.Extents();
+
+	for(int i=0;i<NUM_PLANES;i++)
+	{
+		if((planeMask & (1 << i)) == 0)
+			continue;
+
+		const Vector4 &plane = m_planes[i];
+		float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float r = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if(d + r < 0.0f)
+			return OUTSIDE;
+
+		if(d - r >= 0.0f)
+			planeMask &= ~(1 << i);
+	}
+
+	return planeMask == 0 ? INSIDE : INTERSECTING;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int FrustumCullScalar(const Frustum &frustum, const BoundsStream &bounds, uint32_t *visible)
+{
+	unsigned int numVisible = 0;
+	for(unsigned int i=0;i<bounds.count;i++)
+	{
+		Vector3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		Vector3 extents(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+
+		// Branch free so the scalar and SIMD paths time the same work
+		visible[numVisible] = i;
+		numVisible += frustum.TestAABB(center, extents) ? 1 : 0;
+	}
+
+	return numVisible;
+}
+
+#if defined(__AVX__)
+
+// ****************************************************************************
+// 8 boxes per iteration.  The terms of the planes in planeMask are splatted
+// once up front; the inner loop is a multiply/add and a compare for each of
+// them, then the visible lanes are appended without branching.
+// ****************************************************************************
+unsigned int FrustumCull(const Frustum &frustum, const BoundsStream &bounds, uint32_t *visible, unsigned int planeMask)
+{
+	_ASSERT((reinterpret_cast<size_t>(bounds.centerX) & (FRUSTUM_CULL_ALIGN-1)) == 0);
+
+	__m256 planeX[Frustum::NUM_PLANES];
+	__m256 planeY[Frustum::NUM_PLANES];
+	__m256 planeZ[Frustum::NUM_PLANES];
+	__m256 planeW[Frustum::NUM_PLANES];
+	__m256 absX[Frustum::NUM_PLANES];
+	__m256 absY[Frustum::NUM_PLANES];
+	__m256 absZ[Frustum::NUM_PLANES];
+	int numPlanes = 0;
+	for(int i=0;i<Frustum::NUM_PLANES;i++)
+	{
+		if((planeMask & (1 << i)) == 0)
+			continue;
+
+		const Vector4 &plane = frustum.m_planes[i];
+		planeX[numPlanes] = _mm256_set1_ps(plane.x);
+		planeY[numPlanes] = _mm256_set1_ps(plane.y);
+		planeZ[numPlanes] = _mm256_set1_ps(plane.z);
+		planeW[numPlanes] = _mm256_set1_ps(plane.w);
+		absX[numPlanes] = _mm256_set1_ps(fabsf(plane.x));
+		absY[numPlanes] = _mm256_set1_ps(fabsf(plane.y));
+		absZ[numPlanes] = _mm256_set1_ps(fabsf(plane.z));
+		numPlanes++;
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	unsigned int numVisible = 0;
+	for(unsigned int base=0;base<bounds.count;base+=8)
+	{
+		__m256 cx = _mm256_load_ps(bounds.centerX + base);
+		__m256 cy = _mm256_load_ps(bounds.centerY + base);
+		__m256 cz = _mm256_load_ps(bounds.centerZ + base);
+		__m256 ex = _mm256_load_ps(bounds.extentX + base);
+		__m256 ey = _mm256_load_ps(bounds.extentY + base);
+		__m256 ez = _mm256_load_ps(bounds.extentZ + base);
+
+		__m256 outside = zero;
+		for(int i=0;i<numPlanes;i++)
+		{
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[i], cx), _mm256_mul_ps(planeY[i], cy)), _mm256_mul_ps(planeZ[i], cz)), planeW[i]);
+			__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[i], ex), _mm256_mul_ps(absY[i], ey)), _mm256_mul_ps(absZ[i], ez));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+		}
+
+		unsigned int mask = ~_mm256_movemask_ps(outside) & 0xff;
+		if(bounds.count - base < 8)
+			mask &= (1u << (bounds.count - base)) - 1;
+
+		for(unsigned int lane=0;lane<8;lane++)
+		{
+			visible[numVisible] = base + lane;
+			numVisible += (mask >> lane) & 1;
+		}
+	}
+
+	return numVisible;
+}
+
+#else
+
+// ****************************************************************************
+// 4 boxes per iteration.  Same shape as the AVX version.
+// ****************************************************************************
+unsigned int FrustumCull(const Frustum &frustum, const BoundsStream &bounds, uint32_t *visible, unsigned int planeMask)
+{
+	_ASSERT((reinterpret_cast<size_t>(bounds.centerX) & 15) == 0);
+
+	__m128 planeX[Frustum::NUM_PLANES];
+	__m128 planeY[Frustum::NUM_PLANES];
+	__m128 planeZ[Frustum::NUM_PLANES];
+	__m128 planeW[Frustum::NUM_PLANES];
+	__m128 absX[Frustum::NUM_PLANES];
+	__m128 absY[Frustum::NUM_PLANES];
+	__m128 absZ[Frustum::NUM_PLANES];
+	int numPlanes = 0;
+	for(int i=0;i<Frustum::NUM_PLANES;i++)
+	{
+		if((planeMask & (1 << i)) == 0)
+			continue;
+
+		const Vector4 &plane = frustum.m_planes[i];
+		planeX[numPlanes] = _mm_set1_ps(plane.x);
+		planeY[numPlanes] = _mm_set1_ps(plane.y);
+		planeZ[numPlanes] = _mm_set1_ps(plane.z);
+		planeW[numPlanes] = _mm_set1_ps(plane.w);
+		absX[numPlanes] = _mm_set1_ps(fabsf(plane.x));
+		absY[numPlanes] = _mm_set1_ps(fabsf(plane.y));
+		absZ[numPlanes] = _mm_set1_ps(fabsf(plane.z));
+		numPlanes++;
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	unsigned int numVisible = 0;
+	for(unsigned int base=0;base<bounds.count;base+=4)
+	{
+		__m128 cx = _mm_load_ps(bounds.centerX + base);
+		__m128 cy = _mm_load_ps(bounds.centerY + base);
+		__m128 cz = _mm_load_ps(bounds.centerZ + base);
+		__m128 ex = _mm_load_ps(bounds.extentX + base);
+		__m128 ey = _mm_load_ps(bounds.extentY + base);
+		__m128 ez = _mm_load_ps(bounds.extentZ + base);
+
+		__m128 outside = zero;
+		for(int i=0;i<numPlanes;i++)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[i], cx), _mm_mul_ps(planeY[i], cy)), _mm_mul_ps(planeZ[i], cz)), planeW[i]);
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[i], ex), _mm_mul_ps(absY[i], ey)), _mm_mul_ps(absZ[i], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+		}
+
+		unsigned int mask = ~_mm_movemask_ps(outside) & 0xf;
+		if(bounds.count - base < 4)
+			mask &= (1u << (bounds.count - base)) - 1;
+
+		for(unsigned int lane=0;lane<4;lane++)
+		{
+			visible[numVisible] = base + lane;
+			numVisible += (mask >> lane) & 1;
+		}
+	}
+
+	return numVisible;
+}
+
+#endif
+
+} // namespace Helix
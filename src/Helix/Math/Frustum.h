@@ -0,0 +1,88 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <stdint.h>
+#include "Vector.h"
+#include "Matrix.h"
+
+namespace Helix {
+
+struct AABB;
+
+// ****************************************************************************
+// View frustum as six planes.  A point p is inside a plane when
+// plane.x*p.x + plane.y*p.y + plane.z*p.z + plane.w >= 0.  The planes come
+// straight out of a view projection matrix (column vectors, D3D clip space)
+// and aren't normalized, which is fine for inside/outside tests.
+// ****************************************************************************
+class Frustum
+{
+public:
+	enum
+	{
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		NUM_PLANES
+	};
+
+	Frustum();
+
+	void	SetFromViewProj(const Matrix4x4 &viewProj);
+
+	enum Containment
+	{
+		OUTSIDE = 0,
+		INTERSECTING,
+		INSIDE
+	};
+
+	static const unsigned int	ALL_PLANES = (1 << NUM_PLANES) - 1;
+
+	// False only if the box is entirely outside one of the planes
+	bool	TestAABB(const Vector3 &center, const Vector3 &extents) const;
+	bool	TestAABB(const AABB &box) const;
+
+	// Only tests the planes set in planeMask, and clears the bits of the ones
+	// the box is entirely inside.  A child of the box can start from the
+	// returned mask, since it's inside every plane its parent is.
+	Containment	ClassifyAABB(const AABB &box, unsigned int &planeMask) const;
+
+	Vector4		m_planes[NUM_PLANES];
+};
+
+// ****************************************************************************
+// Boxes laid out for batch culling: centers and half extents, one array per
+// component.  Every array must be FRUSTUM_CULL_ALIGN aligned and hold count
+// rounded up to FRUSTUM_CULL_WIDTH entries; the padding is never reported.
+// ****************************************************************************
+const unsigned int	FRUSTUM_CULL_WIDTH = 8;
+const unsigned int	FRUSTUM_CULL_ALIGN = 32;
+
+struct BoundsStream
+{
+	float *			centerX;
+	float *			centerY;
+	float *			centerZ;
+	float *			extentX;
+	float *			extentY;
+	float *			extentZ;
+	unsigned int	count;
+};
+
+// Writes the index of every box that isn't entirely outside the frustum to
+// visible, in order, and returns how many there were.  visible needs room for
+// the padded count.  FrustumCull tests 8
+// boxes at a time with AVX when the build targets it and 4 at a time with SSE
+// otherwise; AABBTree::QueryFrustum() uses it on the leaves it can't take
+// whole.  FrustumCullScalar gives the same answer one box at a time.
+// planeMask limits FrustumCull to those planes, for boxes already known to be
+// inside the others.
+unsigned int	FrustumCull(const Frustum &frustum, const BoundsStream &bounds, uint32_t *visible, unsigned int planeMask = Frustum::ALL_PLANES);
+unsigned int	FrustumCullScalar(const Frustum &frustum, const BoundsStream &bounds, uint32_t *visible);
+
+} // namespace Helix
+#endif // FRUSTUM_H
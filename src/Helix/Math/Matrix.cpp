@@ -1,4 +1,4 @@
-#include <Math.h>
+#include <math.h>
 #include "Matrix.h"
 
 // ****************************************************************************
@@ -216,14 +216,6 @@ Matrix4x4::Matrix4x4()
 	SetIdentity();
 }
 
-// ****************************************************************************
-// ****************************************************************************
-Matrix4x4::Matrix4x4(const Matrix4x4 &other)
-{
-	for (int i = 0; i < NUM_ELEMENTS; i++)
-		e[i] = other.e[i];
-}
-
 // ****************************************************************************
 // ****************************************************************************
 Matrix4x4::Matrix4x4(const Vector4 &r1, const Vector4 &r2, const Vector4 &r3, const Vector4 &r4)
@@ -41,12 +41,12 @@ public:
 	};
 };
 
-// 4x4 Matrix
+// 4x4 Matrix.  Copied with the implicit copy constructor so it stays
+// trivially copyable, and can sit in records that are copied with memcpy.
 class Matrix4x4
 {
 public:
 	Matrix4x4();
-	Matrix4x4(const Matrix4x4 &other);
 	Matrix4x4(const Vector4 &r1, const Vector4 &r2, const Vector4 &r3, const Vector4 &r4);
 
 	// Matrix setting
@@ -0,0 +1,92 @@
+#ifndef MATRIXSSE_H
+#define MATRIXSSE_H
+
+#include <xmmintrin.h>
+#include "Matrix.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// SSE versions of the Matrix4x4 operations that run once per object per frame.
+// Nothing needs to be 16 byte aligned.  out may be the same matrix as either
+// input.
+// ****************************************************************************
+
+// ****************************************************************************
+// out = a * b
+// ****************************************************************************
+inline void MultiplySSE(const Matrix4x4 &a, const Matrix4x4 &b, Matrix4x4 &out)
+{
+	__m128 b0 = _mm_loadu_ps(b.r[0]);
+	__m128 b1 = _mm_loadu_ps(b.r[1]);
+	__m128 b2 = _mm_loadu_ps(b.r[2]);
+	__m128 b3 = _mm_loadu_ps(b.r[3]);
+
+	for(int row=0;row<4;row++)
+	{
+		__m128 result = _mm_mul_ps(_mm_set1_ps(a.r[row][0]), b0);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.r[row][1]), b1));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.r[row][2]), b2));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a.r[row][3]), b3));
+		_mm_storeu_ps(out.r[row], result);
+	}
+}
+
+// ****************************************************************************
+// Cross product of the xyz lanes.  w comes out 0.
+// ****************************************************************************
+inline __m128 Cross3SSE(__m128 a, __m128 b)
+{
+	__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+	__m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+	return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+}
+
+// ****************************************************************************
+// Inverse of a matrix whose bottom row is 0 0 0 1, which is every world and
+// view matrix we build.  The columns of the inverse of the upper 3x3 are the
+// cross products of its rows over the determinant, so there's no cofactor
+// expansion; the translation is the inverse applied to the old one, negated.
+// ****************************************************************************
+inline void InvertAffineSSE(const Matrix4x4 &m, Matrix4x4 &out)
+{
+	_ASSERT(m.r[3][0] == 0.0f && m.r[3][1] == 0.0f && m.r[3][2] == 0.0f && m.r[3][3] == 1.0f);
+
+	float tx = m.r[0][3];
+	float ty = m.r[1][3];
+	float tz = m.r[2][3];
+
+	__m128 r0 = _mm_loadu_ps(m.r[0]);
+	__m128 r1 = _mm_loadu_ps(m.r[1]);
+	__m128 r2 = _mm_loadu_ps(m.r[2]);
+
+	__m128 c0 = Cross3SSE(r1, r2);
+	__m128 c1 = Cross3SSE(r2, r0);
+	__m128 c2 = Cross3SSE(r0, r1);
+
+	// r0 . c0, summed across the lanes (c0.w is 0)
+	__m128 det = _mm_mul_ps(r0, c0);
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+	_ASSERT(_mm_cvtss_f32(det) != 0.0f);
+
+	__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+	c0 = _mm_mul_ps(c0, invDet);
+	c1 = _mm_mul_ps(c1, invDet);
+	c2 = _mm_mul_ps(c2, invDet);
+
+	// -inverse * t, with 1 in w so the transpose leaves 0 0 0 1 on the bottom
+	__m128 t = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(tx)), _mm_add_ps(_mm_mul_ps(c1, _mm_set1_ps(ty)), _mm_mul_ps(c2, _mm_set1_ps(tz))));
+	t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), t);
+
+	_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+	_mm_storeu_ps(out.r[0], c0);
+	_mm_storeu_ps(out.r[1], c1);
+	_mm_storeu_ps(out.r[2], c2);
+	_mm_storeu_ps(out.r[3], t);
+}
+
+} // namespace Helix
+#endif // MATRIXSSE_H
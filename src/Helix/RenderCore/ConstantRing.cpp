@@ -0,0 +1,328 @@
+#include "ConstantRing.h"
+#include "Utility/bits.h"
+
+namespace Helix {
+
+// Windows have to start and end on a multiple of 16 constants
+const unsigned int	WINDOW_ALIGNMENT = 16 * 16;
+const unsigned int	MIN_RING_SIZE = 64 * 1024;
+const unsigned int	MIN_POOL_SIZE = 4;
+
+// ****************************************************************************
+// ****************************************************************************
+ConstantRing::ConstantRing()
+: m_device(NULL)
+, m_context(NULL)
+, m_blockSize(0)
+, m_blocksPerBuffer(0)
+, m_useOffsets(false)
+, m_blockIndices(NULL)
+, m_ring(NULL)
+, m_ringSize(0)
+, m_ringCursor(0)
+, m_blockStride(0)
+, m_frameStart(0)
+, m_mapped(NULL)
+, m_pool(NULL)
+, m_poolMapped(NULL)
+, m_poolSize(0)
+, m_numMapped(0)
+, m_numBlocks(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+// ****************************************************************************
+// Buffers have to go back through the device, which may already be gone, so
+// call Release() first
+// ****************************************************************************
+ConstantRing::~ConstantRing()
+{
+	_ASSERT(m_ring == NULL && m_pool == NULL && m_blockIndices == NULL);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ConstantRing::Initialize(RenderDevice *device, RenderContext *context, unsigned int blockSize, unsigned int initialBlocks)
+{
+	_ASSERT(device != NULL && context != NULL);
+	_ASSERT(blockSize > 0);
+
+	m_device = device;
+	m_context = context;
+	m_blockSize = blockSize;
+	m_useOffsets = context->ConstantBufferOffsets();
+
+	if(m_useOffsets)
+	{
+		// Every window starts at its own block
+		m_blockStride = ALIGNUP_POW2(blockSize, WINDOW_ALIGNMENT);
+		m_blocksPerBuffer = 1;
+		ReserveRing(initialBlocks * m_blockStride);
+	}
+	else
+	{
+		m_blockStride = ALIGNUP_16(blockSize);
+		m_blocksPerBuffer = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 / m_blockStride;
+		_ASSERT(m_blocksPerBuffer > 0);
+		ReservePool((initialBlocks + m_blocksPerBuffer - 1) / m_blocksPerBuffer);
+	}
+
+	CreateBlockIndices();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ConstantRing::Release()
+{
+	_ASSERT(m_mapped == NULL && m_numMapped == 0);
+
+	if(m_blockIndices != NULL)
+	{
+		m_device->Release(m_blockIndices);
+		m_blockIndices = NULL;
+	}
+
+	if(m_ring != NULL)
+	{
+		m_device->Release(m_ring);
+		m_ring = NULL;
+	}
+	m_ringSize = 0;
+	m_ringCursor = 0;
+
+	for(unsigned int i=0;i<m_poolSize;i++)
+	{
+		m_device->Release(m_pool[i]);
+	}
+	delete [] m_pool;
+	delete [] m_poolMapped;
+	m_pool = NULL;
+	m_poolMapped = NULL;
+	m_poolSize = 0;
+}
+
+// ****************************************************************************
+// 0 up to the last block a bind can reach, so a draw's start instance reads
+// back as its block
+// ****************************************************************************
+void ConstantRing::CreateBlockIndices()
+{
+	uint32_t *indices = new uint32_t[m_blocksPerBuffer];
+	for(unsigned int i=0;i<m_blocksPerBuffer;i++)
+	{
+		indices[i] = i;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.ByteWidth = m_blocksPerBuffer * sizeof(uint32_t);
+
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.pSysMem = indices;
+	initData.SysMemPitch = 0;
+	initData.SysMemSlicePitch = 0;
+
+	HRESULT hr = m_device->CreateBuffer( &bufferDesc, &initData, &m_blockIndices );
+	_ASSERT( SUCCEEDED( hr ) );
+
+	delete [] indices;
+}
+
+// ****************************************************************************
+// Grows the ring to hold at least size bytes.  Whatever was in the old one
+// is done with by the time the next frame asks for more.
+// ****************************************************************************
+void ConstantRing::ReserveRing(unsigned int size)
+{
+	if(size <= m_ringSize)
+		return;
+
+	unsigned int newSize = m_ringSize > MIN_RING_SIZE ? m_ringSize : MIN_RING_SIZE;
+	while(newSize < size)
+	{
+		newSize *= 2;
+	}
+
+	if(m_ring != NULL)
+	{
+		m_device->Release(m_ring);
+		m_ring = NULL;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.ByteWidth = newSize;
+	HRESULT hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_ring );
+	_ASSERT( SUCCEEDED( hr ) );
+
+	// Parking the cursor at the end makes the first map a discard
+	m_ringSize = newSize;
+	m_ringCursor = newSize;
+}
+
+// ****************************************************************************
+// Grows the fallback pool to at least numBuffers buffers of m_blocksPerBuffer
+// blocks
+// ****************************************************************************
+void ConstantRing::ReservePool(unsigned int numBuffers)
+{
+	if(numBuffers <= m_poolSize)
+		return;
+
+	unsigned int newSize = m_poolSize > MIN_POOL_SIZE ? m_poolSize : MIN_POOL_SIZE;
+	while(newSize < numBuffers)
+	{
+		newSize *= 2;
+	}
+
+	ID3D11Buffer **newPool = new ID3D11Buffer *[newSize];
+	if(m_pool != NULL)
+	{
+		memcpy(newPool, m_pool, m_poolSize * sizeof(ID3D11Buffer *));
+		delete [] m_pool;
+	}
+	m_pool = newPool;
+
+	delete [] m_poolMapped;
+	m_poolMapped = new uint8_t *[newSize];
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.ByteWidth = m_blocksPerBuffer * m_blockStride;
+	for(unsigned int i=m_poolSize;i<newSize;i++)
+	{
+		HRESULT hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_pool[i] );
+		_ASSERT( SUCCEEDED( hr ) );
+	}
+
+	m_poolSize = newSize;
+}
+
+// ****************************************************************************
+// On the offset path this is the frame's only map.  It appends after the
+// last frame's blocks, which the GPU may still be reading, and only discards
+// when they won't fit before the end of the ring.  The fallback maps each
+// buffer the frame's blocks need, once, with a discard.
+// ****************************************************************************
+void ConstantRing::BeginFrame(unsigned int numBlocks)
+{
+	_ASSERT(m_mapped == NULL && m_numMapped == 0);
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_numBlocks = numBlocks;
+	if(numBlocks == 0)
+		return;
+
+	if(!m_useOffsets)
+	{
+		unsigned int numBuffers = (numBlocks + m_blocksPerBuffer - 1) / m_blocksPerBuffer;
+		ReservePool(numBuffers);
+
+		for(unsigned int i=0;i<numBuffers;i++)
+		{
+			D3D11_MAPPED_SUBRESOURCE mappedResource;
+			HRESULT hr = m_context->Map(m_pool[i], 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+			_ASSERT( SUCCEEDED( hr ) );
+			m_poolMapped[i] = reinterpret_cast<uint8_t *>(mappedResource.pData);
+		}
+		m_numMapped = numBuffers;
+		m_stats.mapCalls += numBuffers;
+		m_stats.discards += numBuffers;
+		return;
+	}
+
+	unsigned int size = numBlocks * m_blockStride;
+	ReserveRing(size);
+
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if(m_ringCursor + size > m_ringSize)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_ringCursor = 0;
+		m_stats.discards++;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT hr = m_context->Map(m_ring, 0, mapType, 0, &mappedResource);
+	_ASSERT( SUCCEEDED( hr ) );
+	m_stats.mapCalls++;
+
+	m_mapped = reinterpret_cast<uint8_t *>(mappedResource.pData);
+	m_frameStart = m_ringCursor;
+	m_ringCursor += size;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ConstantRing::WriteBlock(unsigned int block, const void *data)
+{
+	_ASSERT(block < m_numBlocks);
+
+	if(m_useOffsets)
+	{
+		_ASSERT(m_mapped != NULL);
+		memcpy(m_mapped + m_frameStart + block * m_blockStride, data, m_blockSize);
+	}
+	else
+	{
+		unsigned int buffer = block / m_blocksPerBuffer;
+		_ASSERT(buffer < m_numMapped);
+		memcpy(m_poolMapped[buffer] + (block % m_blocksPerBuffer) * m_blockStride, data, m_blockSize);
+	}
+
+	m_stats.blocks++;
+	m_stats.bytesUploaded += m_blockSize;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ConstantRing::EndFrame()
+{
+	if(m_mapped != NULL)
+	{
+		m_context->Unmap(m_ring, 0);
+		m_mapped = NULL;
+	}
+
+	for(unsigned int i=0;i<m_numMapped;i++)
+	{
+		m_context->Unmap(m_pool[i], 0);
+	}
+	m_numMapped = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int ConstantRing::Bind(unsigned int block, unsigned int slot)
+{
+	_ASSERT(block < m_numBlocks);
+	_ASSERT(m_mapped == NULL && m_numMapped == 0);
+
+	if(m_useOffsets)
+	{
+		unsigned int firstConstant = (m_frameStart + block * m_blockStride) / 16;
+		unsigned int numConstants = m_blockStride / 16;
+		m_context->VSSetConstantBuffers1(slot, 1, &m_ring, &firstConstant, &numConstants);
+		m_context->PSSetConstantBuffers1(slot, 1, &m_ring, &firstConstant, &numConstants);
+		return 0;
+	}
+
+	unsigned int buffer = block / m_blocksPerBuffer;
+	m_context->VSSetConstantBuffers(slot, 1, &m_pool[buffer]);
+	m_context->PSSetConstantBuffers(slot, 1, &m_pool[buffer]);
+	return block % m_blocksPerBuffer;
+}
+
+} // namespace Helix
@@ -0,0 +1,99 @@
+#ifndef CONSTANTRING_H
+#define CONSTANTRING_H
+
+#include "RenderDevice.h"
+
+namespace Helix {
+
+// Per frame counters for a constant ring
+struct ConstantRingStats
+{
+	unsigned int	blocks;			// Blocks written
+	size_t			bytesUploaded;	// Bytes copied into mapped memory
+	unsigned int	mapCalls;		// Map()s it took
+	unsigned int	discards;		// Maps that renamed the buffer
+};
+
+// ****************************************************************************
+// ConstantRing
+//
+// Hands out fixed size constant blocks for a frame's draws.  All of a
+// frame's blocks are written between BeginFrame() and EndFrame(), and each
+// draw binds its own with Bind().  Shaders see an array of blocks and index
+// it with what Bind() returns, which the draw passes as its start instance
+// into the BlockIndices() stream.
+//
+// If the context can bind windows of a constant buffer, the blocks are laid
+// out in one big buffer, 256 bytes apart.  Each frame takes the next stretch
+// of it with a single no overwrite map, and the buffer is only discarded
+// when the ring wraps.  A frame that doesn't fit grows the buffer.
+//
+// Otherwise there's no way to bind part of a buffer, so the blocks are
+// packed as many to a buffer as fit in 4096 constants, with as many of those
+// as the busiest frame needed.  Each is mapped once a frame with a discard,
+// and Bind() binds the whole buffer and returns where the block sits in it.
+// Draws in the same buffer bind the same thing, which the state cache drops,
+// so buffers are only rebound when the draws move on to the next one.
+// ****************************************************************************
+class ConstantRing
+{
+public:
+	ConstantRing();
+	~ConstantRing();
+
+	void	Initialize(RenderDevice *device, RenderContext *context, unsigned int blockSize, unsigned int initialBlocks);
+	void	Release();
+
+	// Reserves numBlocks blocks for this frame.  Block indices run from 0.
+	void	BeginFrame(unsigned int numBlocks);
+	void	WriteBlock(unsigned int block, const void *data);
+	void	EndFrame();
+
+	// Binds a block written this frame to the same slot of the vertex and
+	// pixel shaders, returning its index in what's bound
+	unsigned int	Bind(unsigned int block, unsigned int slot);
+
+	// Bind() returns less than BlocksPerBuffer().  BlockIndices() is a per
+	// instance stream of uints counting up from 0 for the draw to read it
+	// back from.
+	unsigned int				BlocksPerBuffer() const	{ return m_blocksPerBuffer; }
+	ID3D11Buffer *				BlockIndices() const	{ return m_blockIndices; }
+
+	bool						UsesOffsets() const		{ return m_useOffsets; }
+	const ConstantRingStats &	FrameStats() const		{ return m_stats; }
+
+private:
+	ConstantRing(const ConstantRing &other);
+	ConstantRing & operator=(const ConstantRing &other);
+
+	void	CreateBlockIndices();
+	void	ReserveRing(unsigned int size);
+	void	ReservePool(unsigned int numBuffers);
+
+	RenderDevice *		m_device;
+	RenderContext *		m_context;
+	unsigned int		m_blockSize;
+	unsigned int		m_blocksPerBuffer;
+	bool				m_useOffsets;
+	ID3D11Buffer *		m_blockIndices;
+
+	// Offset path
+	ID3D11Buffer *		m_ring;
+	unsigned int		m_ringSize;			// Bytes
+	unsigned int		m_ringCursor;		// Where the next frame starts
+	unsigned int		m_blockStride;		// Bytes between blocks
+	unsigned int		m_frameStart;		// Where this frame's blocks start
+	uint8_t *			m_mapped;
+
+	// Fallback path
+	ID3D11Buffer **		m_pool;
+	uint8_t **			m_poolMapped;
+	unsigned int		m_poolSize;
+	unsigned int		m_numMapped;		// Buffers this frame's blocks are in
+
+	unsigned int		m_numBlocks;		// Reserved this frame
+	ConstantRingStats	m_stats;
+};
+
+} // namespace Helix
+#endif // CONSTANTRING_H
@@ -0,0 +1,401 @@
+#include <D3Dcompiler.h>
+#include "D3D11Device.h"
+#include "WICTextureLoader.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+D3D11RenderDevice::D3D11RenderDevice(ID3D11Device *device, IDXGISwapChain *swapChain)
+: m_device(device)
+, m_swapChain(swapChain)
+{
+	_ASSERT(device != NULL);
+	_ASSERT(swapChain != NULL);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateBuffer(const D3D11_BUFFER_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Buffer **buffer)
+{
+	return m_device->CreateBuffer(desc, initData, buffer);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateTexture2D(const D3D11_TEXTURE2D_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Texture2D **texture)
+{
+	return m_device->CreateTexture2D(desc, initData, texture);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateTextureFromMemory(const uint8_t *data, size_t size, ID3D11Resource **texture, ID3D11ShaderResourceView **view)
+{
+	return DirectX::CreateWICTextureFromMemory(m_device, data, size, texture, view);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateShaderResourceView(ID3D11Resource *resource, const D3D11_SHADER_RESOURCE_VIEW_DESC *desc, ID3D11ShaderResourceView **view)
+{
+	return m_device->CreateShaderResourceView(resource, desc, view);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateRenderTargetView(ID3D11Resource *resource, const D3D11_RENDER_TARGET_VIEW_DESC *desc, ID3D11RenderTargetView **view)
+{
+	return m_device->CreateRenderTargetView(resource, desc, view);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateDepthStencilView(ID3D11Resource *resource, const D3D11_DEPTH_STENCIL_VIEW_DESC *desc, ID3D11DepthStencilView **view)
+{
+	return m_device->CreateDepthStencilView(resource, desc, view);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::GetBackBuffer(ID3D11Texture2D **texture, D3D11_TEXTURE2D_DESC *desc)
+{
+	HRESULT hr = m_swapChain->GetBuffer( 0, __uuidof( ID3D11Texture2D ), ( LPVOID* )texture );
+	if(SUCCEEDED(hr) && desc != NULL)
+	{
+		(*texture)->GetDesc(desc);
+	}
+	return hr;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CompileShader(const void *source, size_t sourceSize, const char *entry, const char *profile, unsigned int flags, uint8_t **bytecode, size_t *bytecodeSize)
+{
+	ID3DBlob *errorBlob = NULL;
+	ID3DBlob *shaderBlob = NULL;
+
+	HRESULT hr = D3DCompile(source, sourceSize, "Shaders\\", NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, entry, profile, flags, 0, &shaderBlob, &errorBlob);
+	if(hr != S_OK && errorBlob != NULL)
+	{
+		// Display any errors
+		OutputDebugString(static_cast<char *>(errorBlob->GetBufferPointer()) );
+	}
+	if(errorBlob)
+		errorBlob->Release();
+
+	*bytecode = NULL;
+	*bytecodeSize = 0;
+	if(shaderBlob != NULL)
+	{
+		*bytecodeSize = shaderBlob->GetBufferSize();
+		*bytecode = new uint8_t[*bytecodeSize];
+		memcpy(*bytecode, shaderBlob->GetBufferPointer(), *bytecodeSize);
+		shaderBlob->Release();
+	}
+
+	return hr;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateVertexShader(const void *bytecode, size_t bytecodeSize, ID3D11VertexShader **shader)
+{
+	return m_device->CreateVertexShader(bytecode, bytecodeSize, NULL, shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreatePixelShader(const void *bytecode, size_t bytecodeSize, ID3D11PixelShader **shader)
+{
+	return m_device->CreatePixelShader(bytecode, bytecodeSize, NULL, shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, unsigned int numElements, const void *bytecode, size_t bytecodeSize, ID3D11InputLayout **layout)
+{
+	return m_device->CreateInputLayout(elements, numElements, bytecode, bytecodeSize, layout);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC *desc, ID3D11SamplerState **state)
+{
+	return m_device->CreateSamplerState(desc, state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC *desc, ID3D11RasterizerState **state)
+{
+	return m_device->CreateRasterizerState(desc, state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateBlendState(const D3D11_BLEND_DESC *desc, ID3D11BlendState **state)
+{
+	return m_device->CreateBlendState(desc, state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC *desc, ID3D11DepthStencilState **state)
+{
+	return m_device->CreateDepthStencilState(desc, state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderDevice::Release(ID3D11DeviceChild *object)
+{
+	if(object != NULL)
+		object->Release();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+D3D11RenderContext::D3D11RenderContext(ID3D11DeviceContext *context, IDXGISwapChain *swapChain)
+: m_context(context)
+, m_context1(NULL)
+, m_swapChain(swapChain)
+{
+	_ASSERT(context != NULL);
+	_ASSERT(swapChain != NULL);
+
+	// Constant buffer windows need an 11.1 runtime and a driver that does
+	// both offsets and no overwrite maps on constant buffers
+	HRESULT hr = context->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void **>(&m_context1));
+	if(SUCCEEDED(hr))
+	{
+		ID3D11Device *device = NULL;
+		context->GetDevice(&device);
+
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		memset(&options, 0, sizeof(options));
+		hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+		device->Release();
+
+		if(FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		{
+			m_context1->Release();
+			m_context1 = NULL;
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+D3D11RenderContext::~D3D11RenderContext()
+{
+	if(m_context1 != NULL)
+		m_context1->Release();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT D3D11RenderContext::Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped)
+{
+	return m_context->Map(resource, subresource, mapType, flags, mapped);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::Unmap(ID3D11Resource *resource, unsigned int subresource)
+{
+	m_context->Unmap(resource, subresource);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::IASetInputLayout(ID3D11InputLayout *layout)
+{
+	m_context->IASetInputLayout(layout);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets)
+{
+	m_context->IASetVertexBuffers(startSlot, numBuffers, buffers, strides, offsets);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	m_context->IASetIndexBuffer(buffer, format, offset);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	m_context->IASetPrimitiveTopology(topology);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::VSSetShader(ID3D11VertexShader *shader)
+{
+	m_context->VSSetShader(shader, NULL, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::PSSetShader(ID3D11PixelShader *shader)
+{
+	m_context->PSSetShader(shader, NULL, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::GSSetShader(ID3D11GeometryShader *shader)
+{
+	m_context->GSSetShader(shader, NULL, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::HSSetShader(ID3D11HullShader *shader)
+{
+	m_context->HSSetShader(shader, NULL, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::DSSetShader(ID3D11DomainShader *shader)
+{
+	m_context->DSSetShader(shader, NULL, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	m_context->VSSetConstantBuffers(startSlot, numBuffers, buffers);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	m_context->PSSetConstantBuffers(startSlot, numBuffers, buffers);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool D3D11RenderContext::ConstantBufferOffsets()
+{
+	return m_context1 != NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	_ASSERT(m_context1 != NULL);
+	m_context1->VSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstant, numConstants);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	_ASSERT(m_context1 != NULL);
+	m_context1->PSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstant, numConstants);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views)
+{
+	m_context->PSSetShaderResources(startSlot, numViews, views);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers)
+{
+	m_context->PSSetSamplers(startSlot, numSamplers, samplers);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::RSSetState(ID3D11RasterizerState *state)
+{
+	m_context->RSSetState(state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports)
+{
+	m_context->RSSetViewports(numViewports, viewports);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects)
+{
+	m_context->RSSetScissorRects(numRects, rects);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil)
+{
+	m_context->OMSetRenderTargets(numViews, views, depthStencil);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask)
+{
+	m_context->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef)
+{
+	m_context->OMSetDepthStencilState(state, stencilRef);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4])
+{
+	m_context->ClearRenderTargetView(view, color);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil)
+{
+	m_context->ClearDepthStencilView(view, clearFlags, depth, stencil);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	m_context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	m_context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void D3D11RenderContext::Present(unsigned int syncInterval, unsigned int flags)
+{
+	m_swapChain->Present(syncInterval, flags);
+}
+
+} // namespace Helix
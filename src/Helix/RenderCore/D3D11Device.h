@@ -0,0 +1,92 @@
+#ifndef D3D11DEVICE_H
+#define D3D11DEVICE_H
+
+#include "RenderDevice.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// Straight pass through to a real ID3D11Device/IDXGISwapChain
+// ****************************************************************************
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+	D3D11RenderDevice(ID3D11Device *device, IDXGISwapChain *swapChain);
+
+	virtual HRESULT	CreateBuffer(const D3D11_BUFFER_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Buffer **buffer);
+	virtual HRESULT	CreateTexture2D(const D3D11_TEXTURE2D_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Texture2D **texture);
+	virtual HRESULT	CreateTextureFromMemory(const uint8_t *data, size_t size, ID3D11Resource **texture, ID3D11ShaderResourceView **view);
+	virtual HRESULT	CreateShaderResourceView(ID3D11Resource *resource, const D3D11_SHADER_RESOURCE_VIEW_DESC *desc, ID3D11ShaderResourceView **view);
+	virtual HRESULT	CreateRenderTargetView(ID3D11Resource *resource, const D3D11_RENDER_TARGET_VIEW_DESC *desc, ID3D11RenderTargetView **view);
+	virtual HRESULT	CreateDepthStencilView(ID3D11Resource *resource, const D3D11_DEPTH_STENCIL_VIEW_DESC *desc, ID3D11DepthStencilView **view);
+	virtual HRESULT	GetBackBuffer(ID3D11Texture2D **texture, D3D11_TEXTURE2D_DESC *desc);
+
+	virtual HRESULT	CompileShader(const void *source, size_t sourceSize, const char *entry, const char *profile, unsigned int flags, uint8_t **bytecode, size_t *bytecodeSize);
+	virtual HRESULT	CreateVertexShader(const void *bytecode, size_t bytecodeSize, ID3D11VertexShader **shader);
+	virtual HRESULT	CreatePixelShader(const void *bytecode, size_t bytecodeSize, ID3D11PixelShader **shader);
+	virtual HRESULT	CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, unsigned int numElements, const void *bytecode, size_t bytecodeSize, ID3D11InputLayout **layout);
+
+	virtual HRESULT	CreateSamplerState(const D3D11_SAMPLER_DESC *desc, ID3D11SamplerState **state);
+	virtual HRESULT	CreateRasterizerState(const D3D11_RASTERIZER_DESC *desc, ID3D11RasterizerState **state);
+	virtual HRESULT	CreateBlendState(const D3D11_BLEND_DESC *desc, ID3D11BlendState **state);
+	virtual HRESULT	CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC *desc, ID3D11DepthStencilState **state);
+
+	virtual void	Release(ID3D11DeviceChild *object);
+
+private:
+	ID3D11Device *		m_device;
+	IDXGISwapChain *	m_swapChain;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+class D3D11RenderContext : public RenderContext
+{
+public:
+	D3D11RenderContext(ID3D11DeviceContext *context, IDXGISwapChain *swapChain);
+	virtual ~D3D11RenderContext();
+
+	virtual HRESULT	Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped);
+	virtual void	Unmap(ID3D11Resource *resource, unsigned int subresource);
+
+	virtual void	IASetInputLayout(ID3D11InputLayout *layout);
+	virtual void	IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets);
+	virtual void	IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset);
+	virtual void	IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	virtual void	VSSetShader(ID3D11VertexShader *shader);
+	virtual void	PSSetShader(ID3D11PixelShader *shader);
+	virtual void	GSSetShader(ID3D11GeometryShader *shader);
+	virtual void	HSSetShader(ID3D11HullShader *shader);
+	virtual void	DSSetShader(ID3D11DomainShader *shader);
+	virtual void	VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual void	PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual bool	ConstantBufferOffsets();
+	virtual void	VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views);
+	virtual void	PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers);
+
+	virtual void	RSSetState(ID3D11RasterizerState *state);
+	virtual void	RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports);
+	virtual void	RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects);
+	virtual void	OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil);
+	virtual void	OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask);
+	virtual void	OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef);
+
+	virtual void	ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4]);
+	virtual void	ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil);
+
+	virtual void	DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	virtual void	DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	virtual void	Present(unsigned int syncInterval, unsigned int flags);
+
+private:
+	ID3D11DeviceContext *	m_context;
+	ID3D11DeviceContext1 *	m_context1;		// NULL unless the driver can bind constant buffer windows
+	IDXGISwapChain *		m_swapChain;
+};
+
+} // namespace Helix
+#endif // D3D11DEVICE_H
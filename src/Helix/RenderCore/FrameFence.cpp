@@ -0,0 +1,179 @@
+#include "FrameFence.h"
+
+namespace Helix {
+
+// Backoff before giving up the time slice.  A frame that is nearly done is
+// cheaper to spin on than to sleep through.
+const int		FENCE_SPIN_COUNT =		256;
+const int		FENCE_YIELD_COUNT =		16;
+const DWORD		FENCE_WAIT_MS =			1;
+
+// ****************************************************************************
+// ****************************************************************************
+FrameFence::FrameFence()
+: m_submitted(0)
+, m_retired(0)
+, m_shutdown(0)
+, m_depth(1)
+, m_hSubmitted(NULL)
+, m_hRetired(NULL)
+, m_pendingWaitMs(0.0f)
+{
+	for(int i=0;i<MAX_SLOTS;i++)
+	{
+		m_frameSlots[i] = 0;
+		m_producerWaitMs[i] = 0.0f;
+		m_consumerWaitMs[i] = 0.0f;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+FrameFence::~FrameFence()
+{
+	if(m_hSubmitted != NULL)
+		CloseHandle(m_hSubmitted);
+	if(m_hRetired != NULL)
+		CloseHandle(m_hRetired);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void FrameFence::Initialize(int depth)
+{
+	_ASSERT(depth >= 1 && depth <= MAX_DEPTH);
+	_ASSERT(m_hSubmitted == NULL && m_hRetired == NULL);
+
+	m_submitted = 0;
+	m_retired = 0;
+	m_shutdown = 0;
+	m_depth = depth;
+	m_pendingWaitMs = 0.0f;
+
+	m_hSubmitted = CreateEvent(NULL, false, false, NULL);
+	_ASSERT(m_hSubmitted != NULL);
+
+	m_hRetired = CreateEvent(NULL, false, false, NULL);
+	_ASSERT(m_hRetired != NULL);
+}
+
+// ****************************************************************************
+// Wakes up both sides.  Anyone waiting returns without their frame.
+// ****************************************************************************
+void FrameFence::Shutdown()
+{
+	InterlockedExchange(&m_shutdown, 1);
+	SetEvent(m_hSubmitted);
+	SetEvent(m_hRetired);
+}
+
+// ****************************************************************************
+// Waits for counter to reach target.  Spins briefly, then yields, then falls
+// back to the event.  The event wait has a timeout so a kick that lands
+// between our check and the wait only costs us a millisecond.
+// ****************************************************************************
+void FrameFence::Wait(volatile LONG &counter, LONG target, HANDLE hEvent)
+{
+	int tries = 0;
+	while(counter < target && m_shutdown == 0)
+	{
+		if(tries < FENCE_SPIN_COUNT)
+		{
+			YieldProcessor();
+		}
+		else if(tries < FENCE_SPIN_COUNT + FENCE_YIELD_COUNT)
+		{
+			SwitchToThread();
+		}
+		else
+		{
+			DWORD result = WaitForSingleObject(hEvent, FENCE_WAIT_MS);
+			_ASSERT(result == WAIT_OBJECT_0 || result == WAIT_TIMEOUT);
+		}
+		tries++;
+	}
+}
+
+// ****************************************************************************
+// Safe to call more than once per frame; only the time actually spent
+// waiting is charged to the frame.
+// ****************************************************************************
+void FrameFence::WaitForSlot()
+{
+	LONG target = m_submitted + 1 - m_depth;
+	if(m_retired >= target)
+		return;
+
+	m_producerTimer.Start();
+	Wait(m_retired, target, m_hRetired);
+	m_producerTimer.Stop();
+
+	m_pendingWaitMs += m_producerTimer.ElapsedMilliseconds();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void FrameFence::EndFrame(int slot)
+{
+	_ASSERT(slot >= 0 && slot < MAX_SLOTS);
+	_ASSERT(m_submitted - m_retired < m_depth);
+
+	m_frameSlots[m_submitted % MAX_SLOTS] = slot;
+	m_producerWaitMs[slot] = m_pendingWaitMs;
+	m_pendingWaitMs = 0.0f;
+
+	// Publishes the slot along with the count
+	InterlockedIncrement(&m_submitted);
+	SetEvent(m_hSubmitted);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int FrameFence::WaitForFrame()
+{
+	LONG frame = m_retired;
+
+	m_consumerTimer.Start();
+	Wait(m_submitted, frame + 1, m_hSubmitted);
+	m_consumerTimer.Stop();
+
+	if(m_submitted <= frame)
+	{
+		// Shut down with nothing left to draw
+		return -1;
+	}
+
+	int slot = m_frameSlots[frame % MAX_SLOTS];
+	m_consumerWaitMs[slot] = m_consumerTimer.ElapsedMilliseconds();
+	return slot;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void FrameFence::RetireFrame()
+{
+	_ASSERT(m_retired < m_submitted);
+
+	InterlockedIncrement(&m_retired);
+	SetEvent(m_hRetired);
+}
+
+// ****************************************************************************
+// Once nothing is in flight every slot is free, so the producer can carry on
+// round robin from wherever it is in the new range.
+// ****************************************************************************
+void FrameFence::SetDepth(int depth)
+{
+	_ASSERT(depth >= 1 && depth <= MAX_DEPTH);
+	if(depth == m_depth)
+		return;
+
+	m_producerTimer.Start();
+	Wait(m_retired, m_submitted, m_hRetired);
+	m_producerTimer.Stop();
+
+	m_pendingWaitMs += m_producerTimer.ElapsedMilliseconds();
+	m_depth = depth;
+}
+
+} // namespace Helix
@@ -0,0 +1,78 @@
+#ifndef FRAMEFENCE_H
+#define FRAMEFENCE_H
+
+#include "Utility/Timer.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// FrameFence
+//
+// Tracks frames moving between a single producer (the thread that calls
+// RenderScene) and a single consumer (the render thread).  Frames are counted
+// rather than signalled, so neither side can miss a wakeup.
+//
+// Every frame lives in a slot that holds all of its per-frame data.  The depth
+// is how many finished frames may be queued up for the consumer; there is
+// always one more slot than that for the frame being built.  A depth of 1
+// means the producer waits for the previous frame to be drawn before it hands
+// over the next (lowest latency).  2 or 3 let it run further ahead.
+// ****************************************************************************
+class FrameFence
+{
+public:
+	static const int	MAX_DEPTH = 3;
+	static const int	MAX_SLOTS = MAX_DEPTH + 1;
+
+	FrameFence();
+	~FrameFence();
+
+	void	Initialize(int depth);
+	void	Shutdown();
+
+	// Producer side.  WaitForSlot blocks until handing over another frame
+	// would not put more than depth frames in flight.  EndFrame hands the
+	// frame in the given slot to the consumer; NextSlot is where the producer
+	// should build after that.
+	void	WaitForSlot();
+	void	EndFrame(int slot);
+	int		NextSlot(int slot) const	{ return (slot + 1) % (m_depth + 1); }
+
+	// Consumer side.  WaitForFrame blocks until a frame has been handed over
+	// and returns its slot, or -1 once the fence is shut down.  RetireFrame
+	// releases the slot back to the producer.
+	int		WaitForFrame();
+	void	RetireFrame();
+
+	// Drains the pipeline and changes its depth.  Producer thread only, and
+	// only between WaitForSlot and EndFrame.
+	void	SetDepth(int depth);
+	int		GetDepth() const { return m_depth; }
+
+	// How long each side waited on the fence for the frame in a given slot.
+	// Only valid until the slot is reused.
+	float	ProducerWaitMs(int slot) const	{ return m_producerWaitMs[slot]; }
+	float	ConsumerWaitMs(int slot) const	{ return m_consumerWaitMs[slot]; }
+
+private:
+	FrameFence(const FrameFence &other);
+	FrameFence & operator=(const FrameFence &other);
+
+	void	Wait(volatile LONG &counter, LONG target, HANDLE hEvent);
+
+	volatile LONG	m_submitted;				// Frames handed to the consumer
+	volatile LONG	m_retired;					// Frames the consumer has finished with
+	volatile LONG	m_shutdown;
+	int				m_depth;
+	int				m_frameSlots[MAX_SLOTS];	// Slot of each frame in flight, by frame number
+	HANDLE			m_hSubmitted;				// Kicked when m_submitted moves
+	HANDLE			m_hRetired;					// Kicked when m_retired moves
+	Timer			m_producerTimer;
+	Timer			m_consumerTimer;
+	float			m_pendingWaitMs;			// Producer wait for the frame being built
+	float			m_producerWaitMs[MAX_SLOTS];
+	float			m_consumerWaitMs[MAX_SLOTS];
+};
+
+} // namespace Helix
+#endif // FRAMEFENCE_H
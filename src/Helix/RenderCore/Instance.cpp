@@ -5,6 +5,10 @@ namespace Helix
 // ****************************************************************************
 // ****************************************************************************
 Instance::Instance()
+: m_mesh(NULL)
+, m_cullProxy(-1)
+, m_cullDirty(false)
+, m_lod(0)
 {
 	m_worldMatrix.SetIdentity();
 }
@@ -15,6 +19,50 @@ Instance::~Instance()
 {
 }
 
+// ****************************************************************************
+// Resolves the mesh name the first time it's asked for.  Meshes are never
+// unloaded, so the pointer stays good for the life of the instance.
+// ****************************************************************************
+Mesh * Instance::GetMesh()
+{
+	if(m_mesh == NULL)
+	{
+		m_mesh = MeshManager::GetInstance().GetMesh(m_meshName);
+	}
+
+	return m_mesh;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void Instance::SetMeshName(const std::string &name)
+{
+	m_meshName = name;
+	m_mesh = NULL;
+	m_lod = 0;
+	InstanceManager::GetInstance().InstanceChanged(*this);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void Instance::SetWorldMatrix(const Helix::Matrix4x4 &mat)
+{
+	m_worldMatrix = mat;
+	InstanceManager::GetInstance().InstanceChanged(*this);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool Instance::UpdateWorldBounds()
+{
+	Mesh *mesh = GetMesh();
+	if(mesh == NULL)
+		return false;
+
+	m_worldBounds = mesh->GetBounds().Transform(m_worldMatrix);
+	return true;
+}
+
 // ****************************************************************************
 // ****************************************************************************
 //void Instance::Render(int pass)
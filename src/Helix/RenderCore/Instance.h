@@ -4,6 +4,7 @@
 #include <string>
 #include "LuaPlus.h"
 #include "Kernel/RefCount.h"
+#include "Math/AABB.h"
 
 namespace Helix
 {
@@ -19,16 +20,38 @@ public:
 	bool				Load(const std::string &name, LuaPlus::LuaObject &obj);
 	void				SetName(const std::string &name) { m_name = name; }
 	const std::string &	GetName() const { return m_name; }
-	void				SetMeshName(const std::string &name) { m_meshName = name; }
+	void				SetMeshName(const std::string &name);
 	const std::string &	GetMeshName() const { return m_meshName; }
+	Mesh *				GetMesh();
 	const Helix::Matrix4x4 &	GetWorldMatrix() const { return m_worldMatrix; }
+	void				SetWorldMatrix(const Helix::Matrix4x4 &mat);
+
+	// World space bounds.  Only valid once UpdateWorldBounds() has succeeded,
+	// which needs the mesh to be loaded.
+	bool				UpdateWorldBounds();
+	const AABB &		GetWorldBounds() const { return m_worldBounds; }
+
+	// Bookkeeping for InstanceManager's cull tree
+	int					GetCullProxy() const { return m_cullProxy; }
+	void				SetCullProxy(int proxy) { m_cullProxy = proxy; }
+	bool				IsCullDirty() const { return m_cullDirty; }
+	void				SetCullDirty(bool dirty) { m_cullDirty = dirty; }
+
+	// Mesh level of detail it was last submitted with
+	unsigned int		GetLod() const { return m_lod; }
+	void				SetLod(unsigned int lod) { m_lod = lod; }
 //	void				Render(int pass);
 
 private:
 	std::string		m_name;
 	std::string		m_meshName;
+	Mesh *			m_mesh;				// Cached lookup of m_meshName
 
 	Helix::Matrix4x4		m_worldMatrix;
+	AABB					m_worldBounds;
+	int						m_cullProxy;		// AABBTree proxy, -1 until the mesh is loaded
+	bool					m_cullDirty;		// Queued for a bounds update
+	unsigned int			m_lod;
 };
 } // namespace
 
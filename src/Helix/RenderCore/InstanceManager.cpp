@@ -1,12 +1,29 @@
 #include "RenderThread.h"
+#include "Utility/Profiler.h"
 
 namespace Helix {
 // ****************************************************************************
 // ****************************************************************************
 InstanceManager::InstanceManager()
+: m_changed(NULL)
+, m_numChanged(0)
+, m_changedCapacity(0)
+, m_visible(NULL)
+, m_visibleCapacity(0)
+, m_numCulled(0)
+, m_occlusionCulling(true)
+, m_numOccluded(0)
 {
 }
 
+// ****************************************************************************
+// ****************************************************************************
+InstanceManager::~InstanceManager()
+{
+	delete [] m_changed;
+	delete [] m_visible;
+}
+
 // ****************************************************************************
 // ****************************************************************************
 Instance * InstanceManager::CreateInstance(const std::string &instanceName)
@@ -18,6 +35,7 @@ Instance * InstanceManager::CreateInstance(const std::string &instanceName)
 	inst->SetName(instanceName);
 	
 	m_database[instanceName] = inst;
+	InstanceChanged(*inst);
 	return inst;
 }
 
@@ -57,22 +75,168 @@ Instance * InstanceManager::Load(const std::string &name)
 	_ASSERT(inst != NULL);
 
 	m_database[name] = inst;
+	InstanceChanged(*inst);
 	return inst;
 
 }
 
 // ****************************************************************************
 // ****************************************************************************
-void InstanceManager::SubmitInstances()
+void InstanceManager::InstanceChanged(Instance &inst)
+{
+	if(inst.IsCullDirty())
+		return;
+
+	if(m_numChanged == m_changedCapacity)
+	{
+		unsigned int newCapacity = (m_changedCapacity == 0) ? 64 : m_changedCapacity * 2;
+		Instance **newChanged = new Instance *[newCapacity];
+		if(m_numChanged > 0)
+		{
+			memcpy(newChanged, m_changed, m_numChanged * sizeof(Instance *));
+		}
+
+		delete [] m_changed;
+		m_changed = newChanged;
+		m_changedCapacity = newCapacity;
+	}
+
+	inst.SetCullDirty(true);
+	m_changed[m_numChanged++] = &inst;
+}
+
+// ****************************************************************************
+// Brings the tree up to date with everything that changed since last frame.
+// Moves that stay inside a proxy's fat box cost nothing, and leave the flat
+// copy QueryFrustum() walks alone too.  Instances still waiting on their mesh
+// stay on the list for next time.
+// ****************************************************************************
+void InstanceManager::UpdateCullTree()
+{
+	unsigned int numWaiting = 0;
+	for(unsigned int i=0;i<m_numChanged;i++)
+	{
+		Instance *inst = m_changed[i];
+		if(!inst->UpdateWorldBounds())
+		{
+			m_changed[numWaiting++] = inst;
+			continue;
+		}
+
+		if(inst->GetCullProxy() == AABBTree::NULL_NODE)
+		{
+			inst->SetCullProxy(m_tree.CreateProxy(inst->GetWorldBounds(), inst));
+		}
+		else
+		{
+			m_tree.MoveProxy(inst->GetCullProxy(), inst->GetWorldBounds());
+		}
+
+		inst->SetCullDirty(false);
+	}
+	m_numChanged = numWaiting;
+	m_tree.Flatten();
+
+	if(m_tree.NumProxies() > m_visibleCapacity)
+	{
+		delete [] m_visible;
+		m_visibleCapacity = m_tree.NumProxies() * 2;
+		m_visible = new void *[m_visibleCapacity];
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void InstanceManager::SubmitInstances(const Matrix4x4 &viewProj)
+{
+	HX_PROFILE_SCOPE("SubmitInstances");
+
+	UpdateCullTree();
+
+	Frustum frustum;
+	frustum.SetFromViewProj(viewProj);
+
+	unsigned int numVisible = m_tree.QueryFrustum(frustum, m_visible);
+	m_numCulled = m_tree.NumProxies() - numVisible;
+	m_numOccluded = 0;
+
+	if(m_occlusionCulling)
+	{
+		DrawOccluders(viewProj, numVisible);
+	}
+
+	for(unsigned int i=0;i<numVisible;i++)
+	{
+		Instance &inst = *static_cast<Instance *>(m_visible[i]);
+
+		// Occluders would only ever hide themselves
+		if(m_occlusionCulling && !inst.GetMesh()->IsOccluder() && !m_occlusion.IsVisible(inst.GetWorldBounds()))
+		{
+			m_numOccluded++;
+			continue;
+		}
+
+		SubmitInstance(inst);
+	}
+
+	HX_PROFILE_COUNTER("Occluded", m_numOccluded);
+}
+
+// ****************************************************************************
+// Every instance in the tree has its mesh loaded, so the visible list can be
+// used as it is
+// ****************************************************************************
+void InstanceManager::DrawOccluders(const Matrix4x4 &viewProj, unsigned int numVisible)
 {
-	InstanceMap::iterator iter = m_database.begin();
+	HX_PROFILE_SCOPE("DrawOccluders");
 
-	while(iter != m_database.end())
+	m_occlusion.BeginFrame(viewProj);
+	for(unsigned int i=0;i<numVisible;i++)
 	{
-		Instance *inst = iter->second;
-		SubmitInstance(*inst);
-		++iter;
+		Instance &inst = *static_cast<Instance *>(m_visible[i]);
+		Mesh *mesh = inst.GetMesh();
+		if(!mesh->IsOccluder())
+			continue;
+
+		m_occlusion.AddOccluder(mesh->OccluderPositions(), mesh->NumOccluderPositions(), mesh->OccluderIndices(), mesh->NumOccluderTriangles(), inst.GetWorldMatrix());
 	}
+	m_occlusion.Rasterize();
+}
+
+// ****************************************************************************
+// The tree only gets us to the instances whose fat boxes are hit; these test
+// the instance's own bounds
+// ****************************************************************************
+bool RayHitsInstance(void *data, void *userData, const Vector3 &origin, const Vector3 &invDir, float maxDist, float &dist)
+{
+	return static_cast<const Instance *>(userData)->GetWorldBounds().IntersectRay(origin, invDir, maxDist, dist);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool BoxOverlapsInstance(void *data, void *userData, const AABB &box)
+{
+	return static_cast<const Instance *>(userData)->GetWorldBounds().Overlaps(box);
+}
+
+// ****************************************************************************
+// Picking and box queries see the instances that were in the tree as of the
+// last SubmitInstances(), tested against their bounds as they are now.
+// ****************************************************************************
+Instance * InstanceManager::Pick(const Vector3 &origin, const Vector3 &dir, float maxDist, float *hitDist) const
+{
+	void *hit = NULL;
+	if(!m_tree.RayCast(origin, dir, maxDist, &hit, hitDist, RayHitsInstance, NULL))
+		return NULL;
+
+	return static_cast<Instance *>(hit);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int InstanceManager::QueryBox(const AABB &box, Instance **results, unsigned int maxResults) const
+{
+	return m_tree.QueryAABB(box, reinterpret_cast<void **>(results), maxResults, BoxOverlapsInstance, NULL);
 }
 
-} // namespace Helix
\ No newline at end of file
+} // namespace Helix
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <map>
+#include "Math/AABBTree.h"
+#include "OcclusionBuffer.h"
 
 namespace Helix {
 
@@ -27,17 +29,55 @@ public:
 	Instance *	Get(const std::string &name);
 	Instance *	Load(const std::string &name);
 
-	void	SubmitInstances();
+	// Submits every instance whose bounds touch the frustum of viewProj and
+	// aren't hidden behind an occluder
+	void	SubmitInstances(const Matrix4x4 &viewProj);
+
+	// Occluders still draw when it's off; they just don't hide anything
+	void	SetOcclusionCulling(bool enable)	{ m_occlusionCulling = enable; }
+	bool	GetOcclusionCulling() const			{ return m_occlusionCulling; }
+
+	// Queues an instance whose matrix or mesh changed.  Its place in the cull
+	// tree is updated at the start of the next SubmitInstances().
+	void	InstanceChanged(Instance &inst);
+
+	// Nearest instance whose bounds the ray hits within maxDist, or NULL
+	Instance *		Pick(const Vector3 &origin, const Vector3 &dir, float maxDist, float *hitDist = NULL) const;
+
+	// Writes up to maxResults instances whose bounds overlap box.  Returns the
+	// number that overlapped, which may be more than maxResults.
+	unsigned int	QueryBox(const AABB &box, Instance **results, unsigned int maxResults) const;
+
+	unsigned int	NumInstances() const	{ return static_cast<unsigned int>(m_database.size()); }
+	unsigned int	NumCulled() const		{ return m_numCulled; }
+	unsigned int	NumOccluded() const		{ return m_numOccluded; }
 
 private:
 	InstanceManager();
-	~InstanceManager() {}
+	~InstanceManager();
 	InstanceManager(const InstanceManager &other) {}
 	InstanceManager &	operator=(const InstanceManager &other) {}
 
 	typedef std::map<const std::string, Instance *>	InstanceMap;
 
+	void	UpdateCullTree();
+	void	DrawOccluders(const Matrix4x4 &viewProj, unsigned int numVisible);
+
 	InstanceMap		m_database;
+
+	// Instances only go into the tree once their mesh is loaded; until then
+	// they sit on the changed list and are retried every frame.
+	AABBTree		m_tree;
+	Instance **		m_changed;
+	unsigned int	m_numChanged;
+	unsigned int	m_changedCapacity;
+	void **			m_visible;				// QueryFrustum() output, sized to the tree
+	unsigned int	m_visibleCapacity;
+	unsigned int	m_numCulled;
+
+	OcclusionBuffer	m_occlusion;
+	bool			m_occlusionCulling;
+	unsigned int	m_numOccluded;
 };
 
 } // namespace Helix
@@ -1,85 +1,280 @@
+#include <malloc.h>
 #include "Light.h"
-#include "RenderThread.h"
+#include "Kernel/Atomic.h"
 
 namespace Helix {
 
-int			m_lightIndex = 0;
-HANDLE		m_submitLightMutex;
-Light		m_lights[MAX_LIGHTS];
+const unsigned int	NUM_LIGHT_STREAMS = 11;		// Float streams in a LightList
+const unsigned int	MIN_LIGHT_CAPACITY = 256;
+
+const long			NUM_LIGHT_FRAMES = 3;
+const long			LIGHT_FRAME_MASK = 3;
+const long			LIGHT_FRAME_FRESH = 4;	// Set on the ready frame until it's acquired
+
+LightList			m_lightFrames[NUM_LIGHT_FRAMES];
+long				m_lightWriteFrame = 0;		// Submitting thread's
+long				m_lightReadFrame = 1;		// AcquireLights()'s
+volatile long		m_lightReadyFrame = 2;		// Index, plus LIGHT_FRAME_FRESH
 
 // ****************************************************************************
 // ****************************************************************************
-void InitializeLights()
+LightList::LightList()
+: m_numLights(0)
+, m_capacity(0)
+, m_data(NULL)
+, m_posX(NULL)
+, m_posY(NULL)
+, m_posZ(NULL)
+, m_dirX(NULL)
+, m_dirY(NULL)
+, m_dirZ(NULL)
+, m_innerRadius(NULL)
+, m_outerRadius(NULL)
+, m_colorR(NULL)
+, m_colorG(NULL)
+, m_colorB(NULL)
+, m_type(NULL)
 {
-	m_lightIndex = 0;
-	m_submitLightMutex = CreateMutex(NULL,false,"SubmitLight");
 }
 
 // ****************************************************************************
 // ****************************************************************************
-void ShutdownLights()
+LightList::~LightList()
 {
-	CloseHandle(m_submitLightMutex);
+	_aligned_free(m_data);
 }
 
 // ****************************************************************************
+// Room for at least count lights, padding included.  Existing lights are
+// kept.
 // ****************************************************************************
-void ResetLights()
+void LightList::Reserve(unsigned int count)
 {
-	m_lightIndex = 0;
+	count = (count + 3) & ~3;
+	if(count <= m_capacity)
+		return;
+
+	unsigned int capacity = m_capacity > 0 ? m_capacity : MIN_LIGHT_CAPACITY;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	float *data = static_cast<float *>(_aligned_malloc(NUM_LIGHT_STREAMS * capacity * sizeof(float) + capacity, 16));
+	_ASSERT(data != NULL);
+
+	// Streams keep their order in the allocation, so each one moves with a
+	// single copy
+	if(m_data != NULL)
+	{
+		for(unsigned int i=0;i<NUM_LIGHT_STREAMS;i++)
+		{
+			memcpy(data + i * capacity, m_data + i * m_capacity, m_numLights * sizeof(float));
+		}
+		memcpy(data + NUM_LIGHT_STREAMS * capacity, m_type, m_numLights);
+		_aligned_free(m_data);
+	}
+
+	SetStreams(data, capacity);
 }
 
 // ****************************************************************************
+// Every stream is at a fixed place in the allocation
 // ****************************************************************************
-int SubmittedLightCount()
+void LightList::SetStreams(float *data, unsigned int capacity)
 {
-	return m_lightIndex;
+	m_data = data;
+	m_capacity = capacity;
+	m_posX = data;
+	m_posY = data + capacity;
+	m_posZ = data + 2 * capacity;
+	m_dirX = data + 3 * capacity;
+	m_dirY = data + 4 * capacity;
+	m_dirZ = data + 5 * capacity;
+	m_innerRadius = data + 6 * capacity;
+	m_outerRadius = data + 7 * capacity;
+	m_colorR = data + 8 * capacity;
+	m_colorG = data + 9 * capacity;
+	m_colorB = data + 10 * capacity;
+	m_type = reinterpret_cast<uint8_t *>(data + NUM_LIGHT_STREAMS * capacity);
 }
 
 // ****************************************************************************
 // ****************************************************************************
-Light * SubmittedLights()
+void LightList::Swap(LightList &other)
 {
-	return m_lights;
+	float *data = m_data;
+	unsigned int capacity = m_capacity;
+	unsigned int numLights = m_numLights;
+
+	SetStreams(other.m_data, other.m_capacity);
+	m_numLights = other.m_numLights;
+
+	other.SetStreams(data, capacity);
+	other.m_numLights = numLights;
 }
 
 // ****************************************************************************
+// Fills the lanes between Count() and PaddedCount() with lights the kernels
+// throw away
 // ****************************************************************************
-void AddPointLight(const Helix::Vector3 & position, const Helix::Color &color, const float innerRadius, const float outerRadius)
+void LightList::PadTail()
 {
-	Light &light = m_lights[m_lightIndex];
+	unsigned int padded = PaddedCount();
+	for(unsigned int i=m_numLights;i<padded;i++)
+	{
+		m_posX[i] = m_posY[i] = m_posZ[i] = 0.0f;
+		m_outerRadius[i] = -1.0f;
+	}
+}
 
-	light.m_type = Light::POINT;
-	light.m_color = color;
+// ****************************************************************************
+// ****************************************************************************
+void LightList::AddPointLight(const Helix::Vector3 &position, const Helix::Color &color, float innerRadius, float outerRadius)
+{
+	AddPointLights(&position, &color, &innerRadius, &outerRadius, 1);
+}
 
-	// Bit of a hack here
-	// Treat the underlying storage as a Vector3 type and use the assignment operator
-	// to copy values over
-	*((Helix::Vector3 *)&light.point.m_position) = position;
+// ****************************************************************************
+// ****************************************************************************
+void LightList::AddPointLights(const Helix::Vector3 *positions, const Helix::Color *colors, const float *innerRadii, const float *outerRadii, unsigned int count)
+{
+	Reserve(m_numLights + count);
 
-	light.point.m_innerRadius = innerRadius;
-	light.point.m_outerRadius = outerRadius;
+	unsigned int base = m_numLights;
+	for(unsigned int i=0;i<count;i++)
+	{
+		m_posX[base + i] = positions[i].x;
+		m_posY[base + i] = positions[i].y;
+		m_posZ[base + i] = positions[i].z;
+		m_dirX[base + i] = m_dirY[base + i] = m_dirZ[base + i] = 0.0f;
+		m_innerRadius[base + i] = innerRadii[i];
+		m_outerRadius[base + i] = outerRadii[i];
+		m_colorR[base + i] = colors[i].r;
+		m_colorG[base + i] = colors[i].g;
+		m_colorB[base + i] = colors[i].b;
+	}
+	memset(m_type + base, Light::POINT, count);
 
-	m_lightIndex++;
+	m_numLights += count;
+	PadTail();
 }
 
 // ****************************************************************************
+// Doesn't reserve or pad; AddLights() does that once for the batch
 // ****************************************************************************
-bool AquireLightMutex()
+void LightList::AddLight(const Light &light)
 {
-	DWORD result = WaitForSingleObject(m_submitLightMutex,INFINITE);
-	_ASSERT(result == WAIT_OBJECT_0);
+	unsigned int i = m_numLights++;
+	m_type[i] = static_cast<uint8_t>(light.m_type);
+	m_colorR[i] = light.m_color.r;
+	m_colorG[i] = light.m_color.g;
+	m_colorB[i] = light.m_color.b;
+	m_innerRadius[i] = 0.0f;
+	m_outerRadius[i] = -1.0f;
 
-	return result == WAIT_OBJECT_0;
+	switch(light.m_type)
+	{
+	case Light::POINT:
+		m_posX[i] = light.point.m_position[0];
+		m_posY[i] = light.point.m_position[1];
+		m_posZ[i] = light.point.m_position[2];
+		m_dirX[i] = m_dirY[i] = m_dirZ[i] = 0.0f;
+		m_innerRadius[i] = light.point.m_innerRadius;
+		m_outerRadius[i] = light.point.m_outerRadius;
+		break;
+	case Light::DIRECTIONAL:
+		m_posX[i] = m_posY[i] = m_posZ[i] = 0.0f;
+		m_dirX[i] = light.dir.m_dir[0];
+		m_dirY[i] = light.dir.m_dir[1];
+		m_dirZ[i] = light.dir.m_dir[2];
+		break;
+	case Light::SPOT:
+		m_posX[i] = light.cone.m_position[0];
+		m_posY[i] = light.cone.m_position[1];
+		m_posZ[i] = light.cone.m_position[2];
+		m_dirX[i] = light.cone.m_dir[0];
+		m_dirY[i] = light.cone.m_dir[1];
+		m_dirZ[i] = light.cone.m_dir[2];
+		break;
+	}
 }
 
 // ****************************************************************************
 // ****************************************************************************
-bool ReleaseLightMutex()
+void LightList::AddLights(const Light *lights, unsigned int count)
 {
-	DWORD result = ::ReleaseMutex(m_submitLightMutex);
-	_ASSERT(result);
+	Reserve(m_numLights + count);
+	for(unsigned int i=0;i<count;i++)
+	{
+		AddLight(lights[i]);
+	}
+	PadTail();
+}
 
-	return result != 0;
+// ****************************************************************************
+// ****************************************************************************
+void InitializeLights()
+{
+	for(long i=0;i<NUM_LIGHT_FRAMES;i++)
+	{
+		m_lightFrames[i].Clear();
+		m_lightFrames[i].Reserve(MIN_LIGHT_CAPACITY);
+	}
+	m_lightWriteFrame = 0;
+	m_lightReadFrame = 1;
+	AtomicExchange(&m_lightReadyFrame, 2);
 }
-}
\ No newline at end of file
+
+// ****************************************************************************
+// ****************************************************************************
+void AddPointLight(const Helix::Vector3 & position, const Helix::Color &color, const float innerRadius, const float outerRadius)
+{
+	m_lightFrames[m_lightWriteFrame].AddPointLight(position, color, innerRadius, outerRadius);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AddPointLights(const Helix::Vector3 *positions, const Helix::Color *colors, const float *innerRadii, const float *outerRadii, unsigned int count)
+{
+	m_lightFrames[m_lightWriteFrame].AddPointLights(positions, colors, innerRadii, outerRadii, count);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void AddLights(const Light *lights, unsigned int count)
+{
+	m_lightFrames[m_lightWriteFrame].AddLights(lights, count);
+}
+
+// ****************************************************************************
+// The exchange is a full barrier, so the lights are all written before the
+// frame can be acquired.  The frame that comes back is either the one an
+// unacquired publish left behind or one AcquireLights() is done with.
+// ****************************************************************************
+void PublishLights()
+{
+	long previous = AtomicExchange(&m_lightReadyFrame, m_lightWriteFrame | LIGHT_FRAME_FRESH);
+	m_lightWriteFrame = previous & LIGHT_FRAME_MASK;
+	m_lightFrames[m_lightWriteFrame].Clear();
+}
+
+// ****************************************************************************
+// Only this side clears LIGHT_FRAME_FRESH, so once it's seen it stays set
+// until the exchange, whatever the submitting thread does in between
+// ****************************************************************************
+bool AcquireLights(LightList &list)
+{
+	if((m_lightReadyFrame & LIGHT_FRAME_FRESH) == 0)
+	{
+		list.Clear();
+		return false;
+	}
+
+	long previous = AtomicExchange(&m_lightReadyFrame, m_lightReadFrame);
+	m_lightReadFrame = previous & LIGHT_FRAME_MASK;
+	list.Swap(m_lightFrames[m_lightReadFrame]);
+	return true;
+}
+
+} // namespace Helix
@@ -2,44 +2,142 @@
 #define LIGHT_H
 
 #include "Math/Color.h"
+#include "Math/Vector.h"
 
 namespace Helix {
 
-const int	MAX_LIGHTS = 100;
-
+// One light, for adding lights that aren't all point lights.  Lights are
+// stored as a LightList.
 struct Light
 {
 	typedef enum {POINT, DIRECTIONAL, SPOT} LightType;
 
+	struct Directional {
+		float		m_dir[3];
+	};
+
+	struct Cone {
+		float		m_position[3];
+		float		m_dir[3];
+	};
+
+	struct Point {
+		float		m_position[3];
+		float		m_innerRadius;
+		float		m_outerRadius;
+	};
+
 	LightType	m_type;
 
+	// The types are declared outside the union; GCC doesn't allow them inside
+	// an anonymous one
 	union {
-		struct Directional {
-			float		m_dir[3];
-		} dir;
-
-		struct Cone {
-			float		m_position[3];
-			float		m_dir[3];
-		} cone;
-
-		struct Point {
-			float		m_position[3];
-			float		m_innerRadius;
-			float		m_outerRadius;
-		} point;
+		Directional	dir;
+		Cone		cone;
+		Point		point;
 	};
 	Helix::Color		m_color;
 };
 
+// ****************************************************************************
+// LightList
+//
+// A frame's lights with one stream per field, so the culling and binning
+// kernels can load four lights at a time straight out of it.  The streams
+// are 16 byte aligned and hold PaddedCount() lights: the ones past Count()
+// are lights that never light anything, at the origin with an outer radius
+// of -1.  Lights that aren't POINT lights also get an outer radius of -1, so
+// sphere tests throw them away without looking at the type.
+//
+// Grows by doubling and never shrinks, so once it has seen the busiest
+// frame adding lights doesn't allocate.
+// ****************************************************************************
+class LightList
+{
+public:
+	LightList();
+	~LightList();
+
+	void	Clear()		{ m_numLights = 0; }
+	void	Reserve(unsigned int count);
+	void	Swap(LightList &other);
+
+	void	AddPointLight(const Helix::Vector3 &position, const Helix::Color &color, float innerRadius, float outerRadius);
+	void	AddPointLights(const Helix::Vector3 *positions, const Helix::Color *colors, const float *innerRadii, const float *outerRadii, unsigned int count);
+	void	AddLights(const Light *lights, unsigned int count);
+
+	unsigned int	Count() const			{ return m_numLights; }
+	unsigned int	PaddedCount() const		{ return (m_numLights + 3) & ~3; }
+
+	Light::LightType	Type(unsigned int index) const		{ return static_cast<Light::LightType>(m_type[index]); }
+
+	const float *	PositionX() const		{ return m_posX; }
+	const float *	PositionY() const		{ return m_posY; }
+	const float *	PositionZ() const		{ return m_posZ; }
+	const float *	DirectionX() const		{ return m_dirX; }
+	const float *	DirectionY() const		{ return m_dirY; }
+	const float *	DirectionZ() const		{ return m_dirZ; }
+	const float *	InnerRadius() const		{ return m_innerRadius; }
+	const float *	OuterRadius() const		{ return m_outerRadius; }
+	const float *	ColorR() const			{ return m_colorR; }
+	const float *	ColorG() const			{ return m_colorG; }
+	const float *	ColorB() const			{ return m_colorB; }
+
+private:
+	LightList(const LightList &other);
+	LightList & operator=(const LightList &other);
+
+	void	SetStreams(float *data, unsigned int capacity);
+	void	AddLight(const Light &light);
+	void	PadTail();
+
+	unsigned int	m_numLights;
+	unsigned int	m_capacity;		// Always a multiple of 4
+
+	// One allocation holds every stream
+	float *			m_data;
+	float *			m_posX;
+	float *			m_posY;
+	float *			m_posZ;
+	float *			m_dirX;
+	float *			m_dirY;
+	float *			m_dirZ;
+	float *			m_innerRadius;
+	float *			m_outerRadius;
+	float *			m_colorR;
+	float *			m_colorG;
+	float *			m_colorB;
+	uint8_t *		m_type;
+};
+
+// ****************************************************************************
+// Light submission
+//
+// Lights go from the thread that submits them to RenderScene() through three
+// light frames.  The submitting thread owns one and adds to it, then
+// PublishLights() swaps it for the ready frame with one atomic exchange.
+// AcquireLights() swaps the ready frame for the one it last took the same
+// way, but only if something has been published since.  Neither side ever
+// waits on the other: a frame published twice before anyone takes it is
+// replaced by the newer one.
+//
+// Adding and publishing must happen on one thread at a time.  Nothing is
+// seen until it's published, and a frame that nothing was published for
+// has no lights.
+// ****************************************************************************
+
 void	InitializeLights();
-void	ResetLights();
+
 void	AddPointLight(const Helix::Vector3 &position, const Helix::Color &color, const float innerRadius, const float outerRadius);
-bool	AquireLightMutex();
-bool	ReleaseLightMutex();
-Light *	SubmittedLights();
-int		SubmittedLightCount();
+void	AddPointLights(const Helix::Vector3 *positions, const Helix::Color *colors, const float *innerRadii, const float *outerRadii, unsigned int count);
+void	AddLights(const Light *lights, unsigned int count);
+void	PublishLights();
+
+// Swaps the latest published lights into list.  Whatever list held is
+// dropped and its storage goes round again, so nothing is copied.  Returns
+// false, and leaves list empty, if nothing new was published.
+bool	AcquireLights(LightList &list);
 
 } // namespace Helix
 
-#endif LIGHT_H
\ No newline at end of file
+#endif // LIGHT_H
@@ -0,0 +1,305 @@
+#include <math.h>
+#include <emmintrin.h>
+#include "LightBounds.h"
+#include "Math/Matrix.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// Near and far planes back out of the z row of a perspective projection
+// ****************************************************************************
+inline void ProjectionDepthRange(const Matrix4x4 &proj, float &nearZ, float &farZ)
+{
+	nearZ = -proj.r[2][3] / proj.r[2][2];
+	farZ = proj.r[2][3] / (1.0f - proj.r[2][2]);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void SetBoundsEmpty(LightScreenBounds &bounds)
+{
+	bounds.rect.left = bounds.rect.top = bounds.rect.right = bounds.rect.bottom = 0;
+	bounds.minZ = bounds.maxZ = 0.0f;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void SetBoundsFullScreen(LightScreenBounds &bounds, float imageWidth, float imageHeight, float nearZ, float farZ)
+{
+	bounds.rect.left = 0;
+	bounds.rect.top = 0;
+	bounds.rect.right = static_cast<LONG>(imageWidth);
+	bounds.rect.bottom = static_cast<LONG>(imageHeight);
+	bounds.minZ = nearZ;
+	bounds.maxZ = farZ;
+}
+
+// ****************************************************************************
+// Smallest and largest a/z over the circle of radius r around (a, z), with
+// the part in front of the near plane cut off.  The extremes are where the
+// lines from the eye touch the circle; a touching point in front of the near
+// plane (or the eye being inside) moves that extreme to where the circle
+// crosses the near plane.  Mara and McGuire, "2D Polyhedral Bounds of a
+// Clipped, Perspective-Projected 3D Sphere".
+// ****************************************************************************
+inline void ProjectedExtents(float a, float z, float r, float nearZ, float &lo, float &hi)
+{
+	float dz = nearZ - z;
+	float chordSq = r * r - dz * dz;
+	float chord = chordSq > 0.0f ? sqrtf(chordSq) : 0.0f;
+	float clipLo = (a - chord) / nearZ;
+	float clipHi = (a + chord) / nearZ;
+
+	float lenSq = a * a + z * z;
+	float tangentSq = lenSq - r * r;
+	if(tangentSq <= 0.0f)
+	{
+		lo = clipLo;
+		hi = clipHi;
+		return;
+	}
+
+	// Rotate the center by the angle between it and a touching point.  The
+	// touching point itself is cosAngle times that far along.
+	float invLen = 1.0f / sqrtf(lenSq);
+	float cosAngle = sqrtf(tangentSq) * invLen;
+	float sinAngle = r * invLen;
+
+	float loA = a * cosAngle - z * sinAngle;
+	float loZ = a * sinAngle + z * cosAngle;
+	float hiA = a * cosAngle + z * sinAngle;
+	float hiZ = z * cosAngle - a * sinAngle;
+
+	lo = (loZ * cosAngle < nearZ) ? clipLo : loA / loZ;
+	hi = (hiZ * cosAngle < nearZ) ? clipHi : hiA / hiZ;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int ComputeLightScreenBoundsScalar(const LightList &lights, const Matrix4x4 &view, const Matrix4x4 &proj, float imageWidth, float imageHeight, LightScreenBounds *bounds)
+{
+	float nearZ, farZ;
+	ProjectionDepthRange(proj, nearZ, farZ);
+
+	unsigned int numLights = lights.Count();
+	unsigned int numVisible = 0;
+	for(unsigned int i=0;i<numLights;i++)
+	{
+		LightScreenBounds &out = bounds[i];
+		if(lights.Type(i) != Light::POINT)
+		{
+			SetBoundsFullScreen(out, imageWidth, imageHeight, nearZ, farZ);
+			numVisible++;
+			continue;
+		}
+
+		Vector4 center = view * Vector4(lights.PositionX()[i], lights.PositionY()[i], lights.PositionZ()[i], 1.0f);
+		float radius = lights.OuterRadius()[i];
+
+		float minZ = center.z - radius > nearZ ? center.z - radius : nearZ;
+		float maxZ = center.z + radius < farZ ? center.z + radius : farZ;
+		if(minZ > maxZ)
+		{
+			SetBoundsEmpty(out);
+			continue;
+		}
+
+		float loX, hiX, loY, hiY;
+		ProjectedExtents(center.x, center.z, radius, nearZ, loX, hiX);
+		ProjectedExtents(center.y, center.z, radius, nearZ, loY, hiY);
+
+		// To pixels.  Screen y runs down.
+		float left = (proj.r[0][0] * loX + proj.r[0][2] + 1.0f) * 0.5f * imageWidth;
+		float right = (proj.r[0][0] * hiX + proj.r[0][2] + 1.0f) * 0.5f * imageWidth;
+		float top = (1.0f - proj.r[1][1] * hiY - proj.r[1][2]) * 0.5f * imageHeight;
+		float bottom = (1.0f - proj.r[1][1] * loY - proj.r[1][2]) * 0.5f * imageHeight;
+
+		left = left < 0.0f ? 0.0f : (left > imageWidth ? imageWidth : left);
+		right = right < 0.0f ? 0.0f : (right > imageWidth ? imageWidth : right);
+		top = top < 0.0f ? 0.0f : (top > imageHeight ? imageHeight : top);
+		bottom = bottom < 0.0f ? 0.0f : (bottom > imageHeight ? imageHeight : bottom);
+
+		out.rect.left = static_cast<LONG>(floorf(left));
+		out.rect.right = static_cast<LONG>(ceilf(right));
+		out.rect.top = static_cast<LONG>(floorf(top));
+		out.rect.bottom = static_cast<LONG>(ceilf(bottom));
+		out.minZ = minZ;
+		out.maxZ = maxZ;
+
+		if(out.rect.left >= out.rect.right || out.rect.top >= out.rect.bottom)
+		{
+			SetBoundsEmpty(out);
+			continue;
+		}
+
+		numVisible++;
+	}
+
+	return numVisible;
+}
+
+// ****************************************************************************
+// ProjectedExtents() for four circles, both answers worked out and selected
+// ****************************************************************************
+inline void ProjectedExtents4(__m128 a, __m128 z, __m128 r, __m128 nearZ, __m128 &lo, __m128 &hi)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 rSq = _mm_mul_ps(r, r);
+	__m128 dz = _mm_sub_ps(nearZ, z);
+	__m128 chord = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(rSq, _mm_mul_ps(dz, dz)), zero));
+	__m128 clipLo = _mm_div_ps(_mm_sub_ps(a, chord), nearZ);
+	__m128 clipHi = _mm_div_ps(_mm_add_ps(a, chord), nearZ);
+
+	__m128 lenSq = _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(z, z));
+	__m128 tangentSq = _mm_sub_ps(lenSq, rSq);
+	__m128 outside = _mm_cmpgt_ps(tangentSq, zero);
+
+	__m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(lenSq));
+	__m128 cosAngle = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(tangentSq, zero)), invLen);
+	__m128 sinAngle = _mm_mul_ps(r, invLen);
+
+	__m128 loA = _mm_sub_ps(_mm_mul_ps(a, cosAngle), _mm_mul_ps(z, sinAngle));
+	__m128 loZ = _mm_add_ps(_mm_mul_ps(a, sinAngle), _mm_mul_ps(z, cosAngle));
+	__m128 hiA = _mm_add_ps(_mm_mul_ps(a, cosAngle), _mm_mul_ps(z, sinAngle));
+	__m128 hiZ = _mm_sub_ps(_mm_mul_ps(z, cosAngle), _mm_mul_ps(a, sinAngle));
+
+	__m128 useLo = _mm_and_ps(outside, _mm_cmpge_ps(_mm_mul_ps(loZ, cosAngle), nearZ));
+	__m128 useHi = _mm_and_ps(outside, _mm_cmpge_ps(_mm_mul_ps(hiZ, cosAngle), nearZ));
+
+	lo = _mm_or_ps(_mm_and_ps(useLo, _mm_div_ps(loA, loZ)), _mm_andnot_ps(useLo, clipLo));
+	hi = _mm_or_ps(_mm_and_ps(useHi, _mm_div_ps(hiA, hiZ)), _mm_andnot_ps(useHi, clipHi));
+}
+
+// ****************************************************************************
+// Pixel coordinates are clamped to the screen first, so they're never
+// negative and truncation is floor
+// ****************************************************************************
+inline __m128i Floor4(__m128 v)
+{
+	return _mm_cvttps_epi32(v);
+}
+
+inline __m128i Ceil4(__m128 v)
+{
+	__m128i truncated = _mm_cvttps_epi32(v);
+	__m128 below = _mm_cmplt_ps(_mm_cvtepi32_ps(truncated), v);
+	return _mm_sub_epi32(truncated, _mm_castps_si128(below));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int ComputeLightScreenBounds(const LightList &lights, const Matrix4x4 &view, const Matrix4x4 &proj, float imageWidth, float imageHeight, LightScreenBounds *bounds)
+{
+	float nearZ, farZ;
+	ProjectionDepthRange(proj, nearZ, farZ);
+
+	__m128 viewRow[12];
+	for(int row=0;row<3;row++)
+	{
+		for(int col=0;col<4;col++)
+		{
+			viewRow[row * 4 + col] = _mm_set1_ps(view.r[row][col]);
+		}
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 nearZ4 = _mm_set1_ps(nearZ);
+	const __m128 farZ4 = _mm_set1_ps(farZ);
+	const __m128 scaleX = _mm_set1_ps(proj.r[0][0]);
+	const __m128 offsetX = _mm_set1_ps(proj.r[0][2]);
+	const __m128 scaleY = _mm_set1_ps(proj.r[1][1]);
+	const __m128 offsetY = _mm_set1_ps(proj.r[1][2]);
+	const __m128 halfWidth = _mm_set1_ps(0.5f * imageWidth);
+	const __m128 halfHeight = _mm_set1_ps(0.5f * imageHeight);
+	const __m128 width = _mm_set1_ps(imageWidth);
+	const __m128 height = _mm_set1_ps(imageHeight);
+
+	int32_t rect[4][4];
+	float depth[2][4];
+	float valid[4];
+
+	const float *posX = lights.PositionX();
+	const float *posY = lights.PositionY();
+	const float *posZ = lights.PositionZ();
+	const float *radius = lights.OuterRadius();
+
+	unsigned int numLights = lights.Count();
+	unsigned int numVisible = 0;
+	for(unsigned int base=0;base<numLights;base+=4)
+	{
+		// Padding lanes and other light types already have a sphere that
+		// never passes the depth test
+		unsigned int lanes = numLights - base < 4 ? numLights - base : 4;
+		__m128 px = _mm_load_ps(posX + base);
+		__m128 py = _mm_load_ps(posY + base);
+		__m128 pz = _mm_load_ps(posZ + base);
+		__m128 r = _mm_load_ps(radius + base);
+
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewRow[0], px), _mm_mul_ps(viewRow[1], py)), _mm_add_ps(_mm_mul_ps(viewRow[2], pz), viewRow[3]));
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewRow[4], px), _mm_mul_ps(viewRow[5], py)), _mm_add_ps(_mm_mul_ps(viewRow[6], pz), viewRow[7]));
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewRow[8], px), _mm_mul_ps(viewRow[9], py)), _mm_add_ps(_mm_mul_ps(viewRow[10], pz), viewRow[11]));
+
+		__m128 minZ = _mm_max_ps(_mm_sub_ps(cz, r), nearZ4);
+		__m128 maxZ = _mm_min_ps(_mm_add_ps(cz, r), farZ4);
+		__m128 inside = _mm_cmple_ps(minZ, maxZ);
+
+		__m128 loX, hiX, loY, hiY;
+		ProjectedExtents4(cx, cz, r, nearZ4, loX, hiX);
+		ProjectedExtents4(cy, cz, r, nearZ4, loY, hiY);
+
+		__m128 left = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(scaleX, loX), offsetX), one), halfWidth);
+		__m128 right = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(scaleX, hiX), offsetX), one), halfWidth);
+		__m128 top = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(scaleY, hiY)), offsetY), halfHeight);
+		__m128 bottom = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(scaleY, loY)), offsetY), halfHeight);
+
+		left = _mm_min_ps(_mm_max_ps(left, zero), width);
+		right = _mm_min_ps(_mm_max_ps(right, zero), width);
+		top = _mm_min_ps(_mm_max_ps(top, zero), height);
+		bottom = _mm_min_ps(_mm_max_ps(bottom, zero), height);
+
+		__m128i leftI = Floor4(left);
+		__m128i rightI = Ceil4(right);
+		__m128i topI = Floor4(top);
+		__m128i bottomI = Ceil4(bottom);
+
+		__m128i nonEmpty = _mm_and_si128(_mm_cmplt_epi32(leftI, rightI), _mm_cmplt_epi32(topI, bottomI));
+		inside = _mm_and_ps(inside, _mm_castsi128_ps(nonEmpty));
+
+		// Unaligned stores, so the scatter arrays don't need an alignment
+		// attribute; they're always in the L1 anyway
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(rect[0]), _mm_and_si128(leftI, _mm_castps_si128(inside)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(rect[1]), _mm_and_si128(topI, _mm_castps_si128(inside)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(rect[2]), _mm_and_si128(rightI, _mm_castps_si128(inside)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(rect[3]), _mm_and_si128(bottomI, _mm_castps_si128(inside)));
+		_mm_storeu_ps(depth[0], _mm_and_ps(minZ, inside));
+		_mm_storeu_ps(depth[1], _mm_and_ps(maxZ, inside));
+		_mm_storeu_ps(valid, _mm_and_ps(inside, one));
+
+		// Scatter
+		for(unsigned int lane=0;lane<lanes;lane++)
+		{
+			LightScreenBounds &out = bounds[base + lane];
+			if(lights.Type(base + lane) != Light::POINT)
+			{
+				SetBoundsFullScreen(out, imageWidth, imageHeight, nearZ, farZ);
+				numVisible++;
+				continue;
+			}
+
+			out.rect.left = rect[0][lane];
+			out.rect.top = rect[1][lane];
+			out.rect.right = rect[2][lane];
+			out.rect.bottom = rect[3][lane];
+			out.minZ = depth[0][lane];
+			out.maxZ = depth[1][lane];
+			numVisible += valid[lane] != 0.0f ? 1 : 0;
+		}
+	}
+
+	return numVisible;
+}
+
+} // namespace Helix
@@ -0,0 +1,31 @@
+#ifndef LIGHTBOUNDS_H
+#define LIGHTBOUNDS_H
+
+#include "Light.h"
+
+namespace Helix {
+
+class Matrix4x4;
+
+// Where a light's sphere of influence lands on screen
+struct LightScreenBounds
+{
+	D3D11_RECT	rect;		// Pixels, right and bottom exclusive.  Empty if the light can't touch the screen.
+	float		minZ;		// View space depth range of the sphere between the near and far planes
+	float		maxZ;
+};
+
+// Projects the outer radius sphere of every point light through the camera to
+// the smallest screen rectangle that covers it, clipped against the near
+// plane.  Lights that aren't POINT lights cover the whole screen.  proj must be
+// a perspective projection like Matrix4x4::SetProjectionFOV() builds.  Returns
+// the number of lights with a non-empty rectangle.  bounds needs room for
+// lights.Count() entries.  Four lights at a time.
+unsigned int	ComputeLightScreenBounds(const LightList &lights, const Matrix4x4 &view, const Matrix4x4 &proj, float imageWidth, float imageHeight, LightScreenBounds *bounds);
+
+// One light at a time, for reference
+unsigned int	ComputeLightScreenBoundsScalar(const LightList &lights, const Matrix4x4 &view, const Matrix4x4 &proj, float imageWidth, float imageHeight, LightScreenBounds *bounds);
+
+} // namespace Helix
+
+#endif // LIGHTBOUNDS_H
@@ -0,0 +1,383 @@
+#include <malloc.h>
+#include <math.h>
+#include <emmintrin.h>
+#include "LightClusters.h"
+#include "Math/Matrix.h"
+#include "Kernel/JobSystem.h"
+
+namespace Helix {
+
+const unsigned int	LIGHTS_PER_RANGE_JOB = 256;
+
+// ****************************************************************************
+// ****************************************************************************
+LightClusters::LightClusters()
+: m_nearZ(0.0f)
+, m_farZ(0.0f)
+, m_xScale(0.0f)
+, m_yScale(0.0f)
+, m_tileScaleX(0.0f)
+, m_tileScaleY(0.0f)
+, m_tilesX(0)
+, m_tilesY(0)
+, m_numLights(0)
+, m_posX(NULL)
+, m_posY(NULL)
+, m_posZ(NULL)
+, m_radius(NULL)
+, m_rangeCapacity(0)
+, m_rangeData(NULL)
+, m_minX(NULL)
+, m_maxX(NULL)
+, m_minY(NULL)
+, m_maxY(NULL)
+, m_minZ(NULL)
+, m_maxZ(NULL)
+, m_clusterCapacity(0)
+, m_clusterOffsets(NULL)
+, m_clusterCounts(NULL)
+, m_indexCapacity(0)
+, m_lightIndices(NULL)
+, m_numLightIndices(0)
+, m_numBinnedLights(0)
+{
+	memset(m_view, 0, sizeof(m_view));
+	memset(m_sliceStart, 0, sizeof(m_sliceStart));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+LightClusters::~LightClusters()
+{
+	_aligned_free(m_rangeData);
+	delete [] m_clusterOffsets;
+	delete [] m_clusterCounts;
+	delete [] m_lightIndices;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::ReserveRanges(unsigned int count)
+{
+	if(count <= m_rangeCapacity)
+		return;
+
+	unsigned int capacity = m_rangeCapacity > 0 ? m_rangeCapacity : 256;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	_aligned_free(m_rangeData);
+	m_rangeData = static_cast<int32_t *>(_aligned_malloc(6 * capacity * sizeof(int32_t), 16));
+	_ASSERT(m_rangeData != NULL);
+
+	m_minX = m_rangeData;
+	m_maxX = m_rangeData + capacity;
+	m_minY = m_rangeData + 2 * capacity;
+	m_maxY = m_rangeData + 3 * capacity;
+	m_minZ = m_rangeData + 4 * capacity;
+	m_maxZ = m_rangeData + 5 * capacity;
+
+	m_rangeCapacity = capacity;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::ReserveClusters(unsigned int count)
+{
+	if(count <= m_clusterCapacity)
+		return;
+
+	delete [] m_clusterOffsets;
+	delete [] m_clusterCounts;
+
+	m_clusterCapacity = count;
+	m_clusterOffsets = new uint32_t[m_clusterCapacity];
+	m_clusterCounts = new uint32_t[m_clusterCapacity];
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::ReserveIndices(unsigned int count)
+{
+	if(count <= m_indexCapacity)
+		return;
+
+	unsigned int capacity = m_indexCapacity > 0 ? m_indexCapacity : 1024;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	delete [] m_lightIndices;
+	m_lightIndices = new uint32_t[capacity];
+	m_indexCapacity = capacity;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int LightClusters::DepthSlice(float viewZ) const
+{
+	unsigned int slice = 0;
+	for(unsigned int i=1;i<DEPTH_SLICES;i++)
+	{
+		slice += (viewZ >= m_sliceStart[i]) ? 1 : 0;
+	}
+	return slice;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::Build(const LightList &lights, const Matrix4x4 &viewMatrix, const ClusterCamera &camera)
+{
+	_ASSERT(camera.nearZ > 0.0f && camera.farZ > camera.nearZ);
+
+	for(int row=0;row<3;row++)
+	{
+		for(int col=0;col<4;col++)
+		{
+			m_view[row * 4 + col] = viewMatrix.r[row][col];
+		}
+	}
+
+	// Same scale factors as Matrix4x4::SetProjectionFOV()
+	m_nearZ = camera.nearZ;
+	m_farZ = camera.farZ;
+	m_yScale = 1.0f / tan(camera.fovY / 2.0f);
+	m_xScale = m_yScale / camera.aspect;
+
+	float depthRatio = camera.farZ / camera.nearZ;
+	for(unsigned int i=0;i<DEPTH_SLICES;i++)
+	{
+		m_sliceStart[i] = camera.nearZ * pow(depthRatio, static_cast<float>(i) / DEPTH_SLICES);
+	}
+
+	m_tilesX = (static_cast<unsigned int>(camera.imageWidth) + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (static_cast<unsigned int>(camera.imageHeight) + TILE_SIZE - 1) / TILE_SIZE;
+	m_tileScaleX = 0.5f * camera.imageWidth / TILE_SIZE;
+	m_tileScaleY = 0.5f * camera.imageHeight / TILE_SIZE;
+	ReserveClusters(NumClusters());
+
+	// The list is already padded, and anything that isn't a point light has a
+	// negative radius, which never survives the depth test
+	m_numLights = lights.PaddedCount();
+	m_posX = lights.PositionX();
+	m_posY = lights.PositionY();
+	m_posZ = lights.PositionZ();
+	m_radius = lights.OuterRadius();
+	ReserveRanges(m_numLights);
+
+	ParallelFor(m_numLights, LIGHTS_PER_RANGE_JOB, ComputeRangesJob, this);
+	ParallelFor(DEPTH_SLICES, 1, CountSlicesJob, this);
+
+	// Pack the lists back to back
+	unsigned int total = 0;
+	unsigned int numClusters = NumClusters();
+	for(unsigned int i=0;i<numClusters;i++)
+	{
+		m_clusterOffsets[i] = total;
+		total += m_clusterCounts[i];
+	}
+	m_numLightIndices = total;
+	ReserveIndices(total);
+
+	m_numBinnedLights = 0;
+	for(unsigned int i=0;i<m_numLights;i++)
+	{
+		m_numBinnedLights += (m_minZ[i] <= m_maxZ[i]) ? 1 : 0;
+	}
+
+	ParallelFor(DEPTH_SLICES, 1, FillSlicesJob, this);
+}
+
+// ****************************************************************************
+// Tile and slice range of the view space box around each light, four lights at
+// a time.  A coordinate's extreme over the box is at one of its corners, so
+// the screen extents come from the near or far depth of the box depending on
+// which side of the view axis the edge is on.  Lights outside the frustum get
+// an empty slice range; everything else is clamped to the grid.
+// ****************************************************************************
+void LightClusters::ComputeRanges(unsigned int begin, unsigned int end)
+{
+	_ASSERT((begin & 3) == 0 && (end & 3) == 0);
+
+	__m128 view[12];
+	for(int i=0;i<12;i++)
+	{
+		view[i] = _mm_set1_ps(m_view[i]);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 nearZ = _mm_set1_ps(m_nearZ);
+	const __m128 farZ = _mm_set1_ps(m_farZ);
+	const __m128 xScale = _mm_set1_ps(m_xScale);
+	const __m128 yScale = _mm_set1_ps(m_yScale);
+
+	// NDC to tiles.  Screen y runs down, NDC y runs up.
+	const __m128 xTiles = _mm_set1_ps(m_tileScaleX);
+	const __m128 yTiles = _mm_set1_ps(m_tileScaleY);
+	const __m128 lastTileX = _mm_set1_ps(static_cast<float>(m_tilesX - 1));
+	const __m128 lastTileY = _mm_set1_ps(static_cast<float>(m_tilesY - 1));
+
+	__m128 sliceStart[DEPTH_SLICES];
+	for(unsigned int i=1;i<DEPTH_SLICES;i++)
+	{
+		sliceStart[i] = _mm_set1_ps(m_sliceStart[i]);
+	}
+	const __m128i noSlice = _mm_set1_epi32(DEPTH_SLICES);
+
+	for(unsigned int base=begin;base<end;base+=4)
+	{
+		__m128 px = _mm_load_ps(m_posX + base);
+		__m128 py = _mm_load_ps(m_posY + base);
+		__m128 pz = _mm_load_ps(m_posZ + base);
+		__m128 radius = _mm_load_ps(m_radius + base);
+
+		// To view space
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(view[0], px), _mm_mul_ps(view[1], py)), _mm_add_ps(_mm_mul_ps(view[2], pz), view[3]));
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(view[4], px), _mm_mul_ps(view[5], py)), _mm_add_ps(_mm_mul_ps(view[6], pz), view[7]));
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(view[8], px), _mm_mul_ps(view[9], py)), _mm_add_ps(_mm_mul_ps(view[10], pz), view[11]));
+
+		// Depth range inside the frustum
+		__m128 zMin = _mm_max_ps(_mm_sub_ps(cz, radius), nearZ);
+		__m128 zMax = _mm_min_ps(_mm_add_ps(cz, radius), farZ);
+		__m128 inside = _mm_cmple_ps(zMin, zMax);
+
+		// x/z and y/z are smallest at the near depth for an edge left of or
+		// below the axis and at the far depth otherwise; the other way round
+		// for the largest
+		__m128 lo = _mm_sub_ps(cx, radius);
+		__m128 hi = _mm_add_ps(cx, radius);
+		__m128 loNeg = _mm_cmplt_ps(lo, zero);
+		__m128 hiPos = _mm_cmpgt_ps(hi, zero);
+		__m128 minX = _mm_div_ps(_mm_mul_ps(lo, xScale), _mm_or_ps(_mm_and_ps(loNeg, zMin), _mm_andnot_ps(loNeg, zMax)));
+		__m128 maxX = _mm_div_ps(_mm_mul_ps(hi, xScale), _mm_or_ps(_mm_and_ps(hiPos, zMin), _mm_andnot_ps(hiPos, zMax)));
+
+		lo = _mm_sub_ps(cy, radius);
+		hi = _mm_add_ps(cy, radius);
+		loNeg = _mm_cmplt_ps(lo, zero);
+		hiPos = _mm_cmpgt_ps(hi, zero);
+		__m128 minY = _mm_div_ps(_mm_mul_ps(lo, yScale), _mm_or_ps(_mm_and_ps(loNeg, zMin), _mm_andnot_ps(loNeg, zMax)));
+		__m128 maxY = _mm_div_ps(_mm_mul_ps(hi, yScale), _mm_or_ps(_mm_and_ps(hiPos, zMin), _mm_andnot_ps(hiPos, zMax)));
+
+		inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmple_ps(minX, one), _mm_cmpge_ps(maxX, minusOne)));
+		inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmple_ps(minY, one), _mm_cmpge_ps(maxY, minusOne)));
+
+		minX = _mm_max_ps(minX, minusOne);
+		maxX = _mm_min_ps(maxX, one);
+		minY = _mm_max_ps(minY, minusOne);
+		maxY = _mm_min_ps(maxY, one);
+
+		// Everything is non-negative from here, so truncation is floor
+		__m128 tileX0 = _mm_min_ps(_mm_mul_ps(_mm_add_ps(minX, one), xTiles), lastTileX);
+		__m128 tileX1 = _mm_min_ps(_mm_mul_ps(_mm_add_ps(maxX, one), xTiles), lastTileX);
+		__m128 tileY0 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(one, maxY), yTiles), lastTileY);
+		__m128 tileY1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(one, minY), yTiles), lastTileY);
+
+		// Slice = how many slice starts are at or in front of the depth
+		__m128 slice0 = zero;
+		__m128 slice1 = zero;
+		for(unsigned int i=1;i<DEPTH_SLICES;i++)
+		{
+			slice0 = _mm_add_ps(slice0, _mm_and_ps(_mm_cmpge_ps(zMin, sliceStart[i]), one));
+			slice1 = _mm_add_ps(slice1, _mm_and_ps(_mm_cmpge_ps(zMax, sliceStart[i]), one));
+		}
+
+		__m128i insideMask = _mm_castps_si128(inside);
+		__m128i z0 = _mm_or_si128(_mm_and_si128(insideMask, _mm_cvttps_epi32(slice0)), _mm_andnot_si128(insideMask, noSlice));
+
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_minX + base), _mm_cvttps_epi32(tileX0));
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_maxX + base), _mm_cvttps_epi32(tileX1));
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_minY + base), _mm_cvttps_epi32(tileY0));
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_maxY + base), _mm_cvttps_epi32(tileY1));
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_minZ + base), z0);
+		_mm_store_si128(reinterpret_cast<__m128i *>(m_maxZ + base), _mm_cvttps_epi32(slice1));
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::CountSlice(unsigned int slice)
+{
+	uint32_t *counts = m_clusterCounts + ClusterIndex(0, 0, slice);
+	memset(counts, 0, m_tilesX * m_tilesY * sizeof(uint32_t));
+
+	int s = static_cast<int>(slice);
+	for(unsigned int i=0;i<m_numLights;i++)
+	{
+		if(s < m_minZ[i] || s > m_maxZ[i])
+			continue;
+
+		for(int y=m_minY[i];y<=m_maxY[i];y++)
+		{
+			uint32_t *row = counts + y * m_tilesX;
+			for(int x=m_minX[i];x<=m_maxX[i];x++)
+			{
+				row[x]++;
+			}
+		}
+	}
+}
+
+// ****************************************************************************
+// Walks the lights in the same order as CountSlice(), rebuilding the counts as
+// it goes, so each cluster's list comes out sorted.
+// ****************************************************************************
+void LightClusters::FillSlice(unsigned int slice)
+{
+	unsigned int first = ClusterIndex(0, 0, slice);
+	uint32_t *counts = m_clusterCounts + first;
+	const uint32_t *offsets = m_clusterOffsets + first;
+	memset(counts, 0, m_tilesX * m_tilesY * sizeof(uint32_t));
+
+	int s = static_cast<int>(slice);
+	for(unsigned int i=0;i<m_numLights;i++)
+	{
+		if(s < m_minZ[i] || s > m_maxZ[i])
+			continue;
+
+		for(int y=m_minY[i];y<=m_maxY[i];y++)
+		{
+			unsigned int rowStart = y * m_tilesX;
+			for(int x=m_minX[i];x<=m_maxX[i];x++)
+			{
+				unsigned int cluster = rowStart + x;
+				m_lightIndices[offsets[cluster] + counts[cluster]++] = i;
+			}
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::ComputeRangesJob(void *data, unsigned int begin, unsigned int end)
+{
+	static_cast<LightClusters *>(data)->ComputeRanges(begin, end);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::CountSlicesJob(void *data, unsigned int begin, unsigned int end)
+{
+	LightClusters *clusters = static_cast<LightClusters *>(data);
+	for(unsigned int slice=begin;slice<end;slice++)
+	{
+		clusters->CountSlice(slice);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void LightClusters::FillSlicesJob(void *data, unsigned int begin, unsigned int end)
+{
+	LightClusters *clusters = static_cast<LightClusters *>(data);
+	for(unsigned int slice=begin;slice<end;slice++)
+	{
+		clusters->FillSlice(slice);
+	}
+}
+
+} // namespace Helix
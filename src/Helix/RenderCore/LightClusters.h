@@ -0,0 +1,134 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include "Light.h"
+
+namespace Helix {
+
+class Matrix4x4;
+
+// The camera a cluster grid is built for
+struct ClusterCamera
+{
+	float	fovY;
+	float	aspect;
+	float	nearZ;
+	float	farZ;
+	float	imageWidth;
+	float	imageHeight;
+};
+
+// ****************************************************************************
+// LightClusters
+//
+// Bins point lights into a 3D grid of screen tiles by view space depth slices
+// so a lighting pass only has to look at the lights whose sphere of influence
+// (the outer radius) can reach a pixel's cluster.  Slices are exponential in
+// depth, so clusters stay roughly cube shaped all the way out to the far plane.
+//
+// Each light's tile and slice range is worked out four at a time with SSE,
+// then the lights are binned one depth slice per job, so every job owns its
+// own clusters and nothing is shared.  The result is one packed index list
+// with an offset and count per cluster, ready to upload as-is.
+//
+// The lighting pass still draws a quad per light and no pass reads the
+// clusters yet, so the render thread doesn't build them.
+// ****************************************************************************
+class LightClusters
+{
+public:
+	enum
+	{
+		TILE_SIZE =		64,		// Pixels on a side
+		DEPTH_SLICES =	16,
+	};
+
+	LightClusters();
+	~LightClusters();
+
+	// Only POINT lights are binned; the rest light every pixel anyway.  The
+	// lights are read in place, so they have to stay put until Build() returns.
+	void	Build(const LightList &lights, const Matrix4x4 &viewMatrix, const ClusterCamera &camera);
+
+	unsigned int	NumTilesX() const		{ return m_tilesX; }
+	unsigned int	NumTilesY() const		{ return m_tilesY; }
+	unsigned int	NumClusters() const		{ return m_tilesX * m_tilesY * DEPTH_SLICES; }
+	unsigned int	ClusterIndex(unsigned int tileX, unsigned int tileY, unsigned int slice) const
+	{
+		return (slice * m_tilesY + tileY) * m_tilesX + tileX;
+	}
+
+	// Slice a view space depth falls in
+	unsigned int	DepthSlice(float viewZ) const;
+
+	// A cluster's lights are ClusterCounts()[c] entries of LightIndices()
+	// starting at ClusterOffsets()[c].  Indices are into the list given to
+	// Build() and are in ascending order within a cluster.
+	const uint32_t *	ClusterOffsets() const	{ return m_clusterOffsets; }
+	const uint32_t *	ClusterCounts() const	{ return m_clusterCounts; }
+	const uint32_t *	LightIndices() const	{ return m_lightIndices; }
+	unsigned int		NumLightIndices() const	{ return m_numLightIndices; }
+
+	// Lights that landed in at least one cluster
+	unsigned int		NumBinnedLights() const	{ return m_numBinnedLights; }
+
+private:
+	LightClusters(const LightClusters &other);
+	LightClusters & operator=(const LightClusters &other);
+
+	void	ReserveRanges(unsigned int count);
+	void	ReserveClusters(unsigned int count);
+	void	ReserveIndices(unsigned int count);
+
+	void	ComputeRanges(unsigned int begin, unsigned int end);
+	void	CountSlice(unsigned int slice);
+	void	FillSlice(unsigned int slice);
+
+	static void	ComputeRangesJob(void *data, unsigned int begin, unsigned int end);
+	static void	CountSlicesJob(void *data, unsigned int begin, unsigned int end);
+	static void	FillSlicesJob(void *data, unsigned int begin, unsigned int end);
+
+	// Build() inputs
+	float			m_view[12];						// Top three rows of the view matrix
+	float			m_nearZ;
+	float			m_farZ;
+	float			m_xScale;						// Projection scale factors
+	float			m_yScale;
+	float			m_tileScaleX;					// Half the screen size in tiles
+	float			m_tileScaleY;
+	float			m_sliceStart[DEPTH_SLICES];		// View depth where each slice begins
+	unsigned int	m_tilesX;
+	unsigned int	m_tilesY;
+
+	// The light list's streams, padded to a multiple of 4 with lights that
+	// never bin
+	unsigned int	m_numLights;
+	const float *	m_posX;
+	const float *	m_posY;
+	const float *	m_posZ;
+	const float *	m_radius;
+
+	// Inclusive tile and slice range for each light.  Empty when the light
+	// is off screen: m_minZ > m_maxZ.
+	unsigned int	m_rangeCapacity;
+	int32_t *		m_rangeData;
+	int32_t *		m_minX;
+	int32_t *		m_maxX;
+	int32_t *		m_minY;
+	int32_t *		m_maxY;
+	int32_t *		m_minZ;
+	int32_t *		m_maxZ;
+
+	unsigned int	m_clusterCapacity;
+	uint32_t *		m_clusterOffsets;
+	uint32_t *		m_clusterCounts;
+
+	unsigned int	m_indexCapacity;
+	uint32_t *		m_lightIndices;
+	unsigned int	m_numLightIndices;
+	unsigned int	m_numBinnedLights;
+};
+
+} // namespace Helix
+
+#endif // LIGHTCLUSTERS_H
@@ -3,7 +3,10 @@
 typedef std::map<const std::string, HXMaterial *>	MaterialMap;
 struct MaterialState
 {
+	MaterialState() : m_nextId(0) {}
+
 	MaterialMap		m_database;
+	unsigned int	m_nextId;
 };
 MaterialState	*m_materialState = NULL;
 
@@ -21,6 +24,7 @@ HXMaterial * HXCreateMaterial(const std::string &name, LuaPlus::LuaObject &objec
 {
 	HXMaterial * newMat = new HXMaterial;
 	newMat->m_name = name;
+	newMat->m_id = m_materialState->m_nextId++;
 
 	// Load our shader
 	LuaPlus::LuaObject obj = object["Shader"];
@@ -34,16 +38,24 @@ HXMaterial * HXCreateMaterial(const std::string &name, LuaPlus::LuaObject &objec
 	}
 
 	// Load the shader
-	HXShader *shader = HXLoadShader(newMat->m_shaderName);
+	newMat->m_shader = HXLoadShader(newMat->m_shaderName);
+	_ASSERT(newMat->m_shader != NULL);
 	
 	// Make sure we can load the associated texture
 	// Texture names wrapped in []'s signify a render target or other
 	// system texture
-	if(newMat->m_textureName.empty() || (newMat->m_textureName[0] == '[' && newMat->m_textureName[newMat->m_textureName.length()-1] == ']') )
+	if(newMat->m_textureName.empty())
 		return newMat;
 
-	HXTexture *tex = HXLoadTexture(newMat->m_textureName);
-	_ASSERT(tex != NULL);
+	if(newMat->m_textureName[0] == '[' && newMat->m_textureName[newMat->m_textureName.length()-1] == ']')
+	{
+		// System textures are created before any material is loaded
+		newMat->m_texture = HXGetTextureByName(newMat->m_textureName);
+		return newMat;
+	}
+
+	newMat->m_texture = HXLoadTexture(newMat->m_textureName);
+	_ASSERT(newMat->m_texture != NULL);
 
 	return newMat;
 }
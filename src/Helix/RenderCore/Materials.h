@@ -4,11 +4,21 @@
 #include <map>
 #include <string>
 
+struct HXShader;
+struct HXTexture;
+
 struct HXMaterial
 {
+	HXMaterial() : m_id(0), m_shader(NULL), m_texture(NULL) {}
+
 	std::string		m_name;
+	unsigned int	m_id;				// Small unique id used to build draw sort keys
 	std::string		m_shaderName;
 	std::string		m_textureName;
+
+	// Resolved at load time so the renderer never has to look names up
+	HXShader *		m_shader;
+	HXTexture *		m_texture;
 };
 
 void			HXInitializeMaterials();
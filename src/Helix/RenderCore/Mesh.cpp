@@ -1,255 +1,512 @@
 #include "VDecls.h"
 #include "RenderMgr.h"
+#include "RenderDevice.h"
 #include "Materials.h"
+#include "MeshBuild.h"
+#include "MeshFile.h"
+#include "MeshListParser.h"
+#include "Utility/MappedFile.h"
 
 namespace Helix {
+
+unsigned int	m_nextMeshId = 0;
+
+// Going down to a coarser level needs its error this far under the limit, so
+// a mesh sitting right at a switch distance doesn't flip every frame
+const float		LOD_HYSTERESIS = 0.75f;
+
+// ****************************************************************************
+// How a declaration element is packed, or VERTEX_FORMAT_NONE if the
+// declaration doesn't have it
+// ****************************************************************************
+inline VertexFormat DeclVertexFormat(HXVertexDecl &decl, const char *semanticName, unsigned int &offset)
+{
+	int elementOffset = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	offset = 0;
+	if(!HXDeclHasSemantic(decl, semanticName, elementOffset, format))
+		return VERTEX_FORMAT_NONE;
+
+	offset = elementOffset;
+	switch(format)
+	{
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return VERTEX_FORMAT_FLOAT32;
+
+	case DXGI_FORMAT_R16G16_FLOAT:
+		return VERTEX_FORMAT_FLOAT16;
+
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+		return VERTEX_FORMAT_UNORM16;
+
+	case DXGI_FORMAT_R16G16_SNORM:
+		return VERTEX_FORMAT_OCT_SNORM16;
+
+	case DXGI_FORMAT_R8G8_SNORM:
+		return VERTEX_FORMAT_OCT_SNORM8;
+
+	default:
+		_ASSERT(!"Meshes can't be packed into this vertex format");
+		return VERTEX_FORMAT_NONE;
+	}
+}
+
+// ****************************************************************************
+// UV sets past the first follow on from TEXCOORD's offset
+// ****************************************************************************
+inline void DeclVertexLayout(HXVertexDecl &decl, unsigned int numUVSets, VertexLayout &layout)
+{
+	layout.positionFormat = DeclVertexFormat(decl, "POSITION", layout.positionOffset);
+	layout.normalFormat = DeclVertexFormat(decl, "NORMAL", layout.normalOffset);
+	layout.uvFormat = DeclVertexFormat(decl, "TEXCOORD", layout.uvOffset);
+	layout.numUVSets = layout.uvFormat != VERTEX_FORMAT_NONE ? numUVSets : 0;
+	layout.vertexSize = decl.m_vertexSize;
+}
+
+// ****************************************************************************
+// A Lua list of vectors as a flat array
+// ****************************************************************************
+inline float * LuaVectors(LuaPlus::LuaObject &listObj, unsigned int components, unsigned int &count)
+{
+	count = listObj.IsTable() ? listObj.GetTableCount() : 0;
+	if(count == 0)
+		return NULL;
+
+	float *data = new float[count * components];
+	for(unsigned int index=0;index < count; index++)
+	{
+		LuaPlus::LuaObject vectorObj = listObj[index+1];
+		for(unsigned int component=0;component < components; component++)
+		{
+			data[index * components + component] = vectorObj[component+1].GetFloat();
+		}
+	}
+	return data;
+}
+
+// ****************************************************************************
+// A mesh or LOD table's Faces, Vertices, Normals and UVSets, as the
+// MeshListParser would have read them
+// ****************************************************************************
+inline void LuaMeshSourceLod(LuaPlus::LuaObject &lodObj, MeshSourceLod &lod)
+{
+	LuaPlus::LuaObject faceListObj = lodObj["Faces"];
+	_ASSERT(faceListObj.IsTable());
+
+	LuaPlus::LuaObject vertObj = lodObj["Vertices"];
+	_ASSERT(vertObj.IsTable());
+
+	lod.positions = LuaVectors(vertObj, 3, lod.numPositions);
+
+	LuaPlus::LuaObject normalsObj = lodObj["Normals"];
+	lod.normals = LuaVectors(normalsObj, 3, lod.numNormals);
+
+	LuaPlus::LuaObject uvSetsObj = lodObj["UVSets"];
+	lod.numUVSets = uvSetsObj.IsTable() ? uvSetsObj.GetTableCount() : 0;
+	_ASSERT(lod.numUVSets <= MESH_SOURCE_MAX_UV_SETS);
+	for(unsigned int uvSetIdx=0;uvSetIdx < lod.numUVSets; uvSetIdx++)
+	{
+		LuaPlus::LuaObject uvSetObj = uvSetsObj[uvSetIdx+1];
+		lod.uvs[uvSetIdx] = LuaVectors(uvSetObj, 2, lod.numUVs[uvSetIdx]);
+	}
+
+	lod.numTriangles = faceListObj.GetTableCount();
+	unsigned int cornerSize = MeshSourceCornerSize(lod);
+	lod.corners = new uint32_t[lod.numTriangles * 3 * cornerSize];
+
+	uint32_t *corner = lod.corners;
+	for(unsigned int faceIndex=1;faceIndex <= lod.numTriangles; faceIndex++)
+	{
+		LuaPlus::LuaObject faceObj = faceListObj[faceIndex];
+
+		// Triangles only
+		_ASSERT(faceObj.GetTableCount() == 3);
+		for(int faceVertIdx=1; faceVertIdx <= 3; faceVertIdx++)
+		{
+			LuaPlus::LuaObject faceVertObj = faceObj[faceVertIdx];
+
+			LuaPlus::LuaObject posIdxObj = faceVertObj["VertexIndex"];
+			_ASSERT(posIdxObj.IsInteger());
+			_ASSERT(static_cast<unsigned int>(posIdxObj.GetInteger()) < lod.numPositions);
+			corner[0] = posIdxObj.GetInteger();
+
+			LuaPlus::LuaObject normIdxObj = faceVertObj["NormalIndex"];
+			corner[1] = normIdxObj.IsInteger() ? normIdxObj.GetInteger() : 0;
+
+			LuaPlus::LuaObject uvIndicesObj = faceVertObj["UVIndices"];
+			_ASSERT(lod.numUVSets == 0 || static_cast<unsigned int>(uvIndicesObj.GetTableCount()) == lod.numUVSets);
+			for(unsigned int uvSetIdx=0;uvSetIdx < lod.numUVSets; uvSetIdx++)
+			{
+				LuaPlus::LuaObject uvIdxObj = uvIndicesObj[uvSetIdx+1];
+				_ASSERT(uvIdxObj.IsInteger());
+				corner[2 + uvSetIdx] = uvIdxObj.GetInteger();
+			}
+
+			corner += cornerSize;
+		}
+	}
+}
+
 // ****************************************************************************
 // ****************************************************************************
 Mesh::Mesh()
-: m_vertexBuffer(NULL)
-, m_indexBuffer(NULL)
-, m_numVertices(0)
-, m_numIndices(0)
-, m_numTriangles(0)
-, m_32bitIndices(false)
+: m_numLods(0)
+, m_material(NULL)
+, m_quantized(false)
+, m_occluderPositions(NULL)
+, m_numOccluderPositions(0)
+, m_occluderIndices(NULL)
 {
+	memset(m_lods, 0, sizeof(m_lods));
+	m_dequantize.SetIdentity();
+
+	// Level 0's id is the mesh's id, which callers may take before it loads
+	m_lods[0].id = m_nextMeshId++;
 }
 
 Mesh::~Mesh()
 {
-	if(m_vertexBuffer)
-		m_vertexBuffer->Release();
+	RenderDevice *pDevice = RenderMgr::GetInstance().GetRenderDevice();
+
+	for(unsigned int lodIndex=0;lodIndex<MAX_LODS;lodIndex++)
+	{
+		if(m_lods[lodIndex].vertexBuffer)
+			pDevice->Release(m_lods[lodIndex].vertexBuffer);
 
-	if(m_indexBuffer)
-		m_indexBuffer->Release();
+		if(m_lods[lodIndex].indexBuffer)
+			pDevice->Release(m_lods[lodIndex].indexBuffer);
+	}
+
+	delete [] m_occluderPositions;
+	delete [] m_occluderIndices;
 }
 
 // ****************************************************************************
+// Meshes/<filename>.hxmesh if it's fresh, otherwise the .lua, read by the
+// MeshListParser unless it's something only Lua understands
 // ****************************************************************************
 bool Mesh::Load(const std::string &filename)
 {
 	std::string fullPath;
 	fullPath = "Meshes/";
 	fullPath += filename;
-	fullPath += ".lua";
 
-	LuaPlus::LuaState *state = LuaPlus::LuaState::Create();
-	_ASSERT(state != NULL);
-	
-	int retVal = state->DoFile(fullPath.c_str());
-	_ASSERT(retVal == 0);
+	std::string luaPath = fullPath + ".lua";
+	std::string cookedPath = fullPath + ".hxmesh";
 
-	LuaPlus::LuaObject meshList = state->GetGlobals()["MeshList"];
-	_ASSERT(meshList.IsTable());
+	uint64_t luaTime = FileWriteTime(luaPath.c_str());
+	uint64_t cookedTime = FileWriteTime(cookedPath.c_str());
+	if(cookedTime != 0 && cookedTime >= luaTime)
+	{
+		MappedFile file;
+		if(file.Open(cookedPath.c_str()))
+		{
+			unsigned int numMeshes = 0;
+			const MeshFileMesh *meshes = MeshFileMeshes(file.Data(), file.Size(), numMeshes);
+			if(numMeshes > 0)
+			{
+				return Load(meshes[0], file.Data());
+			}
+		}
+	}
+
+	MeshFileWriter writer;
+	bool loaded;
 
-	LuaPlus::LuaObject meshObj = meshList[1];
+	MeshListParser parser;
+	if(ParseMeshListFile(luaPath, parser) && parser.NumMeshes() > 0)
+	{
+		loaded = Load(parser.GetMesh(0), &writer);
+	}
+	else
+	{
+		LuaPlus::LuaState *state = LuaPlus::LuaState::Create();
+		_ASSERT(state != NULL);
+		
+		int retVal = state->DoFile(luaPath.c_str());
+		_ASSERT(retVal == 0);
+
+		LuaPlus::LuaObject meshList = state->GetGlobals()["MeshList"];
+		_ASSERT(meshList.IsTable());
+
+		LuaPlus::LuaObject meshObj = meshList[1];
+		loaded = Load(meshObj, &writer);
+	}
 
-	return Load(meshObj);
+	if(loaded)
+	{
+		writer.Write(cookedPath.c_str());
+	}
+
+	return loaded;
 }
 // ****************************************************************************
+// Copies the mesh's tables into the same flat arrays the parser produces, so
+// both build through the one path
 // ****************************************************************************
-bool Mesh::Load(LuaPlus::LuaObject &meshObj)
+bool Mesh::Load(LuaPlus::LuaObject &meshObj, MeshFileWriter *writer)
 {
+	_ASSERT(meshObj.IsTable());
+
+	MeshSource source;
+	memset(source.lods, 0, sizeof(source.lods));
+
 	LuaPlus::LuaObject matObj = meshObj["Material"];
 	_ASSERT(matObj.IsString());
-	m_materialName = matObj.GetString();
+	source.material = matObj.GetString();
 
 	LuaPlus::LuaObject nameObj = meshObj["Name"];
 	_ASSERT(nameObj.IsString());
-	m_meshName = nameObj.GetString();
+	source.name = nameObj.GetString();
+
+	LuaPlus::LuaObject occluderObj = meshObj["Occluder"];
+	source.occluder = occluderObj.IsBoolean() && occluderObj.GetBoolean();
+
+	// The mesh itself is level 0, and the LODs list holds the rest, finest
+	// first
+	LuaMeshSourceLod(meshObj, source.lods[0]);
+	source.numLods = 1;
+
+	LuaPlus::LuaObject lodListObj = meshObj["LODs"];
+	if(lodListObj.IsTable())
+	{
+		int numLods = lodListObj.GetTableCount();
+		_ASSERT(numLods < MAX_LODS);
+		for(int lodIndex=1;lodIndex <= numLods && source.numLods < MAX_LODS; lodIndex++)
+		{
+			LuaPlus::LuaObject lodObj = lodListObj[lodIndex];
+			_ASSERT(lodObj.IsTable());
+
+			LuaPlus::LuaObject errorObj = lodObj["Error"];
+			_ASSERT(errorObj.IsNumber());
+
+			MeshSourceLod &lod = source.lods[source.numLods++];
+			LuaMeshSourceLod(lodObj, lod);
+			lod.error = errorObj.GetFloat();
+		}
+	}
 
-	return CreatePlatformData(m_meshName,meshObj);
+	bool loaded = Load(source, writer);
+
+	for(unsigned int lodIndex=0;lodIndex < source.numLods; lodIndex++)
+	{
+		ReleaseMeshSourceLod(source.lods[lodIndex]);
+	}
+
+	return loaded;
 }
 // ****************************************************************************
 // ****************************************************************************
-bool Mesh::CreatePlatformData(const std::string &name, LuaPlus::LuaObject &meshObj)
+bool Mesh::Load(const MeshSource &source, MeshFileWriter *writer)
 {
-	_ASSERT(meshObj.IsTable());
+	m_materialName = source.material;
+	m_meshName = source.name;
 
-	LuaPlus::LuaObject faceListObj = meshObj["Faces"];
-	_ASSERT(faceListObj.IsTable());
+	return CreatePlatformData(source, writer);
+}
+// ****************************************************************************
+// Everything loading from source works out is already in the file, so this
+// is just pointing buffer creation at the blobs.  Fails if the material's shader
+// has moved on to a different vertex declaration since the file was cooked.
+// ****************************************************************************
+bool Mesh::Load(const MeshFileMesh &meshData, const uint8_t *fileData)
+{
+	_ASSERT(m_numLods == 0);
 
-	LuaPlus::LuaObject vertObj = meshObj["Vertices"];
-	_ASSERT(vertObj.IsTable());
+	m_meshName = meshData.name;
+	m_materialName = meshData.material;
 
-	LuaPlus::LuaObject normalsObj = meshObj["Normals"];
-	_ASSERT(normalsObj.IsTable());
+	m_material = HXLoadMaterial(m_materialName);
+	_ASSERT(m_material != NULL);
 
-	LuaPlus::LuaObject uvSetsObj = meshObj["UVSets"];
-	_ASSERT(uvSetsObj.IsTable());
+	HXVertexDecl &decl = *m_material->m_shader->m_decl;
+	if(decl.m_name != meshData.vertexDecl || decl.m_vertexSize != static_cast<int>(meshData.vertexSize))
+	{
+		_ASSERT(!"Cooked mesh doesn't match its shader's vertex declaration");
+		return false;
+	}
 
-	LuaPlus::LuaObject nameObj = meshObj["Name"];
-	_ASSERT(nameObj.IsString());
+	m_bounds.minPt = Helix::Vector3(meshData.boundsMin[0], meshData.boundsMin[1], meshData.boundsMin[2]);
+	m_bounds.maxPt = Helix::Vector3(meshData.boundsMax[0], meshData.boundsMax[1], meshData.boundsMax[2]);
+	SetDequantize();
 
-	// Fill in the vertex buffer
-	HXMaterial *mat = HXLoadMaterial(m_materialName);
-	_ASSERT(mat != NULL);
+	// The occlusion buffer reads these every frame, long after the file's
+	// gone, so they get their own copy
+	if(meshData.flags & MESH_FILE_OCCLUDER)
+	{
+		m_numOccluderPositions = meshData.numOccluderPositions;
+		m_occluderPositions = new float[m_numOccluderPositions * 3];
+		memcpy(m_occluderPositions, fileData + meshData.occluderPositionOffset, m_numOccluderPositions * 3 * sizeof(float));
 
-	HXShader *shader = HXGetShaderByName(mat->m_shaderName);
-	_ASSERT(shader != NULL);
+		m_occluderIndices = new uint32_t[meshData.numOccluderTriangles * 3];
+		memcpy(m_occluderIndices, fileData + meshData.occluderIndexOffset, meshData.numOccluderTriangles * 3 * sizeof(uint32_t));
+	}
 
-	int posOffset = 0;
-	int normOffset = 0;
-	int tex1Offset = 0;
+	for(unsigned int lodIndex=0;lodIndex < meshData.numLods && lodIndex < MAX_LODS; lodIndex++)
+	{
+		const MeshFileLod &lodData = meshData.lods[lodIndex];
 
-	HXVertexDecl &decl = *shader->m_decl;
-	int vertexSize = decl.m_vertexSize;
-	bool havePosData = HXDeclHasSemantic(decl,"POSITION",posOffset);
-	bool haveNormData = HXDeclHasSemantic(decl,"NORMAL",normOffset);
-	bool haveTex1Data = HXDeclHasSemantic(decl,"TEXCOORD",tex1Offset);
+		MeshLod &lod = m_lods[lodIndex];
+		if(lodIndex > 0)
+		{
+			lod.id = m_nextMeshId++;
+		}
+		lod.error = lodData.error;
+		lod.numVertices = lodData.numVertices;
+		lod.numIndices = lodData.numIndices;
+		lod.numTriangles = lodData.numIndices / 3;
+		lod.indices32 = lodData.indexSize == 4;
+
+		CreateLodBuffers(lod, fileData + lodData.vertexOffset, meshData.vertexSize, fileData + lodData.indexOffset);
+		m_numLods++;
+	}
 
-	m_numTriangles = faceListObj.GetTableCount();
-	for(unsigned int faceIndex=1;faceIndex <= m_numTriangles; faceIndex++)
-	{
-		LuaPlus::LuaObject &faceObj = faceListObj[faceIndex];
+	_ASSERT(!IsOccluder() || meshData.numOccluderTriangles == m_lods[0].numTriangles);
+	return true;
+}
+// ****************************************************************************
+// ****************************************************************************
+bool Mesh::CreatePlatformData(const MeshSource &source, MeshFileWriter *writer)
+{
+	_ASSERT(source.numLods > 0 && source.numLods <= MAX_LODS);
+	const MeshSourceLod &meshLod = source.lods[0];
 
-		// Triangles only
-		_ASSERT(faceObj.GetTableCount() == 3);
-		m_numVertices += 3;
+	// Object space bounds for culling
+	float boundsMin[3];
+	float boundsMax[3];
+	MeshSourceBounds(meshLod, boundsMin, boundsMax);
+	m_bounds.minPt = Helix::Vector3(boundsMin[0], boundsMin[1], boundsMin[2]);
+	m_bounds.maxPt = Helix::Vector3(boundsMax[0], boundsMax[1], boundsMax[2]);
+
+	m_material = HXLoadMaterial(m_materialName);
+	_ASSERT(m_material != NULL);
+	SetDequantize();
+
+	if(writer != NULL)
+	{
+		const HXVertexDecl &decl = *m_material->m_shader->m_decl;
+		writer->BeginMesh(m_meshName.c_str(), m_materialName.c_str(), decl.m_name.c_str(), decl.m_vertexSize, boundsMin, boundsMax);
 	}
 
-	_ASSERT(m_vertexBuffer == NULL);
-	_ASSERT(m_indexBuffer == NULL);
+	if(source.occluder)
+	{
+		CreateOccluderData(meshLod);
 
-	// Create a system memory buffer for our vertices
-	char *vb = new char[ m_numVertices * vertexSize ];
+		if(writer != NULL)
+		{
+			writer->SetOccluder(m_occluderPositions, m_numOccluderPositions, m_occluderIndices, meshLod.numTriangles);
+		}
+	}
 
-	// Fill it in
-	char *vertPos = vb;
-	for(unsigned int faceIndex=1;faceIndex <= m_numTriangles; faceIndex++)
+	VertexQuantizeError error = { 0.0f, 0.0f, 0.0f };
+	for(unsigned int lodIndex=0;lodIndex < source.numLods; lodIndex++)
 	{
-		LuaPlus::LuaObject faceObj = faceListObj[faceIndex];
-		
-		int numVerts = faceObj.GetTableCount();
-		for(int faceVertIdx=1; faceVertIdx <= numVerts; faceVertIdx++)
+		MeshLod &lod = m_lods[lodIndex];
+		if(lodIndex > 0)
 		{
-			char *dataPos = vertPos;
+			lod.id = m_nextMeshId++;
+			lod.error = source.lods[lodIndex].error;
+			_ASSERT(lod.error >= m_lods[lodIndex - 1].error);
+		}
 
-			// Get face vertex information
-			LuaPlus::LuaObject faceVertObj = faceObj[faceVertIdx];
-			if(havePosData)
-			{
-				// Get position information
-				float *posData = reinterpret_cast<float *>(dataPos);
+		CreateLodBuffers(lod, source.lods[lodIndex], writer, error);
+		m_numLods++;
+	}
 
-				LuaPlus::LuaObject posIdxObj = faceVertObj["VertexIndex"];
-				_ASSERT(posIdxObj.IsInteger());
+	char buffer[256];
+	_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "Mesh %s: %d byte vertices, worst error %g units position, %.3f degrees normal, %.3f texels UV at 1024\n", m_meshName.c_str(), m_material->m_shader->m_decl->m_vertexSize, error.position, error.normalDegrees, error.uvTexels);
+	OutputDebugString(buffer);
 
-				int vertIndex = posIdxObj.GetInteger();
-				LuaPlus::LuaObject PosObj = vertObj[vertIndex+1];
-				
-				posData[0] = PosObj[1].GetFloat();
-				posData[1] = PosObj[2].GetFloat();
-				posData[2] = PosObj[3].GetFloat();
+	if(writer != NULL)
+	{
+		writer->EndMesh();
+	}
 
-				dataPos += 3 * sizeof(float);
-			}
+	return true;
+}
 
-			if(haveNormData)
-			{
-				// Get normal information
-				float *normData = reinterpret_cast<float *>(dataPos);
+// ****************************************************************************
+// Builds one level's vertex and index buffers from its corners and attribute
+// arrays, packed for the material's shader.  What packing loses is added to
+// error.
+// ****************************************************************************
+void Mesh::CreateLodBuffers(MeshLod &lod, const MeshSourceLod &source, MeshFileWriter *writer, VertexQuantizeError &error)
+{
+	_ASSERT(lod.vertexBuffer == NULL);
+	_ASSERT(lod.indexBuffer == NULL);
 
-				LuaPlus::LuaObject normIdxObj = faceVertObj["NormalIndex"];
-				_ASSERT(normIdxObj.IsInteger());
+	// What the shader's vertices hold, and how it's packed
+	HXShader *shader = m_material->m_shader;
+	_ASSERT(shader != NULL);
 
-				int normIndex = normIdxObj.GetInteger();
-				LuaPlus::LuaObject normObj = normalsObj[normIndex+1];
-				normData[0] = normObj[1].GetFloat();
-				normData[1] = normObj[2].GetFloat();
-				normData[2] = normObj[3].GetFloat();
+	HXVertexDecl &decl = *shader->m_decl;
+	VertexLayout layout;
+	DeclVertexLayout(decl, source.numUVSets, layout);
 
-				dataPos += 3 * sizeof(float);
-			}
-			
-			if(haveTex1Data)
-			{
-				// Get UV information
-				LuaPlus::LuaObject uvIndicesObj = faceVertObj["UVIndices"];
-				for(size_t uvSetIdx=1;uvSetIdx <= uvIndicesObj.GetTableCount(); uvSetIdx++)
-				{
-					float *uvData = reinterpret_cast<float *>(dataPos);
-					LuaPlus::LuaObject uvIdxObj = uvIndicesObj[uvSetIdx];
-					_ASSERT(uvIdxObj.IsInteger());
-
-					int uvIndex = uvIdxObj.GetInteger();
-					LuaPlus::LuaObject uvSetObj = uvSetsObj[uvSetIdx];
-					LuaPlus::LuaObject uvObj = uvSetObj[uvIndex+1];
-
-					
-					uvData[0] = uvObj[1].GetFloat();
-					uvData[1] = uvObj[2].GetFloat();
-					dataPos += 2*sizeof(float);
-				}
-			}
+	// Every level is quantized within the whole mesh's bounds, so they all
+	// share the one dequantization matrix
+	float boundsMin[3] = { m_bounds.minPt.x, m_bounds.minPt.y, m_bounds.minPt.z };
+	float boundsMax[3] = { m_bounds.maxPt.x, m_bounds.maxPt.y, m_bounds.maxPt.z };
 
-			// Update vertex pos;
-			vertPos = dataPos;
-		}
+	MeshBuildLod built;
+	BuildMeshLod(source, layout, boundsMin, boundsMax, built, error);
+
+	unsigned int lodIndex = static_cast<unsigned int>(&lod - m_lods);
+	char buffer[256];
+	_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "Mesh %s LOD %u: %u vertices welded to %u\n", m_meshName.c_str(), lodIndex, built.numCorners, built.numVertices);
+	OutputDebugString(buffer);
+
+	_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "Mesh %s LOD %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", m_meshName.c_str(), lodIndex, built.before.acmr, built.after.acmr, built.before.atvr, built.after.atvr);
+	OutputDebugString(buffer);
+
+	lod.numTriangles = source.numTriangles;
+	lod.numVertices = built.numVertices;
+	lod.numIndices = built.numIndices;
+	lod.indices32 = built.indices32;
+
+	if(writer != NULL)
+	{
+		writer->AddLod(lod.error, built.vertices, lod.numVertices, built.indices, lod.numIndices, lod.indices32 ? 4 : 2);
 	}
 
-	// Create our vertex buffer
-	ID3D11Device *pDevice = RenderMgr::GetInstance().GetDevice();
+	CreateLodBuffers(lod, built.vertices, decl.m_vertexSize, built.indices);
+
+	// Destroy the system memory copies
+	ReleaseMeshBuildLod(built);
+}
+
+// ****************************************************************************
+// Creates the level's buffers from vertices and indices it already has the
+// counts for
+// ****************************************************************************
+void Mesh::CreateLodBuffers(MeshLod &lod, const void *vertices, unsigned int vertexSize, const void *indices)
+{
+	_ASSERT(lod.vertexBuffer == NULL);
+	_ASSERT(lod.indexBuffer == NULL);
+
+	RenderDevice *pDevice = RenderMgr::GetInstance().GetRenderDevice();
 
 	// Vertex buffer descriptor
 	D3D11_BUFFER_DESC desc = {0};
 	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.ByteWidth = m_numVertices*vertexSize;
+	desc.ByteWidth = lod.numVertices*vertexSize;
 	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	desc.CPUAccessFlags = 0;
 	desc.MiscFlags = 0;
 
 	// Data initialization descriptor
 	D3D11_SUBRESOURCE_DATA initData = {0};
-	initData.pSysMem = vb;
+	initData.pSysMem = vertices;
 	initData.SysMemPitch = 0;
 	initData.SysMemSlicePitch = 0;
 
 	// Create the buffer
-	HRESULT hr = pDevice->CreateBuffer(&desc,&initData,&m_vertexBuffer);
+	HRESULT hr = pDevice->CreateBuffer(&desc,&initData,&lod.vertexBuffer);
 	_ASSERT( SUCCEEDED(hr) );
 
-	// Destroy the system buffer
-	delete vb;
-
-	// Create our index buffer
-	m_numIndices = m_numTriangles * 3;
-	if(m_numVertices > 0xffff)
-	{
-		m_32bitIndices = true;
-	}
-
-	// Create a system buffer to hold the data
-	int dataSize = m_32bitIndices ? m_numIndices * 4 : m_numIndices * 2;
-	void *ib = static_cast<void *>(new unsigned char[ dataSize ]);
-	unsigned short *usIdxPos = static_cast<unsigned short *>(ib);
-	unsigned long *ulIdxPos = static_cast<unsigned long *>(ib);
-
-	// Now fill it in
-	int indexIndex=0;
-	int vertexIndex=0;
-	for(unsigned int i=0; i<m_numTriangles; i++)
-	{
-		if(m_32bitIndices)
-		{
-			ulIdxPos[indexIndex + 0] = vertexIndex;
-			ulIdxPos[indexIndex + 1] = vertexIndex + 1;
-			ulIdxPos[indexIndex + 2] = vertexIndex + 2;
-		}
-		else
-		{
-			usIdxPos[indexIndex + 0] = vertexIndex;
-			usIdxPos[indexIndex + 1] = vertexIndex + 1;
-			usIdxPos[indexIndex + 2] = vertexIndex + 2;
-		}
-
-		vertexIndex += 3;
-		indexIndex += 3;
-	}
-
-	_ASSERT(indexIndex == m_numIndices);
-
 	// Create the index buffer
+	int dataSize = lod.indices32 ? lod.numIndices * 4 : lod.numIndices * 2;
 	memset(&desc,0,sizeof(desc));
 	desc.Usage = D3D11_USAGE_DEFAULT;
 	desc.ByteWidth = dataSize;
@@ -259,17 +516,83 @@ bool Mesh::CreatePlatformData(const std::string &name, LuaPlus::LuaObject &meshO
 	
 	// Data initialization descriptor
 	memset(&initData,0,sizeof(initData));
-	initData.pSysMem = ib;
+	initData.pSysMem = indices;
 	initData.SysMemPitch = 0;
 	initData.SysMemSlicePitch = 0;
 
-	hr = pDevice->CreateBuffer(&desc,&initData,&m_indexBuffer);
+	hr = pDevice->CreateBuffer(&desc,&initData,&lod.indexBuffer);
 	_ASSERT( SUCCEEDED(hr) );
+}
+// ****************************************************************************
+// Hysteresis only ever holds a finer level than needed, never a coarser one
+// ****************************************************************************
+unsigned int Mesh::SelectLod(float pixelsPerUnit, float maxPixels, unsigned int current) const
+{
+	_ASSERT(m_numLods > 0);
+
+	unsigned int lod = current < m_numLods ? current : m_numLods - 1;
+	while(lod > 0 && m_lods[lod].error * pixelsPerUnit > maxPixels)
+	{
+		lod--;
+	}
 
-	// Destroy the system memory copy
-	delete ib;
+	while(lod + 1 < m_numLods && m_lods[lod + 1].error * pixelsPerUnit <= maxPixels * LOD_HYSTERESIS)
+	{
+		lod++;
+	}
 
-	return true;
+	return lod;
+}
+
+// ****************************************************************************
+// Done once the bounds and material are known
+// ****************************************************************************
+void Mesh::SetDequantize()
+{
+	_ASSERT(m_material != NULL);
+
+	int positionOffset = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	m_quantized = HXDeclHasSemantic(*m_material->m_shader->m_decl, "POSITION", positionOffset, format) && format == DXGI_FORMAT_R16G16B16A16_UNORM;
+
+	m_dequantize.SetIdentity();
+	if(m_quantized)
+	{
+		float boundsMin[3] = { m_bounds.minPt.x, m_bounds.minPt.y, m_bounds.minPt.z };
+		float boundsMax[3] = { m_bounds.maxPt.x, m_bounds.maxPt.y, m_bounds.maxPt.z };
+		float scale[3];
+		float offset[3];
+		PositionDequantize(boundsMin, boundsMax, scale, offset);
+
+		for(int i=0;i<3;i++)
+		{
+			m_dequantize.r[i][i] = scale[i];
+			m_dequantize.r[i][3] = offset[i];
+		}
+	}
+}
+
+// ****************************************************************************
+// Positions are shared between triangles here, unlike in the vertex buffer,
+// so the occlusion buffer transforms each one once
+// ****************************************************************************
+void Mesh::CreateOccluderData(const MeshSourceLod &source)
+{
+	_ASSERT(m_occluderPositions == NULL);
+
+	m_numOccluderPositions = source.numPositions;
+	m_occluderPositions = new float[m_numOccluderPositions * 3];
+	memcpy(m_occluderPositions, source.positions, m_numOccluderPositions * 3 * sizeof(float));
+
+	unsigned int numCorners = source.numTriangles * 3;
+	unsigned int cornerSize = MeshSourceCornerSize(source);
+	m_occluderIndices = new uint32_t[numCorners];
+	for(unsigned int cornerIndex=0;cornerIndex < numCorners; cornerIndex++)
+	{
+		uint32_t posIndex = source.corners[cornerIndex * cornerSize];
+		_ASSERT(posIndex < m_numOccluderPositions);
+		m_occluderIndices[cornerIndex] = posIndex;
+	}
 }
 //
 //// ****************************************************************************
@@ -2,40 +2,95 @@
 #define MESH_H
 
 #include "Kernel/RefCount.h"
+#include "Math/AABB.h"
+#include "MeshLod.h"
+
+struct HXMaterial;
 
 namespace Helix {
 
 class Material;
+class MeshFileWriter;
+struct MeshFileMesh;
+struct MeshSource;
+struct MeshSourceLod;
+struct VertexQuantizeError;
 
 class Mesh : public ReferenceCountable
 {
 public:
+	enum { MAX_LODS = 8 };
+
 	Mesh();
 	~Mesh();
 
+	// Meshes/<filename>.hxmesh if it's at least as new as the .lua, which
+	// otherwise is loaded and cooked into one for next time
 	bool	Load(const std::string &filename);
-	bool	Load(LuaPlus::LuaObject &meshObj);
+
+	// The writer, if given, gets a cooked copy of the mesh
+	bool	Load(LuaPlus::LuaObject &meshObj, MeshFileWriter *writer = NULL);
+	bool	Load(const MeshSource &source, MeshFileWriter *writer = NULL);
+
+	// From a mapped .hxmesh.  The buffers are created straight from the
+	// file's blobs, which only have to stay mapped for the call.
+	bool	Load(const MeshFileMesh &meshData, const uint8_t *fileData);
 
 //	void			Render(int pass);
 	std::string &	GetMaterialName() { return m_materialName; }
-	ID3D11Buffer *	GetVertexBuffer() { return m_vertexBuffer; }
-	ID3D11Buffer *	GetIndexBuffer()  { return m_indexBuffer; }
+	HXMaterial *	GetMaterial() { return m_material; }
+	ID3D11Buffer *	GetVertexBuffer() { return m_lods[0].vertexBuffer; }
+	ID3D11Buffer *	GetIndexBuffer()  { return m_lods[0].indexBuffer; }
+
+	unsigned int	GetId() const { return m_lods[0].id; }
+	const AABB &	GetBounds() const { return m_bounds; }		// Object space
+
+	// Vertex positions packed to 16 bits are 0..1 within the mesh's bounds.
+	// The dequantization matrix takes them back to object space, and is
+	// the identity for meshes with float positions.
+	bool						IsQuantized() const		{ return m_quantized; }
+	const Helix::Matrix4x4 &	GetDequantize() const	{ return m_dequantize; }
+
+	int	NumVertices()	{ return m_lods[0].numVertices; }
+	int NumTriangles()	{ return m_lods[0].numTriangles; }
+	int NumIndices()	{ return m_lods[0].numIndices; }
+
+	// Levels of detail, finest first.  Extra levels come from the LODs list
+	// in the mesh's Lua, each with its Error.
+	unsigned int		NumLods() const					{ return m_numLods; }
+	const MeshLod &		GetLod(unsigned int lod) const	{ return m_lods[lod]; }
+
+	// Coarsest level whose error comes out at no more than maxPixels on
+	// screen, pixelsPerUnit being how many pixels one object space unit
+	// covers where the mesh is.  current is the level picked last time.
+	unsigned int		SelectLod(float pixelsPerUnit, float maxPixels, unsigned int current) const;
 
-	int	NumVertices()	{ return m_numVertices; }
-	int NumTriangles()	{ return m_numTriangles; }
-	int NumIndices()	{ return m_numIndices; }
+	// Meshes marked Occluder in their Lua keep their positions and triangles
+	// on the CPU for the occlusion buffer.  Object space, xyz triples.
+	bool				IsOccluder() const				{ return m_occluderPositions != NULL; }
+	const float *		OccluderPositions() const		{ return m_occluderPositions; }
+	unsigned int		NumOccluderPositions() const	{ return m_numOccluderPositions; }
+	const uint32_t *	OccluderIndices() const			{ return m_occluderIndices; }
+	unsigned int		NumOccluderTriangles() const	{ return m_lods[0].numTriangles; }
 
 private:
-	bool	CreatePlatformData(const std::string &path, LuaPlus::LuaObject &obj);
+	bool	CreatePlatformData(const MeshSource &source, MeshFileWriter *writer);
+	void	CreateLodBuffers(MeshLod &lod, const MeshSourceLod &source, MeshFileWriter *writer, VertexQuantizeError &error);
+	void	CreateLodBuffers(MeshLod &lod, const void *vertices, unsigned int vertexSize, const void *indices);
+	void	CreateOccluderData(const MeshSourceLod &source);
+	void	SetDequantize();
 
-	ID3D11Buffer *	m_vertexBuffer;
-	ID3D11Buffer *	m_indexBuffer;
-	unsigned int	m_numVertices;
-	unsigned int	m_numIndices;
-	unsigned int	m_numTriangles;
+	MeshLod			m_lods[MAX_LODS];
+	unsigned int	m_numLods;
+	HXMaterial *	m_material;
 	std::string		m_materialName;
 	std::string		m_meshName;
-	bool			m_32bitIndices;
+	AABB			m_bounds;
+	Helix::Matrix4x4	m_dequantize;
+	bool			m_quantized;
+	float *			m_occluderPositions;
+	unsigned int	m_numOccluderPositions;
+	uint32_t *		m_occluderIndices;
 };
 
 } // namespace Helix
@@ -0,0 +1,170 @@
+#include <string.h>
+#include "MeshBuild.h"
+#include "MeshListParser.h"
+#include "MeshWeld.h"
+
+namespace Helix {
+
+// How much worse than the cache optimized ACMR overdraw ordering may make a
+// level, to get more clusters to sort
+const float		OVERDRAW_THRESHOLD = 1.05f;
+
+// ****************************************************************************
+// ****************************************************************************
+void MeshSourceBounds(const MeshSourceLod &source, float boundsMin[3], float boundsMax[3])
+{
+	for(int axis=0;axis<3;axis++)
+	{
+		boundsMin[axis] = 3.402823466e+38f;
+		boundsMax[axis] = -3.402823466e+38f;
+	}
+
+	for(unsigned int posIndex=0;posIndex < source.numPositions; posIndex++)
+	{
+		const float *pos = source.positions + posIndex * 3;
+		for(int axis=0;axis<3;axis++)
+		{
+			boundsMin[axis] = pos[axis] < boundsMin[axis] ? pos[axis] : boundsMin[axis];
+			boundsMax[axis] = pos[axis] > boundsMax[axis] ? pos[axis] : boundsMax[axis];
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void BuildMeshLod(const MeshSourceLod &source, const VertexLayout &layout, const float boundsMin[3], const float boundsMax[3], MeshBuildLod &lod, VertexQuantizeError &error)
+{
+	bool havePosData = layout.positionFormat != VERTEX_FORMAT_NONE;
+	bool haveNormData = layout.normalFormat != VERTEX_FORMAT_NONE;
+	_ASSERT(!haveNormData || source.numNormals > 0);
+
+	// Every corner's attribute indices, only for the attributes the vertex
+	// has, so corners differing in something it doesn't store still weld
+	unsigned int numUVSets = layout.numUVSets;
+	_ASSERT(numUVSets <= source.numUVSets);
+	unsigned int keySize = (havePosData ? 1 : 0) + (haveNormData ? 1 : 0) + numUVSets;
+	_ASSERT(keySize > 0);
+
+	unsigned int numCorners = source.numTriangles * 3;
+	uint32_t *keys = new uint32_t[numCorners * keySize];
+
+	unsigned int cornerSize = MeshSourceCornerSize(source);
+	uint32_t *key = keys;
+	for(unsigned int cornerIndex=0;cornerIndex < numCorners; cornerIndex++)
+	{
+		const uint32_t *corner = source.corners + cornerIndex * cornerSize;
+		if(havePosData)
+		{
+			*key++ = corner[0];
+		}
+
+		if(haveNormData)
+		{
+			*key++ = corner[1];
+		}
+
+		for(unsigned int uvSetIdx=0;uvSetIdx < numUVSets; uvSetIdx++)
+		{
+			*key++ = corner[2 + uvSetIdx];
+		}
+	}
+
+	// Shared corners become one vertex, and the indices point at them
+	uint32_t *cornerVertex = new uint32_t[numCorners];
+	uint32_t *vertexCorner = new uint32_t[numCorners];
+	unsigned int numVertices = WeldCorners(keys, numCorners, keySize, cornerVertex, vertexCorner);
+
+	// Unpacked float vertices to work on
+	unsigned int vertexFloats = UnpackedVertexFloats(layout);
+	float *vertices = new float[ numVertices * vertexFloats ];
+
+	// Fill them in from the first corner of each vertex
+	float *dataPos = vertices;
+	for(unsigned int vertexIndex=0;vertexIndex < numVertices; vertexIndex++)
+	{
+		const uint32_t *vertexKey = keys + vertexCorner[vertexIndex] * keySize;
+
+		if(havePosData)
+		{
+			_ASSERT(*vertexKey < source.numPositions);
+			memcpy(dataPos, source.positions + *vertexKey++ * 3, 3 * sizeof(float));
+			dataPos += 3;
+		}
+
+		if(haveNormData)
+		{
+			_ASSERT(*vertexKey < source.numNormals);
+			memcpy(dataPos, source.normals + *vertexKey++ * 3, 3 * sizeof(float));
+			dataPos += 3;
+		}
+
+		for(unsigned int uvSetIdx=0;uvSetIdx < numUVSets; uvSetIdx++)
+		{
+			_ASSERT(*vertexKey < source.numUVs[uvSetIdx]);
+			memcpy(dataPos, source.uvs[uvSetIdx] + *vertexKey++ * 2, 2 * sizeof(float));
+			dataPos += 2;
+		}
+	}
+
+	delete [] keys;
+	delete [] vertexCorner;
+
+	// The corner to vertex map already is an index buffer.  Reorder it for
+	// the post-transform cache, then for overdraw, then the vertices for
+	// fetch.
+	lod.before = AnalyzeVertexCache(cornerVertex, numCorners, numVertices, DEFAULT_CACHE_SIZE);
+
+	OptimizeVertexCache(cornerVertex, numCorners, numVertices);
+	if(havePosData)
+	{
+		// Positions come first
+		OptimizeOverdraw(cornerVertex, numCorners, vertices, vertexFloats * sizeof(float), numVertices, OVERDRAW_THRESHOLD);
+	}
+	numVertices = OptimizeVertexFetch(vertices, numVertices, vertexFloats * sizeof(float), cornerVertex, numCorners);
+
+	lod.after = AnalyzeVertexCache(cornerVertex, numCorners, numVertices, DEFAULT_CACHE_SIZE);
+
+	// Pack them in the layout's formats
+	lod.vertices = new uint8_t[ numVertices * layout.vertexSize ];
+	PackVertices(vertices, numVertices, layout, boundsMin, boundsMax, lod.vertices, error);
+	delete [] vertices;
+
+	lod.numVertices = numVertices;
+	lod.numCorners = numCorners;
+	lod.numIndices = numCorners;
+
+	// Narrow the indices if they fit
+	lod.indices32 = numVertices > 0xffff;
+	if(lod.indices32)
+	{
+		lod.indices = cornerVertex;
+	}
+	else
+	{
+		uint16_t *shortIndices = new uint16_t[numCorners];
+		for(unsigned int i=0;i<numCorners;i++)
+		{
+			shortIndices[i] = static_cast<uint16_t>(cornerVertex[i]);
+		}
+		lod.indices = shortIndices;
+		delete [] cornerVertex;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ReleaseMeshBuildLod(MeshBuildLod &lod)
+{
+	delete [] lod.vertices;
+	if(lod.indices32)
+	{
+		delete [] static_cast<uint32_t *>(lod.indices);
+	}
+	else
+	{
+		delete [] static_cast<uint16_t *>(lod.indices);
+	}
+	memset(&lod, 0, sizeof(lod));
+}
+
+} // namespace Helix
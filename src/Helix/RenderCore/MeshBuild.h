@@ -0,0 +1,46 @@
+#ifndef MESHBUILD_H
+#define MESHBUILD_H
+
+#include <stdint.h>
+#include "MeshOptimizer.h"
+#include "MeshQuantize.h"
+
+namespace Helix {
+
+struct MeshSourceLod;
+
+// ****************************************************************************
+// Mesh building
+//
+// Exported geometry to the vertices and indices a level's buffers are made
+// from.  Corners sharing all their attributes are welded into one vertex,
+// then triangles and vertices are reordered for the GPU and packed into the
+// layout's formats.  Mesh loads through here, and so do tools cooking
+// .hxmesh files, so both get the same bytes.  Nothing here depends on D3D.
+// ****************************************************************************
+
+struct MeshBuildLod
+{
+	uint8_t *			vertices;			// Packed, layout.vertexSize bytes each
+	unsigned int		numVertices;
+	void *				indices;			// uint16_t, or uint32_t if indices32
+	unsigned int		numIndices;
+	bool				indices32;
+	unsigned int		numCorners;			// Vertices before welding
+	VertexCacheStats	before;				// Welded, in exported order
+	VertexCacheStats	after;				// Optimized
+};
+
+// Object space box around the level's positions
+void	MeshSourceBounds(const MeshSourceLod &source, float boundsMin[3], float boundsMax[3]);
+
+// Quantized positions are relative to boundsMin/Max, which should be the
+// whole mesh's so every level shares one dequantization matrix.  What
+// packing loses is added to error.
+void	BuildMeshLod(const MeshSourceLod &source, const VertexLayout &layout, const float boundsMin[3], const float boundsMax[3], MeshBuildLod &lod, VertexQuantizeError &error);
+
+// Frees the arrays and empties it
+void	ReleaseMeshBuildLod(MeshBuildLod &lod);
+
+} // namespace Helix
+#endif // MESHBUILD_H
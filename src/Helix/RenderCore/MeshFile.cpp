@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <string.h>
+#include "MeshFile.h"
+
+namespace Helix {
+
+const unsigned int	MIN_MESH_CAPACITY = 16;
+const size_t		MIN_BLOB_CAPACITY = 64 * 1024;
+
+// ****************************************************************************
+// ****************************************************************************
+inline size_t AlignBlob(size_t offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~static_cast<size_t>(MESH_FILE_ALIGNMENT - 1);
+}
+
+// ****************************************************************************
+// True if count elements of elementSize at offset are aligned and inside a
+// file of the given size
+// ****************************************************************************
+inline bool BlobInFile(uint32_t offset, uint32_t count, uint32_t elementSize, size_t fileSize)
+{
+	if(offset % MESH_FILE_ALIGNMENT != 0)
+		return false;
+
+	return static_cast<uint64_t>(offset) + static_cast<uint64_t>(count) * elementSize <= fileSize;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool NameTerminated(const char *name)
+{
+	return memchr(name, 0, MESH_FILE_NAME_SIZE) != NULL;
+}
+
+// ****************************************************************************
+// Only the table is checked, not what's in the blobs, so this costs the same
+// however big the meshes are
+// ****************************************************************************
+const MeshFileMesh * MeshFileMeshes(const uint8_t *data, size_t size, unsigned int &numMeshes)
+{
+	numMeshes = 0;
+	if(data == NULL || size < sizeof(MeshFileHeader))
+		return NULL;
+
+	const MeshFileHeader *header = reinterpret_cast<const MeshFileHeader *>(data);
+	if(header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION || header->fileSize != size)
+		return NULL;
+
+	if(sizeof(MeshFileHeader) + static_cast<uint64_t>(header->numMeshes) * sizeof(MeshFileMesh) > size)
+		return NULL;
+
+	const MeshFileMesh *meshes = reinterpret_cast<const MeshFileMesh *>(data + sizeof(MeshFileHeader));
+	for(unsigned int i=0;i<header->numMeshes;i++)
+	{
+		const MeshFileMesh &mesh = meshes[i];
+		if(!NameTerminated(mesh.name) || !NameTerminated(mesh.material) || !NameTerminated(mesh.vertexDecl))
+			return NULL;
+
+		if(mesh.vertexSize == 0 || mesh.numLods == 0 || mesh.numLods > MESH_FILE_MAX_LODS)
+			return NULL;
+
+		for(unsigned int j=0;j<mesh.numLods;j++)
+		{
+			const MeshFileLod &lod = mesh.lods[j];
+			if(lod.indexSize != 2 && lod.indexSize != 4)
+				return NULL;
+
+			if(!BlobInFile(lod.vertexOffset, lod.numVertices, mesh.vertexSize, size) ||
+				!BlobInFile(lod.indexOffset, lod.numIndices, lod.indexSize, size))
+				return NULL;
+		}
+
+		if(mesh.flags & MESH_FILE_OCCLUDER)
+		{
+			if(!BlobInFile(mesh.occluderPositionOffset, mesh.numOccluderPositions, 3 * sizeof(float), size) ||
+				!BlobInFile(mesh.occluderIndexOffset, mesh.numOccluderTriangles, 3 * sizeof(uint32_t), size))
+				return NULL;
+		}
+	}
+
+	numMeshes = header->numMeshes;
+	return meshes;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+MeshFileWriter::MeshFileWriter()
+: m_meshes(NULL)
+, m_numMeshes(0)
+, m_meshCapacity(0)
+, m_inMesh(false)
+, m_blobs(NULL)
+, m_blobSize(0)
+, m_blobCapacity(0)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+MeshFileWriter::~MeshFileWriter()
+{
+	delete [] m_meshes;
+	delete [] m_blobs;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MeshFileWriter::BeginMesh(const char *name, const char *material, const char *vertexDecl, unsigned int vertexSize, const float boundsMin[3], const float boundsMax[3])
+{
+	_ASSERT(!m_inMesh);
+	_ASSERT(strlen(name) < MESH_FILE_NAME_SIZE);
+	_ASSERT(strlen(material) < MESH_FILE_NAME_SIZE);
+	_ASSERT(strlen(vertexDecl) < MESH_FILE_NAME_SIZE);
+	_ASSERT(vertexSize > 0);
+
+	if(m_numMeshes == m_meshCapacity)
+	{
+		unsigned int newCapacity = m_meshCapacity > MIN_MESH_CAPACITY ? m_meshCapacity * 2 : MIN_MESH_CAPACITY;
+		MeshFileMesh *newMeshes = new MeshFileMesh[newCapacity];
+		if(m_meshes != NULL)
+		{
+			memcpy(newMeshes, m_meshes, m_numMeshes * sizeof(MeshFileMesh));
+			delete [] m_meshes;
+		}
+		m_meshes = newMeshes;
+		m_meshCapacity = newCapacity;
+	}
+
+	MeshFileMesh &mesh = m_meshes[m_numMeshes];
+	memset(&mesh, 0, sizeof(mesh));
+	strncpy(mesh.name, name, MESH_FILE_NAME_SIZE - 1);
+	strncpy(mesh.material, material, MESH_FILE_NAME_SIZE - 1);
+	strncpy(mesh.vertexDecl, vertexDecl, MESH_FILE_NAME_SIZE - 1);
+	mesh.vertexSize = vertexSize;
+	for(int i=0;i<3;i++)
+	{
+		mesh.boundsMin[i] = boundsMin[i];
+		mesh.boundsMax[i] = boundsMax[i];
+	}
+
+	m_inMesh = true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MeshFileWriter::SetOccluder(const float *positions, unsigned int numPositions, const uint32_t *indices, unsigned int numTriangles)
+{
+	_ASSERT(m_inMesh);
+
+	MeshFileMesh &mesh = m_meshes[m_numMeshes];
+	mesh.flags |= MESH_FILE_OCCLUDER;
+	mesh.occluderPositionOffset = AddBlob(positions, numPositions * 3 * sizeof(float));
+	mesh.numOccluderPositions = numPositions;
+	mesh.occluderIndexOffset = AddBlob(indices, numTriangles * 3 * sizeof(uint32_t));
+	mesh.numOccluderTriangles = numTriangles;
+}
+
+// ****************************************************************************
+// Levels go in finest first, as the mesh wants them
+// ****************************************************************************
+void MeshFileWriter::AddLod(float error, const void *vertices, unsigned int numVertices, const void *indices, unsigned int numIndices, unsigned int indexSize)
+{
+	_ASSERT(m_inMesh);
+	_ASSERT(indexSize == 2 || indexSize == 4);
+
+	MeshFileMesh &mesh = m_meshes[m_numMeshes];
+	_ASSERT(mesh.numLods < MESH_FILE_MAX_LODS);
+
+	MeshFileLod &lod = mesh.lods[mesh.numLods++];
+	lod.vertexOffset = AddBlob(vertices, numVertices * mesh.vertexSize);
+	lod.numVertices = numVertices;
+	lod.indexOffset = AddBlob(indices, numIndices * indexSize);
+	lod.numIndices = numIndices;
+	lod.indexSize = indexSize;
+	lod.error = error;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MeshFileWriter::EndMesh()
+{
+	_ASSERT(m_inMesh);
+	_ASSERT(m_meshes[m_numMeshes].numLods > 0);
+
+	m_numMeshes++;
+	m_inMesh = false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+uint32_t MeshFileWriter::AddBlob(const void *data, size_t size)
+{
+	size_t offset = AlignBlob(m_blobSize);
+	size_t end = offset + size;
+	if(end > m_blobCapacity)
+	{
+		size_t newCapacity = m_blobCapacity > MIN_BLOB_CAPACITY ? m_blobCapacity : MIN_BLOB_CAPACITY;
+		while(newCapacity < end)
+		{
+			newCapacity *= 2;
+		}
+
+		uint8_t *newBlobs = new uint8_t[newCapacity];
+		if(m_blobs != NULL)
+		{
+			memcpy(newBlobs, m_blobs, m_blobSize);
+			delete [] m_blobs;
+		}
+		m_blobs = newBlobs;
+		m_blobCapacity = newCapacity;
+	}
+
+	// Padding is zeroed so the same meshes always cook to the same bytes
+	memset(m_blobs + m_blobSize, 0, offset - m_blobSize);
+	memcpy(m_blobs + offset, data, size);
+	m_blobSize = end;
+
+	_ASSERT(offset <= 0xffffffff);
+	return static_cast<uint32_t>(offset);
+}
+
+// ****************************************************************************
+// Moves the blob offsets past the mesh table and writes everything out
+// ****************************************************************************
+bool MeshFileWriter::Write(const char *filename)
+{
+	_ASSERT(!m_inMesh);
+
+	size_t blobStart = AlignBlob(sizeof(MeshFileHeader) + m_numMeshes * sizeof(MeshFileMesh));
+	size_t fileSize = blobStart + m_blobSize;
+	_ASSERT(fileSize <= 0xffffffff);
+
+	MeshFileHeader header;
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.numMeshes = m_numMeshes;
+	header.fileSize = static_cast<uint32_t>(fileSize);
+
+	uint32_t base = static_cast<uint32_t>(blobStart);
+	for(unsigned int i=0;i<m_numMeshes;i++)
+	{
+		MeshFileMesh &mesh = m_meshes[i];
+		for(unsigned int j=0;j<mesh.numLods;j++)
+		{
+			mesh.lods[j].vertexOffset += base;
+			mesh.lods[j].indexOffset += base;
+		}
+		if(mesh.flags & MESH_FILE_OCCLUDER)
+		{
+			mesh.occluderPositionOffset += base;
+			mesh.occluderIndexOffset += base;
+		}
+	}
+
+	FILE *file = fopen(filename, "wb");
+	bool written = false;
+	if(file != NULL)
+	{
+		static const uint8_t padding[MESH_FILE_ALIGNMENT] = { 0 };
+		size_t tableEnd = sizeof(MeshFileHeader) + m_numMeshes * sizeof(MeshFileMesh);
+
+		written = fwrite(&header, sizeof(header), 1, file) == 1;
+		if(written && m_numMeshes > 0)
+			written = fwrite(m_meshes, sizeof(MeshFileMesh), m_numMeshes, file) == m_numMeshes;
+		if(written && blobStart > tableEnd)
+			written = fwrite(padding, blobStart - tableEnd, 1, file) == 1;
+		if(written && m_blobSize > 0)
+			written = fwrite(m_blobs, m_blobSize, 1, file) == 1;
+
+		written = fclose(file) == 0 && written;
+		if(!written)
+		{
+			remove(filename);
+		}
+	}
+
+	// Put the offsets back so the writer can keep going
+	for(unsigned int i=0;i<m_numMeshes;i++)
+	{
+		MeshFileMesh &mesh = m_meshes[i];
+		for(unsigned int j=0;j<mesh.numLods;j++)
+		{
+			mesh.lods[j].vertexOffset -= base;
+			mesh.lods[j].indexOffset -= base;
+		}
+		if(mesh.flags & MESH_FILE_OCCLUDER)
+		{
+			mesh.occluderPositionOffset -= base;
+			mesh.occluderIndexOffset -= base;
+		}
+	}
+
+	return written;
+}
+
+} // namespace Helix
@@ -0,0 +1,122 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// .hxmesh
+//
+// Meshes cooked down to exactly what buffer creation wants, so loading is
+// mapping the file and pointing D3D at it.  Laid out as
+//
+//	MeshFileHeader
+//	MeshFileMesh[numMeshes]
+//	vertex, index and occluder blobs, each MESH_FILE_ALIGNMENT aligned
+//
+// All offsets are from the start of the file.  Little endian, and nothing
+// in here depends on D3D, so tools can write it anywhere.  Bump
+// MESH_FILE_VERSION whenever the layout or what goes into the blobs
+// changes; files of any other version are rejected and recooked.
+// ****************************************************************************
+
+const uint32_t	MESH_FILE_MAGIC = 0x534d5848;		// "HXMS"
+const uint32_t	MESH_FILE_VERSION = 4;
+
+enum
+{
+	MESH_FILE_ALIGNMENT =	16,
+	MESH_FILE_NAME_SIZE =	64,
+	MESH_FILE_MAX_LODS =	8,
+};
+
+enum MeshFileFlags
+{
+	MESH_FILE_OCCLUDER =	1 << 0,
+};
+
+struct MeshFileHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	numMeshes;
+	uint32_t	fileSize;
+};
+
+struct MeshFileLod
+{
+	uint32_t	vertexOffset;
+	uint32_t	numVertices;
+	uint32_t	indexOffset;
+	uint32_t	numIndices;
+	uint32_t	indexSize;			// 2 or 4 bytes
+	float		error;
+};
+
+struct MeshFileMesh
+{
+	char		name[MESH_FILE_NAME_SIZE];
+	char		material[MESH_FILE_NAME_SIZE];
+	char		vertexDecl[MESH_FILE_NAME_SIZE];	// The vertices are laid out for this declaration
+	uint32_t	vertexSize;
+	uint32_t	flags;
+	float		boundsMin[3];
+	float		boundsMax[3];
+
+	// Shared xyz positions and triangles, for MESH_FILE_OCCLUDER meshes
+	uint32_t	occluderPositionOffset;
+	uint32_t	numOccluderPositions;
+	uint32_t	occluderIndexOffset;
+	uint32_t	numOccluderTriangles;
+
+	uint32_t	numLods;
+	MeshFileLod	lods[MESH_FILE_MAX_LODS];
+};
+
+// The mesh table of a mapped file, or NULL if the file is the wrong version
+// or anything in it points outside it
+const MeshFileMesh *	MeshFileMeshes(const uint8_t *data, size_t size, unsigned int &numMeshes);
+
+// ****************************************************************************
+// MeshFileWriter
+//
+// Collects meshes and writes them out as one .hxmesh.  Blobs are copied in
+// as they're added, so the caller's arrays can go away straight after.
+// ****************************************************************************
+class MeshFileWriter
+{
+public:
+	MeshFileWriter();
+	~MeshFileWriter();
+
+	void	BeginMesh(const char *name, const char *material, const char *vertexDecl, unsigned int vertexSize, const float boundsMin[3], const float boundsMax[3]);
+	void	SetOccluder(const float *positions, unsigned int numPositions, const uint32_t *indices, unsigned int numTriangles);
+	void	AddLod(float error, const void *vertices, unsigned int numVertices, const void *indices, unsigned int numIndices, unsigned int indexSize);
+	void	EndMesh();
+
+	unsigned int	NumMeshes() const	{ return m_numMeshes; }
+
+	bool	Write(const char *filename);
+
+private:
+	MeshFileWriter(const MeshFileWriter &other);
+	MeshFileWriter & operator=(const MeshFileWriter &other);
+
+	uint32_t	AddBlob(const void *data, size_t size);
+
+	MeshFileMesh *	m_meshes;
+	unsigned int	m_numMeshes;
+	unsigned int	m_meshCapacity;
+	bool			m_inMesh;
+
+	// Blob offsets are relative to here until Write() knows how big the
+	// mesh table is
+	uint8_t *		m_blobs;
+	size_t			m_blobSize;
+	size_t			m_blobCapacity;
+};
+
+} // namespace Helix
+#endif // MESHFILE_H
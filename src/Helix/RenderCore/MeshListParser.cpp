@@ -0,0 +1,974 @@
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "MeshListParser.h"
+
+namespace Helix {
+
+const unsigned int	MIN_MESH_CAPACITY = 16;
+const unsigned int	MIN_ARRAY_CAPACITY = 256;
+const size_t		MAX_FALLBACK_NUMBER = 64;
+
+// Exact powers of ten.  A mantissa under 2^53 times or over one of these is
+// correctly rounded, which covers everything the exporter writes.
+const double	EXACT_POWERS_OF_TEN[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+const int		MAX_EXACT_POWER = 22;
+const uint64_t	MAX_EXACT_MANTISSA = static_cast<uint64_t>(1) << 53;
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsNameStart(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool NameIs(const char *name, size_t length, const char *expected)
+{
+	return strncmp(name, expected, length) == 0 && expected[length] == 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline unsigned int LowestBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// ****************************************************************************
+// The exporter indents with a newline and a run of tabs before nearly every
+// token, so whitespace is checked 16 bytes at a time.  The tail too short
+// for a load goes a byte at a time, so nothing past end is ever read.
+// ****************************************************************************
+inline const char * SkipSpaces(const char *pos, const char *end)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+
+	while(end - pos >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+		__m128i spaces = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriageReturn)));
+
+		unsigned int notSpace = ~_mm_movemask_epi8(spaces) & 0xffff;
+		if(notSpace != 0)
+			return pos + LowestBit(notSpace);
+
+		pos += 16;
+	}
+
+	while(pos < end && IsSpace(*pos))
+	{
+		pos++;
+	}
+	return pos;
+}
+
+// ****************************************************************************
+// Makes room for count more after used, doubling
+// ****************************************************************************
+template<typename T>
+inline void Reserve(T *&data, unsigned int used, unsigned int &capacity, unsigned int count)
+{
+	if(used + count <= capacity)
+		return;
+
+	unsigned int newCapacity = capacity > MIN_ARRAY_CAPACITY ? capacity : MIN_ARRAY_CAPACITY;
+	while(newCapacity < used + count)
+	{
+		newCapacity *= 2;
+	}
+
+	T *newData = new T[newCapacity];
+	if(data != NULL)
+	{
+		memcpy(newData, data, used * sizeof(T));
+		delete [] data;
+	}
+	data = newData;
+	capacity = newCapacity;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ReleaseMeshSourceLod(MeshSourceLod &lod)
+{
+	delete [] lod.positions;
+	delete [] lod.normals;
+	delete [] lod.corners;
+	for(unsigned int i=0;i<MESH_SOURCE_MAX_UV_SETS;i++)
+	{
+		delete [] lod.uvs[i];
+	}
+	memset(&lod, 0, sizeof(lod));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+MeshListParser::MeshListParser()
+: m_text(NULL)
+, m_pos(NULL)
+, m_end(NULL)
+, m_failed(false)
+, m_errorLine(0)
+, m_meshes(NULL)
+, m_numMeshes(0)
+, m_meshCapacity(0)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+MeshListParser::~MeshListParser()
+{
+	Release();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MeshListParser::Release()
+{
+	for(unsigned int i=0;i<m_numMeshes;i++)
+	{
+		for(unsigned int j=0;j<MESH_SOURCE_MAX_LODS;j++)
+		{
+			ReleaseMeshSourceLod(m_meshes[i].lods[j]);
+		}
+	}
+	delete [] m_meshes;
+
+	m_meshes = NULL;
+	m_numMeshes = 0;
+	m_meshCapacity = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::Parse(const char *text, size_t size)
+{
+	Release();
+
+	m_text = text;
+	m_pos = text;
+	m_end = text + size;
+	m_failed = false;
+	m_errorLine = 0;
+
+	if(!ParseMeshList())
+	{
+		Release();
+		return false;
+	}
+	return true;
+}
+
+// ****************************************************************************
+// Only counts lines when there's an error to report
+// ****************************************************************************
+bool MeshListParser::Fail()
+{
+	if(!m_failed)
+	{
+		m_failed = true;
+		m_errorLine = 1;
+		for(const char *c = m_text; c < m_pos && c < m_end; c++)
+		{
+			if(*c == '\n')
+				m_errorLine++;
+		}
+	}
+	return false;
+}
+
+// ****************************************************************************
+// Whitespace and -- line comments.  Block comments aren't something the
+// exporter writes, so they're left to fail the parse.
+// ****************************************************************************
+void MeshListParser::SkipWhitespace()
+{
+	for(;;)
+	{
+		m_pos = SkipSpaces(m_pos, m_end);
+		if(m_end - m_pos < 2 || m_pos[0] != '-' || m_pos[1] != '-')
+			return;
+
+		if(m_end - m_pos >= 4 && m_pos[2] == '[' && m_pos[3] == '[')
+			return;
+
+		const char *lineEnd = static_cast<const char *>(memchr(m_pos, '\n', m_end - m_pos));
+		m_pos = lineEnd != NULL ? lineEnd : m_end;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::Accept(char c)
+{
+	SkipWhitespace();
+	if(m_pos < m_end && *m_pos == c)
+	{
+		m_pos++;
+		return true;
+	}
+	return false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::Expect(char c)
+{
+	return Accept(c) || Fail();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseName(const char *&name, size_t &length)
+{
+	SkipWhitespace();
+	if(m_pos >= m_end || !IsNameStart(*m_pos))
+		return Fail();
+
+	name = m_pos;
+	while(m_pos < m_end && (IsNameStart(*m_pos) || IsDigit(*m_pos)))
+	{
+		m_pos++;
+	}
+	length = m_pos - name;
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseUInt(uint32_t &value)
+{
+	SkipWhitespace();
+	if(m_pos >= m_end || !IsDigit(*m_pos))
+		return Fail();
+
+	uint64_t result = 0;
+	while(m_pos < m_end && IsDigit(*m_pos))
+	{
+		result = result * 10 + (*m_pos - '0');
+		if(result > 0xffffffff)
+			return Fail();
+		m_pos++;
+	}
+
+	// An index written as a float isn't one
+	if(m_pos < m_end && (*m_pos == '.' || *m_pos == 'e' || *m_pos == 'E'))
+		return Fail();
+
+	value = static_cast<uint32_t>(result);
+	return true;
+}
+
+// ****************************************************************************
+// Up to 19 significant digits go into an integer mantissa, and if that and
+// the power of ten are both exact in a double one multiply or divide gives
+// the correctly rounded value.  Anything else goes to strtod.
+// ****************************************************************************
+bool MeshListParser::ParseFloat(float &value)
+{
+	SkipWhitespace();
+	const char *start = m_pos;
+	const char *pos = m_pos;
+
+	bool negative = false;
+	if(pos < m_end && (*pos == '-' || *pos == '+'))
+	{
+		negative = *pos == '-';
+		pos++;
+	}
+
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool haveDigits = false;
+
+	while(pos < m_end && IsDigit(*pos))
+	{
+		if(significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*pos - '0');
+			if(mantissa != 0)
+				significantDigits++;
+		}
+		else
+		{
+			exponent++;
+		}
+		haveDigits = true;
+		pos++;
+	}
+
+	if(pos < m_end && *pos == '.')
+	{
+		pos++;
+		while(pos < m_end && IsDigit(*pos))
+		{
+			if(significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*pos - '0');
+				if(mantissa != 0)
+					significantDigits++;
+				exponent--;
+			}
+			haveDigits = true;
+			pos++;
+		}
+	}
+
+	if(!haveDigits)
+		return Fail();
+
+	if(pos < m_end && (*pos == 'e' || *pos == 'E'))
+	{
+		pos++;
+		bool negativeExponent = false;
+		if(pos < m_end && (*pos == '-' || *pos == '+'))
+		{
+			negativeExponent = *pos == '-';
+			pos++;
+		}
+
+		if(pos >= m_end || !IsDigit(*pos))
+			return Fail();
+
+		int written = 0;
+		while(pos < m_end && IsDigit(*pos))
+		{
+			if(written < 10000)
+				written = written * 10 + (*pos - '0');
+			pos++;
+		}
+		exponent += negativeExponent ? -written : written;
+	}
+
+	// Hex numbers and the like
+	if(pos < m_end && (IsNameStart(*pos) || IsDigit(*pos)))
+		return Fail();
+
+	double result;
+	if(mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER)
+	{
+		result = static_cast<double>(mantissa);
+		result = exponent < 0 ? result / EXACT_POWERS_OF_TEN[-exponent] : result * EXACT_POWERS_OF_TEN[exponent];
+		result = negative ? -result : result;
+	}
+	else
+	{
+		size_t length = pos - start;
+		if(length >= MAX_FALLBACK_NUMBER)
+			return Fail();
+
+		char number[MAX_FALLBACK_NUMBER];
+		memcpy(number, start, length);
+		number[length] = 0;
+		result = strtod(number, NULL);
+	}
+
+	value = static_cast<float>(result);
+	m_pos = pos;
+	return true;
+}
+
+// ****************************************************************************
+// The exporter never escapes anything, so a backslash is left to Lua
+// ****************************************************************************
+bool MeshListParser::ParseString(std::string &value)
+{
+	SkipWhitespace();
+	if(m_pos >= m_end || (*m_pos != '"' && *m_pos != '\''))
+		return Fail();
+
+	char quote = *m_pos++;
+	const char *start = m_pos;
+	while(m_pos < m_end && *m_pos != quote)
+	{
+		if(*m_pos == '\\' || *m_pos == '\n')
+			return Fail();
+		m_pos++;
+	}
+
+	if(m_pos >= m_end)
+		return Fail();
+
+	value.assign(start, m_pos - start);
+	m_pos++;
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseBool(bool &value)
+{
+	const char *name;
+	size_t length;
+	if(!ParseName(name, length))
+		return false;
+
+	if(NameIs(name, length, "true"))
+		value = true;
+	else if(NameIs(name, length, "false"))
+		value = false;
+	else
+		return Fail();
+
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::SkipValue()
+{
+	SkipWhitespace();
+	if(m_pos >= m_end)
+		return Fail();
+
+	char c = *m_pos;
+	if(c == '{')
+	{
+		m_pos++;
+
+		unsigned int position = 0;
+		const char *name;
+		size_t nameLength;
+		while(NextField(position, name, nameLength))
+		{
+			if(!SkipValue() || !EndField())
+				return false;
+		}
+		return !m_failed;
+	}
+
+	if(c == '"' || c == '\'')
+	{
+		std::string value;
+		return ParseString(value);
+	}
+
+	if(c == '-' || c == '+' || c == '.' || IsDigit(c))
+	{
+		float value;
+		return ParseFloat(value);
+	}
+
+	const char *name;
+	size_t length;
+	if(!ParseName(name, length))
+		return false;
+
+	return NameIs(name, length, "true") || NameIs(name, length, "false") || NameIs(name, length, "nil") || Fail();
+}
+
+// ****************************************************************************
+// Reads up to a field's value.  name comes back NULL for positional and [n]
+// fields, which must count up from 1 in position.  False at the table's
+// closing brace, or on failure.
+// ****************************************************************************
+bool MeshListParser::NextField(unsigned int &position, const char *&name, size_t &nameLength)
+{
+	if(m_failed)
+		return false;
+
+	if(Accept('}'))
+		return false;
+
+	name = NULL;
+	nameLength = 0;
+	if(m_pos >= m_end)
+		return Fail();
+
+	if(*m_pos == '[')
+	{
+		m_pos++;
+
+		uint32_t index;
+		if(!ParseUInt(index) || !Expect(']') || !Expect('='))
+			return false;
+
+		if(index != position + 1)
+			return Fail();
+
+		position++;
+		return true;
+	}
+
+	if(IsNameStart(*m_pos))
+	{
+		const char *start = m_pos;
+		ParseName(name, nameLength);
+		SkipWhitespace();
+		if(m_pos < m_end && *m_pos == '=' && (m_pos + 1 >= m_end || m_pos[1] != '='))
+		{
+			m_pos++;
+			return true;
+		}
+
+		// A positional true, false or nil
+		m_pos = start;
+		name = NULL;
+		nameLength = 0;
+	}
+
+	position++;
+	return true;
+}
+
+// ****************************************************************************
+// After a field's value comes a separator or the end of the table
+// ****************************************************************************
+bool MeshListParser::EndField()
+{
+	if(Accept(',') || Accept(';'))
+		return true;
+
+	return (m_pos < m_end && *m_pos == '}') || Fail();
+}
+
+// ****************************************************************************
+// MeshList = { mesh, mesh, ... } and nothing else
+// ****************************************************************************
+bool MeshListParser::ParseMeshList()
+{
+	const char *name;
+	size_t nameLength;
+	if(!ParseName(name, nameLength))
+		return false;
+
+	if(!NameIs(name, nameLength, "MeshList"))
+		return Fail();
+
+	if(!Expect('=') || !Expect('{'))
+		return false;
+
+	unsigned int position = 0;
+	while(NextField(position, name, nameLength))
+	{
+		if(name != NULL)
+			return Fail();
+
+		if(m_numMeshes == m_meshCapacity)
+		{
+			unsigned int newCapacity = m_meshCapacity > MIN_MESH_CAPACITY ? m_meshCapacity * 2 : MIN_MESH_CAPACITY;
+			MeshSource *newMeshes = new MeshSource[newCapacity];
+			for(unsigned int i=0;i<m_numMeshes;i++)
+			{
+				newMeshes[i] = m_meshes[i];
+			}
+			delete [] m_meshes;
+			m_meshes = newMeshes;
+			m_meshCapacity = newCapacity;
+		}
+
+		// Counted straight away so a failure releases what it got to
+		MeshSource &mesh = m_meshes[m_numMeshes++];
+		mesh.name.clear();
+		mesh.material.clear();
+		mesh.occluder = false;
+		memset(mesh.lods, 0, sizeof(mesh.lods));
+		mesh.numLods = 1;
+
+		if(!ParseMesh(mesh) || !EndField())
+			return false;
+	}
+
+	if(m_failed)
+		return false;
+
+	SkipWhitespace();
+	return m_pos == m_end || Fail();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseMesh(MeshSource &mesh)
+{
+	if(!Expect('{'))
+		return false;
+
+	unsigned int numCornerUVs = 0;
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		if(name == NULL)
+			return Fail();
+
+		bool parsed;
+		if(NameIs(name, nameLength, "Name"))
+		{
+			parsed = ParseString(mesh.name);
+		}
+		else if(NameIs(name, nameLength, "Material"))
+		{
+			parsed = ParseString(mesh.material);
+		}
+		else if(NameIs(name, nameLength, "Occluder"))
+		{
+			parsed = ParseBool(mesh.occluder);
+		}
+		else if(NameIs(name, nameLength, "LODs"))
+		{
+			parsed = ParseLods(mesh);
+		}
+		else
+		{
+			bool handled;
+			parsed = ParseGeometry(name, nameLength, mesh.lods[0], numCornerUVs, handled);
+			if(parsed && !handled)
+			{
+				parsed = SkipValue();
+			}
+		}
+
+		if(!parsed || !EndField())
+			return false;
+	}
+
+	if(m_failed)
+		return false;
+
+	if(mesh.name.empty() || mesh.material.empty())
+		return Fail();
+
+	return CheckLod(mesh.lods[0], numCornerUVs);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseLods(MeshSource &mesh)
+{
+	if(!Expect('{'))
+		return false;
+
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		if(name != NULL || mesh.numLods == MESH_SOURCE_MAX_LODS)
+			return Fail();
+
+		MeshSourceLod &lod = mesh.lods[mesh.numLods++];
+		if(!Expect('{'))
+			return false;
+
+		bool haveError = false;
+		unsigned int numCornerUVs = 0;
+		unsigned int lodPosition = 0;
+		while(NextField(lodPosition, name, nameLength))
+		{
+			if(name == NULL)
+				return Fail();
+
+			bool parsed;
+			if(NameIs(name, nameLength, "Error"))
+			{
+				parsed = ParseFloat(lod.error);
+				haveError = true;
+			}
+			else
+			{
+				bool handled;
+				parsed = ParseGeometry(name, nameLength, lod, numCornerUVs, handled);
+				if(parsed && !handled)
+				{
+					parsed = SkipValue();
+				}
+			}
+
+			if(!parsed || !EndField())
+				return false;
+		}
+
+		if(m_failed || !haveError || !CheckLod(lod, numCornerUVs) || !EndField())
+			return Fail();
+	}
+
+	return !m_failed;
+}
+
+// ****************************************************************************
+// The fields a mesh and its LODs share.  handled is false for anything else.
+// ****************************************************************************
+bool MeshListParser::ParseGeometry(const char *name, size_t nameLength, MeshSourceLod &lod, unsigned int &numCornerUVs, bool &handled)
+{
+	handled = true;
+	if(NameIs(name, nameLength, "Faces"))
+		return lod.corners == NULL ? ParseFaces(lod, numCornerUVs) : Fail();
+
+	if(NameIs(name, nameLength, "Vertices"))
+		return lod.positions == NULL ? ParseVectors(3, lod.positions, lod.numPositions) : Fail();
+
+	if(NameIs(name, nameLength, "Normals"))
+		return lod.normals == NULL ? ParseVectors(3, lod.normals, lod.numNormals) : Fail();
+
+	if(NameIs(name, nameLength, "UVSets"))
+		return lod.numUVSets == 0 ? ParseUVSets(lod) : Fail();
+
+	handled = false;
+	return true;
+}
+
+// ****************************************************************************
+// { { x, y, z }, ... }.  Named fields alongside the vectors are skipped.
+// ****************************************************************************
+bool MeshListParser::ParseVectors(unsigned int components, float *&data, unsigned int &count)
+{
+	if(!Expect('{'))
+		return false;
+
+	unsigned int capacity = 0;
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		if(name != NULL)
+		{
+			if(!SkipValue() || !EndField())
+				return false;
+			continue;
+		}
+
+		if(!Expect('{'))
+			return false;
+
+		Reserve(data, count * components, capacity, components);
+		float *vector = data + count * components;
+
+		unsigned int numComponents = 0;
+		unsigned int componentPosition = 0;
+		while(NextField(componentPosition, name, nameLength))
+		{
+			if(name != NULL || numComponents == components)
+				return Fail();
+
+			if(!ParseFloat(vector[numComponents++]) || !EndField())
+				return false;
+		}
+
+		if(m_failed || numComponents != components)
+			return Fail();
+
+		count++;
+		if(!EndField())
+			return false;
+	}
+
+	return !m_failed;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool MeshListParser::ParseUVSets(MeshSourceLod &lod)
+{
+	if(!Expect('{'))
+		return false;
+
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		bool parsed;
+		if(name != NULL)
+		{
+			parsed = SkipValue();
+		}
+		else if(lod.numUVSets < MESH_SOURCE_MAX_UV_SETS)
+		{
+			unsigned int set = lod.numUVSets++;
+			parsed = ParseVectors(2, lod.uvs[set], lod.numUVs[set]);
+		}
+		else
+		{
+			return Fail();
+		}
+
+		if(!parsed || !EndField())
+			return false;
+	}
+
+	return !m_failed;
+}
+
+// ****************************************************************************
+// { { corner, corner, corner }, ... }.  UVSets may come after, so corners
+// are stored with however many UV indices the first one has, and CheckLod()
+// makes sure that matches.
+// ****************************************************************************
+bool MeshListParser::ParseFaces(MeshSourceLod &lod, unsigned int &numCornerUVs)
+{
+	if(!Expect('{'))
+		return false;
+
+	unsigned int capacity = 0;
+	unsigned int cornerSize = 0;
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		if(name != NULL || !Expect('{'))
+			return Fail();
+
+		unsigned int numCorners = 0;
+		unsigned int cornerPosition = 0;
+		while(NextField(cornerPosition, name, nameLength))
+		{
+			if(name != NULL || numCorners == 3)
+				return Fail();
+
+			uint32_t corner[2 + MESH_SOURCE_MAX_UV_SETS];
+			unsigned int numUVs = 0;
+			if(!ParseCorner(corner, numUVs) || !EndField())
+				return false;
+
+			if(cornerSize == 0)
+			{
+				numCornerUVs = numUVs;
+				cornerSize = 2 + numUVs;
+			}
+			else if(numUVs != numCornerUVs)
+			{
+				return Fail();
+			}
+
+			unsigned int used = (lod.numTriangles * 3 + numCorners) * cornerSize;
+			Reserve(lod.corners, used, capacity, cornerSize);
+			memcpy(lod.corners + used, corner, cornerSize * sizeof(uint32_t));
+			numCorners++;
+		}
+
+		if(m_failed || numCorners != 3)
+			return Fail();
+
+		lod.numTriangles++;
+		if(!EndField())
+			return false;
+	}
+
+	return !m_failed;
+}
+
+// ****************************************************************************
+// { NormalIndex = n, UVIndices = { uv, ... }, VertexIndex = v }
+// ****************************************************************************
+bool MeshListParser::ParseCorner(uint32_t *corner, unsigned int &numUVs)
+{
+	if(!Expect('{'))
+		return false;
+
+	bool haveVertex = false;
+	corner[1] = 0;
+
+	unsigned int position = 0;
+	const char *name;
+	size_t nameLength;
+	while(NextField(position, name, nameLength))
+	{
+		if(name == NULL)
+			return Fail();
+
+		bool parsed;
+		if(NameIs(name, nameLength, "VertexIndex"))
+		{
+			parsed = ParseUInt(corner[0]);
+			haveVertex = true;
+		}
+		else if(NameIs(name, nameLength, "NormalIndex"))
+		{
+			parsed = ParseUInt(corner[1]);
+		}
+		else if(NameIs(name, nameLength, "UVIndices"))
+		{
+			parsed = Expect('{');
+
+			unsigned int uvPosition = 0;
+			while(parsed && NextField(uvPosition, name, nameLength))
+			{
+				if(name != NULL || numUVs == MESH_SOURCE_MAX_UV_SETS)
+					return Fail();
+
+				parsed = ParseUInt(corner[2 + numUVs++]) && EndField();
+			}
+			parsed = parsed && !m_failed;
+		}
+		else
+		{
+			parsed = SkipValue();
+		}
+
+		if(!parsed || !EndField())
+			return false;
+	}
+
+	return !m_failed && (haveVertex || Fail());
+}
+
+// ****************************************************************************
+// Indices are checked here, once, so building buffers from the arrays can
+// trust them.  Attributes the level doesn't have aren't checked, and
+// nothing should ask for them.
+// ****************************************************************************
+bool MeshListParser::CheckLod(const MeshSourceLod &lod, unsigned int numCornerUVs)
+{
+	if(lod.numTriangles == 0 || lod.numPositions == 0 || numCornerUVs != lod.numUVSets)
+		return Fail();
+
+	unsigned int cornerSize = MeshSourceCornerSize(lod);
+	for(unsigned int i=0;i<lod.numTriangles * 3;i++)
+	{
+		const uint32_t *corner = lod.corners + i * cornerSize;
+		if(corner[0] >= lod.numPositions)
+			return Fail();
+
+		if(lod.numNormals > 0 && corner[1] >= lod.numNormals)
+			return Fail();
+
+		for(unsigned int set=0;set<lod.numUVSets;set++)
+		{
+			if(lod.numUVs[set] > 0 && corner[2 + set] >= lod.numUVs[set])
+				return Fail();
+		}
+	}
+
+	return true;
+}
+
+} // namespace Helix
@@ -0,0 +1,124 @@
+#ifndef MESHLISTPARSER_H
+#define MESHLISTPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace Helix {
+
+enum
+{
+	MESH_SOURCE_MAX_LODS =		8,
+	MESH_SOURCE_MAX_UV_SETS =	4,
+};
+
+// ****************************************************************************
+// Exported geometry in flat arrays, the way the exporter wrote it: one array
+// per attribute, and triangles as corners that index each of them.  Each
+// corner is a position index, a normal index, then a UV index per set.
+// ****************************************************************************
+struct MeshSourceLod
+{
+	float			error;
+	float *			positions;			// xyz
+	unsigned int	numPositions;
+	float *			normals;			// xyz
+	unsigned int	numNormals;
+	float *			uvs[MESH_SOURCE_MAX_UV_SETS];		// uv
+	unsigned int	numUVs[MESH_SOURCE_MAX_UV_SETS];
+	unsigned int	numUVSets;
+	uint32_t *		corners;
+	unsigned int	numTriangles;
+};
+
+// Uint32s per corner
+inline unsigned int MeshSourceCornerSize(const MeshSourceLod &lod)
+{
+	return 2 + lod.numUVSets;
+}
+
+// One entry of a MeshList.  Level 0 is the mesh itself and the rest come
+// from its LODs list, finest first.
+struct MeshSource
+{
+	std::string		name;
+	std::string		material;
+	bool			occluder;
+	MeshSourceLod	lods[MESH_SOURCE_MAX_LODS];
+	unsigned int	numLods;
+};
+
+// Frees the arrays and empties it
+void	ReleaseMeshSourceLod(MeshSourceLod &lod);
+
+// ****************************************************************************
+// MeshListParser
+//
+// Reads the MeshList files the exporter writes straight into MeshSources,
+// without a Lua VM.  Only the table constructor subset the exporter uses is
+// understood: named, [n] and positional fields, numbers, strings, booleans
+// and -- comments.  Anything else fails the parse, so callers can hand the
+// file to Lua instead.  Fields the meshes don't use are skipped.
+// ****************************************************************************
+class MeshListParser
+{
+public:
+	MeshListParser();
+	~MeshListParser();
+
+	// text doesn't need terminating.  Anything parsed before is released.
+	bool	Parse(const char *text, size_t size);
+
+	unsigned int		NumMeshes() const					{ return m_numMeshes; }
+	const MeshSource &	GetMesh(unsigned int index) const	{ return m_meshes[index]; }
+
+	// Where the last parse gave up
+	unsigned int	ErrorLine() const	{ return m_errorLine; }
+
+private:
+	MeshListParser(const MeshListParser &other);
+	MeshListParser & operator=(const MeshListParser &other);
+
+	void	Release();
+	bool	Fail();
+
+	// Lexing
+	void	SkipWhitespace();
+	bool	Accept(char c);
+	bool	Expect(char c);
+	bool	ParseName(const char *&name, size_t &length);
+	bool	ParseUInt(uint32_t &value);
+	bool	ParseFloat(float &value);
+	bool	ParseString(std::string &value);
+	bool	ParseBool(bool &value);
+	bool	SkipValue();
+
+	// Tables
+	bool	NextField(unsigned int &position, const char *&name, size_t &nameLength);
+	bool	EndField();
+
+	// The schema
+	bool	ParseMeshList();
+	bool	ParseMesh(MeshSource &mesh);
+	bool	ParseLods(MeshSource &mesh);
+	bool	ParseGeometry(const char *name, size_t nameLength, MeshSourceLod &lod, unsigned int &numCornerUVs, bool &handled);
+	bool	ParseVectors(unsigned int components, float *&data, unsigned int &count);
+	bool	ParseUVSets(MeshSourceLod &lod);
+	bool	ParseFaces(MeshSourceLod &lod, unsigned int &numCornerUVs);
+	bool	ParseCorner(uint32_t *corner, unsigned int &numUVs);
+	bool	CheckLod(const MeshSourceLod &lod, unsigned int numCornerUVs);
+
+	const char *	m_text;
+	const char *	m_pos;
+	const char *	m_end;
+	bool			m_failed;
+	unsigned int	m_errorLine;
+
+	MeshSource *	m_meshes;
+	unsigned int	m_numMeshes;
+	unsigned int	m_meshCapacity;
+};
+
+} // namespace Helix
+#endif // MESHLISTPARSER_H
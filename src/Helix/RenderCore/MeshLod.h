@@ -0,0 +1,23 @@
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+namespace Helix {
+
+// One level of detail.  Level 0 is the mesh as authored and each level after
+// it is coarser.  error is the furthest, in object space units, the level's
+// surface strays from level 0's.
+struct MeshLod
+{
+	ID3D11Buffer *	vertexBuffer;
+	ID3D11Buffer *	indexBuffer;
+	unsigned int	numVertices;
+	unsigned int	numIndices;
+	unsigned int	numTriangles;
+	unsigned int	id;					// Small unique id used to build draw sort keys
+	float			error;
+	bool			indices32;
+};
+
+} // namespace Helix
+
+#endif // MESHLOD_H
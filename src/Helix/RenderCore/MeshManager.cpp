@@ -1,3 +1,8 @@
+#include <stdio.h>
+#include "MeshListParser.h"
+#include "Utility/MappedFile.h"
+#include "Utility/Timer.h"
+
 namespace Helix {
 
 // ****************************************************************************
@@ -43,7 +48,23 @@ Mesh * MeshManager::Load(const std::string &meshName, const std::string &filenam
 }
 // ****************************************************************************
 // ****************************************************************************
-Mesh * MeshManager::Load(const std::string &meshName, LuaPlus::LuaObject &meshObj)
+Mesh * MeshManager::Load(const std::string &meshName, LuaPlus::LuaObject &meshObj, MeshFileWriter *writer)
+{
+	Mesh *mesh = GetMesh(meshName);
+	if(mesh != NULL)
+	{
+		return mesh;
+	}
+
+	mesh = new Mesh;
+	mesh->Load(meshObj, writer);
+	m_database[meshName] = mesh;
+
+	return mesh;
+}
+// ****************************************************************************
+// ****************************************************************************
+Mesh * MeshManager::Load(const std::string &meshName, const MeshFileMesh &meshData, const uint8_t *fileData)
 {
 	Mesh *mesh = GetMesh(meshName);
 	if(mesh != NULL)
@@ -52,10 +73,57 @@ Mesh * MeshManager::Load(const std::string &meshName, LuaPlus::LuaObject &meshOb
 	}
 
 	mesh = new Mesh;
-	mesh->Load(meshObj);
+	mesh->Load(meshData, fileData);
 	m_database[meshName] = mesh;
 
 	return mesh;
 }
+// ****************************************************************************
+// ****************************************************************************
+Mesh * MeshManager::Load(const std::string &meshName, const MeshSource &source, MeshFileWriter *writer)
+{
+	Mesh *mesh = GetMesh(meshName);
+	if(mesh != NULL)
+	{
+		return mesh;
+	}
+
+	mesh = new Mesh;
+	mesh->Load(source, writer);
+	m_database[meshName] = mesh;
+
+	return mesh;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ParseMeshListFile(const std::string &path, MeshListParser &parser)
+{
+	MappedFile file;
+	if(!file.Open(path.c_str()))
+		return false;
+
+	Timer timer;
+	timer.Start();
+
+	bool parsed = parser.Parse(reinterpret_cast<const char *>(file.Data()), file.Size());
+
+	timer.Stop();
+
+	char buffer[256];
+	if(parsed)
+	{
+		float megabytes = file.Size() / (1024.0f * 1024.0f);
+		float ms = timer.ElapsedMilliseconds();
+		_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "Parsed %s: %.2f MB in %.2f ms, %.1f MB/s\n", path.c_str(), megabytes, ms, ms > 0.0f ? megabytes * 1000.0f / ms : 0.0f);
+	}
+	else
+	{
+		_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "Parsing %s stopped at line %u, falling back to Lua\n", path.c_str(), parser.ErrorLine());
+	}
+	OutputDebugString(buffer);
+
+	return parsed;
+}
 
 } // namespace Helix
\ No newline at end of file
@@ -8,6 +8,10 @@
 namespace Helix {
 
 class Mesh;
+class MeshFileWriter;
+class MeshListParser;
+struct MeshFileMesh;
+struct MeshSource;
 
 class MeshManager
 {
@@ -28,7 +32,9 @@ public:
 	Mesh *	GetMesh(const std::string &meshName);
 	Mesh *	Load(const std::string &meshName);
 	Mesh *	Load(const std::string &meshName, const std::string &filename);
-	Mesh *	Load(const std::string &meshname, LuaPlus::LuaObject &meshObj);
+	Mesh *	Load(const std::string &meshname, LuaPlus::LuaObject &meshObj, MeshFileWriter *writer = NULL);
+	Mesh *	Load(const std::string &meshName, const MeshFileMesh &meshData, const uint8_t *fileData);
+	Mesh *	Load(const std::string &meshName, const MeshSource &source, MeshFileWriter *writer = NULL);
 
 private:
 	MeshManager() {}
@@ -39,6 +45,10 @@ private:
 	MeshMap		m_database;
 };
 
+// Maps a MeshList .lua and reads it with the parser.  False if it can't be
+// opened or is something only Lua understands.
+bool	ParseMeshListFile(const std::string &path, MeshListParser &parser);
+
 } // namespace Helix
 
 #endif
\ No newline at end of file
@@ -0,0 +1,494 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "MeshOptimizer.h"
+
+namespace Helix {
+
+// Forsyth's scoring.  The cache he models is an LRU of this many entries,
+// bigger than any real one so vertices that fall out of the real cache still
+// pull their triangles in a little.
+const int		FORSYTH_CACHE_SIZE = 32;
+const float		CACHE_DECAY_POWER = 1.5f;
+const float		LAST_TRIANGLE_SCORE = 0.75f;
+const float		VALENCE_BOOST_SCALE = 2.0f;
+const float		VALENCE_BOOST_POWER = 0.5f;
+
+// ****************************************************************************
+// Vertices in the triangle just drawn score the same whatever their order,
+// so the next triangle isn't pushed to reuse one particular edge.  After
+// that the score falls off with how long ago the vertex was used.  Vertices
+// with few triangles left get a boost so they're finished off rather than
+// left stranded.
+// ****************************************************************************
+inline float VertexScore(int cachePosition, unsigned int trianglesLeft)
+{
+	if(trianglesLeft == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if(cachePosition >= 0)
+	{
+		if(cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	return score + VALENCE_BOOST_SCALE * powf(static_cast<float>(trianglesLeft), -VALENCE_BOOST_POWER);
+}
+
+// ****************************************************************************
+// FIFO replacement, which is what GPUs actually do.  A vertex is a hit if
+// fewer than cacheSize misses have happened since it went in.
+// ****************************************************************************
+VertexCacheStats AnalyzeVertexCache(const uint32_t *indices, unsigned int numIndices, unsigned int numVertices, unsigned int cacheSize)
+{
+	_ASSERT(numIndices % 3 == 0);
+
+	VertexCacheStats stats;
+	memset(&stats, 0, sizeof(stats));
+	if(numIndices == 0 || numVertices == 0)
+		return stats;
+
+	// When each vertex went into the cache, in misses
+	unsigned int *loadedAt = new unsigned int[numVertices];
+	memset(loadedAt, 0, numVertices * sizeof(unsigned int));
+
+	unsigned int time = cacheSize + 1;
+	for(unsigned int i=0;i<numIndices;i++)
+	{
+		uint32_t vertex = indices[i];
+		_ASSERT(vertex < numVertices);
+
+		if(time - loadedAt[vertex] > cacheSize)
+		{
+			loadedAt[vertex] = time++;
+			stats.transforms++;
+		}
+	}
+
+	delete [] loadedAt;
+
+	stats.acmr = static_cast<float>(stats.transforms) / (numIndices / 3);
+	stats.atvr = static_cast<float>(stats.transforms) / numVertices;
+	return stats;
+}
+
+// ****************************************************************************
+// Greedy: always draw the highest scoring triangle touching the modelled
+// cache, and when none does, the next undrawn one in the old order.  Only
+// vertices in the cache change score after each triangle, so each step is
+// cheap and the whole thing runs in linear time.
+// ****************************************************************************
+void OptimizeVertexCache(uint32_t *indices, unsigned int numIndices, unsigned int numVertices)
+{
+	_ASSERT(numIndices % 3 == 0);
+
+	unsigned int numTriangles = numIndices / 3;
+	if(numTriangles == 0)
+		return;
+
+	// Triangles using each vertex, packed.  trianglesLeft counts the ones
+	// still to draw, which are kept at the front of each vertex's range.
+	unsigned int *trianglesLeft = new unsigned int[numVertices];
+	unsigned int *adjacencyStart = new unsigned int[numVertices];
+	uint32_t *adjacency = new uint32_t[numIndices];
+
+	memset(trianglesLeft, 0, numVertices * sizeof(unsigned int));
+	for(unsigned int i=0;i<numIndices;i++)
+	{
+		_ASSERT(indices[i] < numVertices);
+		trianglesLeft[indices[i]]++;
+	}
+
+	unsigned int offset = 0;
+	for(unsigned int v=0;v<numVertices;v++)
+	{
+		adjacencyStart[v] = offset;
+		offset += trianglesLeft[v];
+		trianglesLeft[v] = 0;
+	}
+
+	for(unsigned int i=0;i<numIndices;i++)
+	{
+		uint32_t v = indices[i];
+		adjacency[adjacencyStart[v] + trianglesLeft[v]++] = i / 3;
+	}
+
+	int *cachePosition = new int[numVertices];
+	float *vertexScore = new float[numVertices];
+	for(unsigned int v=0;v<numVertices;v++)
+	{
+		cachePosition[v] = -1;
+		vertexScore[v] = VertexScore(-1, trianglesLeft[v]);
+	}
+
+	bool *drawn = new bool[numTriangles];
+	memset(drawn, 0, numTriangles * sizeof(bool));
+
+	uint32_t *output = new uint32_t[numIndices];
+
+	// Three spare slots for the triangle being added
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	unsigned int nextUndrawn = 0;
+	int best = 0;
+	for(unsigned int drawnCount=0;drawnCount<numTriangles;drawnCount++)
+	{
+		if(best < 0)
+		{
+			while(drawn[nextUndrawn])
+			{
+				nextUndrawn++;
+			}
+			best = nextUndrawn;
+		}
+
+		const uint32_t *triangle = indices + best * 3;
+		memcpy(output + drawnCount * 3, triangle, 3 * sizeof(uint32_t));
+		drawn[best] = true;
+
+		// Take it out of its vertices' lists
+		for(int i=0;i<3;i++)
+		{
+			uint32_t v = triangle[i];
+			uint32_t *list = adjacency + adjacencyStart[v];
+			unsigned int count = trianglesLeft[v];
+			for(unsigned int j=0;j<count;j++)
+			{
+				if(list[j] == static_cast<uint32_t>(best))
+				{
+					list[j] = list[count - 1];
+					break;
+				}
+			}
+			trianglesLeft[v]--;
+		}
+
+		// Its vertices go to the front, everything else moves back
+		int newCount = 0;
+		for(int i=0;i<3;i++)
+		{
+			newCache[newCount++] = triangle[i];
+		}
+		for(int i=0;i<cacheCount;i++)
+		{
+			uint32_t v = cache[i];
+			if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCount++] = v;
+			}
+		}
+
+		// Rescore everything that was or is in the cache, then the triangles
+		// they're in, remembering the best of those
+		for(int i=0;i<newCount;i++)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], trianglesLeft[v]);
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+		for(int i=0;i<newCount;i++)
+		{
+			uint32_t v = newCache[i];
+			const uint32_t *list = adjacency + adjacencyStart[v];
+			for(unsigned int j=0;j<trianglesLeft[v];j++)
+			{
+				uint32_t t = list[j];
+				const uint32_t *tri = indices + t * 3;
+				float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+				if(score > bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+	}
+
+	memcpy(indices, output, numIndices * sizeof(uint32_t));
+
+	delete [] output;
+	delete [] drawn;
+	delete [] vertexScore;
+	delete [] cachePosition;
+	delete [] adjacency;
+	delete [] adjacencyStart;
+	delete [] trianglesLeft;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline const float * Position(const void *positions, unsigned int stride, uint32_t vertex)
+{
+	return reinterpret_cast<const float *>(static_cast<const uint8_t *>(positions) + vertex * stride);
+}
+
+// ****************************************************************************
+// Cache misses running one triangle at a time from a cold cache
+// ****************************************************************************
+class ClusterCache
+{
+public:
+	ClusterCache(unsigned int numVertices, unsigned int cacheSize)
+	: m_cacheSize(cacheSize)
+	, m_time(cacheSize + 1)
+	{
+		m_loadedAt = new unsigned int[numVertices];
+		memset(m_loadedAt, 0, numVertices * sizeof(unsigned int));
+	}
+
+	~ClusterCache()
+	{
+		delete [] m_loadedAt;
+	}
+
+	// Pushing the clock past every entry empties the cache
+	void Flush()
+	{
+		m_time += m_cacheSize + 1;
+	}
+
+	unsigned int Draw(const uint32_t *triangle)
+	{
+		unsigned int misses = 0;
+		for(int i=0;i<3;i++)
+		{
+			if(m_time - m_loadedAt[triangle[i]] > m_cacheSize)
+			{
+				m_loadedAt[triangle[i]] = m_time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+private:
+	ClusterCache(const ClusterCache &other);
+	ClusterCache & operator=(const ClusterCache &other);
+
+	unsigned int *	m_loadedAt;
+	unsigned int	m_cacheSize;
+	unsigned int	m_time;
+};
+
+struct OverdrawCluster
+{
+	unsigned int	start;		// First triangle
+	unsigned int	count;
+	float			sortKey;
+};
+
+// ****************************************************************************
+// Farthest out and facing out sorts first
+// ****************************************************************************
+inline bool ClusterDrawsFirst(const OverdrawCluster &a, const OverdrawCluster &b)
+{
+	return a.sortKey > b.sortKey;
+}
+
+// ****************************************************************************
+// Hard boundaries go where the cache optimized order missed on all three
+// vertices, since the cache was cold there anyway.  Within each of those
+// a soft boundary goes wherever the cluster so far, from a cold cache, is
+// already within threshold of the whole hard cluster's ACMR.  Clusters are
+// then sorted on how far their centroid sits out from the mesh's along
+// their average normal, so the outside of a mesh draws before what it
+// hides.
+// ****************************************************************************
+void OptimizeOverdraw(uint32_t *indices, unsigned int numIndices, const void *positions, unsigned int positionStride, unsigned int numVertices, float threshold)
+{
+	_ASSERT(numIndices % 3 == 0);
+
+	unsigned int numTriangles = numIndices / 3;
+	if(numTriangles < 2)
+		return;
+
+	ClusterCache cache(numVertices, DEFAULT_CACHE_SIZE);
+
+	unsigned int *hardStart = new unsigned int[numTriangles + 1];
+	unsigned int numHard = 0;
+	for(unsigned int t=0;t<numTriangles;t++)
+	{
+		unsigned int misses = cache.Draw(indices + t * 3);
+		if(t == 0 || misses == 3)
+		{
+			hardStart[numHard++] = t;
+		}
+	}
+	hardStart[numHard] = numTriangles;
+
+	OverdrawCluster *clusters = new OverdrawCluster[numTriangles];
+	unsigned int numClusters = 0;
+	for(unsigned int h=0;h<numHard;h++)
+	{
+		unsigned int start = hardStart[h];
+		unsigned int end = hardStart[h + 1];
+
+		cache.Flush();
+		unsigned int misses = 0;
+		for(unsigned int t=start;t<end;t++)
+		{
+			misses += cache.Draw(indices + t * 3);
+		}
+		float target = threshold * misses / (end - start);
+
+		cache.Flush();
+		unsigned int clusterStart = start;
+		unsigned int clusterMisses = 0;
+		for(unsigned int t=start;t<end;t++)
+		{
+			clusterMisses += cache.Draw(indices + t * 3);
+
+			unsigned int count = t + 1 - clusterStart;
+			if(t + 1 == end || clusterMisses <= target * count)
+			{
+				clusters[numClusters].start = clusterStart;
+				clusters[numClusters].count = count;
+				numClusters++;
+
+				cache.Flush();
+				clusterStart = t + 1;
+				clusterMisses = 0;
+			}
+		}
+	}
+
+	delete [] hardStart;
+
+	// Area weighted centroid of the mesh, and of each cluster along with its
+	// area weighted normal
+	float (*clusterCentroid)[3] = new float[numClusters][3];
+	float (*clusterNormal)[3] = new float[numClusters][3];
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for(unsigned int c=0;c<numClusters;c++)
+	{
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+
+		for(unsigned int t=clusters[c].start;t<clusters[c].start + clusters[c].count;t++)
+		{
+			const float *p0 = Position(positions, positionStride, indices[t*3]);
+			const float *p1 = Position(positions, positionStride, indices[t*3+1]);
+			const float *p2 = Position(positions, positionStride, indices[t*3+2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+			float a = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+
+			for(int i=0;i<3;i++)
+			{
+				centroid[i] += (p0[i] + p1[i] + p2[i]) * (a / 3.0f);
+				normal[i] += n[i];
+			}
+			area += a;
+		}
+
+		for(int i=0;i<3;i++)
+		{
+			meshCentroid[i] += centroid[i];
+			clusterCentroid[c][i] = area > 0.0f ? centroid[i] / area : 0.0f;
+			clusterNormal[c][i] = normal[i];
+		}
+		meshArea += area;
+	}
+
+	for(int i=0;i<3;i++)
+	{
+		meshCentroid[i] = meshArea > 0.0f ? meshCentroid[i] / meshArea : 0.0f;
+	}
+
+	for(unsigned int c=0;c<numClusters;c++)
+	{
+		const float *n = clusterNormal[c];
+		float length = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		float key = 0.0f;
+		if(length > 0.0f)
+		{
+			for(int i=0;i<3;i++)
+			{
+				key += (clusterCentroid[c][i] - meshCentroid[i]) * n[i];
+			}
+			key /= length;
+		}
+		clusters[c].sortKey = key;
+	}
+
+	delete [] clusterCentroid;
+	delete [] clusterNormal;
+
+	std::stable_sort(clusters, clusters + numClusters, ClusterDrawsFirst);
+
+	uint32_t *output = new uint32_t[numIndices];
+	uint32_t *out = output;
+	for(unsigned int c=0;c<numClusters;c++)
+	{
+		unsigned int count = clusters[c].count * 3;
+		memcpy(out, indices + clusters[c].start * 3, count * sizeof(uint32_t));
+		out += count;
+	}
+	_ASSERT(out == output + numIndices);
+
+	memcpy(indices, output, numIndices * sizeof(uint32_t));
+
+	delete [] output;
+	delete [] clusters;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int OptimizeVertexFetch(void *vertices, unsigned int numVertices, unsigned int vertexSize, uint32_t *indices, unsigned int numIndices)
+{
+	const uint32_t UNUSED = 0xffffffff;
+
+	uint32_t *remap = new uint32_t[numVertices];
+	memset(remap, 0xff, numVertices * sizeof(uint32_t));
+
+	unsigned int numUsed = 0;
+	for(unsigned int i=0;i<numIndices;i++)
+	{
+		uint32_t v = indices[i];
+		_ASSERT(v < numVertices);
+
+		if(remap[v] == UNUSED)
+		{
+			remap[v] = numUsed++;
+		}
+		indices[i] = remap[v];
+	}
+
+	uint8_t *source = static_cast<uint8_t *>(vertices);
+	uint8_t *copy = new uint8_t[numVertices * vertexSize];
+	memcpy(copy, source, numVertices * vertexSize);
+	for(unsigned int v=0;v<numVertices;v++)
+	{
+		if(remap[v] != UNUSED)
+		{
+			memcpy(source + remap[v] * vertexSize, copy + v * vertexSize, vertexSize);
+		}
+	}
+
+	delete [] copy;
+	delete [] remap;
+	return numUsed;
+}
+
+} // namespace Helix
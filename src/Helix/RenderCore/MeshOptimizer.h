@@ -0,0 +1,54 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// Mesh optimization
+//
+// Reorders indexed triangle lists for the GPU, in this order:
+//
+//	OptimizeVertexCache()	Forsyth's linear-speed ordering, so triangles
+//							reuse the vertices the post-transform cache
+//							still holds
+//	OptimizeOverdraw()		Cuts that order into clusters where the cache
+//							starts cold anyway and sorts the clusters so
+//							outward facing ones draw first, after Sander,
+//							Nehab and Barczak's "Fast Triangle Reordering"
+//	OptimizeVertexFetch()	Renumbers vertices in the order they're first
+//							used, so vertex fetch walks memory forwards
+//
+// Each step only ever changes the order of triangles or vertices, never
+// the mesh.  Everything here runs on the CPU at load or cook time.
+// ****************************************************************************
+
+// How well an index order uses a FIFO post-transform cache of cacheSize
+// entries.  ACMR is transforms per triangle, 0.5 at best for big regular
+// meshes and 3 at worst.  ATVR is transforms per vertex, 1 being perfect.
+struct VertexCacheStats
+{
+	unsigned int	transforms;
+	float			acmr;
+	float			atvr;
+};
+
+const unsigned int	DEFAULT_CACHE_SIZE = 16;
+
+VertexCacheStats	AnalyzeVertexCache(const uint32_t *indices, unsigned int numIndices, unsigned int numVertices, unsigned int cacheSize);
+
+void	OptimizeVertexCache(uint32_t *indices, unsigned int numIndices, unsigned int numVertices);
+
+// positions are xyz floats, positionStride bytes apart.  threshold is how
+// much worse than the cache optimized ACMR a cluster may get to allow more,
+// smaller clusters, which sort better; 1.05 is a good start.
+void	OptimizeOverdraw(uint32_t *indices, unsigned int numIndices, const void *positions, unsigned int positionStride, unsigned int numVertices, float threshold);
+
+// Reorders vertices, vertexSize bytes each, in place and remaps the indices
+// to match.  Vertices no triangle uses are dropped off the end.  Returns the
+// number left.
+unsigned int	OptimizeVertexFetch(void *vertices, unsigned int numVertices, unsigned int vertexSize, uint32_t *indices, unsigned int numIndices);
+
+} // namespace Helix
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,333 @@
+#include <math.h>
+#include <string.h>
+#include "MeshQuantize.h"
+
+namespace Helix {
+
+const float		UNORM16_MAX = 65535.0f;
+const float		UV_ERROR_TEXELS = 1024.0f;
+const float		DEGREES_PER_RADIAN = 57.2957795f;
+
+// ****************************************************************************
+// ****************************************************************************
+inline float Clamp(float value, float minValue, float maxValue)
+{
+	return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline float SignNotZero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int UnpackedVertexFloats(const VertexLayout &layout)
+{
+	unsigned int floats = 0;
+	if(layout.positionFormat != VERTEX_FORMAT_NONE)
+		floats += 3;
+	if(layout.normalFormat != VERTEX_FORMAT_NONE)
+		floats += 3;
+	if(layout.uvFormat != VERTEX_FORMAT_NONE)
+		floats += 2 * layout.numUVSets;
+	return floats;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void PositionDequantize(const float boundsMin[3], const float boundsMax[3], float scale[3], float offset[3])
+{
+	for(int i=0;i<3;i++)
+	{
+		float extent = boundsMax[i] - boundsMin[i];
+		scale[i] = extent > 0.0f ? extent : 1.0f;
+		offset[i] = boundsMin[i];
+	}
+}
+
+// ****************************************************************************
+// Round to nearest even, like the GPU.  Too small for a half comes out as a
+// denormal or zero, too big as infinity.
+// ****************************************************************************
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	// Infinity and NaN, keeping NaN a NaN
+	if(magnitude >= 0x7f800000)
+		return static_cast<uint16_t>(sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00));
+
+	// Rounds up past 65504
+	if(magnitude >= 0x477ff000)
+		return static_cast<uint16_t>(sign | 0x7c00);
+
+	// Under 2^-14 is a denormal, in units of 2^-24
+	if(magnitude < 0x38800000)
+	{
+		uint32_t exponent = magnitude >> 23;
+		uint32_t shift = 126 - exponent;
+		if(shift > 24)
+			return static_cast<uint16_t>(sign);
+
+		uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+		uint32_t result = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1 << shift) - 1);
+		uint32_t halfway = 1 << (shift - 1);
+		if(remainder > halfway || (remainder == halfway && (result & 1)))
+			result++;
+		return static_cast<uint16_t>(sign | result);
+	}
+
+	// Rebias the exponent from 127 to 15.  A carry out of the mantissa
+	// correctly bumps the exponent.
+	uint32_t result = (magnitude - 0x38000000) >> 13;
+	uint32_t remainder = magnitude & 0x1fff;
+	if(remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+		result++;
+	return static_cast<uint16_t>(sign | result);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+float HalfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if(exponent == 0)
+	{
+		float result = mantissa * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+
+	uint32_t bits;
+	if(exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// ****************************************************************************
+// The lower half of the octahedron folds out over the corners of the upper
+// half's diamond
+// ****************************************************************************
+void OctahedralDecode(int32_t x, int32_t y, unsigned int bits, float normal[3])
+{
+	// SNORM's most negative value is -1 too
+	float maxValue = static_cast<float>((1 << (bits - 1)) - 1);
+	float u = Clamp(x / maxValue, -1.0f, 1.0f);
+	float v = Clamp(y / maxValue, -1.0f, 1.0f);
+
+	float n[3] = { u, v, 1.0f - fabsf(u) - fabsf(v) };
+	float t = n[2] < 0.0f ? -n[2] : 0.0f;
+	n[0] += n[0] >= 0.0f ? -t : t;
+	n[1] += n[1] >= 0.0f ? -t : t;
+
+	float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	for(int i=0;i<3;i++)
+	{
+		normal[i] = n[i] / length;
+	}
+}
+
+// ****************************************************************************
+// Rounding each axis on its own isn't the closest code, so all four codes
+// around the exact point are decoded and the nearest kept.  Cook time only,
+// so the extra work is free.
+// ****************************************************************************
+void OctahedralEncode(const float normal[3], unsigned int bits, int32_t &x, int32_t &y)
+{
+	_ASSERT(bits >= 2 && bits <= 16);
+
+	float l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	if(l1 <= 0.0f)
+	{
+		x = 0;
+		y = 0;
+		return;
+	}
+
+	float u = normal[0] / l1;
+	float v = normal[1] / l1;
+	if(normal[2] < 0.0f)
+	{
+		float foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float foldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	float unit[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+
+	int32_t maxValue = (1 << (bits - 1)) - 1;
+	int32_t baseX = static_cast<int32_t>(floorf(u * maxValue));
+	int32_t baseY = static_cast<int32_t>(floorf(v * maxValue));
+
+	float bestDot = -2.0f;
+	for(int i=0;i<4;i++)
+	{
+		int32_t codeX = baseX + (i & 1);
+		int32_t codeY = baseY + (i >> 1);
+		codeX = codeX < -maxValue ? -maxValue : (codeX > maxValue ? maxValue : codeX);
+		codeY = codeY < -maxValue ? -maxValue : (codeY > maxValue ? maxValue : codeY);
+
+		float decoded[3];
+		OctahedralDecode(codeX, codeY, bits, decoded);
+		float dot = decoded[0] * unit[0] + decoded[1] * unit[1] + decoded[2] * unit[2];
+		if(dot > bestDot)
+		{
+			bestDot = dot;
+			x = codeX;
+			y = codeY;
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void PackPosition(const float *position, const VertexLayout &layout, const float scale[3], const float offset[3], uint8_t *out, VertexQuantizeError &error)
+{
+	if(layout.positionFormat == VERTEX_FORMAT_FLOAT32)
+	{
+		memcpy(out, position, 3 * sizeof(float));
+		return;
+	}
+
+	_ASSERT(layout.positionFormat == VERTEX_FORMAT_UNORM16);
+
+	uint16_t packed[4];
+	float distanceSq = 0.0f;
+	for(int i=0;i<3;i++)
+	{
+		float normalized = Clamp((position[i] - offset[i]) / scale[i], 0.0f, 1.0f);
+		packed[i] = static_cast<uint16_t>(normalized * UNORM16_MAX + 0.5f);
+
+		float delta = offset[i] + packed[i] / UNORM16_MAX * scale[i] - position[i];
+		distanceSq += delta * delta;
+	}
+	packed[3] = 0xffff;
+	memcpy(out, packed, sizeof(packed));
+
+	float distance = sqrtf(distanceSq);
+	error.position = distance > error.position ? distance : error.position;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void PackNormal(const float *normal, const VertexLayout &layout, uint8_t *out, VertexQuantizeError &error)
+{
+	if(layout.normalFormat == VERTEX_FORMAT_FLOAT32)
+	{
+		memcpy(out, normal, 3 * sizeof(float));
+		return;
+	}
+
+	_ASSERT(layout.normalFormat == VERTEX_FORMAT_OCT_SNORM16 || layout.normalFormat == VERTEX_FORMAT_OCT_SNORM8);
+
+	unsigned int bits = layout.normalFormat == VERTEX_FORMAT_OCT_SNORM16 ? 16 : 8;
+	int32_t x, y;
+	OctahedralEncode(normal, bits, x, y);
+
+	if(bits == 16)
+	{
+		int16_t packed[2] = { static_cast<int16_t>(x), static_cast<int16_t>(y) };
+		memcpy(out, packed, sizeof(packed));
+	}
+	else
+	{
+		int8_t packed[2] = { static_cast<int8_t>(x), static_cast<int8_t>(y) };
+		memcpy(out, packed, sizeof(packed));
+	}
+
+	// acos of a float dot product can't resolve angles this small, the cross
+	// product's length can
+	float decoded[3];
+	OctahedralDecode(x, y, bits, decoded);
+	float cross[3] =
+	{
+		normal[1] * decoded[2] - normal[2] * decoded[1],
+		normal[2] * decoded[0] - normal[0] * decoded[2],
+		normal[0] * decoded[1] - normal[1] * decoded[0],
+	};
+	float sine = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	float cosine = normal[0] * decoded[0] + normal[1] * decoded[1] + normal[2] * decoded[2];
+	float degrees = atan2f(sine, cosine) * DEGREES_PER_RADIAN;
+	error.normalDegrees = degrees > error.normalDegrees ? degrees : error.normalDegrees;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void PackUV(const float *uv, const VertexLayout &layout, uint8_t *out, VertexQuantizeError &error)
+{
+	if(layout.uvFormat == VERTEX_FORMAT_FLOAT32)
+	{
+		memcpy(out, uv, 2 * sizeof(float));
+		return;
+	}
+
+	_ASSERT(layout.uvFormat == VERTEX_FORMAT_FLOAT16);
+
+	uint16_t packed[2] = { FloatToHalf(uv[0]), FloatToHalf(uv[1]) };
+	memcpy(out, packed, sizeof(packed));
+
+	for(int i=0;i<2;i++)
+	{
+		float texels = fabsf(HalfToFloat(packed[i]) - uv[i]) * UV_ERROR_TEXELS;
+		error.uvTexels = texels > error.uvTexels ? texels : error.uvTexels;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void PackVertices(const float *vertices, unsigned int numVertices, const VertexLayout &layout, const float boundsMin[3], const float boundsMax[3], uint8_t *out, VertexQuantizeError &error)
+{
+	float scale[3];
+	float offset[3];
+	PositionDequantize(boundsMin, boundsMax, scale, offset);
+
+	unsigned int uvSize = layout.uvFormat == VERTEX_FORMAT_FLOAT16 ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+	unsigned int vertexFloats = UnpackedVertexFloats(layout);
+
+	memset(out, 0, numVertices * layout.vertexSize);
+	for(unsigned int vertexIndex=0;vertexIndex < numVertices; vertexIndex++)
+	{
+		const float *source = vertices + vertexIndex * vertexFloats;
+		uint8_t *dest = out + vertexIndex * layout.vertexSize;
+
+		if(layout.positionFormat != VERTEX_FORMAT_NONE)
+		{
+			PackPosition(source, layout, scale, offset, dest + layout.positionOffset, error);
+			source += 3;
+		}
+
+		if(layout.normalFormat != VERTEX_FORMAT_NONE)
+		{
+			PackNormal(source, layout, dest + layout.normalOffset, error);
+			source += 3;
+		}
+
+		if(layout.uvFormat != VERTEX_FORMAT_NONE)
+		{
+			for(unsigned int uvSetIdx=0;uvSetIdx < layout.numUVSets; uvSetIdx++)
+			{
+				PackUV(source, layout, dest + layout.uvOffset + uvSetIdx * uvSize, error);
+				source += 2;
+			}
+		}
+	}
+}
+
+} // namespace Helix
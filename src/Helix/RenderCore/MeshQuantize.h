@@ -0,0 +1,79 @@
+#ifndef MESHQUANTIZE_H
+#define MESHQUANTIZE_H
+
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// Vertex compression
+//
+// Meshes are built with float attributes and packed into whatever formats
+// their vertex declaration asks for:
+//
+//	Positions	16 bit UNORM within the mesh's bounds.  The shader sees 0..1
+//				and the box is put back by the dequantization matrix, which
+//				the renderer folds into the world view matrix.
+//	Normals		Octahedral, two 16 or 8 bit SNORMs.  The shader unfolds them.
+//	UVs			Half floats.
+//
+// Any attribute can also stay 32 bit float.  Nothing here depends on D3D,
+// so tools can pack meshes too.
+// ****************************************************************************
+
+enum VertexFormat
+{
+	VERTEX_FORMAT_NONE,				// Not in the vertex
+	VERTEX_FORMAT_FLOAT32,
+	VERTEX_FORMAT_FLOAT16,
+	VERTEX_FORMAT_UNORM16,			// Positions only, four components with w = 1
+	VERTEX_FORMAT_OCT_SNORM16,		// Normals only
+	VERTEX_FORMAT_OCT_SNORM8,		// Normals only
+};
+
+// Where each attribute goes in a packed vertex.  UV sets follow each other
+// from uvOffset.
+struct VertexLayout
+{
+	VertexFormat	positionFormat;
+	unsigned int	positionOffset;
+	VertexFormat	normalFormat;
+	unsigned int	normalOffset;
+	VertexFormat	uvFormat;
+	unsigned int	uvOffset;
+	unsigned int	numUVSets;
+	unsigned int	vertexSize;
+};
+
+// The worst any one vertex came out, in object space units for positions,
+// degrees for normals and texels of a 1024 texture for UVs
+struct VertexQuantizeError
+{
+	float	position;
+	float	normalDegrees;
+	float	uvTexels;
+};
+
+// Floats in each unpacked vertex: xyz position, xyz normal and uv per set,
+// for the attributes the layout has
+unsigned int	UnpackedVertexFloats(const VertexLayout &layout);
+
+// The box a quantized position's 0..1 maps back onto.  Flat axes get a
+// scale of 1 so the matrix stays invertible.
+void	PositionDequantize(const float boundsMin[3], const float boundsMax[3], float scale[3], float offset[3]);
+
+// Packs numVertices unpacked vertices into out, layout.vertexSize bytes each.
+// Padding is zeroed.  error gets the worst of what these vertices lost added
+// to what's already there.
+void	PackVertices(const float *vertices, unsigned int numVertices, const VertexLayout &layout, const float boundsMin[3], const float boundsMax[3], uint8_t *out, VertexQuantizeError &error);
+
+uint16_t	FloatToHalf(float value);
+float		HalfToFloat(uint16_t value);
+
+// Unit normal to and from the octahedron unfolded onto a square, each axis
+// a signed integer of the given number of bits
+void	OctahedralEncode(const float normal[3], unsigned int bits, int32_t &x, int32_t &y);
+void	OctahedralDecode(int32_t x, int32_t y, unsigned int bits, float normal[3]);
+
+} // namespace Helix
+#endif // MESHQUANTIZE_H
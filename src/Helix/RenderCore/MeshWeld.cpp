@@ -0,0 +1,75 @@
+#include <string.h>
+#include "MeshWeld.h"
+
+namespace Helix {
+
+const uint32_t	EMPTY_SLOT = 0xffffffff;
+
+// ****************************************************************************
+// Murmur3's finalizer folded over the tuple.  Index tuples are small and
+// highly correlated, so every bit needs mixing before it picks a slot.
+// ****************************************************************************
+inline uint32_t HashKey(const uint32_t *key, unsigned int keySize)
+{
+	uint32_t hash = 0x9e3779b9;
+	for(unsigned int i=0;i<keySize;i++)
+	{
+		hash ^= key[i];
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35;
+		hash ^= hash >> 16;
+	}
+	return hash;
+}
+
+// ****************************************************************************
+// The table is a power of two at least twice the corner count, so it's never
+// more than half full and probes stay short
+// ****************************************************************************
+unsigned int WeldCorners(const uint32_t *keys, unsigned int numCorners, unsigned int keySize, uint32_t *cornerVertex, uint32_t *vertexCorner)
+{
+	_ASSERT(keySize > 0);
+
+	unsigned int tableSize = 16;
+	while(tableSize < numCorners * 2)
+	{
+		tableSize *= 2;
+	}
+	unsigned int mask = tableSize - 1;
+
+	// Slots hold vertex numbers
+	uint32_t *table = new uint32_t[tableSize];
+	memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+	unsigned int numVertices = 0;
+	for(unsigned int corner=0;corner<numCorners;corner++)
+	{
+		const uint32_t *key = keys + corner * keySize;
+		unsigned int slot = HashKey(key, keySize) & mask;
+
+		// Linear probing until the tuple or a free slot turns up
+		while(table[slot] != EMPTY_SLOT)
+		{
+			const uint32_t *other = keys + vertexCorner[table[slot]] * keySize;
+			if(memcmp(key, other, keySize * sizeof(uint32_t)) == 0)
+				break;
+
+			slot = (slot + 1) & mask;
+		}
+
+		if(table[slot] == EMPTY_SLOT)
+		{
+			table[slot] = numVertices;
+			vertexCorner[numVertices] = corner;
+			numVertices++;
+		}
+
+		cornerVertex[corner] = table[slot];
+	}
+
+	delete [] table;
+	return numVertices;
+}
+
+} // namespace Helix
@@ -0,0 +1,26 @@
+#ifndef MESHWELD_H
+#define MESHWELD_H
+
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// Vertex welding
+//
+// Exported meshes describe each triangle corner as a tuple of attribute
+// indices (position, normal, one per UV set).  Corners with the same tuple
+// are the same vertex, so they're hashed into an open addressing table and
+// only the first of each is kept.
+//
+// keys holds numCorners tuples of keySize indices each.  On return
+// cornerVertex maps every corner to its vertex, and vertexCorner maps every
+// vertex back to the first corner that made it, so the caller can build the
+// vertex from that corner's attributes.  Vertices are numbered in the order
+// their first corner appears.  Both arrays must hold numCorners entries.
+// Returns the number of vertices.
+// ****************************************************************************
+unsigned int	WeldCorners(const uint32_t *keys, unsigned int numCorners, unsigned int keySize, uint32_t *cornerVertex, uint32_t *vertexCorner);
+
+} // namespace Helix
+#endif // MESHWELD_H
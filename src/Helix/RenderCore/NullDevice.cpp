@@ -0,0 +1,522 @@
+#include "NullDevice.h"
+#include "Kernel/Atomic.h"
+
+namespace Helix {
+
+// What actually lives behind the interface pointers the null device hands out
+struct NullObject
+{
+	uint32_t	id;
+	uint32_t	size;		// Bytes of CPU visible storage, for mappable buffers
+	uint8_t *	data;
+};
+
+const unsigned int	MIN_LOG_SIZE = 4096;
+
+// ****************************************************************************
+// ****************************************************************************
+inline NullObject * ToNullObject(const void *object)
+{
+	return reinterpret_cast<NullObject *>(const_cast<void *>(object));
+}
+
+// ****************************************************************************
+// Id 0 is reserved for NULL so unbinds show up in the log too
+// ****************************************************************************
+inline uint32_t NullObjectId(const void *object)
+{
+	return object != NULL ? ToNullObject(object)->id : 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+NullRenderDevice::NullRenderDevice(unsigned int backBufferWidth, unsigned int backBufferHeight)
+: m_backBufferWidth(backBufferWidth)
+, m_backBufferHeight(backBufferHeight)
+, m_nextId(0)
+, m_numLiveObjects(0)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+NullRenderDevice::~NullRenderDevice()
+{
+	// Anything still alive at this point was never released by the renderer.
+	// The records themselves go away with the process.
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ID3D11DeviceChild * NullRenderDevice::CreateObject(size_t size)
+{
+	NullObject *object = new NullObject;
+	object->id = AtomicIncrement(&m_nextId);
+	object->size = static_cast<uint32_t>(size);
+	object->data = size > 0 ? new uint8_t[size] : NULL;
+
+	AtomicIncrement(&m_numLiveObjects);
+	return reinterpret_cast<ID3D11DeviceChild *>(object);
+}
+
+// ****************************************************************************
+// Only buffers the CPU can write to get backing storage
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateBuffer(const D3D11_BUFFER_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Buffer **buffer)
+{
+	_ASSERT(desc != NULL && buffer != NULL);
+	size_t size = (desc->CPUAccessFlags & D3D11_CPU_ACCESS_WRITE) ? desc->ByteWidth : 0;
+	*buffer = reinterpret_cast<ID3D11Buffer *>(CreateObject(size));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateTexture2D(const D3D11_TEXTURE2D_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Texture2D **texture)
+{
+	_ASSERT(desc != NULL && texture != NULL);
+	*texture = reinterpret_cast<ID3D11Texture2D *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateTextureFromMemory(const uint8_t *data, size_t size, ID3D11Resource **texture, ID3D11ShaderResourceView **view)
+{
+	_ASSERT(data != NULL && size > 0);
+	*texture = reinterpret_cast<ID3D11Resource *>(CreateObject(0));
+	*view = reinterpret_cast<ID3D11ShaderResourceView *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateShaderResourceView(ID3D11Resource *resource, const D3D11_SHADER_RESOURCE_VIEW_DESC *desc, ID3D11ShaderResourceView **view)
+{
+	_ASSERT(resource != NULL);
+	*view = reinterpret_cast<ID3D11ShaderResourceView *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateRenderTargetView(ID3D11Resource *resource, const D3D11_RENDER_TARGET_VIEW_DESC *desc, ID3D11RenderTargetView **view)
+{
+	_ASSERT(resource != NULL);
+	*view = reinterpret_cast<ID3D11RenderTargetView *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateDepthStencilView(ID3D11Resource *resource, const D3D11_DEPTH_STENCIL_VIEW_DESC *desc, ID3D11DepthStencilView **view)
+{
+	_ASSERT(resource != NULL);
+	*view = reinterpret_cast<ID3D11DepthStencilView *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// Every call hands out a new texture, which the caller releases like it would
+// the swap chain's.
+// ****************************************************************************
+HRESULT NullRenderDevice::GetBackBuffer(ID3D11Texture2D **texture, D3D11_TEXTURE2D_DESC *desc)
+{
+	*texture = reinterpret_cast<ID3D11Texture2D *>(CreateObject(0));
+
+	if(desc != NULL)
+	{
+		memset(desc, 0, sizeof(D3D11_TEXTURE2D_DESC));
+		desc->Width = m_backBufferWidth;
+		desc->Height = m_backBufferHeight;
+		desc->MipLevels = 1;
+		desc->ArraySize = 1;
+		desc->Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc->SampleDesc.Count = 1;
+		desc->Usage = D3D11_USAGE_DEFAULT;
+		desc->BindFlags = D3D11_BIND_RENDER_TARGET;
+	}
+	return S_OK;
+}
+
+// ****************************************************************************
+// There's no compiler behind us.  Hand back a token so the layout/shader
+// creation that follows has something to chew on.
+// ****************************************************************************
+HRESULT NullRenderDevice::CompileShader(const void *source, size_t sourceSize, const char *entry, const char *profile, unsigned int flags, uint8_t **bytecode, size_t *bytecodeSize)
+{
+	_ASSERT(source != NULL && entry != NULL && profile != NULL);
+
+	size_t size = strlen(entry) + 1;
+	*bytecode = new uint8_t[size];
+	memcpy(*bytecode, entry, size);
+	*bytecodeSize = size;
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateVertexShader(const void *bytecode, size_t bytecodeSize, ID3D11VertexShader **shader)
+{
+	_ASSERT(bytecode != NULL && bytecodeSize > 0);
+	*shader = reinterpret_cast<ID3D11VertexShader *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreatePixelShader(const void *bytecode, size_t bytecodeSize, ID3D11PixelShader **shader)
+{
+	_ASSERT(bytecode != NULL && bytecodeSize > 0);
+	*shader = reinterpret_cast<ID3D11PixelShader *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, unsigned int numElements, const void *bytecode, size_t bytecodeSize, ID3D11InputLayout **layout)
+{
+	_ASSERT(elements != NULL && numElements > 0);
+	*layout = reinterpret_cast<ID3D11InputLayout *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC *desc, ID3D11SamplerState **state)
+{
+	*state = reinterpret_cast<ID3D11SamplerState *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC *desc, ID3D11RasterizerState **state)
+{
+	*state = reinterpret_cast<ID3D11RasterizerState *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateBlendState(const D3D11_BLEND_DESC *desc, ID3D11BlendState **state)
+{
+	*state = reinterpret_cast<ID3D11BlendState *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC *desc, ID3D11DepthStencilState **state)
+{
+	*state = reinterpret_cast<ID3D11DepthStencilState *>(CreateObject(0));
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderDevice::Release(ID3D11DeviceChild *object)
+{
+	if(object == NULL)
+		return;
+
+	NullObject *nullObject = ToNullObject(object);
+	delete [] nullObject->data;
+	delete nullObject;
+
+	long live = AtomicDecrement(&m_numLiveObjects);
+	_ASSERT(live >= 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+NullRenderContext::NullRenderContext(bool constantBufferOffsets)
+: m_log(NULL)
+, m_logCount(0)
+, m_logSize(MIN_LOG_SIZE)
+, m_lastLog(NULL)
+, m_lastLogCount(0)
+, m_lastLogSize(MIN_LOG_SIZE)
+, m_numFrames(0)
+, m_constantBufferOffsets(constantBufferOffsets)
+{
+	m_log = new RenderCommand[m_logSize];
+	m_lastLog = new RenderCommand[m_lastLogSize];
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(&m_lastStats, 0, sizeof(m_lastStats));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+NullRenderContext::~NullRenderContext()
+{
+	delete [] m_log;
+	delete [] m_lastLog;
+}
+
+// ****************************************************************************
+// The log only grows; once it has seen the busiest frame it stays put.
+// ****************************************************************************
+inline void NullRenderContext::Record(RenderCommand::Op op, unsigned int slot, unsigned int count, uint32_t arg, bool isState)
+{
+	if(m_logCount == m_logSize)
+	{
+		RenderCommand *newLog = new RenderCommand[m_logSize * 2];
+		memcpy(newLog, m_log, m_logCount * sizeof(RenderCommand));
+		delete [] m_log;
+		m_log = newLog;
+		m_logSize *= 2;
+	}
+
+	RenderCommand &cmd = m_log[m_logCount++];
+	cmd.op = static_cast<uint8_t>(op);
+	cmd.slot = static_cast<uint8_t>(slot);
+	cmd.count = static_cast<uint16_t>(count);
+	cmd.arg = arg;
+
+	m_stats.calls++;
+	m_stats.opCounts[op]++;
+	if(isState)
+		m_stats.stateChanges++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT NullRenderContext::Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped)
+{
+	NullObject *object = ToNullObject(resource);
+	_ASSERT(object != NULL && object->data != NULL);
+
+	mapped->pData = object->data;
+	mapped->RowPitch = object->size;
+	mapped->DepthPitch = object->size;
+
+	Record(RenderCommand::MAP, subresource, 0, object->id, false);
+	m_stats.maps++;
+	m_stats.bytesMapped += object->size;
+	return S_OK;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::Unmap(ID3D11Resource *resource, unsigned int subresource)
+{
+	Record(RenderCommand::UNMAP, subresource, 0, NullObjectId(resource), false);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::IASetInputLayout(ID3D11InputLayout *layout)
+{
+	Record(RenderCommand::SET_INPUT_LAYOUT, 0, 1, NullObjectId(layout), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets)
+{
+	Record(RenderCommand::SET_VERTEX_BUFFERS, startSlot, numBuffers, NullObjectId(buffers[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	Record(RenderCommand::SET_INDEX_BUFFER, 0, 1, NullObjectId(buffer), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	Record(RenderCommand::SET_TOPOLOGY, 0, 1, static_cast<uint32_t>(topology), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::VSSetShader(ID3D11VertexShader *shader)
+{
+	Record(RenderCommand::SET_VS, 0, 1, NullObjectId(shader), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::PSSetShader(ID3D11PixelShader *shader)
+{
+	Record(RenderCommand::SET_PS, 0, 1, NullObjectId(shader), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::GSSetShader(ID3D11GeometryShader *shader)
+{
+	Record(RenderCommand::SET_GS, 0, 1, NullObjectId(shader), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::HSSetShader(ID3D11HullShader *shader)
+{
+	Record(RenderCommand::SET_HS, 0, 1, NullObjectId(shader), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::DSSetShader(ID3D11DomainShader *shader)
+{
+	Record(RenderCommand::SET_DS, 0, 1, NullObjectId(shader), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	Record(RenderCommand::SET_VS_CONSTANTS, startSlot, numBuffers, NullObjectId(buffers[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	Record(RenderCommand::SET_PS_CONSTANTS, startSlot, numBuffers, NullObjectId(buffers[0]), true);
+}
+
+// ****************************************************************************
+// Unless asked otherwise, so the renderer's offset path can be run headless
+// ****************************************************************************
+bool NullRenderContext::ConstantBufferOffsets()
+{
+	return m_constantBufferOffsets;
+}
+
+// ****************************************************************************
+// The window isn't logged; it's the same bind as far as the counters go
+// ****************************************************************************
+void NullRenderContext::VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	_ASSERT((firstConstant[0] & 15) == 0 && (numConstants[0] & 15) == 0);
+	Record(RenderCommand::SET_VS_CONSTANTS, startSlot, numBuffers, NullObjectId(buffers[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	_ASSERT((firstConstant[0] & 15) == 0 && (numConstants[0] & 15) == 0);
+	Record(RenderCommand::SET_PS_CONSTANTS, startSlot, numBuffers, NullObjectId(buffers[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views)
+{
+	Record(RenderCommand::SET_PS_RESOURCES, startSlot, numViews, NullObjectId(views[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers)
+{
+	Record(RenderCommand::SET_PS_SAMPLERS, startSlot, numSamplers, NullObjectId(samplers[0]), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::RSSetState(ID3D11RasterizerState *state)
+{
+	Record(RenderCommand::SET_RASTERIZER_STATE, 0, 1, NullObjectId(state), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports)
+{
+	Record(RenderCommand::SET_VIEWPORTS, 0, numViewports, 0, true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects)
+{
+	Record(RenderCommand::SET_SCISSOR_RECTS, 0, numRects, 0, true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil)
+{
+	Record(RenderCommand::SET_RENDER_TARGETS, 0, numViews, numViews > 0 ? NullObjectId(views[0]) : 0, true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask)
+{
+	Record(RenderCommand::SET_BLEND_STATE, 0, 1, NullObjectId(state), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef)
+{
+	Record(RenderCommand::SET_DEPTH_STENCIL_STATE, 0, 1, NullObjectId(state), true);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4])
+{
+	Record(RenderCommand::CLEAR_RENDER_TARGET, 0, 0, NullObjectId(view), false);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil)
+{
+	Record(RenderCommand::CLEAR_DEPTH_STENCIL, 0, 0, NullObjectId(view), false);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void NullRenderContext::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	Record(RenderCommand::DRAW_INDEXED, 0, 0, indexCount, false);
+	m_stats.draws++;
+	m_stats.instances++;
+	m_stats.indices += indexCount;
+}
+
+// ****************************************************************************
+// The instance count goes in the count field, clamped to what fits
+// ****************************************************************************
+void NullRenderContext::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	Record(RenderCommand::DRAW_INDEXED_INSTANCED, 0, instanceCount < 0xffff ? instanceCount : 0xffff, indexCount, false);
+	m_stats.draws++;
+	m_stats.instances += instanceCount;
+	m_stats.indices += indexCount * instanceCount;
+}
+
+// ****************************************************************************
+// Closes out the frame.  The log and counters just recorded become the "last
+// frame" and the other log is reused for the next one.
+// ****************************************************************************
+void NullRenderContext::Present(unsigned int syncInterval, unsigned int flags)
+{
+	Record(RenderCommand::PRESENT, 0, 0, m_numFrames, false);
+
+	RenderCommand *log = m_lastLog;
+	unsigned int logSize = m_lastLogSize;
+	m_lastLog = m_log;
+	m_lastLogSize = m_logSize;
+	m_lastLogCount = m_logCount;
+	m_log = log;
+	m_logSize = logSize;
+	m_logCount = 0;
+
+	m_lastStats = m_stats;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_numFrames++;
+}
+
+} // namespace Helix
@@ -0,0 +1,190 @@
+#ifndef NULLDEVICE_H
+#define NULLDEVICE_H
+
+#include "RenderDevice.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// Null backend
+//
+// Accepts everything the renderer asks for without touching a GPU, so the
+// submission, sort and state binding paths can be run and timed headless.
+// Objects are small records handed back behind the D3D11 interface pointers;
+// the renderer never looks inside them.  The context writes every call into a
+// compact command log and keeps per frame counters; Present() ends the frame.
+//
+// It builds anywhere the tests do.  NullDeviceTest runs the render graph,
+// constant ring and state cache through it on Linux, and ScenePassesTest
+// runs the GBuffer and lighting passes.  RenderThread itself still needs
+// Win32 threads and events, LuaPlus and a D3D shader compiler, which is why
+// the passes live in ScenePasses.
+// ****************************************************************************
+
+// One logged context call.  8 bytes so a frame's worth stays in cache.
+struct RenderCommand
+{
+	enum Op
+	{
+		MAP = 0,
+		UNMAP,
+		SET_INPUT_LAYOUT,
+		SET_VERTEX_BUFFERS,
+		SET_INDEX_BUFFER,
+		SET_TOPOLOGY,
+		SET_VS,
+		SET_PS,
+		SET_GS,
+		SET_HS,
+		SET_DS,
+		SET_VS_CONSTANTS,
+		SET_PS_CONSTANTS,
+		SET_PS_RESOURCES,
+		SET_PS_SAMPLERS,
+		SET_RASTERIZER_STATE,
+		SET_VIEWPORTS,
+		SET_SCISSOR_RECTS,
+		SET_RENDER_TARGETS,
+		SET_BLEND_STATE,
+		SET_DEPTH_STENCIL_STATE,
+		CLEAR_RENDER_TARGET,
+		CLEAR_DEPTH_STENCIL,
+		DRAW_INDEXED,
+		DRAW_INDEXED_INSTANCED,
+		PRESENT,
+		NUM_OPS
+	};
+
+	uint8_t		op;
+	uint8_t		slot;		// First slot for ranged binds
+	uint16_t	count;		// Number of slots for ranged binds, or instances for an instanced draw
+	uint32_t	arg;		// Id of the (first) object bound, or the index count of a draw
+};
+
+// Per frame counters
+struct RenderContextStats
+{
+	unsigned int	calls;				// Every context call
+	unsigned int	stateChanges;		// Calls that bind state
+	unsigned int	draws;				// Draw calls, instanced or not
+	unsigned int	instances;			// Objects drawn
+	unsigned int	indices;
+	unsigned int	maps;
+	size_t			bytesMapped;
+	unsigned int	opCounts[RenderCommand::NUM_OPS];
+};
+
+// ****************************************************************************
+// ****************************************************************************
+class NullRenderDevice : public RenderDevice
+{
+public:
+	NullRenderDevice(unsigned int backBufferWidth, unsigned int backBufferHeight);
+	virtual ~NullRenderDevice();
+
+	virtual HRESULT	CreateBuffer(const D3D11_BUFFER_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Buffer **buffer);
+	virtual HRESULT	CreateTexture2D(const D3D11_TEXTURE2D_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Texture2D **texture);
+	virtual HRESULT	CreateTextureFromMemory(const uint8_t *data, size_t size, ID3D11Resource **texture, ID3D11ShaderResourceView **view);
+	virtual HRESULT	CreateShaderResourceView(ID3D11Resource *resource, const D3D11_SHADER_RESOURCE_VIEW_DESC *desc, ID3D11ShaderResourceView **view);
+	virtual HRESULT	CreateRenderTargetView(ID3D11Resource *resource, const D3D11_RENDER_TARGET_VIEW_DESC *desc, ID3D11RenderTargetView **view);
+	virtual HRESULT	CreateDepthStencilView(ID3D11Resource *resource, const D3D11_DEPTH_STENCIL_VIEW_DESC *desc, ID3D11DepthStencilView **view);
+	virtual HRESULT	GetBackBuffer(ID3D11Texture2D **texture, D3D11_TEXTURE2D_DESC *desc);
+
+	virtual HRESULT	CompileShader(const void *source, size_t sourceSize, const char *entry, const char *profile, unsigned int flags, uint8_t **bytecode, size_t *bytecodeSize);
+	virtual HRESULT	CreateVertexShader(const void *bytecode, size_t bytecodeSize, ID3D11VertexShader **shader);
+	virtual HRESULT	CreatePixelShader(const void *bytecode, size_t bytecodeSize, ID3D11PixelShader **shader);
+	virtual HRESULT	CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, unsigned int numElements, const void *bytecode, size_t bytecodeSize, ID3D11InputLayout **layout);
+
+	virtual HRESULT	CreateSamplerState(const D3D11_SAMPLER_DESC *desc, ID3D11SamplerState **state);
+	virtual HRESULT	CreateRasterizerState(const D3D11_RASTERIZER_DESC *desc, ID3D11RasterizerState **state);
+	virtual HRESULT	CreateBlendState(const D3D11_BLEND_DESC *desc, ID3D11BlendState **state);
+	virtual HRESULT	CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC *desc, ID3D11DepthStencilState **state);
+
+	virtual void	Release(ID3D11DeviceChild *object);
+
+	// Objects created and not yet released
+	unsigned int	NumLiveObjects() const	{ return m_numLiveObjects; }
+
+private:
+	NullRenderDevice(const NullRenderDevice &other);
+	NullRenderDevice & operator=(const NullRenderDevice &other);
+
+	ID3D11DeviceChild *	CreateObject(size_t size);
+
+	unsigned int		m_backBufferWidth;
+	unsigned int		m_backBufferHeight;
+	volatile long		m_nextId;
+	volatile long		m_numLiveObjects;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+class NullRenderContext : public RenderContext
+{
+public:
+	// Without constant buffer offsets it takes the path D3D 11.0 drivers do
+	explicit NullRenderContext(bool constantBufferOffsets = true);
+	virtual ~NullRenderContext();
+
+	virtual HRESULT	Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped);
+	virtual void	Unmap(ID3D11Resource *resource, unsigned int subresource);
+
+	virtual void	IASetInputLayout(ID3D11InputLayout *layout);
+	virtual void	IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets);
+	virtual void	IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset);
+	virtual void	IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	virtual void	VSSetShader(ID3D11VertexShader *shader);
+	virtual void	PSSetShader(ID3D11PixelShader *shader);
+	virtual void	GSSetShader(ID3D11GeometryShader *shader);
+	virtual void	HSSetShader(ID3D11HullShader *shader);
+	virtual void	DSSetShader(ID3D11DomainShader *shader);
+	virtual void	VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual void	PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual bool	ConstantBufferOffsets();
+	virtual void	VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views);
+	virtual void	PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers);
+
+	virtual void	RSSetState(ID3D11RasterizerState *state);
+	virtual void	RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports);
+	virtual void	RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects);
+	virtual void	OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil);
+	virtual void	OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask);
+	virtual void	OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef);
+
+	virtual void	ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4]);
+	virtual void	ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil);
+
+	virtual void	DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	virtual void	DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	virtual void	Present(unsigned int syncInterval, unsigned int flags);
+
+	// The last frame that was presented
+	const RenderContextStats &	LastFrameStats() const	{ return m_lastStats; }
+	const RenderCommand *		LastFrameCommands() const	{ return m_lastLog; }
+	unsigned int				LastFrameNumCommands() const	{ return m_lastLogCount; }
+	unsigned int				NumFrames() const		{ return m_numFrames; }
+
+private:
+	NullRenderContext(const NullRenderContext &other);
+	NullRenderContext & operator=(const NullRenderContext &other);
+
+	void	Record(RenderCommand::Op op, unsigned int slot, unsigned int count, uint32_t arg, bool isState);
+
+	RenderCommand *			m_log;
+	unsigned int			m_logCount;
+	unsigned int			m_logSize;
+	RenderCommand *			m_lastLog;
+	unsigned int			m_lastLogCount;
+	unsigned int			m_lastLogSize;
+	RenderContextStats		m_stats;
+	RenderContextStats		m_lastStats;
+	unsigned int			m_numFrames;
+	bool					m_constantBufferOffsets;
+};
+
+} // namespace Helix
+#endif // NULLDEVICE_H
@@ -0,0 +1,568 @@
+#include <malloc.h>
+#include <math.h>
+#include <emmintrin.h>
+#include "OcclusionBuffer.h"
+#include "Math/AABB.h"
+#include "Kernel/JobSystem.h"
+
+namespace Helix {
+
+const int32_t		SUBPIXEL_BITS = 4;
+const int32_t		SUBPIXEL_SIZE = 1 << SUBPIXEL_BITS;
+const int32_t		SUBPIXEL_HALF = SUBPIXEL_SIZE / 2;
+
+// Triangles are only clipped to x and y once they poke this far outside the
+// screen, in multiples of w.  Keeps the fixed point edge functions well inside
+// 32 bits without clipping most triangles that merely cross the screen edge.
+const float			GUARD_BAND = 2.0f;
+
+// Clip planes as xyzw coefficients; inside is a dot product >= 0
+const unsigned int	NUM_CLIP_PLANES = 5;
+const float			CLIP_PLANES[NUM_CLIP_PLANES][4] =
+{
+	{  0.0f,  0.0f, 1.0f, 0.0f },			// Near, D3D depth runs 0 to w
+	{  1.0f,  0.0f, 0.0f, GUARD_BAND },		// Left
+	{ -1.0f,  0.0f, 0.0f, GUARD_BAND },		// Right
+	{  0.0f,  1.0f, 0.0f, GUARD_BAND },		// Bottom
+	{  0.0f, -1.0f, 0.0f, GUARD_BAND },		// Top
+};
+
+// A triangle clipped against every plane has at most this many corners
+const unsigned int	MAX_CLIP_VERTS = 3 + NUM_CLIP_PLANES;
+
+const unsigned int	MIN_OCCLUDER_VERTS = 1024;
+const unsigned int	MIN_OCCLUDER_TRIANGLES = 1024;
+const unsigned int	MIN_BIN_SIZE = 256;
+
+// ****************************************************************************
+// ****************************************************************************
+inline float ClipDistance(const float *plane, const float *v)
+{
+	return plane[0] * v[0] + plane[1] * v[1] + plane[2] * v[2] + plane[3] * v[3];
+}
+
+// ****************************************************************************
+// ****************************************************************************
+OcclusionBuffer::OcclusionBuffer()
+: m_depth(NULL)
+, m_clipVerts(NULL)
+, m_clipVertCapacity(0)
+, m_triangles(NULL)
+, m_numTriangles(0)
+, m_triangleCapacity(0)
+{
+	m_viewProj.SetIdentity();
+
+	m_depth = static_cast<float *>(_aligned_malloc(WIDTH * HEIGHT * sizeof(float), 16));
+	_ASSERT(m_depth != NULL);
+	for(unsigned int i=0;i<WIDTH * HEIGHT;i++)
+	{
+		m_depth[i] = 1.0f;
+	}
+	for(unsigned int i=0;i<HIZ_WIDTH * HIZ_HEIGHT;i++)
+	{
+		m_hiZ[i] = 1.0f;
+	}
+
+	for(unsigned int i=0;i<NUM_TILES;i++)
+	{
+		m_bins[i] = NULL;
+		m_binCounts[i] = 0;
+		m_binCapacity[i] = 0;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+OcclusionBuffer::~OcclusionBuffer()
+{
+	_aligned_free(m_depth);
+	_aligned_free(m_clipVerts);
+	delete [] m_triangles;
+	for(unsigned int i=0;i<NUM_TILES;i++)
+	{
+		delete [] m_bins[i];
+	}
+}
+
+// ****************************************************************************
+// Scratch space, so nothing needs keeping
+// ****************************************************************************
+void OcclusionBuffer::ReserveVertices(unsigned int count)
+{
+	if(count <= m_clipVertCapacity)
+		return;
+
+	unsigned int capacity = m_clipVertCapacity > 0 ? m_clipVertCapacity : MIN_OCCLUDER_VERTS;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	_aligned_free(m_clipVerts);
+	m_clipVerts = static_cast<float *>(_aligned_malloc(4 * capacity * sizeof(float), 16));
+	_ASSERT(m_clipVerts != NULL);
+	m_clipVertCapacity = capacity;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void OcclusionBuffer::ReserveTriangles(unsigned int count)
+{
+	if(count <= m_triangleCapacity)
+		return;
+
+	unsigned int capacity = m_triangleCapacity > 0 ? m_triangleCapacity : MIN_OCCLUDER_TRIANGLES;
+	while(capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	OcclusionTriangle *triangles = new OcclusionTriangle[capacity];
+	if(m_numTriangles > 0)
+	{
+		memcpy(triangles, m_triangles, m_numTriangles * sizeof(OcclusionTriangle));
+	}
+	delete [] m_triangles;
+	m_triangles = triangles;
+	m_triangleCapacity = capacity;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void OcclusionBuffer::BeginFrame(const Matrix4x4 &viewProj)
+{
+	m_viewProj = viewProj;
+	m_numTriangles = 0;
+	for(unsigned int i=0;i<NUM_TILES;i++)
+	{
+		m_binCounts[i] = 0;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void OcclusionBuffer::AddOccluder(const float *positions, unsigned int numPositions, const uint32_t *indices, unsigned int numTriangles, const Matrix4x4 &world)
+{
+	Matrix4x4 mvp = m_viewProj * world;
+
+	// To clip space.  Each column of the matrix scales one input component.
+	__m128 col0 = _mm_setr_ps(mvp.r[0][0], mvp.r[1][0], mvp.r[2][0], mvp.r[3][0]);
+	__m128 col1 = _mm_setr_ps(mvp.r[0][1], mvp.r[1][1], mvp.r[2][1], mvp.r[3][1]);
+	__m128 col2 = _mm_setr_ps(mvp.r[0][2], mvp.r[1][2], mvp.r[2][2], mvp.r[3][2]);
+	__m128 col3 = _mm_setr_ps(mvp.r[0][3], mvp.r[1][3], mvp.r[2][3], mvp.r[3][3]);
+
+	ReserveVertices(numPositions);
+	for(unsigned int i=0;i<numPositions;i++)
+	{
+		const float *p = positions + 3 * i;
+		__m128 clip = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(p[0])), _mm_mul_ps(col1, _mm_set1_ps(p[1]))),
+			_mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(p[2])), col3));
+		_mm_store_ps(m_clipVerts + 4 * i, clip);
+	}
+
+	for(unsigned int i=0;i<numTriangles;i++)
+	{
+		const uint32_t *tri = indices + 3 * i;
+		_ASSERT(tri[0] < numPositions && tri[1] < numPositions && tri[2] < numPositions);
+		ClipTriangle(m_clipVerts + 4 * tri[0], m_clipVerts + 4 * tri[1], m_clipVerts + 4 * tri[2]);
+	}
+}
+
+// ****************************************************************************
+// Throws away triangles wholly outside the frustum, then clips what's left
+// against the near plane and the guard band
+// ****************************************************************************
+void OcclusionBuffer::ClipTriangle(const float *v0, const float *v1, const float *v2)
+{
+	const float *verts[3] = { v0, v1, v2 };
+
+	unsigned int left = 0, right = 0, bottom = 0, top = 0, front = 0, behind = 0;
+	unsigned int clipMask = 0;
+	for(int i=0;i<3;i++)
+	{
+		const float *v = verts[i];
+		left += v[0] < -v[3] ? 1 : 0;
+		right += v[0] > v[3] ? 1 : 0;
+		bottom += v[1] < -v[3] ? 1 : 0;
+		top += v[1] > v[3] ? 1 : 0;
+		front += v[2] < 0.0f ? 1 : 0;
+		behind += v[2] > v[3] ? 1 : 0;
+
+		for(unsigned int plane=0;plane<NUM_CLIP_PLANES;plane++)
+		{
+			clipMask |= ClipDistance(CLIP_PLANES[plane], v) < 0.0f ? (1 << plane) : 0;
+		}
+	}
+
+	if(left == 3 || right == 3 || bottom == 3 || top == 3 || front == 3 || behind == 3)
+		return;
+
+	if(clipMask == 0)
+	{
+		SetupTriangle(v0, v1, v2);
+		return;
+	}
+
+	// Sutherland-Hodgman, one plane at a time
+	float polyA[MAX_CLIP_VERTS][4];
+	float polyB[MAX_CLIP_VERTS][4];
+	float (*in)[4] = polyA;
+	float (*out)[4] = polyB;
+	unsigned int numIn = 3;
+	for(int i=0;i<3;i++)
+	{
+		memcpy(in[i], verts[i], 4 * sizeof(float));
+	}
+
+	for(unsigned int plane=0;plane<NUM_CLIP_PLANES && numIn >= 3;plane++)
+	{
+		if((clipMask & (1 << plane)) == 0)
+			continue;
+
+		unsigned int numOut = 0;
+		for(unsigned int i=0;i<numIn;i++)
+		{
+			const float *a = in[i];
+			const float *b = in[(i + 1) % numIn];
+			float da = ClipDistance(CLIP_PLANES[plane], a);
+			float db = ClipDistance(CLIP_PLANES[plane], b);
+
+			if(da >= 0.0f)
+			{
+				memcpy(out[numOut++], a, 4 * sizeof(float));
+			}
+
+			if((da >= 0.0f) != (db >= 0.0f))
+			{
+				float t = da / (da - db);
+				for(int c=0;c<4;c++)
+				{
+					out[numOut][c] = a[c] + (b[c] - a[c]) * t;
+				}
+				numOut++;
+			}
+		}
+
+		float (*swap)[4] = in;
+		in = out;
+		out = swap;
+		numIn = numOut;
+	}
+
+	for(unsigned int i=2;i<numIn;i++)
+	{
+		SetupTriangle(in[0], in[i - 1], in[i]);
+	}
+}
+
+// ****************************************************************************
+// Projects a clipped triangle, snaps it to the subpixel grid and bins it.
+// Triangles that don't cover a pixel center are dropped.
+// ****************************************************************************
+void OcclusionBuffer::SetupTriangle(const float *v0, const float *v1, const float *v2)
+{
+	const float *verts[3] = { v0, v1, v2 };
+
+	int32_t x[3], y[3];
+	float z[3];
+	for(int i=0;i<3;i++)
+	{
+		const float *v = verts[i];
+		if(v[3] <= 0.0f)
+			return;
+
+		float invW = 1.0f / v[3];
+		float sx = (v[0] * invW * 0.5f + 0.5f) * WIDTH;
+		float sy = (0.5f - v[1] * invW * 0.5f) * HEIGHT;
+		x[i] = static_cast<int32_t>(floorf(sx * SUBPIXEL_SIZE + 0.5f));
+		y[i] = static_cast<int32_t>(floorf(sy * SUBPIXEL_SIZE + 0.5f));
+		z[i] = v[2] * invW;
+	}
+
+	// Both windings draw, so put every triangle the same way round: positive
+	// area, which has the inside of every edge function positive
+	int32_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if(area == 0)
+		return;
+
+	if(area < 0)
+	{
+		int32_t ti = x[1]; x[1] = x[2]; x[2] = ti;
+		ti = y[1]; y[1] = y[2]; y[2] = ti;
+		float tf = z[1]; z[1] = z[2]; z[2] = tf;
+		area = -area;
+	}
+
+	// Pixels whose centers can be inside
+	int32_t minFX = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2]) : (x[1] < x[2] ? x[1] : x[2]);
+	int32_t maxFX = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2]) : (x[1] > x[2] ? x[1] : x[2]);
+	int32_t minFY = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2]) : (y[1] < y[2] ? y[1] : y[2]);
+	int32_t maxFY = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2]) : (y[1] > y[2] ? y[1] : y[2]);
+
+	int32_t minX = (minFX + SUBPIXEL_HALF - 1) >> SUBPIXEL_BITS;
+	int32_t maxX = (maxFX - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+	int32_t minY = (minFY + SUBPIXEL_HALF - 1) >> SUBPIXEL_BITS;
+	int32_t maxY = (maxFY - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+	minX = minX > 0 ? minX : 0;
+	minY = minY > 0 ? minY : 0;
+	maxX = maxX < WIDTH - 1 ? maxX : WIDTH - 1;
+	maxY = maxY < HEIGHT - 1 ? maxY : HEIGHT - 1;
+	if(minX > maxX || minY > maxY)
+		return;
+
+	ReserveTriangles(m_numTriangles + 1);
+	OcclusionTriangle &tri = m_triangles[m_numTriangles];
+
+	// Top and left edges own the pixel centers that land exactly on them
+	for(int i=0;i<3;i++)
+	{
+		int j = (i + 1) % 3;
+		int32_t a = y[i] - y[j];
+		int32_t b = x[j] - x[i];
+		bool topLeft = a > 0 || (a == 0 && b > 0);
+
+		tri.edgeA[i] = a;
+		tri.edgeB[i] = b;
+		tri.edgeC[i] = -a * x[i] - b * y[i] - (topLeft ? 0 : 1);
+	}
+
+	// Depth plane through the snapped corners
+	float fx0 = static_cast<float>(x[0]) / SUBPIXEL_SIZE;
+	float fy0 = static_cast<float>(y[0]) / SUBPIXEL_SIZE;
+	float dx1 = static_cast<float>(x[1] - x[0]) / SUBPIXEL_SIZE;
+	float dy1 = static_cast<float>(y[1] - y[0]) / SUBPIXEL_SIZE;
+	float dx2 = static_cast<float>(x[2] - x[0]) / SUBPIXEL_SIZE;
+	float dy2 = static_cast<float>(y[2] - y[0]) / SUBPIXEL_SIZE;
+	float invArea = 1.0f / (dx1 * dy2 - dx2 * dy1);
+	float dz1 = z[1] - z[0];
+	float dz2 = z[2] - z[0];
+
+	tri.depthA = (dz1 * dy2 - dz2 * dy1) * invArea;
+	tri.depthB = (dz2 * dx1 - dz1 * dx2) * invArea;
+	tri.depthC = z[0] - tri.depthA * fx0 - tri.depthB * fy0;
+
+	tri.minX = minX;
+	tri.minY = minY;
+	tri.maxX = maxX;
+	tri.maxY = maxY;
+
+	unsigned int index = m_numTriangles++;
+	for(int ty=minY / TILE_HEIGHT;ty<=maxY / TILE_HEIGHT;ty++)
+	{
+		for(int tx=minX / TILE_WIDTH;tx<=maxX / TILE_WIDTH;tx++)
+		{
+			unsigned int tile = ty * TILES_X + tx;
+			if(m_binCounts[tile] == m_binCapacity[tile])
+			{
+				unsigned int capacity = m_binCapacity[tile] > 0 ? m_binCapacity[tile] * 2 : MIN_BIN_SIZE;
+				uint32_t *bin = new uint32_t[capacity];
+				if(m_binCounts[tile] > 0)
+				{
+					memcpy(bin, m_bins[tile], m_binCounts[tile] * sizeof(uint32_t));
+				}
+				delete [] m_bins[tile];
+				m_bins[tile] = bin;
+				m_binCapacity[tile] = capacity;
+			}
+			m_bins[tile][m_binCounts[tile]++] = index;
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void OcclusionBuffer::Rasterize()
+{
+	ParallelFor(NUM_TILES, 1, RasterizeTilesJob, this);
+}
+
+// ****************************************************************************
+// Clears the tile, draws its triangles four pixels at a time and builds its
+// part of the max depth mip.  Every tile starts on a multiple of 4 pixels, so
+// a group of four never straddles two tiles.
+// ****************************************************************************
+void OcclusionBuffer::RasterizeTile(unsigned int tile)
+{
+	int32_t tileX = (tile % TILES_X) * TILE_WIDTH;
+	int32_t tileY = (tile / TILES_X) * TILE_HEIGHT;
+
+	const __m128 far4 = _mm_set1_ps(1.0f);
+	for(int32_t y=tileY;y<tileY + TILE_HEIGHT;y++)
+	{
+		float *row = m_depth + y * WIDTH;
+		for(int32_t x=tileX;x<tileX + TILE_WIDTH;x+=4)
+		{
+			_mm_store_ps(row + x, far4);
+		}
+	}
+
+	const __m128i minusOne = _mm_set1_epi32(-1);
+	const unsigned int numTriangles = m_binCounts[tile];
+	const uint32_t *bin = m_bins[tile];
+	for(unsigned int t=0;t<numTriangles;t++)
+	{
+		const OcclusionTriangle &tri = m_triangles[bin[t]];
+
+		int32_t minX = (tri.minX > tileX ? tri.minX : tileX) & ~3;
+		int32_t maxX = tri.maxX < tileX + TILE_WIDTH - 1 ? tri.maxX : tileX + TILE_WIDTH - 1;
+		int32_t minY = tri.minY > tileY ? tri.minY : tileY;
+		int32_t maxY = tri.maxY < tileY + TILE_HEIGHT - 1 ? tri.maxY : tileY + TILE_HEIGHT - 1;
+
+		// Edge functions and depth at the first pixel center, and how they
+		// change across a group of four and down a row
+		int32_t centerX = (minX << SUBPIXEL_BITS) + SUBPIXEL_HALF;
+		int32_t centerY = (minY << SUBPIXEL_BITS) + SUBPIXEL_HALF;
+
+		int32_t rowEdge[3];
+		__m128i laneEdge[3];
+		__m128i stepEdge[3];
+		for(int i=0;i<3;i++)
+		{
+			int32_t a = tri.edgeA[i] * SUBPIXEL_SIZE;
+			rowEdge[i] = tri.edgeA[i] * centerX + tri.edgeB[i] * centerY + tri.edgeC[i];
+			laneEdge[i] = _mm_setr_epi32(0, a, 2 * a, 3 * a);
+			stepEdge[i] = _mm_set1_epi32(4 * a);
+		}
+
+		float rowDepth = tri.depthA * (static_cast<float>(minX) + 0.5f) + tri.depthB * (static_cast<float>(minY) + 0.5f) + tri.depthC;
+		const __m128 laneDepth = _mm_setr_ps(0.0f, tri.depthA, 2.0f * tri.depthA, 3.0f * tri.depthA);
+		const __m128 stepDepth = _mm_set1_ps(4.0f * tri.depthA);
+
+		for(int32_t y=minY;y<=maxY;y++)
+		{
+			float *row = m_depth + y * WIDTH;
+
+			__m128i e0 = _mm_add_epi32(_mm_set1_epi32(rowEdge[0]), laneEdge[0]);
+			__m128i e1 = _mm_add_epi32(_mm_set1_epi32(rowEdge[1]), laneEdge[1]);
+			__m128i e2 = _mm_add_epi32(_mm_set1_epi32(rowEdge[2]), laneEdge[2]);
+			__m128 depth = _mm_add_ps(_mm_set1_ps(rowDepth), laneDepth);
+
+			for(int32_t x=minX;x<=maxX;x+=4)
+			{
+				// Inside when no edge function is negative
+				__m128i inside = _mm_cmpgt_epi32(_mm_or_si128(e0, _mm_or_si128(e1, e2)), minusOne);
+				if(_mm_movemask_epi8(inside) != 0)
+				{
+					__m128 mask = _mm_castsi128_ps(inside);
+					__m128 old = _mm_load_ps(row + x);
+					__m128 nearer = _mm_min_ps(old, depth);
+					_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearer), _mm_andnot_ps(mask, old)));
+				}
+
+				e0 = _mm_add_epi32(e0, stepEdge[0]);
+				e1 = _mm_add_epi32(e1, stepEdge[1]);
+				e2 = _mm_add_epi32(e2, stepEdge[2]);
+				depth = _mm_add_ps(depth, stepDepth);
+			}
+
+			for(int i=0;i<3;i++)
+			{
+				rowEdge[i] += tri.edgeB[i] * SUBPIXEL_SIZE;
+			}
+			rowDepth += tri.depthB;
+		}
+	}
+
+	// Max depth of each block
+	for(int32_t by=tileY / HIZ_BLOCK;by<(tileY + TILE_HEIGHT) / HIZ_BLOCK;by++)
+	{
+		for(int32_t bx=tileX / HIZ_BLOCK;bx<(tileX + TILE_WIDTH) / HIZ_BLOCK;bx++)
+		{
+			__m128 blockMax = _mm_setzero_ps();
+			for(int32_t y=by * HIZ_BLOCK;y<(by + 1) * HIZ_BLOCK;y++)
+			{
+				const float *row = m_depth + y * WIDTH + bx * HIZ_BLOCK;
+				for(int32_t x=0;x<HIZ_BLOCK;x+=4)
+				{
+					blockMax = _mm_max_ps(blockMax, _mm_load_ps(row + x));
+				}
+			}
+			blockMax = _mm_max_ps(blockMax, _mm_shuffle_ps(blockMax, blockMax, _MM_SHUFFLE(2, 3, 0, 1)));
+			blockMax = _mm_max_ps(blockMax, _mm_shuffle_ps(blockMax, blockMax, _MM_SHUFFLE(1, 0, 3, 2)));
+			m_hiZ[by * HIZ_WIDTH + bx] = _mm_cvtss_f32(blockMax);
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void OcclusionBuffer::RasterizeTilesJob(void *data, unsigned int begin, unsigned int end)
+{
+	OcclusionBuffer *buffer = static_cast<OcclusionBuffer *>(data);
+	for(unsigned int tile=begin;tile<end;tile++)
+	{
+		buffer->RasterizeTile(tile);
+	}
+}
+
+// ****************************************************************************
+// The box's screen rectangle is rounded out to whole pixels and then to max
+// depth blocks, and its nearest corner is compared against every block.
+// ****************************************************************************
+bool OcclusionBuffer::IsVisible(const AABB &box) const
+{
+	__m128 col0 = _mm_setr_ps(m_viewProj.r[0][0], m_viewProj.r[1][0], m_viewProj.r[2][0], m_viewProj.r[3][0]);
+	__m128 col1 = _mm_setr_ps(m_viewProj.r[0][1], m_viewProj.r[1][1], m_viewProj.r[2][1], m_viewProj.r[3][1]);
+	__m128 col2 = _mm_setr_ps(m_viewProj.r[0][2], m_viewProj.r[1][2], m_viewProj.r[2][2], m_viewProj.r[3][2]);
+	__m128 col3 = _mm_setr_ps(m_viewProj.r[0][3], m_viewProj.r[1][3], m_viewProj.r[2][3], m_viewProj.r[3][3]);
+
+	float minX = static_cast<float>(WIDTH);
+	float maxX = 0.0f;
+	float minY = static_cast<float>(HEIGHT);
+	float maxY = 0.0f;
+	float minZ = 1.0f;
+
+	float clip[4];
+	for(int corner=0;corner<8;corner++)
+	{
+		float px = (corner & 1) ? box.maxPt.x : box.minPt.x;
+		float py = (corner & 2) ? box.maxPt.y : box.minPt.y;
+		float pz = (corner & 4) ? box.maxPt.z : box.minPt.z;
+		__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(px)), _mm_mul_ps(col1, _mm_set1_ps(py))),
+			_mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(pz)), col3));
+		_mm_storeu_ps(clip, v);
+
+		// In front of the near plane
+		if(clip[2] < 0.0f || clip[3] <= 0.0f)
+			return true;
+
+		float invW = 1.0f / clip[3];
+		float sx = (clip[0] * invW * 0.5f + 0.5f) * WIDTH;
+		float sy = (0.5f - clip[1] * invW * 0.5f) * HEIGHT;
+		float sz = clip[2] * invW;
+
+		minX = sx < minX ? sx : minX;
+		maxX = sx > maxX ? sx : maxX;
+		minY = sy < minY ? sy : minY;
+		maxY = sy > maxY ? sy : maxY;
+		minZ = sz < minZ ? sz : minZ;
+	}
+
+	int32_t x0 = static_cast<int32_t>(floorf(minX));
+	int32_t x1 = static_cast<int32_t>(floorf(maxX));
+	int32_t y0 = static_cast<int32_t>(floorf(minY));
+	int32_t y1 = static_cast<int32_t>(floorf(maxY));
+	x0 = x0 > 0 ? x0 : 0;
+	y0 = y0 > 0 ? y0 : 0;
+	x1 = x1 < WIDTH - 1 ? x1 : WIDTH - 1;
+	y1 = y1 < HEIGHT - 1 ? y1 : HEIGHT - 1;
+
+	// Off the edge of the buffer; leave it to the frustum test
+	if(x0 > x1 || y0 > y1)
+		return true;
+
+	for(int32_t by=y0 / HIZ_BLOCK;by<=y1 / HIZ_BLOCK;by++)
+	{
+		const float *row = m_hiZ + by * HIZ_WIDTH;
+		for(int32_t bx=x0 / HIZ_BLOCK;bx<=x1 / HIZ_BLOCK;bx++)
+		{
+			if(minZ <= row[bx])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace Helix
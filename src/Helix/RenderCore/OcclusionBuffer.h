@@ -0,0 +1,118 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include <stdint.h>
+#include "Math/Matrix.h"
+
+namespace Helix {
+
+struct AABB;
+
+// Screen space setup for one occluder triangle.  Edge functions are in 1/16th
+// pixel fixed point; a pixel center is inside when all three are >= 0.
+struct OcclusionTriangle
+{
+	int32_t		edgeA[3];		// Per 1/16th pixel step in x
+	int32_t		edgeB[3];		// Per 1/16th pixel step in y
+	int32_t		edgeC[3];		// At the origin, fill rule bias included
+	float		depthA;			// z/w = depthA*x + depthB*y + depthC, in pixels
+	float		depthB;
+	float		depthC;
+	int32_t		minX;			// Pixel bounds, inclusive and clipped to the screen
+	int32_t		minY;
+	int32_t		maxX;
+	int32_t		maxY;
+};
+
+// ****************************************************************************
+// OcclusionBuffer
+//
+// A small depth-only software rasterizer for occlusion culling.  Occluder
+// meshes are drawn into a low resolution depth buffer each frame, then
+// bounding boxes are tested against a max depth mip of it: a box is hidden
+// when its nearest point is behind the farthest occluder depth everywhere it
+// could cover.
+//
+// AddOccluder() transforms, clips and sets up triangles and bins them into
+// screen tiles on the calling thread.  Rasterize() then draws each tile as a
+// job, four pixels at a time, with integer edge functions so the result
+// doesn't depend on how the tiles are spread over the workers.
+//
+// Depth is D3D's z/w, 0 at the near plane and 1 at the far plane.  Nothing
+// here touches the GPU.
+// ****************************************************************************
+class OcclusionBuffer
+{
+public:
+	enum
+	{
+		WIDTH =			256,
+		HEIGHT =		128,
+		TILE_WIDTH =	64,
+		TILE_HEIGHT =	32,
+		TILES_X =		WIDTH / TILE_WIDTH,
+		TILES_Y =		HEIGHT / TILE_HEIGHT,
+		NUM_TILES =		TILES_X * TILES_Y,
+		HIZ_BLOCK =		8,					// Pixels on a side of a max depth block
+		HIZ_WIDTH =		WIDTH / HIZ_BLOCK,
+		HIZ_HEIGHT =	HEIGHT / HIZ_BLOCK,
+	};
+
+	OcclusionBuffer();
+	~OcclusionBuffer();
+
+	// Throws away the last frame's occluders
+	void	BeginFrame(const Matrix4x4 &viewProj);
+
+	// positions are xyz triples, indices are triples into them.  Winding
+	// doesn't matter; both sides of every triangle occlude.
+	void	AddOccluder(const float *positions, unsigned int numPositions, const uint32_t *indices, unsigned int numTriangles, const Matrix4x4 &world);
+
+	void	Rasterize();
+
+	// False only if every pixel the world space box could touch is covered
+	// by something nearer.  Conservative; boxes crossing the near plane are
+	// always visible.
+	bool	IsVisible(const AABB &box) const;
+
+	// Row major, 1 where nothing was drawn
+	const float *	Depth() const			{ return m_depth; }
+	const float *	MaxDepth() const		{ return m_hiZ; }
+
+	unsigned int	NumTriangles() const	{ return m_numTriangles; }
+
+private:
+	OcclusionBuffer(const OcclusionBuffer &other);
+	OcclusionBuffer & operator=(const OcclusionBuffer &other);
+
+	void	ReserveVertices(unsigned int count);
+	void	ReserveTriangles(unsigned int count);
+	void	ClipTriangle(const float *v0, const float *v1, const float *v2);
+	void	SetupTriangle(const float *v0, const float *v1, const float *v2);
+	void	RasterizeTile(unsigned int tile);
+
+	static void	RasterizeTilesJob(void *data, unsigned int begin, unsigned int end);
+
+	Matrix4x4			m_viewProj;
+
+	float *				m_depth;
+	float				m_hiZ[HIZ_WIDTH * HIZ_HEIGHT];
+
+	// AddOccluder() scratch: positions in clip space, xyzw
+	float *				m_clipVerts;
+	unsigned int		m_clipVertCapacity;
+
+	OcclusionTriangle *	m_triangles;
+	unsigned int		m_numTriangles;
+	unsigned int		m_triangleCapacity;
+
+	// Indices into m_triangles of the ones touching each tile, in the order
+	// they were added
+	uint32_t *			m_bins[NUM_TILES];
+	unsigned int		m_binCounts[NUM_TILES];
+	unsigned int		m_binCapacity[NUM_TILES];
+};
+
+} // namespace Helix
+
+#endif // OCCLUSIONBUFFER_H
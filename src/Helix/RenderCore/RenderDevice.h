@@ -0,0 +1,103 @@
+#ifndef RENDERDEVICE_H
+#define RENDERDEVICE_H
+
+namespace Helix {
+
+// ****************************************************************************
+// RenderDevice / RenderContext
+//
+// The slice of ID3D11Device and ID3D11DeviceContext the renderer actually
+// uses.  Everything in RenderCore goes through these so a backend other than
+// D3D11 can be dropped in underneath (see NullDevice.h).  The D3D11 structs
+// and interface pointers are kept as the vocabulary; a backend is free to hand
+// out its own objects behind those pointers as long as it's the only one that
+// ever looks inside them.  Objects are released through the device for the
+// same reason.
+// ****************************************************************************
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// Resources
+	virtual HRESULT	CreateBuffer(const D3D11_BUFFER_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Buffer **buffer) = 0;
+	virtual HRESULT	CreateTexture2D(const D3D11_TEXTURE2D_DESC *desc, const D3D11_SUBRESOURCE_DATA *initData, ID3D11Texture2D **texture) = 0;
+	virtual HRESULT	CreateTextureFromMemory(const uint8_t *data, size_t size, ID3D11Resource **texture, ID3D11ShaderResourceView **view) = 0;
+	virtual HRESULT	CreateShaderResourceView(ID3D11Resource *resource, const D3D11_SHADER_RESOURCE_VIEW_DESC *desc, ID3D11ShaderResourceView **view) = 0;
+	virtual HRESULT	CreateRenderTargetView(ID3D11Resource *resource, const D3D11_RENDER_TARGET_VIEW_DESC *desc, ID3D11RenderTargetView **view) = 0;
+	virtual HRESULT	CreateDepthStencilView(ID3D11Resource *resource, const D3D11_DEPTH_STENCIL_VIEW_DESC *desc, ID3D11DepthStencilView **view) = 0;
+
+	// The swap chain's back buffer.  The caller releases the texture.
+	virtual HRESULT	GetBackBuffer(ID3D11Texture2D **texture, D3D11_TEXTURE2D_DESC *desc) = 0;
+
+	// Shaders.  CompileShader returns the bytecode in a buffer the caller
+	// frees with delete [].
+	virtual HRESULT	CompileShader(const void *source, size_t sourceSize, const char *entry, const char *profile, unsigned int flags, uint8_t **bytecode, size_t *bytecodeSize) = 0;
+	virtual HRESULT	CreateVertexShader(const void *bytecode, size_t bytecodeSize, ID3D11VertexShader **shader) = 0;
+	virtual HRESULT	CreatePixelShader(const void *bytecode, size_t bytecodeSize, ID3D11PixelShader **shader) = 0;
+	virtual HRESULT	CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, unsigned int numElements, const void *bytecode, size_t bytecodeSize, ID3D11InputLayout **layout) = 0;
+
+	// State objects
+	virtual HRESULT	CreateSamplerState(const D3D11_SAMPLER_DESC *desc, ID3D11SamplerState **state) = 0;
+	virtual HRESULT	CreateRasterizerState(const D3D11_RASTERIZER_DESC *desc, ID3D11RasterizerState **state) = 0;
+	virtual HRESULT	CreateBlendState(const D3D11_BLEND_DESC *desc, ID3D11BlendState **state) = 0;
+	virtual HRESULT	CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC *desc, ID3D11DepthStencilState **state) = 0;
+
+	virtual void	Release(ID3D11DeviceChild *object) = 0;
+};
+
+class RenderContext
+{
+public:
+	virtual ~RenderContext() {}
+
+	virtual HRESULT	Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped) = 0;
+	virtual void	Unmap(ID3D11Resource *resource, unsigned int subresource) = 0;
+
+	// Input assembler
+	virtual void	IASetInputLayout(ID3D11InputLayout *layout) = 0;
+	virtual void	IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets) = 0;
+	virtual void	IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset) = 0;
+	virtual void	IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+
+	// Shader stages
+	virtual void	VSSetShader(ID3D11VertexShader *shader) = 0;
+	virtual void	PSSetShader(ID3D11PixelShader *shader) = 0;
+	virtual void	GSSetShader(ID3D11GeometryShader *shader) = 0;
+	virtual void	HSSetShader(ID3D11HullShader *shader) = 0;
+	virtual void	DSSetShader(ID3D11DomainShader *shader) = 0;
+	virtual void	VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers) = 0;
+	virtual void	PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers) = 0;
+
+	// Constant buffer binds that only expose a window of each buffer, the
+	// D3D 11.1 way.  firstConstant and numConstants are in 16 byte constants
+	// and must be multiples of 16.  Only valid if ConstantBufferOffsets() is
+	// true, which also means dynamic constant buffers can be mapped with
+	// D3D11_MAP_WRITE_NO_OVERWRITE.
+	virtual bool	ConstantBufferOffsets() = 0;
+	virtual void	VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants) = 0;
+	virtual void	PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants) = 0;
+
+	virtual void	PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views) = 0;
+	virtual void	PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers) = 0;
+
+	// Rasterizer / output merger
+	virtual void	RSSetState(ID3D11RasterizerState *state) = 0;
+	virtual void	RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports) = 0;
+	virtual void	RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects) = 0;
+	virtual void	OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil) = 0;
+	virtual void	OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask) = 0;
+	virtual void	OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef) = 0;
+
+	virtual void	ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4]) = 0;
+	virtual void	ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil) = 0;
+
+	virtual void	DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void	DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+
+	// Ends the frame
+	virtual void	Present(unsigned int syncInterval, unsigned int flags) = 0;
+};
+
+} // namespace Helix
+#endif // RENDERDEVICE_H
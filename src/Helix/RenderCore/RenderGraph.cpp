@@ -0,0 +1,829 @@
+#include <stdio.h>
+#include "RenderGraph.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// Two descs can share a texture if everything but how they're cleared matches
+// ****************************************************************************
+inline bool SameLayout(const RenderGraphTextureDesc &a, const RenderGraphTextureDesc &b)
+{
+	return a.width == b.width &&
+		a.height == b.height &&
+		a.format == b.format &&
+		a.targetFormat == b.targetFormat &&
+		a.shaderFormat == b.shaderFormat &&
+		a.depthStencil == b.depthStencil;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline size_t FormatBytes(DXGI_FORMAT format)
+{
+	switch(format)
+	{
+		case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+
+		case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+		case DXGI_FORMAT_R32G32_TYPELESS:
+		case DXGI_FORMAT_R32G32_FLOAT:
+			return 8;
+
+		case DXGI_FORMAT_R16_TYPELESS:
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_SNORM:
+		case DXGI_FORMAT_D16_UNORM:
+			return 2;
+
+		case DXGI_FORMAT_R8_TYPELESS:
+		case DXGI_FORMAT_R8_UNORM:
+			return 1;
+
+		default:
+			return 4;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline size_t TextureBytes(const RenderGraphTextureDesc &desc)
+{
+	return static_cast<size_t>(desc.width) * desc.height * FormatBytes(desc.format);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+RenderGraph::RenderGraph()
+: m_device(NULL)
+, m_context(NULL)
+, m_numResources(0)
+, m_numPasses(0)
+, m_numExecuted(0)
+, m_finalUnbindMask(0)
+, m_compiled(false)
+, m_numPhysical(0)
+, m_numCreated(0)
+{
+	m_error[0] = 0;
+}
+
+// ****************************************************************************
+// Textures have to go back through the device, which may already be gone, so
+// call Release() first
+// ****************************************************************************
+RenderGraph::~RenderGraph()
+{
+	_ASSERT(m_numCreated == 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::Initialize(RenderDevice *device, RenderContext *context)
+{
+	_ASSERT(device != NULL && context != NULL);
+
+	m_device = device;
+	m_context = context;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::Release()
+{
+	for(unsigned int i=0;i<m_numCreated;i++)
+	{
+		ReleasePhysical(m_physical[i]);
+	}
+	m_numCreated = 0;
+	Reset();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::Reset()
+{
+	m_numResources = 0;
+	m_numPasses = 0;
+	m_numExecuted = 0;
+	m_finalUnbindMask = 0;
+	m_numPhysical = 0;
+	m_compiled = false;
+	m_error[0] = 0;
+}
+
+// ****************************************************************************
+// A texture the graph owns.  It only exists while passes use it, and may
+// share memory with others that don't overlap it.
+// ****************************************************************************
+RenderGraphResource RenderGraph::CreateTexture(const char *name, const RenderGraphTextureDesc &desc)
+{
+	_ASSERT(m_numResources < MAX_RESOURCES);
+
+	Resource &resource = m_resources[m_numResources];
+	memset(&resource, 0, sizeof(resource));
+	resource.name = name;
+	resource.desc = desc;
+	resource.physical = -1;
+	return m_numResources++;
+}
+
+// ****************************************************************************
+// A texture someone else owns.  Only the views the passes need have to be
+// given.
+// ****************************************************************************
+RenderGraphResource RenderGraph::ImportTexture(const char *name, const RenderGraphTextureDesc &desc, ID3D11RenderTargetView *target, ID3D11DepthStencilView *depthStencil, ID3D11ShaderResourceView *shaderView)
+{
+	RenderGraphResource index = CreateTexture(name, desc);
+
+	Resource &resource = m_resources[index];
+	resource.imported = true;
+	resource.target = target;
+	resource.depthStencil = depthStencil;
+	resource.shaderView = shaderView;
+	return index;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::MarkOutput(RenderGraphResource resource)
+{
+	_ASSERT(resource >= 0 && resource < static_cast<int>(m_numResources));
+	m_resources[resource].output = true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+RenderGraphPass RenderGraph::AddPass(const char *name, RenderPassFn fn, void *data)
+{
+	_ASSERT(m_numPasses < MAX_PASSES);
+	_ASSERT(fn != NULL);
+
+	Pass &pass = m_passes[m_numPasses];
+	memset(&pass, 0, sizeof(pass));
+	pass.name = name;
+	pass.fn = fn;
+	pass.data = data;
+	pass.depth = -1;
+	return m_numPasses++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::ReadTexture(RenderGraphPass pass, RenderGraphResource resource, unsigned int slot)
+{
+	_ASSERT(pass >= 0 && pass < static_cast<int>(m_numPasses));
+	_ASSERT(resource >= 0 && resource < static_cast<int>(m_numResources));
+	_ASSERT(slot < MAX_SHADER_SLOTS);
+
+	Pass &p = m_passes[pass];
+	_ASSERT(p.numReads < MAX_PASS_READS);
+	for(unsigned int i=0;i<p.numReads;i++)
+	{
+		_ASSERT(p.readSlots[i] != slot);
+	}
+
+	p.reads[p.numReads] = resource;
+	p.readSlots[p.numReads] = slot;
+	p.numReads++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::ReadDepth(RenderGraphPass pass, RenderGraphResource resource)
+{
+	_ASSERT(pass >= 0 && pass < static_cast<int>(m_numPasses));
+	_ASSERT(resource >= 0 && resource < static_cast<int>(m_numResources));
+	_ASSERT(m_resources[resource].desc.depthStencil);
+
+	Pass &p = m_passes[pass];
+	_ASSERT(p.depth == -1);
+	p.depth = resource;
+	p.writesDepth = false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::WriteTarget(RenderGraphPass pass, RenderGraphResource resource)
+{
+	_ASSERT(pass >= 0 && pass < static_cast<int>(m_numPasses));
+	_ASSERT(resource >= 0 && resource < static_cast<int>(m_numResources));
+	_ASSERT(!m_resources[resource].desc.depthStencil);
+
+	Pass &p = m_passes[pass];
+	_ASSERT(p.numTargets < MAX_PASS_TARGETS);
+	p.targets[p.numTargets++] = resource;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::WriteDepth(RenderGraphPass pass, RenderGraphResource resource)
+{
+	ReadDepth(pass, resource);
+	m_passes[pass].writesDepth = true;
+}
+
+// ****************************************************************************
+// Works out which passes run and what has to happen around each one.  Pure
+// bookkeeping; nothing here touches the device.
+// ****************************************************************************
+bool RenderGraph::Compile()
+{
+	m_compiled = false;
+	m_numExecuted = 0;
+	m_error[0] = 0;
+
+	if(!SortPasses())
+		return false;
+
+	CullPasses();
+	ComputeLifetimes();
+	AssignPhysical();
+	ComputeBindings();
+	m_compiled = true;
+	return true;
+}
+
+// ****************************************************************************
+// True if the pass binds the resource itself for output
+// ****************************************************************************
+bool RenderGraph::Writes(const Pass &pass, RenderGraphResource resource) const
+{
+	for(unsigned int i=0;i<pass.numTargets;i++)
+	{
+		if(pass.targets[i] == resource)
+			return true;
+	}
+
+	return pass.writesDepth && pass.depth == resource;
+}
+
+// ****************************************************************************
+// Topological sort.  Each pass gets a bit per pass it has to follow: every
+// writer of what it reads, and every writer added before it of what it
+// writes.  Then the earliest added pass whose predecessors have all been
+// placed goes next, so passes that were added in a workable order stay in
+// it.  If none can go, the rest wait on each other.
+//
+// A read always sees the finished texture, so one added after some of its
+// writers but before others is refused rather than quietly moved.
+// ****************************************************************************
+bool RenderGraph::SortPasses()
+{
+	uint32_t after[MAX_PASSES];
+	for(unsigned int i=0;i<m_numPasses;i++)
+	{
+		const Pass &pass = m_passes[i];
+		after[i] = 0;
+
+		RenderGraphResource reads[MAX_PASS_READS + 1];
+		unsigned int numReads = 0;
+		for(unsigned int j=0;j<pass.numReads;j++)
+		{
+			reads[numReads++] = pass.reads[j];
+		}
+		if(pass.depth != -1 && !pass.writesDepth)
+		{
+			reads[numReads++] = pass.depth;
+		}
+
+		for(unsigned int j=0;j<numReads;j++)
+		{
+			uint32_t writers = 0;
+			for(unsigned int k=0;k<m_numPasses;k++)
+			{
+				if(k != i && Writes(m_passes[k], reads[j]))
+				{
+					writers |= 1u << k;
+				}
+			}
+
+			const Resource &resource = m_resources[reads[j]];
+			if(writers == 0 && !resource.imported)
+			{
+				snprintf(m_error, sizeof(m_error), "%s reads %s, which nothing writes", pass.name, resource.name);
+				return false;
+			}
+
+			// Added between two writes, it can't mean the finished texture
+			uint32_t before = writers & ((1u << i) - 1);
+			if(before != 0 && before != writers)
+			{
+				snprintf(m_error, sizeof(m_error), "%s reads %s between writes to it", pass.name, resource.name);
+				return false;
+			}
+
+			after[i] |= writers;
+		}
+
+		for(unsigned int k=0;k<i;k++)
+		{
+			const Pass &other = m_passes[k];
+			for(unsigned int j=0;j<other.numTargets;j++)
+			{
+				if(Writes(pass, other.targets[j]))
+					after[i] |= 1u << k;
+			}
+			if(other.writesDepth && Writes(pass, other.depth))
+				after[i] |= 1u << k;
+		}
+	}
+
+	uint32_t placed = 0;
+	for(unsigned int i=0;i<m_numPasses;i++)
+	{
+		unsigned int next = 0;
+		while(next < m_numPasses)
+		{
+			if((placed & (1u << next)) == 0 && (after[next] & ~placed) == 0)
+				break;
+			next++;
+		}
+
+		if(next == m_numPasses)
+		{
+			for(next=0;(placed & (1u << next)) != 0;next++)
+			{
+			}
+			snprintf(m_error, sizeof(m_error), "%s is in a cycle of passes reading what the others write", m_passes[next].name);
+			return false;
+		}
+
+		m_order[i] = next;
+		placed |= 1u << next;
+	}
+
+	return true;
+}
+
+// ****************************************************************************
+// Walks the sorted passes backwards from the outputs.  A pass survives if it
+// writes something a surviving pass or an output needs; what it reads is then
+// needed too.  Every reader of a resource is sorted after all its writers, so
+// a resource's needs are known by the time its writers are reached.  Once
+// needed, a resource stays needed, so every earlier pass writing it is kept
+// as well.  That's conservative, but passes may only write part of a target
+// and blend over what's there.
+// ****************************************************************************
+void RenderGraph::CullPasses()
+{
+	bool needed[MAX_RESOURCES];
+	for(unsigned int i=0;i<m_numResources;i++)
+	{
+		needed[i] = m_resources[i].output;
+	}
+
+	for(int i=static_cast<int>(m_numPasses)-1;i>=0;i--)
+	{
+		Pass &pass = m_passes[m_order[i]];
+
+		pass.live = pass.writesDepth && needed[pass.depth];
+		for(unsigned int j=0;j<pass.numTargets && !pass.live;j++)
+		{
+			pass.live = needed[pass.targets[j]];
+		}
+
+		if(!pass.live)
+			continue;
+
+		for(unsigned int j=0;j<pass.numReads;j++)
+		{
+			needed[pass.reads[j]] = true;
+		}
+		if(pass.depth != -1)
+		{
+			needed[pass.depth] = true;
+		}
+	}
+
+	m_numExecuted = 0;
+	for(unsigned int i=0;i<m_numPasses;i++)
+	{
+		if(m_passes[m_order[i]].live)
+		{
+			m_executed[m_numExecuted++] = m_order[i];
+		}
+	}
+}
+
+// ****************************************************************************
+// First and last executed pass touching each resource.  A transient's first
+// use has to write it, or it would be read before anything was in it.
+// ****************************************************************************
+void RenderGraph::ComputeLifetimes()
+{
+	for(unsigned int i=0;i<m_numResources;i++)
+	{
+		m_resources[i].firstUse = -1;
+		m_resources[i].lastUse = -1;
+	}
+
+	for(unsigned int i=0;i<m_numExecuted;i++)
+	{
+		Pass &pass = m_passes[m_executed[i]];
+		pass.clearMask = 0;
+
+		RenderGraphResource used[MAX_PASS_READS + MAX_PASS_TARGETS + 1];
+		unsigned int numUsed = 0;
+		for(unsigned int j=0;j<pass.numTargets;j++)
+		{
+			used[numUsed++] = pass.targets[j];
+		}
+		if(pass.depth != -1)
+		{
+			used[numUsed++] = pass.depth;
+		}
+		unsigned int numWritten = numUsed;
+		for(unsigned int j=0;j<pass.numReads;j++)
+		{
+			used[numUsed++] = pass.reads[j];
+		}
+
+		for(unsigned int j=0;j<numUsed;j++)
+		{
+			Resource &resource = m_resources[used[j]];
+			bool write = j < pass.numTargets || (j < numWritten && pass.writesDepth);
+
+			if(resource.firstUse == -1)
+			{
+				_ASSERT(write || resource.imported);
+				resource.firstUse = i;
+
+				// Clear where it's first written
+				if(write && resource.desc.clear)
+				{
+					pass.clearMask |= 1u << used[j];
+				}
+			}
+			resource.lastUse = i;
+		}
+	}
+
+	// Outputs have to survive the whole graph
+	for(unsigned int i=0;i<m_numResources;i++)
+	{
+		Resource &resource = m_resources[i];
+		if(resource.output && resource.firstUse != -1)
+		{
+			resource.lastUse = static_cast<int>(m_numExecuted);
+		}
+	}
+}
+
+// ****************************************************************************
+// Gives each used transient a physical texture.  Resources are taken in the
+// order they come alive and go into the first texture of the same layout
+// whose last user has already run, so short-lived targets get reused along
+// the frame.
+// ****************************************************************************
+void RenderGraph::AssignPhysical()
+{
+	int physicalLastUse[MAX_RESOURCES];
+	m_numPhysical = 0;
+
+	for(unsigned int i=0;i<m_numResources;i++)
+	{
+		m_resources[i].physical = -1;
+	}
+
+	for(unsigned int i=0;i<m_numExecuted;i++)
+	{
+		for(unsigned int j=0;j<m_numResources;j++)
+		{
+			Resource &resource = m_resources[j];
+			if(resource.imported || resource.firstUse != static_cast<int>(i))
+				continue;
+
+			unsigned int physical = 0;
+			while(physical < m_numPhysical)
+			{
+				if(physicalLastUse[physical] < resource.firstUse && SameLayout(m_physicalDescs[physical], resource.desc))
+					break;
+				physical++;
+			}
+
+			if(physical == m_numPhysical)
+			{
+				m_physicalDescs[m_numPhysical++] = resource.desc;
+			}
+
+			resource.physical = physical;
+			physicalLastUse[physical] = resource.lastUse;
+		}
+	}
+}
+
+// ****************************************************************************
+// Tracks what's left in each shader slot from pass to pass.  A slot is
+// unbound before a pass that writes the memory it still holds, since D3D
+// won't have a texture bound for reading and writing at once.  Whatever is
+// still bound at the end gets unbound after the last pass.
+// ****************************************************************************
+void RenderGraph::ComputeBindings()
+{
+	RenderGraphResource bound[MAX_SHADER_SLOTS];
+	for(unsigned int i=0;i<MAX_SHADER_SLOTS;i++)
+	{
+		bound[i] = -1;
+	}
+
+	for(unsigned int i=0;i<m_numExecuted;i++)
+	{
+		Pass &pass = m_passes[m_executed[i]];
+		pass.unbindMask = 0;
+
+		// Depth only bound for testing still can't be read at the same time
+		for(unsigned int slot=0;slot<MAX_SHADER_SLOTS;slot++)
+		{
+			if(bound[slot] != -1 && WritesMemoryOf(pass, bound[slot]))
+			{
+				pass.unbindMask |= 1u << slot;
+				bound[slot] = -1;
+			}
+		}
+
+		for(unsigned int j=0;j<pass.numReads;j++)
+		{
+			_ASSERT(!WritesMemoryOf(pass, pass.reads[j]));
+			bound[pass.readSlots[j]] = pass.reads[j];
+		}
+	}
+
+	m_finalUnbindMask = 0;
+	for(unsigned int slot=0;slot<MAX_SHADER_SLOTS;slot++)
+	{
+		if(bound[slot] != -1)
+		{
+			m_finalUnbindMask |= 1u << slot;
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool RenderGraph::SameMemory(RenderGraphResource a, RenderGraphResource b) const
+{
+	if(a == b)
+		return true;
+
+	const Resource &ra = m_resources[a];
+	const Resource &rb = m_resources[b];
+	return !ra.imported && !rb.imported && ra.physical != -1 && ra.physical == rb.physical;
+}
+
+// ****************************************************************************
+// True if the pass binds the resource, or one sharing its memory, for output
+// ****************************************************************************
+bool RenderGraph::WritesMemoryOf(const Pass &pass, RenderGraphResource resource) const
+{
+	for(unsigned int i=0;i<pass.numTargets;i++)
+	{
+		if(SameMemory(pass.targets[i], resource))
+			return true;
+	}
+
+	return pass.depth != -1 && SameMemory(pass.depth, resource);
+}
+
+// ****************************************************************************
+// Makes sure there's a texture behind every physical slot Compile() handed
+// out.  Ones from the last Realize() are kept if their layout still matches.
+// ****************************************************************************
+void RenderGraph::Realize()
+{
+	_ASSERT(m_compiled);
+	_ASSERT(m_device != NULL);
+
+	for(unsigned int i=0;i<m_numPhysical;i++)
+	{
+		PhysicalTexture &physical = m_physical[i];
+		if(i < m_numCreated)
+		{
+			if(SameLayout(physical.desc, m_physicalDescs[i]))
+				continue;
+
+			ReleasePhysical(physical);
+		}
+
+		physical.desc = m_physicalDescs[i];
+		CreatePhysical(physical);
+	}
+
+	if(m_numPhysical > m_numCreated)
+	{
+		m_numCreated = m_numPhysical;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::CreatePhysical(PhysicalTexture &physical)
+{
+	const RenderGraphTextureDesc &desc = physical.desc;
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = desc.width;
+	textureDesc.Height = desc.height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = desc.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (desc.depthStencil ? D3D11_BIND_DEPTH_STENCIL : D3D11_BIND_RENDER_TARGET);
+
+	HRESULT hr = m_device->CreateTexture2D( &textureDesc, NULL, &physical.texture );
+	_ASSERT( SUCCEEDED(hr) );
+
+	physical.target = NULL;
+	physical.depthStencil = NULL;
+	if(desc.depthStencil)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsDesc;
+		ZeroMemory(&dsDesc, sizeof(dsDesc));
+		dsDesc.Format = desc.targetFormat;
+		dsDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		dsDesc.Texture2D.MipSlice = 0;
+
+		hr = m_device->CreateDepthStencilView( physical.texture, &dsDesc, &physical.depthStencil );
+		_ASSERT( SUCCEEDED(hr) );
+	}
+	else
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC rtDesc;
+		ZeroMemory(&rtDesc, sizeof(rtDesc));
+		rtDesc.Format = desc.targetFormat;
+		rtDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+		rtDesc.Texture2D.MipSlice = 0;
+
+		hr = m_device->CreateRenderTargetView( physical.texture, &rtDesc, &physical.target );
+		_ASSERT( SUCCEEDED(hr) );
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
+	ZeroMemory(&srDesc, sizeof(srDesc));
+	srDesc.Format = desc.shaderFormat;
+	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srDesc.Texture2D.MostDetailedMip = 0;
+	srDesc.Texture2D.MipLevels = 1;
+
+	hr = m_device->CreateShaderResourceView( physical.texture, &srDesc, &physical.shaderView );
+	_ASSERT( SUCCEEDED(hr) );
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void RenderGraph::ReleasePhysical(PhysicalTexture &physical)
+{
+	if(physical.target != NULL)
+	{
+		m_device->Release(physical.target);
+		physical.target = NULL;
+	}
+	if(physical.depthStencil != NULL)
+	{
+		m_device->Release(physical.depthStencil);
+		physical.depthStencil = NULL;
+	}
+	if(physical.shaderView != NULL)
+	{
+		m_device->Release(physical.shaderView);
+		physical.shaderView = NULL;
+	}
+	if(physical.texture != NULL)
+	{
+		m_device->Release(physical.texture);
+		physical.texture = NULL;
+	}
+}
+
+// ****************************************************************************
+// Runs the surviving passes in order.  Before each one: unbind shader inputs
+// it's about to write over, bind its targets, clear what it writes first,
+// then bind its inputs.
+// ****************************************************************************
+void RenderGraph::Execute()
+{
+	_ASSERT(m_compiled);
+	_ASSERT(m_numPhysical <= m_numCreated);
+
+	ID3D11ShaderResourceView *const nullView = NULL;
+
+	for(unsigned int i=0;i<m_numExecuted;i++)
+	{
+		const Pass &pass = m_passes[m_executed[i]];
+
+		for(unsigned int slot=0;slot<MAX_SHADER_SLOTS;slot++)
+		{
+			if(pass.unbindMask & (1u << slot))
+			{
+				m_context->PSSetShaderResources(slot, 1, &nullView);
+			}
+		}
+
+		ID3D11RenderTargetView *targets[MAX_PASS_TARGETS];
+		for(unsigned int j=0;j<pass.numTargets;j++)
+		{
+			targets[j] = TargetView(pass.targets[j]);
+		}
+		ID3D11DepthStencilView *depthStencil = pass.depth != -1 ? DepthStencilView(pass.depth) : NULL;
+		m_context->OMSetRenderTargets(pass.numTargets, targets, depthStencil);
+
+		for(unsigned int j=0;j<m_numResources;j++)
+		{
+			if(!(pass.clearMask & (1u << j)))
+				continue;
+
+			const RenderGraphTextureDesc &desc = m_resources[j].desc;
+			if(desc.depthStencil)
+			{
+				m_context->ClearDepthStencilView(DepthStencilView(j), D3D11_CLEAR_DEPTH, desc.clearDepth, 0);
+			}
+			else
+			{
+				m_context->ClearRenderTargetView(TargetView(j), desc.clearColor);
+			}
+		}
+
+		for(unsigned int j=0;j<pass.numReads;j++)
+		{
+			ID3D11ShaderResourceView *view = ShaderView(pass.reads[j]);
+			m_context->PSSetShaderResources(pass.readSlots[j], 1, &view);
+		}
+
+		pass.fn(pass.data);
+	}
+
+	for(unsigned int slot=0;slot<MAX_SHADER_SLOTS;slot++)
+	{
+		if(m_finalUnbindMask & (1u << slot))
+		{
+			m_context->PSSetShaderResources(slot, 1, &nullView);
+		}
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+size_t RenderGraph::PhysicalBytes() const
+{
+	size_t bytes = 0;
+	for(unsigned int i=0;i<m_numPhysical;i++)
+	{
+		bytes += TextureBytes(m_physicalDescs[i]);
+	}
+	return bytes;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+size_t RenderGraph::TransientBytes() const
+{
+	size_t bytes = 0;
+	for(unsigned int i=0;i<m_numResources;i++)
+	{
+		const Resource &resource = m_resources[i];
+		if(!resource.imported && resource.physical != -1)
+		{
+			bytes += TextureBytes(resource.desc);
+		}
+	}
+	return bytes;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ID3D11RenderTargetView * RenderGraph::TargetView(RenderGraphResource resource) const
+{
+	const Resource &r = m_resources[resource];
+	if(r.imported)
+		return r.target;
+	return r.physical != -1 ? m_physical[r.physical].target : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ID3D11DepthStencilView * RenderGraph::DepthStencilView(RenderGraphResource resource) const
+{
+	const Resource &r = m_resources[resource];
+	if(r.imported)
+		return r.depthStencil;
+	return r.physical != -1 ? m_physical[r.physical].depthStencil : NULL;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ID3D11ShaderResourceView * RenderGraph::ShaderView(RenderGraphResource resource) const
+{
+	const Resource &r = m_resources[resource];
+	if(r.imported)
+		return r.shaderView;
+	return r.physical != -1 ? m_physical[r.physical].shaderView : NULL;
+}
+
+} // namespace Helix
@@ -0,0 +1,211 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "RenderDevice.h"
+
+namespace Helix {
+
+// Handles are indices into the graph, -1 for none
+typedef int		RenderGraphResource;
+typedef int		RenderGraphPass;
+
+// Draws a pass.  Its render targets and shader inputs are already bound.
+typedef void (*RenderPassFn)(void *data);
+
+struct RenderGraphTextureDesc
+{
+	unsigned int	width;
+	unsigned int	height;
+	DXGI_FORMAT		format;				// Of the texture
+	DXGI_FORMAT		targetFormat;		// Of its render target or depth stencil view
+	DXGI_FORMAT		shaderFormat;		// Of its shader resource view
+	bool			depthStencil;
+
+	// Cleared by the first pass that writes it.  A transient texture that
+	// isn't cleared must be completely covered by that pass, since it may
+	// share memory with another one.
+	bool			clear;
+	float			clearColor[4];
+	float			clearDepth;
+};
+
+// ****************************************************************************
+// RenderGraph
+//
+// A frame's passes and the textures they read and write.  Passes declare
+// their inputs and outputs up front; Compile() then works out everything
+// that used to be done by hand around them:
+//
+//  - Passes are put in order by what they read and write.  A pass that reads
+//    a texture runs after every pass that writes it, wherever it was added,
+//    and passes writing the same texture run in the order they were added.
+//    Otherwise passes keep the order they were added in.  A texture can't be
+//    read and then written again: use a new texture for the new contents
+//    instead, which costs nothing once the two are aliased.
+//  - Passes that nothing marked as an output depends on are culled.
+//  - Each texture is cleared right before the first pass that writes it.
+//  - Shader inputs still bound when a later pass writes the same memory are
+//    unbound first, and every input is unbound once the graph has run.
+//  - Transient textures whose lifetimes don't overlap and whose descs match
+//    share one physical texture.
+//
+// Compile() only looks at the declarations, so it can be run and checked
+// without a device.  It fails if the passes can't be ordered, a pass reads a
+// texture between writes to it, or reads a transient texture nothing writes.  Realize() then creates the physical
+// textures, keeping any that still fit from the last compile, and Execute()
+// binds, clears and calls each pass in turn.
+//
+// Imported textures belong to someone else (the back buffer, say) and are
+// only ever bound.
+// ****************************************************************************
+class RenderGraph
+{
+public:
+	enum
+	{
+		MAX_PASSES =			32,
+		MAX_RESOURCES =			32,
+		MAX_PASS_READS =		8,
+		MAX_PASS_TARGETS =		D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT,
+		MAX_SHADER_SLOTS =		16,
+	};
+
+	RenderGraph();
+	~RenderGraph();
+
+	void	Initialize(RenderDevice *device, RenderContext *context);
+	void	Release();
+
+	// Forgets every pass and resource.  Physical textures are kept for the
+	// next Realize().
+	void	Reset();
+
+	RenderGraphResource	CreateTexture(const char *name, const RenderGraphTextureDesc &desc);
+	RenderGraphResource	ImportTexture(const char *name, const RenderGraphTextureDesc &desc, ID3D11RenderTargetView *target, ID3D11DepthStencilView *depthStencil, ID3D11ShaderResourceView *shaderView);
+
+	// Keeps every pass it depends on from being culled
+	void	MarkOutput(RenderGraphResource resource);
+
+	RenderGraphPass		AddPass(const char *name, RenderPassFn fn, void *data);
+
+	// Bound to a pixel shader slot for the pass
+	void	ReadTexture(RenderGraphPass pass, RenderGraphResource resource, unsigned int slot);
+
+	// Bound as the pass's depth stencil for testing, without it counting as
+	// a write
+	void	ReadDepth(RenderGraphPass pass, RenderGraphResource resource);
+
+	// Render targets are bound in the order they're written
+	void	WriteTarget(RenderGraphPass pass, RenderGraphResource resource);
+	void	WriteDepth(RenderGraphPass pass, RenderGraphResource resource);
+
+	// Returns false, and says why in CompileError(), if the graph can't run
+	bool	Compile();
+	void	Realize();
+	void	Execute();
+
+	// What Compile() came up with
+	const char *	CompileError() const					{ return m_error; }
+	unsigned int	NumExecutedPasses() const				{ return m_numExecuted; }
+	RenderGraphPass	ExecutedPass(unsigned int index) const	{ return m_executed[index]; }
+	bool			IsCulled(RenderGraphPass pass) const	{ return !m_passes[pass].live; }
+	int				PhysicalIndex(RenderGraphResource resource) const	{ return m_resources[resource].physical; }
+	unsigned int	NumPhysicalTextures() const				{ return m_numPhysical; }
+
+	// Bit per resource cleared before the pass, and bit per shader slot
+	// unbound before it
+	uint32_t		ClearMask(RenderGraphPass pass) const	{ return m_passes[pass].clearMask; }
+	uint32_t		UnbindMask(RenderGraphPass pass) const	{ return m_passes[pass].unbindMask; }
+	uint32_t		FinalUnbindMask() const					{ return m_finalUnbindMask; }
+
+	// Memory the transient textures take, and would take without aliasing
+	size_t			PhysicalBytes() const;
+	size_t			TransientBytes() const;
+
+	// Views of a resource.  Only valid after Realize().
+	ID3D11RenderTargetView *	TargetView(RenderGraphResource resource) const;
+	ID3D11DepthStencilView *	DepthStencilView(RenderGraphResource resource) const;
+	ID3D11ShaderResourceView *	ShaderView(RenderGraphResource resource) const;
+
+private:
+	RenderGraph(const RenderGraph &other);
+	RenderGraph & operator=(const RenderGraph &other);
+
+	struct Resource
+	{
+		const char *				name;
+		RenderGraphTextureDesc		desc;
+		bool						imported;
+		bool						output;
+		int							physical;		// Index into m_physical, -1 if imported or unused
+		int							firstUse;		// Executed pass indices
+		int							lastUse;
+
+		// Imported views
+		ID3D11RenderTargetView *	target;
+		ID3D11DepthStencilView *	depthStencil;
+		ID3D11ShaderResourceView *	shaderView;
+	};
+
+	struct Pass
+	{
+		const char *			name;
+		RenderPassFn			fn;
+		void *					data;
+		RenderGraphResource		reads[MAX_PASS_READS];
+		unsigned int			readSlots[MAX_PASS_READS];
+		unsigned int			numReads;
+		RenderGraphResource		targets[MAX_PASS_TARGETS];
+		unsigned int			numTargets;
+		RenderGraphResource		depth;
+		bool					writesDepth;
+		bool					live;
+		uint32_t				clearMask;
+		uint32_t				unbindMask;
+	};
+
+	struct PhysicalTexture
+	{
+		RenderGraphTextureDesc		desc;			// What the texture was created with
+		ID3D11Texture2D *			texture;
+		ID3D11RenderTargetView *	target;
+		ID3D11DepthStencilView *	depthStencil;
+		ID3D11ShaderResourceView *	shaderView;
+	};
+
+	bool	SameMemory(RenderGraphResource a, RenderGraphResource b) const;
+	bool	WritesMemoryOf(const Pass &pass, RenderGraphResource resource) const;
+	bool	Writes(const Pass &pass, RenderGraphResource resource) const;
+	bool	SortPasses();
+	void	CullPasses();
+	void	ComputeLifetimes();
+	void	AssignPhysical();
+	void	ComputeBindings();
+	void	CreatePhysical(PhysicalTexture &physical);
+	void	ReleasePhysical(PhysicalTexture &physical);
+
+	RenderDevice *		m_device;
+	RenderContext *		m_context;
+
+	Resource			m_resources[MAX_RESOURCES];
+	unsigned int		m_numResources;
+	Pass				m_passes[MAX_PASSES];
+	unsigned int		m_numPasses;
+
+	RenderGraphPass		m_order[MAX_PASSES];		// Every pass, sorted
+	RenderGraphPass		m_executed[MAX_PASSES];
+	unsigned int		m_numExecuted;
+	uint32_t			m_finalUnbindMask;
+	bool				m_compiled;
+	char				m_error[128];
+
+	// What Compile() asked for, and what Realize() last made, which may be
+	// more
+	RenderGraphTextureDesc	m_physicalDescs[MAX_RESOURCES];
+	unsigned int		m_numPhysical;
+	PhysicalTexture		m_physical[MAX_RESOURCES];
+	unsigned int		m_numCreated;
+};
+
+} // namespace Helix
+#endif // RENDERGRAPH_H
@@ -3,6 +3,9 @@
 
 namespace Helix {
 
+class RenderDevice;
+class RenderContext;
+
 class RenderMgr
 {
 public:
@@ -37,9 +40,32 @@ public:
 		return m_swapChain;
 	}
 
+	// The backend everything in RenderCore goes through.  Set up by
+	// InitializeRenderer.
+	void SetRenderDevice(RenderDevice *device, RenderContext *context)
+	{
+		_ASSERT(device != NULL && context != NULL);
+		m_renderDevice = device;
+		m_renderContext = context;
+	}
+
+	RenderDevice * GetRenderDevice()
+	{
+		return m_renderDevice;
+	}
+
+	RenderContext * GetRenderContext()
+	{
+		return m_renderContext;
+	}
+
 private:
 	RenderMgr()
 	: m_device(NULL)
+	, m_context(NULL)
+	, m_swapChain(NULL)
+	, m_renderDevice(NULL)
+	, m_renderContext(NULL)
 	{}
 
 	RenderMgr(const RenderMgr &other)
@@ -53,6 +79,8 @@ private:
 	ID3D11Device *			m_device;
 	ID3D11DeviceContext *	m_context;
 	IDXGISwapChain *		m_swapChain;
+	RenderDevice *			m_renderDevice;
+	RenderContext *			m_renderContext;
 };
 
 } // namespace Helix
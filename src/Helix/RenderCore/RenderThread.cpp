@@ -3,45 +3,49 @@
 #include <DXGI.h>
 #include "RenderThread.h"
 #include "RenderMgr.h"
-#include "VDecls.h"
+#include "D3D11Device.h"
 #include "Light.h"
 #include "Materials.h"
 #include "Utility/bits.h"
+#include "SortKey.h"
+#include "FrameFence.h"
+#include "StateCache.h"
+#include "RenderGraph.h"
+#include "ScenePasses.h"
+#include "SubmitQueue.h"
+#include "Kernel/JobSystem.h"
+#include "Math/MatrixSSE.h"
+#include "Utility/Profiler.h"
 
 namespace Helix {
 
 const int					STACK_SIZE =				16*1024;	// 16k
-const int					NUM_SUBMISSION_BUFFERS	=	2;
 int							m_backbufferWidth = 0;
 int							m_backbufferHeight = 0;
 bool						m_renderThreadInitialized =	false;
 bool						m_renderThreadShutdown =	false;
 bool						m_inRender =				false;
 HANDLE						m_hThread	=				NULL;
-HANDLE						m_startRenderEvent	=		NULL;
-HANDLE						m_rendererReady =			NULL;
-HANDLE						m_hSubmitMutex =			NULL;
-ID3D11Device *				m_D3DDevice =				NULL;
-ID3D11DeviceContext *		m_context =					NULL;
-IDXGISwapChain *			m_swapChain =				NULL;
+HANDLE						m_rendererExited =			NULL;
+RenderDevice *				m_device =					NULL;
+RenderContext *				m_context =					NULL;
+StateCacheContext *			m_stateCache =				NULL;
 
 ID3D11RenderTargetView *	m_backBufferView = NULL;
 ID3D11Texture2D *			m_backDepthStencil = NULL;
 ID3D11DepthStencilView *	m_backDepthStencilView = NULL;
 
-enum { ALBEDO = 0, NORMAL, DEPTH, MAX_TARGETS };
-
-ID3D11Texture2D *			m_Texture[MAX_TARGETS];
-ID3D11RenderTargetView *	m_RTView[MAX_TARGETS];
-ID3D11ShaderResourceView *	m_SRView[MAX_TARGETS];
+// The GBuffer and lighting passes and the targets between them
+RenderGraph					m_frameGraph;
+RenderGraphResource			m_albedoTarget = -1;
+RenderGraphResource			m_normalTarget = -1;
+RenderGraphResource			m_depthTarget = -1;
+RenderGraphResource			m_depthStencilTarget = -1;
+RenderGraphResource			m_backBufferTarget = -1;
 
 HXMaterial *				m_lightingMat = NULL;
-ID3D11Texture2D *			m_depthStencilTexture = NULL;
-ID3D11DepthStencilView *	m_depthStencilDSView = NULL;
-ID3D11ShaderResourceView *	m_depthStencilSRView = NULL;
-ID3D11Buffer *				m_quadVB = NULL;
-ID3D11Buffer *				m_quadIB = NULL;
 ID3D11RasterizerState *		m_RState = NULL;
+ID3D11RasterizerState *		m_lightRState = NULL;		// m_RState with scissoring, for light quads
 ID3D11BlendState *			m_GBufferBlendState = NULL;
 ID3D11DepthStencilState *	m_GBufferDSState = NULL;
 ID3D11BlendState *			m_lightingBlendState = NULL;
@@ -71,38 +75,22 @@ struct CONSTANT_BUFFER_FRAME
 	float					m_viewAspect;
 };
 
-ID3D11Buffer	*m_objectConstants = NULL;
-struct CONSTANT_BUFFER_OBJECT
-{
-	Helix::Matrix4x4		m_worldViewMatrix;
-	Helix::Matrix4x4		m_worldViewIT;
-	Helix::Matrix4x4		m_invWorldViewProj;
-};
-
-ID3D11Buffer	*m_lightingConstants = NULL;
-struct POINTLIGHT_CONSTANTS
-{
-	Helix::Vector4	m_pointLoc;
-	Helix::Vector4	m_pointColor;
-	float			m_lightRadius;
-};
+// The GBuffer and lighting passes themselves
+ScenePasses		m_scenePasses;
 
-struct RenderData
-{
-	Helix::Matrix4x4	worldMatrix;
-	std::string			meshName;
-	std::string			materialName;
-	RenderData *		next;
-};
-
-int					m_submissionIndex = 0;
 int					m_renderIndex = 0;
-RenderData *		m_submissionBuffers[NUM_SUBMISSION_BUFFERS];
+FrameDrawList		m_frameDrawLists[NUM_SUBMISSION_BUFFERS];
+SubmissionStats		m_submissionStats;
 Helix::Matrix4x4	m_viewMatrix[NUM_SUBMISSION_BUFFERS];
 Helix::Matrix4x4	m_projMatrix[NUM_SUBMISSION_BUFFERS];
 
-Light			m_renderLights[MAX_LIGHTS];
-int				m_numRenderLights = 0;
+// Frames handed from RenderScene() to the render thread.  Every array above
+// indexed by submission/render index is one slot per frame in flight.
+FrameFence			m_frameFence;
+int					m_pipelineDepth = 1;
+int					m_pendingPipelineDepth = 0;
+
+LightList		m_renderLights[NUM_SUBMISSION_BUFFERS];	// Swapped in from the submitted lights
 
 float			m_cameraNear = 0;
 float			m_cameraFar = 0;
@@ -113,25 +101,27 @@ float			m_fov = 0;
 float			m_viewAspect;
 float			m_invTanHalfFOV = 0;
 
-ID3D11SamplerState	*m_basicSampler;
-
-struct QuadVert {
-	float	pos[3];
-	float	uv[2];
+// What SubmitInstance() needs to pick levels of detail, one per frame in
+// flight since the camera for the next frame is submitted while the render
+// thread may still be on the last one
+struct LodCamera
+{
+	Helix::Vector3	position;
+	float			pixelScale;			// Pixels one unit covers one unit away
 };
 
+LodCamera		m_lodCameras[NUM_SUBMISSION_BUFFERS];
+float			m_lodMaxPixels = 1.0f;
+
+ID3D11SamplerState	*m_basicSampler;
+
 void	CreateViews();
 void	CreateBackbufferViews();
-void	CreateColorTarget();
-void	CreateDepthTarget();
-void	CreateDepthStencilTarget();
-void	CreateNormalTarget();
-void	CreateQuad();
+void	CreateFrameGraph();
 void	CreateRenderStates();
 void	CreateConstantBuffers();
+void	CreateScenePasses();
 
-void	FillGBuffer();
-void	DoLighting();
 void	ShowNormals();
 
 // ****************************************************************************
@@ -144,29 +134,100 @@ void	InitializeRenderThread();
 void	InitializeThreadLoader();
 // ****************************************************************************
 // ****************************************************************************
-inline int SubmissionIndex()
+const SubmissionStats & GetSubmissionStats()
 {
-	return m_submissionIndex;
+	return m_submissionStats;
 }
 
 // ****************************************************************************
+// Called from RenderScene() once the submission index has moved on.  Gathers
+// the frame's records from every producer's bucket into one list for the
+// render thread.
 // ****************************************************************************
-inline bool AcquireMutex()
+void MergeFrameDrawList(int index)
 {
-	DWORD result = WaitForSingleObject(m_hSubmitMutex,INFINITE);
-	_ASSERT(result == WAIT_OBJECT_0);
+	FrameDrawList &list = m_frameDrawLists[index];
+	list.arena.Reset();
+	list.numDraws = MergeSubmitBuckets(index, list.arena, list.draws);
+}
+
+// One frame's worth of work for the transform stage
+struct TransformJobData
+{
+	FrameDrawList *		list;
+	Helix::Matrix4x4	viewMatrix;
+	Helix::Matrix4x4	invViewProj;
+};
+
+const unsigned int	TRANSFORM_BATCH_SIZE = 128;
+
+// ****************************************************************************
+// Builds the constant block for draws [begin, end).  The shaders take
+// mul(pos, M) from column major buffers, so with our column vectors the
+// world view matrix is view * world, and the inverse of proj * view * world
+// is the inverse world times the frame's inverse view projection.
+//
+// Quantized meshes get their dequantization folded onto the end of the
+// world view matrix, so it takes vertex buffer positions straight to view
+// space.  The other two stay in object space.
+// ****************************************************************************
+void TransformDraws(void *data, unsigned int begin, unsigned int end)
+{
+	TransformJobData *job = reinterpret_cast<TransformJobData *>(data);
+	RenderData **draws = job->list->draws;
+	CONSTANT_BUFFER_OBJECT *constants = job->list->constants;
+
+	Helix::Matrix4x4 invWorld;
+	Helix::Matrix4x4 worldView;
+	for(unsigned int index = begin; index < end; index++)
+	{
+		const Helix::Matrix4x4 &worldMat = draws[index]->worldMatrix;
+		const Mesh *mesh = draws[index]->mesh;
+		CONSTANT_BUFFER_OBJECT &objConst = constants[index];
+
+		Helix::MultiplySSE(job->viewMatrix, worldMat, worldView);
+		if(mesh->IsQuantized())
+		{
+			Helix::MultiplySSE(worldView, mesh->GetDequantize(), objConst.m_worldViewMatrix);
+		}
+		else
+		{
+			objConst.m_worldViewMatrix = worldView;
+		}
 
-	return result == WAIT_OBJECT_0;
+		Helix::InvertAffineSSE(worldMat, invWorld);
+		Helix::MultiplySSE(invWorld, job->invViewProj, objConst.m_invWorldViewProj);
+
+		// Generate the inverse transpose of the WorldView matrix
+		// We don't use any non uniform scaling, so we can just send down the 
+		// upper 3x3 of the world view matrix
+		Helix::Matrix4x4 &worldViewIT = objConst.m_worldViewIT;
+		worldViewIT = worldView;
+		worldViewIT.r[0][3] = worldViewIT.r[1][3]= worldViewIT.r[2][3] = 0;
+	}
 }
 
 // ****************************************************************************
+// Called from RenderScene() once the frame's draws are merged.  Fills in
+// every draw's per object constants on the job workers, so all the render
+// thread has left to do is copy them out.
 // ****************************************************************************
-inline bool ReleaseMutex()
+void TransformDrawList(int index)
 {
-	DWORD result = ::ReleaseMutex(m_hSubmitMutex);
-	_ASSERT(result);
+	HX_PROFILE_SCOPE("TransformDrawList");
+
+	FrameDrawList &list = m_frameDrawLists[index];
+	list.constants = list.arena.Alloc<CONSTANT_BUFFER_OBJECT>(list.numDraws > 0 ? list.numDraws : 1);
+	if(list.numDraws == 0)
+		return;
 
-	return result != 0;
+	TransformJobData job;
+	job.list = &list;
+	job.viewMatrix = m_viewMatrix[index];
+	job.invViewProj = m_projMatrix[index] * m_viewMatrix[index];
+	job.invViewProj.Invert();
+
+	ParallelFor(list.numDraws, TRANSFORM_BATCH_SIZE, TransformDraws, &job);
 }
 
 // ****************************************************************************
@@ -207,10 +268,39 @@ void SetAmbientColor(const DXGI_RGB &color)
 // ****************************************************************************
 bool RenderThreadReady()
 {
-	DWORD result = WaitForSingleObject(m_rendererReady,INFINITE);
-	_ASSERT(result == WAIT_OBJECT_0);
+	// Only blocks if handing over the frame being built would put us more
+	// than the pipeline depth ahead of the render thread
+	HX_PROFILE_SCOPE("WaitForSlot");
+	m_frameFence.WaitForSlot();
 
-	return result == WAIT_OBJECT_0;
+	return !GetRenderThreadShutdown();
+}
+
+// ****************************************************************************
+// Sets how many frames may be queued up for the render thread (1..3).  Before
+// the renderer is up this just picks the starting depth; afterwards the change
+// is applied at the next RenderScene(), once the pipeline has drained.
+// ****************************************************************************
+void SetFramePipelineDepth(int depth)
+{
+	_ASSERT(depth >= 1 && depth <= FrameFence::MAX_DEPTH);
+	depth = depth < 1 ? 1 : (depth > FrameFence::MAX_DEPTH ? FrameFence::MAX_DEPTH : depth);
+
+	if(!m_renderThreadInitialized)
+	{
+		m_pipelineDepth = depth;
+	}
+	else
+	{
+		m_pendingPipelineDepth = depth;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int GetFramePipelineDepth()
+{
+	return m_pendingPipelineDepth != 0 ? m_pendingPipelineDepth : m_frameFence.GetDepth();
 }
 
 // ****************************************************************************
@@ -222,18 +312,16 @@ void CreateBackbufferViews()
 {
 	// Get the back buffer and desc
 	ID3D11Texture2D* pBuffer = NULL;
-	HRESULT hr = m_swapChain->GetBuffer( 0, __uuidof( ID3D11Texture2D ), ( LPVOID* )&pBuffer );
-	_ASSERT( SUCCEEDED(hr) );
-
 	D3D11_TEXTURE2D_DESC backBufferSurfaceDesc;
-	pBuffer->GetDesc( &backBufferSurfaceDesc );
+	HRESULT hr = m_device->GetBackBuffer( &pBuffer, &backBufferSurfaceDesc );
+	_ASSERT( SUCCEEDED(hr) );
 
 	// Save off our width/height
 	m_backbufferWidth = backBufferSurfaceDesc.Width;
 	m_backbufferHeight = backBufferSurfaceDesc.Height;
 
-	hr = m_D3DDevice->CreateRenderTargetView( pBuffer, NULL, &m_backBufferView );
-	pBuffer->Release();
+	hr = m_device->CreateRenderTargetView( pBuffer, NULL, &m_backBufferView );
+	m_device->Release(pBuffer);
 	_ASSERT( SUCCEEDED(hr) );
 
 	HXAddTexture(new HXTexture(m_backBufferView),"[backbuffer]");
@@ -251,7 +339,7 @@ void CreateBackbufferViews()
 	descDepth.BindFlags = D3D11_BIND_DEPTH_STENCIL;
 	descDepth.CPUAccessFlags = 0;
 	descDepth.MiscFlags = 0;
-	hr = m_D3DDevice->CreateTexture2D( &descDepth, NULL, &m_backDepthStencil );
+	hr = m_device->CreateTexture2D( &descDepth, NULL, &m_backDepthStencil );
 	_ASSERT( SUCCEEDED(hr) );
 
 	// Create the depth stencil view
@@ -263,192 +351,88 @@ void CreateBackbufferViews()
 	//else
 	descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	descDSV.Texture2D.MipSlice = 0;
-	hr = m_D3DDevice->CreateDepthStencilView( m_backDepthStencil, &descDSV, &m_backDepthStencilView );
+	hr = m_device->CreateDepthStencilView( m_backDepthStencil, &descDSV, &m_backDepthStencilView );
 
 	HXAddTexture(new HXTexture(m_backDepthStencilView), "[backdepthstencil]");
 	_ASSERT( SUCCEEDED(hr) );
 }
 
-// ****************************************************************************
-// - Create a color render target texture (DXGI_FORMAT_R8G8B8A8_UNORM)
-// - Create a render target view for the color render target
-// - Create a shader view for the color render target
-// ****************************************************************************
-void CreateColorTarget()
-{
-	// Create some empty render targets
-	D3D11_TEXTURE2D_DESC desc;
-	ZeroMemory(&desc, sizeof(desc));
-	desc.Width = m_backbufferWidth;
-	desc.Height = m_backbufferHeight;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; //DXGI_FORMAT_R10G10B10A2_UNORM ;
-	desc.SampleDesc.Count = 1;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-
-	// Create the texture
-	HRESULT hr = m_D3DDevice->CreateTexture2D( &desc, NULL, &m_Texture[ALBEDO] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	// Create the render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtDesc;
-	rtDesc.Format = desc.Format;
-	rtDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	rtDesc.Texture2D.MipSlice = 0;
-
-	hr = m_D3DDevice->CreateRenderTargetView( m_Texture[ALBEDO], &rtDesc, &m_RTView[ALBEDO] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_RTView[ALBEDO]), "[albedotarget]");
-
-	// Create the shader input view
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-	srDesc.Format = desc.Format;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-
-	hr = m_D3DDevice->CreateShaderResourceView( m_Texture[ALBEDO], &srDesc, &m_SRView[ALBEDO] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_SRView[ALBEDO]), "[albedoshader]");
-}
-
 // ****************************************************************************
 // ****************************************************************************
-void CreateDepthTarget()
+inline RenderGraphTextureDesc ScreenTextureDesc(DXGI_FORMAT format)
 {
-	// Create some empty render targets
-	D3D11_TEXTURE2D_DESC desc;
-	ZeroMemory(&desc, sizeof(desc));
-	desc.Width = m_backbufferWidth;
-	desc.Height = m_backbufferHeight;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R16_FLOAT;
-	desc.SampleDesc.Count = 1;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-
-	// Create the texture
-	HRESULT hr = m_D3DDevice->CreateTexture2D( &desc, NULL, &m_Texture[DEPTH] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	// Create the render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtDesc;
-	rtDesc.Format = desc.Format;
-	rtDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	rtDesc.Texture2D.MipSlice = 0;
-
-	hr = m_D3DDevice->CreateRenderTargetView( m_Texture[DEPTH], &rtDesc, &m_RTView[DEPTH] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_RTView[DEPTH]), "[depthtarget]");
-
-	// Create the shader input view
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-	srDesc.Format = desc.Format;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-
-	hr = m_D3DDevice->CreateShaderResourceView( m_Texture[DEPTH], &srDesc, &m_SRView[DEPTH] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_SRView[DEPTH]), "[depthshader]");
-}
-// ****************************************************************************
-// - Create a depth/stencil target texture (DXGI_FORMAT_R16_TYPELESS)
-// - Create a depth/stencil view
-// - Create a shader resource view for our depth/stencil 
-// ****************************************************************************
-void CreateDepthStencilTarget()
-{
-	// Create a depth/stencil texture
-	D3D11_TEXTURE2D_DESC desc;
-	ZeroMemory(&desc, sizeof(desc));
-	desc.Width = m_backbufferWidth;
-	desc.Height = m_backbufferHeight;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R16_TYPELESS ;
-	desc.SampleDesc.Count = 1;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-
-	HRESULT hr = m_D3DDevice->CreateTexture2D( &desc, NULL, &m_depthStencilTexture );
-	_ASSERT( SUCCEEDED(hr) );
-
-	// Create the depth/stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC dsDesc;
-	ZeroMemory(&dsDesc,sizeof(dsDesc));
-	dsDesc.Format = DXGI_FORMAT_D16_UNORM;
-	dsDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	dsDesc.Texture2D.MipSlice = 0;
-
-	hr = m_D3DDevice->CreateDepthStencilView(m_depthStencilTexture,&dsDesc,&m_depthStencilDSView );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_depthStencilDSView), "[depthstenciltarget]");
-
-	// Create our shader resource view
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-	ZeroMemory(&srDesc, sizeof(srDesc));
-	srDesc.Format = DXGI_FORMAT_R16_UNORM;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-
-	hr = m_D3DDevice->CreateShaderResourceView(m_depthStencilTexture,&srDesc,&m_depthStencilSRView );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_depthStencilSRView), "[depthstencilshader]");
+	RenderGraphTextureDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.width = m_backbufferWidth;
+	desc.height = m_backbufferHeight;
+	desc.format = format;
+	desc.targetFormat = format;
+	desc.shaderFormat = format;
+	desc.clear = true;
+	return desc;
 }
 
 // ****************************************************************************
+// Declares the frame: the GBuffer pass fills albedo, normal and depth, and
+// the lighting pass reads them back into the back buffer, depth testing
+// against the GBuffer's depth/stencil.  The graph takes care of the clears
+// and of unbinding the GBuffer inputs before they're written again.
+//
+// Materials look the targets up by name, so they're registered here too.
 // ****************************************************************************
-void CreateNormalTarget()
+void CreateFrameGraph()
 {
-	// Create some empty render targets
-	D3D11_TEXTURE2D_DESC desc;
-	ZeroMemory(&desc, sizeof(desc));
-	desc.Width = m_backbufferWidth;
-	desc.Height = m_backbufferHeight;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R16G16B16A16_SNORM ;
-	desc.SampleDesc.Count = 1;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-
-	// Create the texture
-	HRESULT hr = m_D3DDevice->CreateTexture2D( &desc, NULL, &m_Texture[NORMAL] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	// Create the render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtDesc;
-	rtDesc.Format = desc.Format;
-	rtDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	rtDesc.Texture2D.MipSlice = 0;
-
-	hr = m_D3DDevice->CreateRenderTargetView( m_Texture[NORMAL], &rtDesc, &m_RTView[NORMAL] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_RTView[NORMAL]), "[normaltarget]");
-
-	// Create the shader input view
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc;
-	srDesc.Format = desc.Format;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-
-	hr = m_D3DDevice->CreateShaderResourceView( m_Texture[NORMAL], &srDesc, &m_SRView[NORMAL] );
-	_ASSERT( SUCCEEDED(hr) );
-
-	HXAddTexture(new HXTexture(m_SRView[NORMAL]), "[normalshader]");
+	m_frameGraph.Initialize(m_device, m_context);
+
+	RenderGraphTextureDesc backBufferDesc = ScreenTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM);
+	backBufferDesc.clearColor[3] = 1.0f;
+	m_backBufferTarget = m_frameGraph.ImportTexture("BackBuffer", backBufferDesc, m_backBufferView, NULL, NULL);
+
+	RenderGraphTextureDesc albedoDesc = ScreenTextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM); //DXGI_FORMAT_R10G10B10A2_UNORM
+	albedoDesc.clearColor[1] = 0.125f;
+	albedoDesc.clearColor[2] = 0.3f;
+	albedoDesc.clearColor[3] = 1.0f;
+	m_albedoTarget = m_frameGraph.CreateTexture("Albedo", albedoDesc);
+	m_normalTarget = m_frameGraph.CreateTexture("Normal", ScreenTextureDesc(DXGI_FORMAT_R16G16B16A16_SNORM));
+	m_depthTarget = m_frameGraph.CreateTexture("Depth", ScreenTextureDesc(DXGI_FORMAT_R16_FLOAT));
+
+	RenderGraphTextureDesc depthStencilDesc = ScreenTextureDesc(DXGI_FORMAT_R16_TYPELESS);
+	depthStencilDesc.targetFormat = DXGI_FORMAT_D16_UNORM;
+	depthStencilDesc.shaderFormat = DXGI_FORMAT_R16_UNORM;
+	depthStencilDesc.depthStencil = true;
+	depthStencilDesc.clearDepth = 1.0f;
+	m_depthStencilTarget = m_frameGraph.CreateTexture("DepthStencil", depthStencilDesc);
+
+	RenderGraphPass gbuffer = m_frameGraph.AddPass("FillGBuffer", ScenePasses::FillGBuffer, &m_scenePasses);
+	m_frameGraph.WriteTarget(gbuffer, m_albedoTarget);
+	m_frameGraph.WriteTarget(gbuffer, m_normalTarget);
+	m_frameGraph.WriteTarget(gbuffer, m_depthTarget);
+	m_frameGraph.WriteDepth(gbuffer, m_depthStencilTarget);
+
+	RenderGraphPass lighting = m_frameGraph.AddPass("DoLighting", ScenePasses::DoLighting, &m_scenePasses);
+	m_frameGraph.ReadTexture(lighting, m_albedoTarget, 0);
+	m_frameGraph.ReadTexture(lighting, m_normalTarget, 1);
+	m_frameGraph.ReadTexture(lighting, m_depthTarget, 2);
+	m_frameGraph.ReadDepth(lighting, m_depthStencilTarget);
+	m_frameGraph.WriteTarget(lighting, m_backBufferTarget);
+
+	m_frameGraph.MarkOutput(m_backBufferTarget);
+	if(!m_frameGraph.Compile())
+	{
+		OutputDebugString(m_frameGraph.CompileError());
+		OutputDebugString("\n");
+		_ASSERT(false);
+	}
+	m_frameGraph.Realize();
+
+	HXAddTexture(new HXTexture(m_frameGraph.TargetView(m_albedoTarget)), "[albedotarget]");
+	HXAddTexture(new HXTexture(m_frameGraph.ShaderView(m_albedoTarget)), "[albedoshader]");
+	HXAddTexture(new HXTexture(m_frameGraph.TargetView(m_normalTarget)), "[normaltarget]");
+	HXAddTexture(new HXTexture(m_frameGraph.ShaderView(m_normalTarget)), "[normalshader]");
+	HXAddTexture(new HXTexture(m_frameGraph.TargetView(m_depthTarget)), "[depthtarget]");
+	HXAddTexture(new HXTexture(m_frameGraph.ShaderView(m_depthTarget)), "[depthshader]");
+	HXAddTexture(new HXTexture(m_frameGraph.DepthStencilView(m_depthStencilTarget)), "[depthstenciltarget]");
+	HXAddTexture(new HXTexture(m_frameGraph.ShaderView(m_depthStencilTarget)), "[depthstencilshader]");
 }
 
 // ****************************************************************************
@@ -458,10 +442,7 @@ void CreateNormalTarget()
 void CreateViews()
 {
 	CreateBackbufferViews();
-	CreateColorTarget();
-	CreateDepthTarget();
-	CreateDepthStencilTarget();
-	CreateNormalTarget();
+	CreateFrameGraph();
 }
 // ****************************************************************************
 // ****************************************************************************
@@ -478,77 +459,6 @@ void LoadShapes()
 	MeshManager::GetInstance().Load("[lightsphere]","lightsphere");
 }
 
-// ****************************************************************************
-// ****************************************************************************
-void CreateQuad()
-{
-	// Vertex buffer descriptor
-	int vertexSize = 3*sizeof(float) + 2*sizeof(float);
-	QuadVert quadVerts[4];
-
-	quadVerts[0].pos[0] = -1.0f;
-	quadVerts[0].pos[1] = -1.0f;
-	quadVerts[0].pos[2] = 0.5f;
-	quadVerts[0].uv[0] = 0.0f;
-	quadVerts[0].uv[1] = 1.0f;
-
-	quadVerts[1].pos[0] = -1.0f;
-	quadVerts[1].pos[1] = 1.0f;
-	quadVerts[1].pos[2] = 0.5f;
-	quadVerts[1].uv[0] = 0.0f;
-	quadVerts[1].uv[1] = 0.0f;
-
-	quadVerts[2].pos[0] = 1.0f;
-	quadVerts[2].pos[1] = 1.0f;
-	quadVerts[2].pos[2] = 0.5f;
-	quadVerts[2].uv[0] = 1.0f;
-	quadVerts[2].uv[1] = 0.0f;
-
-	quadVerts[3].pos[0] = 1.0f;
-	quadVerts[3].pos[1] = -1.0f;
-	quadVerts[3].pos[2] = 0.5f;
-	quadVerts[3].uv[0] = 1.0f;
-	quadVerts[3].uv[1] = 1.0f;
-
-	D3D11_BUFFER_DESC bufferDesc = {0};
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(quadVerts);
-	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bufferDesc.CPUAccessFlags = 0;
-	bufferDesc.MiscFlags = 0;
-
-	// Data initialization descriptor
-	D3D11_SUBRESOURCE_DATA initData = {0};
-	initData.pSysMem = &quadVerts;
-	initData.SysMemPitch = 0;
-	initData.SysMemSlicePitch = 0;
-
-	// Create the buffer
-	HRESULT hr = m_D3DDevice->CreateBuffer(&bufferDesc,&initData,&m_quadVB);
-	_ASSERT( SUCCEEDED(hr) );
-
-	// Create our index buffer
-	unsigned short ibData[4] = { 1, 2, 0, 3 };
-
-	// Create the index buffer
-	memset(&bufferDesc,0,sizeof(bufferDesc));
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(ibData);
-	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bufferDesc.CPUAccessFlags = 0;
-	bufferDesc.MiscFlags = 0;
-	
-	// Data initialization descriptor
-	memset(&initData,0,sizeof(initData));
-	initData.pSysMem = ibData;
-	initData.SysMemPitch = 0;
-	initData.SysMemSlicePitch = 0;
-
-	hr = m_D3DDevice->CreateBuffer(&bufferDesc,&initData,&m_quadIB);
-	_ASSERT( SUCCEEDED(hr) );
-
-}
-
 // ****************************************************************************
 // ****************************************************************************
 void CreateRenderStates()
@@ -566,7 +476,12 @@ void CreateRenderStates()
 	rDesc.ScissorEnable = false;
 	rDesc.MultisampleEnable = false;
 	rDesc.AntialiasedLineEnable = false;
-	HRESULT hr = m_D3DDevice->CreateRasterizerState(&rDesc, &m_RState);
+	HRESULT hr = m_device->CreateRasterizerState(&rDesc, &m_RState);
+	_ASSERT( SUCCEEDED(hr) );
+
+	// Lights only draw inside their screen bounds
+	rDesc.ScissorEnable = true;
+	hr = m_device->CreateRasterizerState(&rDesc, &m_lightRState);
 	_ASSERT( SUCCEEDED(hr) );
 
 	// Create a blend state for creating GBuffer
@@ -585,7 +500,7 @@ void CreateRenderStates()
 		blendStateDesc.RenderTarget[i].BlendOpAlpha = D3D11_BLEND_OP_ADD;
 		blendStateDesc.RenderTarget[i].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL ;
 	}
-	hr = m_D3DDevice->CreateBlendState(&blendStateDesc,&m_GBufferBlendState);
+	hr = m_device->CreateBlendState(&blendStateDesc,&m_GBufferBlendState);
 	_ASSERT( SUCCEEDED( hr ) );
 	
 	// Depth/stencil for creating GBuffer
@@ -611,7 +526,7 @@ void CreateRenderStates()
 	depthStencilStateDesc.BackFace = stencilOp;
 
 	ID3D11DepthStencilState *depthStencilState = NULL;
-	hr = m_D3DDevice->CreateDepthStencilState(&depthStencilStateDesc,&m_GBufferDSState);
+	hr = m_device->CreateDepthStencilState(&depthStencilStateDesc,&m_GBufferDSState);
 	_ASSERT( SUCCEEDED( hr ) );
 
 	// Depth/stencil for light blending
@@ -633,7 +548,7 @@ void CreateRenderStates()
 	depthStencilStateDesc.BackFace = stencilOp;
 
 	depthStencilState = NULL;
-	hr = m_D3DDevice->CreateDepthStencilState(&depthStencilStateDesc,&m_lightingDSState);
+	hr = m_device->CreateDepthStencilState(&depthStencilStateDesc,&m_lightingDSState);
 	_ASSERT( SUCCEEDED( hr ) );
 
 	// Create a blend state for deferred lighting
@@ -664,7 +579,7 @@ void CreateRenderStates()
 		blendStateDesc.RenderTarget[i].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL ;
 	}
 
-	hr = m_D3DDevice->CreateBlendState(&blendStateDesc,&m_lightingBlendState);
+	hr = m_device->CreateBlendState(&blendStateDesc,&m_lightingBlendState);
 	_ASSERT( SUCCEEDED( hr ) );
 
 	// Create a SamplerState
@@ -685,7 +600,7 @@ void CreateRenderStates()
 	samplerDesc.BorderColor[0] = samplerDesc.BorderColor[1] = samplerDesc.BorderColor[2] = samplerDesc.BorderColor[3] = 0;
 	samplerDesc.MinLOD = 0;
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	hr = m_D3DDevice->CreateSamplerState(&samplerDesc,&m_basicSampler);
+	hr = m_device->CreateSamplerState(&samplerDesc,&m_basicSampler);
 	_ASSERT( SUCCEEDED( hr ) ) ;
 }
 
@@ -705,17 +620,25 @@ void CreateConstantBuffers()
 	//bufferDesc.StructureByteStride = 0;
 
 	bufferDesc.ByteWidth = Align<16>(sizeof( CONSTANT_BUFFER_FRAME ));
-	HRESULT hr = m_D3DDevice->CreateBuffer( &bufferDesc, NULL, &m_frameConstants );
+	HRESULT hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_frameConstants );
 	_ASSERT( SUCCEEDED( hr ) );
 
-	bufferDesc.ByteWidth = Align<16>(sizeof( CONSTANT_BUFFER_OBJECT ));
-	hr = m_D3DDevice->CreateBuffer( &bufferDesc, NULL, &m_objectConstants );
-	_ASSERT( SUCCEEDED( hr ) );
-
-	bufferDesc.ByteWidth = Align<16>(sizeof(POINTLIGHT_CONSTANTS));
-	hr = m_D3DDevice->CreateBuffer( &bufferDesc, NULL, &m_lightingConstants );
-	_ASSERT( SUCCEEDED( hr ) );
+}
 
+// ****************************************************************************
+// Hands the passes the states made above and lets them make their buffers
+// ****************************************************************************
+void CreateScenePasses()
+{
+	ScenePassStates states;
+	states.rasterizer = m_RState;
+	states.lightRasterizer = m_lightRState;
+	states.gbufferBlend = m_GBufferBlendState;
+	states.gbufferDepthStencil = m_GBufferDSState;
+	states.lightingBlend = m_lightingBlendState;
+	states.lightingDepthStencil = m_lightingDSState;
+	states.lightShader = m_lightingMat->m_shader;
+	m_scenePasses.Initialize(m_device, m_context, states);
 }
 
 
@@ -725,9 +648,23 @@ void InitializeRenderer(ID3D11Device* dev, ID3D11DeviceContext *context, IDXGISw
 {
 	_ASSERT(dev != NULL);
 	_ASSERT( swapChain != NULL) ;
-	m_D3DDevice = dev;
-	m_context = context;
-	m_swapChain = swapChain;
+
+	InitializeRenderer(new D3D11RenderDevice(dev, swapChain), new D3D11RenderContext(context, swapChain));
+}
+
+// ****************************************************************************
+// Brings the renderer up on top of any backend.  The renderer doesn't own the
+// device or context; they need to outlive it.  Everything talks to the context
+// through the state cache so redundant binds never reach the backend.
+// ****************************************************************************
+void InitializeRenderer(RenderDevice *device, RenderContext *context)
+{
+	_ASSERT(device != NULL);
+	_ASSERT(context != NULL);
+	m_device = device;
+	m_stateCache = new StateCacheContext(context);
+	m_context = m_stateCache;
+	RenderMgr::GetInstance().SetRenderDevice(device, m_context);
 
 	// Initialize managers
 	HXInitializeShaders();
@@ -739,9 +676,9 @@ void InitializeRenderer(ID3D11Device* dev, ID3D11DeviceContext *context, IDXGISw
 	CreateViews();
 	LoadLightShaders();
 	LoadShapes();
-	CreateQuad();
 	CreateRenderStates();
 	CreateConstantBuffers();
+	CreateScenePasses();
 
 	// Set our viewport
 	D3D11_VIEWPORT vp;
@@ -756,6 +693,7 @@ void InitializeRenderer(ID3D11Device* dev, ID3D11DeviceContext *context, IDXGISw
 	InitializeLights();
 
 	// Initialize threading
+	InitializeJobSystem();
 	InitializeRenderThread();
 	InitializeThreadLoader();
 }
@@ -767,19 +705,23 @@ void InitializeRenderThread()
 	_ASSERT(m_renderThreadInitialized == false);
 	m_renderThreadInitialized = true;
 
-	m_startRenderEvent = CreateEvent(NULL, false, false,"RenderStartEvent");
-	_ASSERT(m_startRenderEvent != NULL);
+	m_rendererExited = CreateEvent(NULL, false, false, "RenderEndEvent");
+	_ASSERT(m_rendererExited != NULL);
 
-	m_rendererReady = CreateEvent(NULL, false, false, "RenderEndEvent");
-	_ASSERT(m_rendererReady != NULL);
+	_ASSERT(NUM_SUBMISSION_BUFFERS == FrameFence::MAX_SLOTS);
+	m_frameFence.Initialize(m_pipelineDepth);
+	m_pendingPipelineDepth = 0;
 
-	m_submissionIndex = 0;
+	SetSubmissionIndex(0);
 	for(int i=0;i<NUM_SUBMISSION_BUFFERS; i++)
 	{
-		m_submissionBuffers[i] = NULL;
+		m_frameDrawLists[i].arena.Reset();
+		m_frameDrawLists[i].draws = NULL;
+		m_frameDrawLists[i].constants = NULL;
+		m_frameDrawLists[i].numDraws = 0;
+		m_renderLights[i].Clear();
 	}
-
-	m_hSubmitMutex = CreateMutex(NULL,false,"RenderSubmit");
+	memset(&m_submissionStats, 0, sizeof(m_submissionStats));
 
 	// Now create the thread
 	m_hThread = (HANDLE)_beginthread( Helix::RenderThreadFunc, STACK_SIZE, NULL );
@@ -799,50 +741,82 @@ bool GetRenderThreadShutdown()
 void ShutDownRenderThread()
 {
 	m_renderThreadShutdown = true;
+	m_frameFence.Shutdown();
 
 	// Wait for the thread to exit
-	DWORD result = WaitForSingleObject(m_rendererReady,INFINITE);
+	DWORD result = WaitForSingleObject(m_rendererExited,INFINITE);
 	_ASSERT(result == WAIT_OBJECT_0);
 
-	CloseHandle(m_startRenderEvent);
-	CloseHandle(m_rendererReady);
+	CloseHandle(m_rendererExited);
 
-	// Thread safety first!
-	AcquireMutex();
+	// The render thread was the only one handing out jobs
+	ShutdownJobSystem();
+
+	m_scenePasses.Release();
+	m_frameGraph.Release();
+
+	// Nobody should be submitting by now
+	ReleaseSubmitBuckets();
 
 	for(int i=0;i<NUM_SUBMISSION_BUFFERS;i++)
 	{
-		RenderData *obj = m_submissionBuffers[i];
-		while(obj != NULL)
-		{
-			RenderData *nextObj = obj->next;
-			delete obj;
-			obj = nextObj;
-		}
+		m_frameDrawLists[i].numDraws = 0;
+		m_frameDrawLists[i].arena.Reset();
 	}
-	ReleaseMutex();
-	CloseHandle(m_hSubmitMutex);
 }
 
 // ****************************************************************************
 // ****************************************************************************
 void RenderScene()
 {
-	// Copy light information
-	AquireLightMutex();
-	Light *submittedLights = SubmittedLights();
-	int lightCount = SubmittedLightCount();
-	memcpy(m_renderLights, submittedLights, lightCount * sizeof(Light));
-	m_numRenderLights = lightCount;
-	ResetLights();
-	ReleaseLightMutex();
-
-	// This call happens from the main thread.  Setup our render/submission
-	// indices before kicking off the renderer
-	m_renderIndex = m_submissionIndex;
-	m_submissionIndex = (m_submissionIndex + 1 ) % NUM_SUBMISSION_BUFFERS;
-	DWORD result = SetEvent(m_startRenderEvent);
-	_ASSERT(result != 0);
+	HX_PROFILE_SCOPE("RenderScene");
+
+	// Make sure the render thread is far enough along that the next slot is
+	// free.  A no-op if RenderThreadReady() already waited.
+	m_frameFence.WaitForSlot();
+
+	int index = SubmissionIndex();
+	if(m_pendingPipelineDepth != 0)
+	{
+		m_frameFence.SetDepth(m_pendingPipelineDepth);
+		m_pendingPipelineDepth = 0;
+	}
+
+	// Take the latest published lights.  The slot's old list is done with,
+	// so it goes back round to collect more.
+	AcquireLights(m_renderLights[index]);
+
+	// This call happens from the main thread.  Move submission on to the next
+	// slot before handing this one to the renderer.  Producers on other
+	// threads may still be submitting; anything that lands after the flip
+	// goes to the next frame.
+	SetSubmissionIndex(m_frameFence.NextSlot(index));
+	MergeFrameDrawList(index);
+	TransformDrawList(index);
+
+	m_frameFence.EndFrame(index);
+}
+
+// ****************************************************************************
+// Projects the error of the instance's levels from the point on its bounds
+// nearest the camera.  Uniform scale in the world matrix scales the error
+// along with everything else.
+// ****************************************************************************
+inline unsigned int SelectInstanceLod(const Instance &inst, const Mesh &mesh, const LodCamera &camera)
+{
+	if(mesh.NumLods() == 1)
+		return 0;
+
+	const AABB &bounds = inst.GetWorldBounds();
+	float dx = max(max(bounds.minPt.x - camera.position.x, camera.position.x - bounds.maxPt.x), 0.0f);
+	float dy = max(max(bounds.minPt.y - camera.position.y, camera.position.y - bounds.maxPt.y), 0.0f);
+	float dz = max(max(bounds.minPt.z - camera.position.z, camera.position.z - bounds.maxPt.z), 0.0f);
+	float distance = max(sqrtf(dx * dx + dy * dy + dz * dz), m_cameraNear);
+
+	const Helix::Matrix4x4 &world = inst.GetWorldMatrix();
+	float scale = sqrtf(world.r[0][0] * world.r[0][0] + world.r[1][0] * world.r[1][0] + world.r[2][0] * world.r[2][0]);
+
+	return mesh.SelectLod(scale * camera.pixelScale / distance, m_lodMaxPixels, inst.GetLod());
 }
 
 // ****************************************************************************
@@ -852,39 +826,44 @@ void RenderScene()
 // ****************************************************************************
 void SubmitInstance(Instance &inst)
 {
-	// Thread safety first
-	AcquireMutex();
+	// Resolve everything up front so the render thread only sees handles
+	Mesh *mesh = inst.GetMesh();
+	_ASSERT(mesh != NULL);
+	HXMaterial *mat = mesh->GetMaterial();
+	_ASSERT(mat != NULL);
 
-	// Create an object which holds our rendering information
-	RenderData *obj = new RenderData;
+	// Either this lands in the frame being built, or RenderScene() waits for
+	// it to be written before it takes the frame
+	int index;
+	SubmissionBuffer &buffer = BeginSubmit(index);
 
-	// Save the world matrix
-	obj->worldMatrix = inst.GetWorldMatrix();
+	unsigned int lodIndex = SelectInstanceLod(inst, *mesh, m_lodCameras[index]);
+	const MeshLod &lod = mesh->GetLod(lodIndex);
+	inst.SetLod(lodIndex);
 
-	// Save the name of the mesh
-	obj->meshName = inst.GetMeshName();
-	
-	// Get the name of the material
-	Mesh *mesh = MeshManager::GetInstance().GetMesh(obj->meshName);
-	obj->materialName = mesh->GetMaterialName();
+	// Grab the next draw record
+	RenderData *obj = AllocRenderData(buffer);
 
-	// Setup the object
-	obj->next = m_submissionBuffers[m_submissionIndex];
+	obj->worldMatrix = inst.GetWorldMatrix();
+	obj->sortKey = MakeSortKey(PASS_GBUFFER, mat->m_shader->m_id, mat->m_id, lod.id);
+	obj->mesh = mesh;
+	obj->lod = &lod;
+	obj->material = mat;
+	obj->shader = mat->m_shader;
 
-	// Put it at the head of the list
-	m_submissionBuffers[m_submissionIndex] = obj;
+	buffer.numTriangles += lod.numTriangles;
+	buffer.fullTriangles += mesh->GetLod(0).numTriangles;
 
-	// Thread safety first
-	ReleaseMutex();
+	EndSubmit();
 }
 
 // ****************************************************************************
 // ****************************************************************************
 void SubmitViewMatrix(Helix::Matrix4x4 &mat)
 {
-	AcquireMutex();
-	m_viewMatrix[m_submissionIndex] = mat;
-	ReleaseMutex();
+	// The camera is owned by the thread that calls RenderScene(), which is
+	// also the only one that moves the submission index.
+	m_viewMatrix[SubmissionIndex()] = mat;
 
 	m_cameraNear = 1.0f;
 	m_cameraFar = 200.0f;
@@ -899,290 +878,52 @@ void SubmitViewMatrix(Helix::Matrix4x4 &mat)
 	//deg = static_cast<float>(D3DXToDegree(m_fovY));
 	m_fov = fov;
 	m_invTanHalfFOV = 1.0f/tan(fov/2.0f);
-}
 
-// ****************************************************************************
-// ****************************************************************************
-void SubmitProjMatrix(Helix::Matrix4x4 &mat)
-{
-	AcquireMutex();
-	m_projMatrix[m_submissionIndex] = mat;
-	ReleaseMutex();
+	// The view is a rotation and a translation, so the camera sits at minus
+	// the translation run back through the transposed rotation
+	LodCamera &lodCamera = m_lodCameras[SubmissionIndex()];
+	lodCamera.position.x = -(mat.r[0][0] * mat.r[0][3] + mat.r[1][0] * mat.r[1][3] + mat.r[2][0] * mat.r[2][3]);
+	lodCamera.position.y = -(mat.r[0][1] * mat.r[0][3] + mat.r[1][1] * mat.r[1][3] + mat.r[2][1] * mat.r[2][3]);
+	lodCamera.position.z = -(mat.r[0][2] * mat.r[0][3] + mat.r[1][2] * mat.r[1][3] + mat.r[2][2] * mat.r[2][3]);
+	lodCamera.pixelScale = d;
 }
 
 // ****************************************************************************
 // ****************************************************************************
-void RenderPointLight(Light &light)
+void SubmitProjMatrix(Helix::Matrix4x4 &mat)
 {
-	FLOAT blendFactor[4] = {0,0,0,0};
-	m_context->OMSetBlendState(m_lightingBlendState,blendFactor,0xffffffff);
-
-	Helix::Vector4 lightPos(light.point.m_position);
-
-	// Constants
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-
-	// Set vertex shader point light constants
-	HRESULT hr = m_context->Map(m_objectConstants, NULL, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	_ASSERT(SUCCEEDED(hr)) ;
-	
-	CONSTANT_BUFFER_OBJECT *objConst = reinterpret_cast<CONSTANT_BUFFER_OBJECT *>(mappedResource.pData);
-
-	m_context->Unmap(m_objectConstants, 0);
-	m_context->VSSetConstantBuffers(1, 1, &m_objectConstants);
-
-	// Set pixel shader point light constants
-	hr = m_context->Map(m_lightingConstants, NULL, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	_ASSERT(SUCCEEDED(hr)) ;
-
-	POINTLIGHT_CONSTANTS *plConstants = reinterpret_cast<POINTLIGHT_CONSTANTS *>(mappedResource.pData);
-
-	// Position
-	plConstants->m_pointLoc.x = lightPos.x;
-	plConstants->m_pointLoc.y = lightPos.y;
-	plConstants->m_pointLoc.z = lightPos.z;
-	plConstants->m_pointLoc.w = 1.0f;
-
-	// Color
-	plConstants->m_pointColor.x = light.m_color.r;
-	plConstants->m_pointColor.y = light.m_color.g;
-	plConstants->m_pointColor.z = light.m_color.b;
-	plConstants->m_pointColor.w = 1.0f;
-
-	// Light radius
-	plConstants->m_lightRadius = 5.0f;
-
-	m_context->Unmap(m_lightingConstants,0);
-	m_context->PSSetConstantBuffers(3,1,&m_lightingConstants);
-
-	// Get the mesh/material/shader/effect
-	HXShader *shader = HXGetShaderByName(m_lightingMat->m_shaderName);
-
-	// Set the input layout 
-	m_context->IASetInputLayout(shader->m_decl->m_layout);
-
-	// Set our IB/VB
-	unsigned int stride = shader->m_decl->m_vertexSize;
-	unsigned int offset = 0;
-	m_context->IASetVertexBuffers(0, 1, &m_quadVB, &stride, &offset);
-	m_context->IASetIndexBuffer(m_quadIB, DXGI_FORMAT_R16_UINT, 0);
-
-	// Set our prim type
-	m_context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP );
-
-	// Set our states
-	m_context->RSSetState(m_RState);
-
-	// Set the shaders
-	m_context->VSSetShader(shader->m_vshader,NULL, 0);
-	m_context->PSSetShader(shader->m_pshader,NULL, 0);
-	m_context->HSSetShader(NULL, NULL, 0);
-	m_context->GSSetShader(NULL, NULL, 0);
-	m_context->DSSetShader(NULL, NULL, 0);
-
-	// Draw
-	m_context->DrawIndexed(4, 0, 0);
+	m_projMatrix[SubmissionIndex()] = mat;
 }
 
 // ****************************************************************************
 // ****************************************************************************
-void SetMaterialParameters(HXMaterial *mat)
+void SetLodErrorThreshold(float pixels)
 {
-	HXShader *shader = HXGetShaderByName(mat->m_shaderName);
-	_ASSERT(shader != NULL);
-
-	HXTexture *tex = HXGetTextureByName(mat->m_textureName);
-
-	if( tex != NULL)
-	{
-		// Mesh that only uses render targets as input textures 
-		// may not have a texture 
-		ID3D11ShaderResourceView *textureRV = tex->m_shaderView;
-		m_context->PSSetShaderResources(0, 1, &textureRV);
-	}
-}
-// ****************************************************************************
-// ****************************************************************************
-void FillGBuffer()
-{
-	// Reset our view
-	ID3D11ShaderResourceView*const pSRV[3] = { NULL,NULL,NULL };
-	m_context->PSSetShaderResources( 0, 2, pSRV );
-
-	//
-	// Clear the render targets
-	//
-	float ClearColor[4] = { 0.0f, 0.125f, 0.3f, 1.0f }; // red, green, blue, alpha
-	float ClearNormal[3] = { 0.0f, 0.0f, 0.0f };
-	float ClearDepth[1] = { 0.0f };
-	m_context->ClearRenderTargetView( m_RTView[ALBEDO], ClearColor );
-	m_context->ClearRenderTargetView( m_RTView[NORMAL], ClearNormal );
-	m_context->ClearRenderTargetView( m_RTView[DEPTH], ClearDepth) ;
-	m_context->ClearDepthStencilView( m_depthStencilDSView, D3D11_CLEAR_DEPTH, 1.0f, 0);
-	//device->ClearRenderTargetView( m_backBufferView, ClearColor );
-
-	m_context->OMSetDepthStencilState(m_GBufferDSState,0);
-	FLOAT blendFactor[4] = {0,0,0,0};
-	m_context->OMSetBlendState(m_GBufferBlendState,blendFactor,0xffffffff);
-
-	// Set our render targets
-	m_context->OMSetRenderTargets(3, m_RTView, m_depthStencilDSView);
-	//device->OMSetRenderTargets(1,&m_backBufferView,NULL);
-
-	// Go through all of our render objects
-	RenderData *obj = m_submissionBuffers[m_renderIndex];
-
-	// Per object VS constants start at 1
-	int objectConstantSlot = 1;
-	while(obj)
-	{
-		// TODO: We only have a max of D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT (14) constant buffer
-		// slots.  This uses one constant buffer per object, however each constant buffer can hold up to 4096 
-		// constants.  Ideally, you'd pack a number of object constants enough to fill one constant buffer.
-		_ASSERT(objectConstantSlot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
-		D3D11_MAPPED_SUBRESOURCE mappedResource;
-		HRESULT hr = m_context->Map(m_objectConstants, NULL, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-		_ASSERT( SUCCEEDED( hr ) );
-		CONSTANT_BUFFER_OBJECT *vsObjectConstants = reinterpret_cast<CONSTANT_BUFFER_OBJECT*>(mappedResource.pData);
-
-		// TODO: Get the world matrix from the object.  
-		// Use I for now
-		Helix::Matrix4x4 worldMat;
-
-		Helix::Matrix4x4 viewMat = m_viewMatrix[m_renderIndex];
-		Helix::Matrix4x4 projMat = m_projMatrix[m_renderIndex];
-
-		// Calculate the WorldView matrix
-		Helix::Matrix4x4 worldView = worldMat * viewMat;
-		vsObjectConstants->m_worldViewMatrix = worldView;
-
-		Helix::Matrix4x4 worldViewProj = worldView * projMat;
-		Helix::Matrix4x4 invWorldViewProj = worldViewProj;
-		invWorldViewProj.Invert();
-		vsObjectConstants->m_invWorldViewProj = invWorldViewProj;
-
-		// Generate the inverse transpose of the WorldView matrix
-		// We don't use any non uniform scaling, so we can just send down the 
-		// upper 3x3 of the world view matrix
-		Helix::Matrix4x4 worldViewIT = worldView;
-		worldViewIT.r[0][3] = worldViewIT.r[1][3]= worldViewIT.r[2][3] = worldViewIT.r[3][0] = worldViewIT.r[3][1] = worldViewIT.r[3][2] = 0;
-		worldViewIT.r[3][3] = 1;
-		vsObjectConstants->m_worldViewIT = worldViewIT;
-
-		// Done with per-object VS constants
-		m_context->Unmap(m_objectConstants, NULL);
-
-		// Set the per object constants in slot 1
-		m_context->VSSetConstantBuffers(1, 1, &m_objectConstants);
-		m_context->PSSetConstantBuffers(1, 1, &m_objectConstants);
-
-		// Set the parameters
-		HXMaterial *mat = HXGetMaterial(obj->materialName);
-		SetMaterialParameters(mat);
-
-		// Set our input assembly buffers
-		Mesh *mesh = MeshManager::GetInstance().GetMesh(obj->meshName);
-		HXShader *shader = HXGetShaderByName(mat->m_shaderName);
-
-		// Set the input layout 
-		m_context->IASetInputLayout(shader->m_decl->m_layout);
-
-		// Set our vertex/index buffers
-		unsigned int stride = shader->m_decl->m_vertexSize;
-		unsigned int offset = 0;
-		ID3D11Buffer *vb = mesh->GetVertexBuffer();
-		m_context->IASetVertexBuffers(0,1,&vb,&stride,&offset);
-		m_context->IASetIndexBuffer(mesh->GetIndexBuffer(),DXGI_FORMAT_R16_UINT,0);
-
-		// Set our prim type
-		m_context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-
-		// Set our shader
-		m_context->VSSetShader(shader->m_vshader, NULL, 0);
-		m_context->PSSetShader(shader->m_pshader, NULL, 0);
-		m_context->GSSetShader(NULL, NULL, 0);
-		m_context->DSSetShader(NULL, NULL, 0);
-		m_context->HSSetShader(NULL, NULL, 0);
-
-		// Draw
-		m_context->DrawIndexed( mesh->NumIndices(), 0, 0 );
-
-		// Start rendering
-		//ID3DX11Effect *effect = shader->m_pEffect;
-		//D3D11_TECHNIQUE_DESC techDesc;
-		//ID3DX11EffectTechnique *technique = effect->GetTechniqueByIndex(0);
-		//technique->GetDesc(&techDesc);
-		//for( unsigned int passIndex = 0; passIndex < techDesc.Passes; passIndex++ )
-		//{
-		//	technique->GetPassByIndex( passIndex )->Apply( 0 );
-		//	m_context->DrawIndexed( mesh->NumIndices(), 0, 0 );
-		//}
-
-		// Next
-		obj=obj->next;
-	}
+	_ASSERT(pixels > 0.0f);
+	m_lodMaxPixels = pixels;
 }
 
 // ****************************************************************************
 // ****************************************************************************
-void DoLighting()
+void RenderThreadFunc(void *data)
 {
-	ID3D11Device *device = m_D3DDevice;
-	ID3D11DeviceContext *context = m_context;
-
-	// Clear the backbuffer/depth/stencil
-	float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // red, green, blue, alpha
-	context->ClearRenderTargetView( m_backBufferView, ClearColor );
-	context->ClearDepthStencilView( m_backDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-	// Copy the albedo texture to the backbuffer
-
-	// Switch to final backbuffer/depth/stencil
-	context->OMSetRenderTargets(1,&m_backBufferView, m_depthStencilDSView/*m_backDepthStencilView*/);
-	context->OMSetDepthStencilState(m_lightingDSState,0);
+	HX_PROFILE_THREAD("Render");
 
-	// Reset our view
-	ID3D11ShaderResourceView*const pSRV[3] = { NULL,NULL,NULL };
-	m_context->PSSetShaderResources( 0, 3, pSRV );
-
-	// Set our textures as inputs
-	// Albedo texture
-	m_context->PSSetShaderResources(0, 1, &m_SRView[ALBEDO]);
-
-	// Normal texture
-	m_context->PSSetShaderResources(1, 1, &m_SRView[NORMAL]);
-
-	// Depth texture
-	m_context->PSSetShaderResources(2, 1, &m_SRView[DEPTH]);
-
-	// Go render all lights
-	for(int iLightIndex=0;iLightIndex < m_numRenderLights; iLightIndex++)
+	while(!GetRenderThreadShutdown())
 	{
-		Light &light = m_renderLights[iLightIndex];
-
-		switch(light.m_type)
+		// Wait for RenderScene() to hand us a frame
+		int slot;
 		{
-			case Light::POINT: 
-				RenderPointLight(light);
-				break;
+			HX_PROFILE_SCOPE("WaitForFrame");
+			slot = m_frameFence.WaitForFrame();
 		}
+		if(slot < 0)
+		{
+			break;
+		}
+		m_renderIndex = slot;
 
-	}
-
-	// Reset our view
-	m_context->PSSetShaderResources( 0, 3, pSRV );
-}
-// ****************************************************************************
-// ****************************************************************************
-void RenderThreadFunc(void *data)
-{
-	while(!GetRenderThreadShutdown())
-	{
-		DWORD result = SetEvent(m_rendererReady);
-		_ASSERT(result != 0);
-
-		result = WaitForSingleObject(m_startRenderEvent,INFINITE);
-		_ASSERT(result == WAIT_OBJECT_0);
+		HX_PROFILE_SCOPE("RenderFrame");
 
 		// Set our samplers
 		m_context->PSSetSamplers(0, 1, &m_basicSampler);
@@ -1210,7 +951,7 @@ void RenderThreadFunc(void *data)
 		memcpy(&frameConstants->m_invViewMatrix, &invView.e, sizeof(Helix::Matrix4x4));
 
 		// Inverse view/proj
-		Helix::Matrix4x4 viewProj = viewMat * projMat;
+		Helix::Matrix4x4 viewProj = projMat * viewMat;
 		Helix::Matrix4x4 invViewProj = viewProj;
 		invViewProj.Invert();
 		memcpy(&frameConstants->m_invViewProj, &invViewProj.e, sizeof(Helix::Matrix4x4));
@@ -1268,23 +1009,72 @@ void RenderThreadFunc(void *data)
 		m_context->VSSetConstantBuffers(0, 1, &m_frameConstants);
 		m_context->PSSetConstantBuffers(0, 1, &m_frameConstants);
 
-		FillGBuffer();
-		DoLighting();
+		ScenePassFrame frame;
+		frame.draws = &m_frameDrawLists[m_renderIndex];
+		frame.lights = &m_renderLights[m_renderIndex];
+		frame.viewMatrix = viewMat;
+		frame.projMatrix = projMat;
+		frame.cameraNear = m_cameraNear;
+		frame.cameraFar = m_cameraFar;
+		frame.imageWidth = static_cast<float>(m_backbufferWidth);
+		frame.imageHeight = static_cast<float>(m_backbufferHeight);
+		m_scenePasses.SetFrame(frame);
 
-		m_swapChain->Present(0,0);
+		m_frameGraph.Execute();
 
-		// Delete all our render objects
-		RenderData *obj = m_submissionBuffers[m_renderIndex];
-		while(obj != NULL)
 		{
-			RenderData *nextObj = obj->next;
-			delete obj;
-			obj = nextObj;
+			HX_PROFILE_SCOPE("Present");
+			m_context->Present(0,0);
 		}
 
-		m_submissionBuffers[m_renderIndex] = NULL;
-
+		// Retire the frame.  Record what it cost before the arenas forget.
+		// Producers are writing the other index, so this frame's buffers in
+		// every bucket are ours to reset.
+		const ScenePassStats &passStats = m_scenePasses.FrameStats();
+		m_submissionStats.stateChanges = passStats.stateChanges;
+		m_submissionStats.stateChangesSaved = passStats.stateChangesSaved;
+		m_submissionStats.drawCalls = passStats.drawCalls;
+		m_submissionStats.instancedDraws = passStats.instancedDraws;
+		m_submissionStats.pointLightsDrawn = passStats.pointLightsDrawn;
+		m_submissionStats.lightScissorPixels = passStats.lightScissorPixels;
+		m_submissionStats.objectConstantBytes = passStats.objectConstantBytes;
+		m_submissionStats.objectConstantMaps = passStats.objectConstantMaps;
+
+		FrameDrawList &list = m_frameDrawLists[m_renderIndex];
+		m_submissionStats.numDraws = list.numDraws;
+		m_submissionStats.heapAllocations = list.arena.HeapAllocations();
+		m_submissionStats.arenaOverflows = list.arena.Overflows();
+		m_submissionStats.arenaBytesUsed = list.arena.BytesUsed();
+		m_submissionStats.arenaCapacity = list.arena.Capacity();
+		m_submissionStats.pipelineDepth = m_frameFence.GetDepth();
+		m_submissionStats.producerWaitMs = m_frameFence.ProducerWaitMs(m_renderIndex);
+		m_submissionStats.renderWaitMs = m_frameFence.ConsumerWaitMs(m_renderIndex);
+		m_submissionStats.contextCallsIssued = m_stateCache->LastFrameStats().issued;
+		m_submissionStats.contextCallsFiltered = m_stateCache->LastFrameStats().filtered;
+
+		HX_PROFILE_COUNTER("Draws", m_submissionStats.numDraws);
+		HX_PROFILE_COUNTER("Draw calls", m_submissionStats.drawCalls);
+		HX_PROFILE_COUNTER("Point lights drawn", m_submissionStats.pointLightsDrawn);
+
+		SubmittedFrameStats submitted;
+		RetireSubmitBuckets(m_renderIndex, submitted);
+		m_submissionStats.numSubmitThreads = submitted.numThreads;
+		m_submissionStats.heapAllocations += submitted.heapAllocations;
+		m_submissionStats.arenaOverflows += submitted.arenaOverflows;
+		m_submissionStats.arenaBytesUsed += submitted.arenaBytesUsed;
+		m_submissionStats.arenaCapacity += submitted.arenaCapacity;
+		m_submissionStats.trianglesSubmitted = submitted.numTriangles;
+		m_submissionStats.trianglesAvailable = submitted.fullTriangles;
+
+		HX_PROFILE_COUNTER("Triangles submitted", m_submissionStats.trianglesSubmitted);
+		HX_PROFILE_COUNTER("Triangles available", m_submissionStats.trianglesAvailable);
+
+		// The slot is free for the main thread again
+		m_frameFence.RetireFrame();
 	}
+
+	DWORD result = SetEvent(m_rendererExited);
+	_ASSERT(result != 0);
 }
 
 } // namespace Helix
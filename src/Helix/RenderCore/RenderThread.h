@@ -22,13 +22,48 @@ struct Flags
 namespace Helix {
 
 class Instance;
+class RenderDevice;
+class RenderContext;
+
+	// Per frame submission counters, captured when the render thread retires
+	// a frame.
+	struct SubmissionStats
+	{
+		unsigned int	numDraws;			// Draw records submitted
+		unsigned int	heapAllocations;	// Heap allocations made by the frame arena
+		unsigned int	arenaOverflows;		// Overflow blocks the frame arenas have ever needed
+		size_t			arenaBytesUsed;		// Bytes of the frame arena in use
+		size_t			arenaCapacity;		// Bytes reserved by the frame arena
+		unsigned int	stateChanges;		// Shader/material/mesh changes issued after sorting
+		unsigned int	drawCalls;			// G-buffer draw calls after instancing
+		unsigned int	instancedDraws;		// Draw records folded into instanced draw calls
+		unsigned int	stateChangesSaved;	// Changes the sort removed versus submission order
+		unsigned int	numSubmitThreads;	// Threads that submitted draws this frame
+		int				pipelineDepth;		// Frames allowed to queue up for the render thread
+		float			producerWaitMs;		// Time the main thread blocked on the frame fence
+		float			renderWaitMs;		// Time the render thread sat idle waiting for the frame
+		unsigned int	contextCallsIssued;		// State binds that reached the context
+		unsigned int	contextCallsFiltered;	// Redundant state binds the state cache dropped
+		unsigned int	pointLightsDrawn;		// Point lights with some part on screen
+		unsigned int	lightScissorPixels;		// Pixels inside the drawn lights' scissor rects
+		size_t			objectConstantBytes;	// Per object constants copied into the constant ring
+		unsigned int	objectConstantMaps;		// Map calls it took to get them there
+		unsigned int	trianglesSubmitted;		// Triangles in the levels of detail picked for the draws
+		unsigned int	trianglesAvailable;		// Triangles the same draws have at full detail
+	};
 
 	void	InitializeRenderer(ID3D11Device *dev, ID3D11DeviceContext *context, IDXGISwapChain *swapChain);
+	void	InitializeRenderer(RenderDevice *device, RenderContext *context);
 	bool	GetRenderThreadShutdown();
 	void	ShutDownRenderThread();
 	void	RenderScene();
 	bool	RenderThreadReady();
 
+	// Frame pipelining.  1 = lowest latency, 2-3 = more overlap between the
+	// main thread and the render thread.
+	void	SetFramePipelineDepth(int depth);
+	int		GetFramePipelineDepth();
+
 	int		SubmissionIndex();
 
 	// Set sunlight 
@@ -38,9 +73,16 @@ class Instance;
 	// Set ambient
 	void	SetAmbientColor(const DXGI_RGB &color);
 
+	// The camera picks each instance's level of detail, so submit it before
+	// the frame's instances
 	void	SubmitProjMatrix(Helix::Matrix4x4 &mat);
 	void	SubmitViewMatrix(Helix::Matrix4x4 &mat);
-	void	SubmitInstance(Instance &inst);
+	void	SubmitInstance(Instance &inst);		// Safe to call from any thread
+
+	// Most pixels a mesh level's error may cover before a finer level is used
+	void	SetLodErrorThreshold(float pixels);
+
+	const SubmissionStats &	GetSubmissionStats();
 
 
 } // namespace Helix
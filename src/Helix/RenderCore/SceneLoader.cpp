@@ -1,38 +1,119 @@
+#include <stdio.h>
 #include "SceneLoader.h"
+#include "MeshFile.h"
+#include "MeshListParser.h"
+#include "Utility/MappedFile.h"
+#include "Utility/Timer.h"
 
 namespace Helix {
 
+// ****************************************************************************
+// Every mesh in a cooked scene.  False if the file's unusable, in which case
+// nothing has been loaded from it.
+// ****************************************************************************
+bool LoadCookedScene(const std::string &cookedPath)
+{
+	MappedFile file;
+	if(!file.Open(cookedPath.c_str()))
+		return false;
+
+	unsigned int numMeshes = 0;
+	const MeshFileMesh *meshes = MeshFileMeshes(file.Data(), file.Size(), numMeshes);
+	if(numMeshes == 0)
+		return false;
+
+	for(unsigned int meshIndex=0;meshIndex < numMeshes; meshIndex++)
+	{
+		std::string meshName = meshes[meshIndex].name;
+
+		MeshManager::GetInstance().Load(meshName, meshes[meshIndex], file.Data());
+		Instance *inst = InstanceManager::GetInstance().CreateInstance(meshName);
+		inst->SetMeshName(meshName);
+	}
+
+	return true;
+}
+
+// ****************************************************************************
+// Scenes/<sceneName>.hxmesh holds the scene's meshes cooked, and is used as
+// long as it's at least as new as the .lua.  Otherwise the .lua is read,
+// by the MeshListParser or failing that by Lua, and cooked into it for next
+// time.
+// ****************************************************************************
 bool LoadScene(const std::string &sceneName)
 {
+	Timer timer;
+	timer.Start();
+
 	std::string fullPath;
 	fullPath = "Scenes/";
 	fullPath += sceneName;
-	fullPath += ".lua";
 
-	LuaPlus::LuaStateAuto state;
-	state = LuaPlus::LuaState::Create();
-	
-	int retVal = state->DoFile(fullPath.c_str());
-	_ASSERT(retVal==0);
+	std::string luaPath = fullPath + ".lua";
+	std::string cookedPath = fullPath + ".hxmesh";
 
-	LuaPlus::LuaObject meshList = state->GetGlobals()["MeshList"];
-	_ASSERT(meshList.IsTable());
+	uint64_t luaTime = FileWriteTime(luaPath.c_str());
+	uint64_t cookedTime = FileWriteTime(cookedPath.c_str());
+	bool cooked = cookedTime != 0 && cookedTime >= luaTime && LoadCookedScene(cookedPath);
 
-	int numMeshes = meshList.GetCount();
-	for(int meshIndex=1;meshIndex <= meshList.GetCount(); meshIndex++)
+	if(!cooked)
 	{
-		LuaPlus::LuaObject meshObj = meshList[meshIndex];
-		LuaPlus::LuaObject nameObj = meshObj["Name"];
-		_ASSERT(nameObj.IsString());
+		MeshFileWriter writer;
+		unsigned int numMeshes = 0;
 
-		std::string meshName = nameObj.GetString();
+		MeshListParser parser;
+		if(ParseMeshListFile(luaPath, parser))
+		{
+			numMeshes = parser.NumMeshes();
+			for(unsigned int meshIndex=0;meshIndex < numMeshes; meshIndex++)
+			{
+				const MeshSource &source = parser.GetMesh(meshIndex);
 
-		MeshManager::GetInstance().Load(meshName,meshObj);
-		Instance *inst = InstanceManager::GetInstance().CreateInstance(meshName);
-		inst->SetMeshName(meshName);
+				MeshManager::GetInstance().Load(source.name,source,&writer);
+				Instance *inst = InstanceManager::GetInstance().CreateInstance(source.name);
+				inst->SetMeshName(source.name);
+			}
+		}
+		else
+		{
+			LuaPlus::LuaStateAuto state;
+			state = LuaPlus::LuaState::Create();
+
+			int retVal = state->DoFile(luaPath.c_str());
+			_ASSERT(retVal==0);
+
+			LuaPlus::LuaObject meshList = state->GetGlobals()["MeshList"];
+			_ASSERT(meshList.IsTable());
+
+			numMeshes = meshList.GetCount();
+			for(unsigned int meshIndex=1;meshIndex <= numMeshes; meshIndex++)
+			{
+				LuaPlus::LuaObject meshObj = meshList[meshIndex];
+				LuaPlus::LuaObject nameObj = meshObj["Name"];
+				_ASSERT(nameObj.IsString());
 
+				std::string meshName = nameObj.GetString();
+
+				MeshManager::GetInstance().Load(meshName,meshObj,&writer);
+				Instance *inst = InstanceManager::GetInstance().CreateInstance(meshName);
+				inst->SetMeshName(meshName);
+
+			}
+		}
+
+		// Meshes some earlier load already made never reach the writer
+		if(writer.NumMeshes() == numMeshes)
+		{
+			writer.Write(cookedPath.c_str());
+		}
 	}
 
+	timer.Stop();
+
+	char buffer[256];
+	_snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "LoadScene %s: %.2f ms from %s\n", sceneName.c_str(), timer.ElapsedMilliseconds(), cooked ? cookedPath.c_str() : luaPath.c_str());
+	OutputDebugString(buffer);
+
 	return true;
 }
-} // namespace Helix
\ No newline at end of file
+} // namespace Helix
@@ -0,0 +1,687 @@
+#include <string.h>
+#include "ScenePasses.h"
+#include "Light.h"
+#include "LightBounds.h"
+#include "Materials.h"
+#include "MeshLod.h"
+#include "Shaders.h"
+#include "SortKey.h"
+#include "SubmitQueue.h"
+#include "Textures.h"
+#include "VDecls.h"
+#include "Utility/bits.h"
+#include "Utility/Profiler.h"
+#include "Utility/Sort/RadixSort.h"
+
+namespace Helix {
+
+struct INSTANCE_DATA
+{
+	Helix::Matrix4x4		m_worldViewMatrix;
+};
+
+const unsigned int	MIN_INSTANCE_BUFFER_SIZE = 1024;
+const unsigned int	MIN_INSTANCE_RUN = 2;			// Shorter runs aren't worth the second stream
+
+struct POINTLIGHT_CONSTANTS
+{
+	Helix::Vector4	m_pointLoc;
+	Helix::Vector4	m_pointColor;
+	float			m_lightRadius;
+};
+
+struct QuadVert {
+	float	pos[3];
+	float	uv[2];
+};
+
+// A stretch of the sorted draw list that's issued with one draw call
+struct ScenePasses::DrawRun
+{
+	unsigned int		first;			// Index into the sorted order
+	unsigned int		count;
+	unsigned int		startInstance;	// First entry in the instance buffer
+	unsigned int		constantBlock;	// Block in the object constant ring, if not instanced
+	bool				instanced;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+ScenePasses::ScenePasses()
+: m_device(NULL)
+, m_context(NULL)
+, m_quadVB(NULL)
+, m_quadIB(NULL)
+, m_objectConstants(NULL)
+, m_lightingConstants(NULL)
+, m_instanceBuffer(NULL)
+, m_instanceBufferSize(0)
+, m_lightBounds(NULL)
+, m_lightBoundsSize(0)
+{
+	memset(&m_states, 0, sizeof(m_states));
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_frame.draws = NULL;
+	m_frame.lights = NULL;
+	m_frame.cameraNear = 0.0f;
+	m_frame.cameraFar = 0.0f;
+	m_frame.imageWidth = 0.0f;
+	m_frame.imageHeight = 0.0f;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+ScenePasses::~ScenePasses()
+{
+	_ASSERT(m_device == NULL);
+	delete [] m_lightBounds;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ScenePasses::Initialize(RenderDevice *device, RenderContext *context, const ScenePassStates &states)
+{
+	_ASSERT(m_device == NULL);
+	_ASSERT(device != NULL && context != NULL);
+	_ASSERT(states.lightShader != NULL);
+	m_device = device;
+	m_context = context;
+	m_states = states;
+
+	CreateQuad();
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	bufferDesc.ByteWidth = Align<16>(sizeof( CONSTANT_BUFFER_OBJECT ));
+	HRESULT hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_objectConstants );
+	_ASSERT( SUCCEEDED( hr ) );
+
+	bufferDesc.ByteWidth = Align<16>(sizeof(POINTLIGHT_CONSTANTS));
+	hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_lightingConstants );
+	_ASSERT( SUCCEEDED( hr ) );
+
+	m_objectConstantRing.Initialize(m_device, m_context, sizeof(CONSTANT_BUFFER_OBJECT), MIN_DRAWS_PER_FRAME);
+	_ASSERT(m_objectConstantRing.BlocksPerBuffer() <= MAX_OBJECT_BLOCKS);
+}
+
+// ****************************************************************************
+// Releases the buffers made here.  The states were only borrowed.
+// ****************************************************************************
+void ScenePasses::Release()
+{
+	if(m_device == NULL)
+		return;
+
+	m_objectConstantRing.Release();
+
+	ID3D11Buffer **buffers[] = { &m_quadVB, &m_quadIB, &m_objectConstants, &m_lightingConstants, &m_instanceBuffer };
+	for(unsigned int i=0;i<sizeof(buffers) / sizeof(buffers[0]);i++)
+	{
+		if(*buffers[i] != NULL)
+		{
+			m_device->Release(*buffers[i]);
+			*buffers[i] = NULL;
+		}
+	}
+	m_instanceBufferSize = 0;
+
+	m_device = NULL;
+	m_context = NULL;
+}
+
+// ****************************************************************************
+// Full screen quad the light shader scissors down to each light
+// ****************************************************************************
+void ScenePasses::CreateQuad()
+{
+	QuadVert quadVerts[4];
+
+	quadVerts[0].pos[0] = -1.0f;
+	quadVerts[0].pos[1] = -1.0f;
+	quadVerts[0].pos[2] = 0.5f;
+	quadVerts[0].uv[0] = 0.0f;
+	quadVerts[0].uv[1] = 1.0f;
+
+	quadVerts[1].pos[0] = -1.0f;
+	quadVerts[1].pos[1] = 1.0f;
+	quadVerts[1].pos[2] = 0.5f;
+	quadVerts[1].uv[0] = 0.0f;
+	quadVerts[1].uv[1] = 0.0f;
+
+	quadVerts[2].pos[0] = 1.0f;
+	quadVerts[2].pos[1] = 1.0f;
+	quadVerts[2].pos[2] = 0.5f;
+	quadVerts[2].uv[0] = 1.0f;
+	quadVerts[2].uv[1] = 0.0f;
+
+	quadVerts[3].pos[0] = 1.0f;
+	quadVerts[3].pos[1] = -1.0f;
+	quadVerts[3].pos[2] = 0.5f;
+	quadVerts[3].uv[0] = 1.0f;
+	quadVerts[3].uv[1] = 1.0f;
+
+	D3D11_BUFFER_DESC bufferDesc = {0};
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = sizeof(quadVerts);
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+
+	// Data initialization descriptor
+	D3D11_SUBRESOURCE_DATA initData = {0};
+	initData.pSysMem = &quadVerts;
+	initData.SysMemPitch = 0;
+	initData.SysMemSlicePitch = 0;
+
+	// Create the buffer
+	HRESULT hr = m_device->CreateBuffer(&bufferDesc,&initData,&m_quadVB);
+	_ASSERT( SUCCEEDED(hr) );
+
+	// Create our index buffer
+	unsigned short ibData[4] = { 1, 2, 0, 3 };
+
+	// Create the index buffer
+	memset(&bufferDesc,0,sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = sizeof(ibData);
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	
+	// Data initialization descriptor
+	memset(&initData,0,sizeof(initData));
+	initData.pSysMem = ibData;
+	initData.SysMemPitch = 0;
+	initData.SysMemSlicePitch = 0;
+
+	hr = m_device->CreateBuffer(&bufferDesc,&initData,&m_quadIB);
+	_ASSERT( SUCCEEDED(hr) );
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void SetMaterialParameters(RenderContext *context, HXMaterial *mat)
+{
+	HXTexture *tex = mat->m_texture;
+
+	if( tex != NULL)
+	{
+		// Mesh that only uses render targets as input textures
+		// may not have a texture
+		ID3D11ShaderResourceView *textureRV = tex->m_shaderView;
+		context->PSSetShaderResources(0, 1, &textureRV);
+	}
+}
+
+// ****************************************************************************
+// Counts how many times the shader, material or mesh changes when the draws
+// are issued in the given order.  A NULL order means submission order.
+// ****************************************************************************
+unsigned int CountStateChanges(RenderData * const *draws, const uint32_t *order, unsigned int numDraws)
+{
+	unsigned int changes = 0;
+	const RenderData *prev = NULL;
+	for(unsigned int index = 0; index < numDraws; index++)
+	{
+		const RenderData *obj = draws[order != NULL ? order[index] : index];
+		if(prev == NULL || obj->shader != prev->shader)
+			changes++;
+		if(prev == NULL || obj->material != prev->material)
+			changes++;
+		if(prev == NULL || obj->lod != prev->lod)
+			changes++;
+		prev = obj;
+	}
+	return changes;
+}
+
+// ****************************************************************************
+// Fills in the depth part of every draw's sort key and radix sorts the frame.
+// Returns the draw order as indices into list.draws.  Scratch space comes
+// out of the frame's arena so it goes away when the frame retires.
+// ****************************************************************************
+uint32_t * ScenePasses::SortDrawList(FrameDrawList &list)
+{
+	HX_PROFILE_SCOPE("SortDrawList");
+
+	unsigned int numDraws = list.numDraws;
+	uint64_t *keys = list.arena.Alloc<uint64_t>(numDraws);
+	uint64_t *tmpKeys = list.arena.Alloc<uint64_t>(numDraws);
+	uint32_t *order = list.arena.Alloc<uint32_t>(numDraws);
+	uint32_t *tmpOrder = list.arena.Alloc<uint32_t>(numDraws);
+
+	// Only the view space z of each object's origin is needed for the depth,
+	// and that's already sitting in its world view matrix.  For quantized
+	// meshes it's the corner of their bounds instead, which sorts as well.
+	for(unsigned int index = 0; index < numDraws; index++)
+	{
+		float viewZ = list.constants[index].m_worldViewMatrix.r[2][3];
+		keys[index] = SetSortKeyDepth(list.draws[index]->sortKey, viewZ, m_frame.cameraNear, m_frame.cameraFar);
+		order[index] = index;
+	}
+
+	RadixSort64(keys, order, tmpKeys, tmpOrder, numDraws);
+
+	unsigned int unsortedChanges = CountStateChanges(list.draws, NULL, numDraws);
+	unsigned int sortedChanges = CountStateChanges(list.draws, order, numDraws);
+	m_stats.stateChanges = sortedChanges;
+	m_stats.stateChangesSaved = unsortedChanges > sortedChanges ? unsortedChanges - sortedChanges : 0;
+
+	return order;
+}
+
+// ****************************************************************************
+// Splits the sorted draws into runs that share mesh, material and shader.
+// Mesh, material and shader sit above depth in the sort key, so identical
+// draws are always adjacent.  A run is drawn instanced if it's long enough
+// and its shader has an instanced variant; otherwise each draw is its own run.
+// ****************************************************************************
+ScenePasses::DrawRun * ScenePasses::BuildDrawRuns(FrameDrawList &list, const uint32_t *order, unsigned int &numRuns)
+{
+	DrawRun *runs = list.arena.Alloc<DrawRun>(list.numDraws);
+	numRuns = 0;
+
+	unsigned int index = 0;
+	while(index < list.numDraws)
+	{
+		const RenderData *first = list.draws[order[index]];
+		unsigned int count = 1;
+		while(index + count < list.numDraws)
+		{
+			const RenderData *obj = list.draws[order[index + count]];
+			if(obj->lod != first->lod || obj->material != first->material || obj->shader != first->shader)
+				break;
+			count++;
+		}
+
+		if(count >= MIN_INSTANCE_RUN && first->shader->m_instanceVShader != NULL)
+		{
+			DrawRun &run = runs[numRuns++];
+			run.first = index;
+			run.count = count;
+			run.startInstance = 0;
+			run.constantBlock = 0;
+			run.instanced = true;
+		}
+		else
+		{
+			for(unsigned int i=0;i<count;i++)
+			{
+				DrawRun &run = runs[numRuns++];
+				run.first = index + i;
+				run.count = 1;
+				run.startInstance = 0;
+				run.constantBlock = 0;
+				run.instanced = false;
+			}
+		}
+
+		index += count;
+	}
+
+	return runs;
+}
+
+// ****************************************************************************
+// Grows the instance buffer to hold at least numInstances.  The old contents
+// are thrown away; the buffer is refilled every frame anyway.
+// ****************************************************************************
+void ScenePasses::ReserveInstanceBuffer(unsigned int numInstances)
+{
+	if(numInstances <= m_instanceBufferSize)
+		return;
+
+	unsigned int size = m_instanceBufferSize > MIN_INSTANCE_BUFFER_SIZE ? m_instanceBufferSize : MIN_INSTANCE_BUFFER_SIZE;
+	while(size < numInstances)
+	{
+		size *= 2;
+	}
+
+	if(m_instanceBuffer != NULL)
+	{
+		m_device->Release(m_instanceBuffer);
+		m_instanceBuffer = NULL;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.ByteWidth = size * sizeof(INSTANCE_DATA);
+	HRESULT hr = m_device->CreateBuffer( &bufferDesc, NULL, &m_instanceBuffer );
+	_ASSERT( SUCCEEDED( hr ) );
+
+	m_instanceBufferSize = size;
+}
+
+// ****************************************************************************
+// Writes the world view matrix of every instanced draw into the instance
+// buffer with a single map, and hands each run its first instance.  Returns
+// the number of instances written.
+// ****************************************************************************
+unsigned int ScenePasses::FillInstanceBuffer(FrameDrawList &list, const uint32_t *order, DrawRun *runs, unsigned int numRuns)
+{
+	HX_PROFILE_SCOPE("FillInstanceBuffer");
+
+	unsigned int numInstances = 0;
+	for(unsigned int runIndex = 0; runIndex < numRuns; runIndex++)
+	{
+		if(runs[runIndex].instanced)
+		{
+			runs[runIndex].startInstance = numInstances;
+			numInstances += runs[runIndex].count;
+		}
+	}
+
+	if(numInstances == 0)
+		return 0;
+
+	ReserveInstanceBuffer(numInstances);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT hr = m_context->Map(m_instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	_ASSERT( SUCCEEDED( hr ) );
+	INSTANCE_DATA *instances = reinterpret_cast<INSTANCE_DATA *>(mappedResource.pData);
+
+	for(unsigned int runIndex = 0; runIndex < numRuns; runIndex++)
+	{
+		const DrawRun &run = runs[runIndex];
+		if(!run.instanced)
+			continue;
+
+		_ASSERT(list.draws[order[run.first]]->shader->m_instanceDecl->m_instanceSize == sizeof(INSTANCE_DATA));
+		for(unsigned int i=0;i<run.count;i++)
+		{
+			instances[run.startInstance + i].m_worldViewMatrix = list.constants[order[run.first + i]].m_worldViewMatrix;
+		}
+	}
+
+	m_context->Unmap(m_instanceBuffer, 0);
+
+	return numInstances;
+}
+
+// ****************************************************************************
+// Writes the per object constants of every draw that isn't instanced into
+// the constant ring, in draw order, and hands each run its block.  The
+// blocks were built during submission, so this is just the copy.
+// ****************************************************************************
+void ScenePasses::UploadObjectConstants(FrameDrawList &list, const uint32_t *order, DrawRun *runs, unsigned int numRuns)
+{
+	HX_PROFILE_SCOPE("UploadObjectConstants");
+
+	unsigned int numBlocks = 0;
+	for(unsigned int runIndex = 0; runIndex < numRuns; runIndex++)
+	{
+		if(!runs[runIndex].instanced)
+		{
+			runs[runIndex].constantBlock = numBlocks++;
+		}
+	}
+
+	m_objectConstantRing.BeginFrame(numBlocks);
+	for(unsigned int runIndex = 0; runIndex < numRuns; runIndex++)
+	{
+		const DrawRun &run = runs[runIndex];
+		if(!run.instanced)
+		{
+			m_objectConstantRing.WriteBlock(run.constantBlock, &list.constants[order[run.first]]);
+		}
+	}
+	m_objectConstantRing.EndFrame();
+
+	const ConstantRingStats &ringStats = m_objectConstantRing.FrameStats();
+	m_stats.objectConstantBytes = ringStats.bytesUploaded;
+	m_stats.objectConstantMaps = ringStats.mapCalls;
+}
+
+// ****************************************************************************
+// GBuffer pass.  The frame graph has already cleared and bound the targets.
+// ****************************************************************************
+void ScenePasses::FillGBuffer(void *data)
+{
+	HX_PROFILE_SCOPE("FillGBuffer");
+
+	reinterpret_cast<ScenePasses *>(data)->DrawGBuffer();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ScenePasses::DrawGBuffer()
+{
+	m_context->OMSetDepthStencilState(m_states.gbufferDepthStencil,0);
+	float blendFactor[4] = {0,0,0,0};
+	m_context->OMSetBlendState(m_states.gbufferBlend,blendFactor,0xffffffff);
+
+	// Go through all of our render objects in state order
+	FrameDrawList &list = *m_frame.draws;
+	uint32_t *drawOrder = SortDrawList(list);
+
+	// Fold runs that share state into instanced draws and stream their
+	// matrices up in one go before drawing anything
+	unsigned int numRuns = 0;
+	DrawRun *runs = BuildDrawRuns(list, drawOrder, numRuns);
+	unsigned int numInstances = FillInstanceBuffer(list, drawOrder, runs, numRuns);
+	UploadObjectConstants(list, drawOrder, runs, numRuns);
+
+	m_stats.drawCalls = numRuns;
+	m_stats.instancedDraws = numInstances;
+
+	for(unsigned int runIndex = 0; runIndex < numRuns; runIndex++)
+	{
+		const DrawRun &run = runs[runIndex];
+		RenderData *obj = list.draws[drawOrder[run.first]];
+
+		// Set the parameters
+		HXMaterial *mat = obj->material;
+		SetMaterialParameters(m_context, mat);
+
+		// Set our input assembly buffers
+		const MeshLod *lod = obj->lod;
+		HXShader *shader = obj->shader;
+		ID3D11Buffer *vb = lod->vertexBuffer;
+		unsigned int objectIndex = 0;
+
+		if(run.instanced)
+		{
+			// Set the input layout
+			m_context->IASetInputLayout(shader->m_instanceDecl->m_layout);
+
+			// Mesh vertices in slot 0, one world view matrix per instance in slot 1
+			ID3D11Buffer *vbs[2] = { vb, m_instanceBuffer };
+			unsigned int strides[2] = { static_cast<unsigned int>(shader->m_instanceDecl->m_vertexSize), static_cast<unsigned int>(shader->m_instanceDecl->m_instanceSize) };
+			unsigned int offsets[2] = { 0, 0 };
+			m_context->IASetVertexBuffers(0,2,vbs,strides,offsets);
+			m_context->VSSetShader(shader->m_instanceVShader);
+		}
+		else
+		{
+			// Per object constants.  What's bound may hold other draws'
+			// blocks too, so the draw's index in it goes in as the start
+			// instance and comes back out of the block index stream.
+			objectIndex = m_objectConstantRing.Bind(run.constantBlock, OBJECT_BLOCKS_SLOT);
+
+			// Set the input layout
+			m_context->IASetInputLayout(shader->m_decl->m_layout);
+
+			// Mesh vertices in slot 0, block indices in slot 1
+			ID3D11Buffer *vbs[2] = { vb, m_objectConstantRing.BlockIndices() };
+			unsigned int strides[2] = { static_cast<unsigned int>(shader->m_decl->m_vertexSize), sizeof(uint32_t) };
+			unsigned int offsets[2] = { 0, 0 };
+			m_context->IASetVertexBuffers(0,2,vbs,strides,offsets);
+			m_context->VSSetShader(shader->m_vshader);
+		}
+		m_context->IASetIndexBuffer(lod->indexBuffer, lod->indices32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+
+		// Set our prim type
+		m_context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+
+		// Set the rest of our shader
+		m_context->PSSetShader(shader->m_pshader);
+		m_context->GSSetShader(NULL);
+		m_context->DSSetShader(NULL);
+		m_context->HSSetShader(NULL);
+
+		// Draw
+		if(run.instanced)
+		{
+			m_context->DrawIndexedInstanced( lod->numIndices, run.count, 0, 0, run.startInstance );
+		}
+		else
+		{
+			m_context->DrawIndexedInstanced( lod->numIndices, 1, 0, 0, objectIndex );
+		}
+	}
+}
+
+// ****************************************************************************
+// Grows the per light screen bounds to hold at least numLights
+// ****************************************************************************
+void ScenePasses::ReserveLightBounds(unsigned int numLights)
+{
+	if(numLights <= m_lightBoundsSize)
+		return;
+
+	unsigned int size = m_lightBoundsSize > 0 ? m_lightBoundsSize : 256;
+	while(size < numLights)
+	{
+		size *= 2;
+	}
+
+	delete [] m_lightBounds;
+	m_lightBounds = new LightScreenBounds[size];
+	m_lightBoundsSize = size;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ScenePasses::RenderPointLight(const LightList &lights, unsigned int index, const LightScreenBounds &bounds)
+{
+	float blendFactor[4] = {0,0,0,0};
+	m_context->OMSetBlendState(m_states.lightingBlend,blendFactor,0xffffffff);
+
+	Helix::Vector4 lightPos(lights.PositionX()[index], lights.PositionY()[index], lights.PositionZ()[index], 1.0f);
+
+	// Constants
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+
+	// Set vertex shader point light constants
+	HRESULT hr = m_context->Map(m_objectConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	_ASSERT(SUCCEEDED(hr)) ;
+
+	m_context->Unmap(m_objectConstants, 0);
+	m_context->VSSetConstantBuffers(1, 1, &m_objectConstants);
+
+	// Set pixel shader point light constants
+	hr = m_context->Map(m_lightingConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	_ASSERT(SUCCEEDED(hr)) ;
+
+	POINTLIGHT_CONSTANTS *plConstants = reinterpret_cast<POINTLIGHT_CONSTANTS *>(mappedResource.pData);
+
+	// Position
+	plConstants->m_pointLoc.x = lightPos.x;
+	plConstants->m_pointLoc.y = lightPos.y;
+	plConstants->m_pointLoc.z = lightPos.z;
+	plConstants->m_pointLoc.w = 1.0f;
+
+	// Color
+	plConstants->m_pointColor.x = lights.ColorR()[index];
+	plConstants->m_pointColor.y = lights.ColorG()[index];
+	plConstants->m_pointColor.z = lights.ColorB()[index];
+	plConstants->m_pointColor.w = 1.0f;
+
+	// Light radius
+	plConstants->m_lightRadius = lights.OuterRadius()[index];
+
+	m_context->Unmap(m_lightingConstants,0);
+	m_context->PSSetConstantBuffers(3,1,&m_lightingConstants);
+
+	HXShader *shader = m_states.lightShader;
+
+	// Set the input layout
+	m_context->IASetInputLayout(shader->m_decl->m_layout);
+
+	// Set our IB/VB
+	unsigned int stride = shader->m_decl->m_vertexSize;
+	unsigned int offset = 0;
+	m_context->IASetVertexBuffers(0, 1, &m_quadVB, &stride, &offset);
+	m_context->IASetIndexBuffer(m_quadIB, DXGI_FORMAT_R16_UINT, 0);
+
+	// Set our prim type
+	m_context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP );
+
+	// Set our states
+	m_context->RSSetState(m_states.lightRasterizer);
+	m_context->RSSetScissorRects(1, &bounds.rect);
+
+	// Set the shaders
+	m_context->VSSetShader(shader->m_vshader);
+	m_context->PSSetShader(shader->m_pshader);
+	m_context->HSSetShader(NULL);
+	m_context->GSSetShader(NULL);
+	m_context->DSSetShader(NULL);
+
+	// Draw
+	m_context->DrawIndexed(4, 0, 0);
+}
+
+// ****************************************************************************
+// Lighting pass.  The frame graph has already cleared and bound the back
+// buffer, with the GBuffer's depth/stencil for testing, and bound albedo,
+// normal and depth to slots 0-2.
+// ****************************************************************************
+void ScenePasses::DoLighting(void *data)
+{
+	HX_PROFILE_SCOPE("DoLighting");
+
+	reinterpret_cast<ScenePasses *>(data)->DrawLights();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ScenePasses::DrawLights()
+{
+	m_context->OMSetDepthStencilState(m_states.lightingDepthStencil,0);
+
+	// Find where each light lands on screen
+	const LightList &lights = *m_frame.lights;
+	unsigned int numLights = lights.Count();
+	ReserveLightBounds(numLights);
+	ComputeLightScreenBounds(lights, m_frame.viewMatrix, m_frame.projMatrix, m_frame.imageWidth, m_frame.imageHeight, m_lightBounds);
+
+	// Go render all lights
+	m_stats.pointLightsDrawn = 0;
+	m_stats.lightScissorPixels = 0;
+	for(unsigned int iLightIndex=0;iLightIndex < numLights; iLightIndex++)
+	{
+		const LightScreenBounds &bounds = m_lightBounds[iLightIndex];
+
+		// Off screen or behind the camera
+		if(bounds.rect.left >= bounds.rect.right)
+			continue;
+
+		switch(lights.Type(iLightIndex))
+		{
+			case Light::POINT:
+				RenderPointLight(lights, iLightIndex, bounds);
+				m_stats.pointLightsDrawn++;
+				m_stats.lightScissorPixels += (bounds.rect.right - bounds.rect.left) * (bounds.rect.bottom - bounds.rect.top);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// Nothing else expects scissoring
+	m_context->RSSetState(m_states.rasterizer);
+}
+
+} // namespace Helix
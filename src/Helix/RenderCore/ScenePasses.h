@@ -0,0 +1,149 @@
+#ifndef SCENEPASSES_H
+#define SCENEPASSES_H
+
+#include "Math/Matrix.h"
+#include "Utility/Memory/LinearAlloc.h"
+#include "ConstantRing.h"
+#include "RenderDevice.h"
+
+struct HXShader;
+
+namespace Helix {
+
+class LightList;
+struct LightScreenBounds;
+struct RenderData;
+
+// Per object constants, one block of shared.hlsl's VSObjectBlocks
+struct CONSTANT_BUFFER_OBJECT
+{
+	Helix::Matrix4x4		m_worldViewMatrix;
+	Helix::Matrix4x4		m_worldViewIT;
+	Helix::Matrix4x4		m_invWorldViewProj;
+};
+
+const unsigned int	OBJECT_BLOCKS_SLOT = 3;		// VSObjectBlocks in shared.hlsl
+const unsigned int	MAX_OBJECT_BLOCKS = 341;	// Its OBJECT_BLOCKS
+
+// What the render thread consumes.  RenderScene() gathers pointers to every
+// bucket's records for the frame into one list; the records themselves stay
+// where the producers wrote them.  The per object constants are worked out
+// for the whole list before the render thread sees it, one per draw in the
+// same order.
+struct FrameDrawList
+{
+	LinearAllocator				arena;
+	RenderData **				draws;
+	CONSTANT_BUFFER_OBJECT *	constants;
+	unsigned int				numDraws;
+};
+
+// The states and light shader the passes draw with.  Whoever owns the device
+// makes them, so the passes never build D3D descs or load anything.
+struct ScenePassStates
+{
+	ID3D11RasterizerState *		rasterizer;				// Put back after the lighting pass
+	ID3D11RasterizerState *		lightRasterizer;		// rasterizer with scissoring, for light quads
+	ID3D11BlendState *			gbufferBlend;
+	ID3D11DepthStencilState *	gbufferDepthStencil;
+	ID3D11BlendState *			lightingBlend;
+	ID3D11DepthStencilState *	lightingDepthStencil;
+	HXShader *					lightShader;
+};
+
+// One frame for the passes to draw
+struct ScenePassFrame
+{
+	FrameDrawList *		draws;
+	const LightList *	lights;
+	Helix::Matrix4x4	viewMatrix;
+	Helix::Matrix4x4	projMatrix;
+	float				cameraNear;
+	float				cameraFar;
+	float				imageWidth;
+	float				imageHeight;
+};
+
+// What the last frame's passes did
+struct ScenePassStats
+{
+	unsigned int	stateChanges;			// Shader/material/mesh changes issued after sorting
+	unsigned int	stateChangesSaved;		// Changes the sort removed versus submission order
+	unsigned int	drawCalls;				// G-buffer draw calls after instancing
+	unsigned int	instancedDraws;			// Draw records folded into instanced draw calls
+	unsigned int	pointLightsDrawn;		// Point lights with some part on screen
+	unsigned int	lightScissorPixels;		// Pixels inside the drawn lights' scissor rects
+	size_t			objectConstantBytes;	// Per object constants copied into the constant ring
+	unsigned int	objectConstantMaps;		// Map calls it took to get them there
+};
+
+// ****************************************************************************
+// ScenePasses
+//
+// The GBuffer and lighting passes: sorting a frame's draws, folding them into
+// instanced draws, streaming their constants up and issuing them, then a
+// scissored quad per point light.  Everything goes through RenderContext, so
+// they run on any backend, the null one included.  FillGBuffer() and
+// DoLighting() are frame graph pass functions that take the ScenePasses as
+// their data; the graph binds the targets around them.
+// ****************************************************************************
+class ScenePasses
+{
+public:
+	ScenePasses();
+	~ScenePasses();
+
+	// Makes the buffers the passes own.  The states are borrowed and have to
+	// outlive the passes.
+	void	Initialize(RenderDevice *device, RenderContext *context, const ScenePassStates &states);
+	void	Release();
+
+	// The frame the next FillGBuffer() and DoLighting() draw.  Everything it
+	// points to has to stay put until they're done.
+	void	SetFrame(const ScenePassFrame &frame)	{ m_frame = frame; }
+
+	static void	FillGBuffer(void *data);
+	static void	DoLighting(void *data);
+
+	const ScenePassStats &	FrameStats() const	{ return m_stats; }
+
+private:
+	ScenePasses(const ScenePasses &other);
+	ScenePasses & operator=(const ScenePasses &other);
+
+	struct DrawRun;
+
+	void			CreateQuad();
+	void			DrawGBuffer();
+	void			DrawLights();
+	uint32_t *		SortDrawList(FrameDrawList &list);
+	DrawRun *		BuildDrawRuns(FrameDrawList &list, const uint32_t *order, unsigned int &numRuns);
+	void			ReserveInstanceBuffer(unsigned int numInstances);
+	unsigned int	FillInstanceBuffer(FrameDrawList &list, const uint32_t *order, DrawRun *runs, unsigned int numRuns);
+	void			UploadObjectConstants(FrameDrawList &list, const uint32_t *order, DrawRun *runs, unsigned int numRuns);
+	void			ReserveLightBounds(unsigned int numLights);
+	void			RenderPointLight(const LightList &lights, unsigned int index, const LightScreenBounds &bounds);
+
+	RenderDevice *		m_device;
+	RenderContext *		m_context;
+	ScenePassStates		m_states;
+	ScenePassFrame		m_frame;
+	ScenePassStats		m_stats;
+
+	ID3D11Buffer *		m_quadVB;
+	ID3D11Buffer *		m_quadIB;
+	ID3D11Buffer *		m_objectConstants;
+	ID3D11Buffer *		m_lightingConstants;
+	ConstantRing		m_objectConstantRing;		// Per draw blocks for the G-buffer pass
+
+	// Per instance stream for instanced draws, refilled every frame
+	ID3D11Buffer *		m_instanceBuffer;
+	unsigned int		m_instanceBufferSize;		// In instances
+
+	LightScreenBounds *	m_lightBounds;
+	unsigned int		m_lightBoundsSize;
+};
+
+} // namespace Helix
+
+#endif // SCENEPASSES_H
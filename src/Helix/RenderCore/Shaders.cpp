@@ -1,12 +1,16 @@
 #include <D3Dcompiler.h>
 #include "Shaders.h"
 #include "RenderMgr.h"
+#include "RenderDevice.h"
 #include "ThreadLoad/ThreadLoad.h"
 
 typedef std::map<const std::string, HXShader *>	ShaderMap;
 struct ShaderState
 {
+	ShaderState() : m_nextId(0) {}
+
 	ShaderMap			m_shaderMap;
+	unsigned int		m_nextId;
 };
 
 ShaderState *	m_shaderState = NULL;
@@ -107,7 +111,7 @@ void HXLoadShader(HXShader &shader, LuaPlus::LuaObject &shaderObj)
 	dwShaderFlags |= D3DCOMPILE_WARNINGS_ARE_ERRORS | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
 #endif
 
-	ID3D11Device *pDevice = Helix::RenderMgr::GetInstance().GetDevice();
+	Helix::RenderDevice *pDevice = Helix::RenderMgr::GetInstance().GetRenderDevice();
 
 	// Load the .hlsl file
 	HANDLE hFile = CreateFile(fxPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -123,49 +127,55 @@ void HXLoadShader(HXShader &shader, LuaPlus::LuaObject &shaderObj)
 
 	// Compile the .hlsl into our vertex and pixel shaders
 	// Compile the vertex shader
-	ID3DBlob *errorBlob = NULL;
-	ID3DBlob *pShaderBlob = NULL;
+	uint8_t *bytecode = NULL;
+	size_t bytecodeSize = 0;
 
 	// Compile vertex shader
-	HRESULT hr = D3DCompile(shaderBuffer, fileSize, "Shaders\\", NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, vsEntry.c_str(), vsProfile.c_str(), dwShaderFlags, 0, &pShaderBlob, &errorBlob);
-	if(hr != S_OK)
-	{
-		// Display any errors
-		OutputDebugString(static_cast<char *>(errorBlob->GetBufferPointer()) );
-	}
+	HRESULT hr = pDevice->CompileShader(shaderBuffer, fileSize, vsEntry.c_str(), vsProfile.c_str(), dwShaderFlags, &bytecode, &bytecodeSize);
 	_ASSERT(hr == S_OK);
-	if(errorBlob)
-		errorBlob->Release();
-	errorBlob = NULL;
 
 	// Create vertex shader
-	hr = pDevice->CreateVertexShader(pShaderBlob->GetBufferPointer(), pShaderBlob->GetBufferSize(), NULL, &shader.m_vshader);
+	hr = pDevice->CreateVertexShader(bytecode, bytecodeSize, &shader.m_vshader);
 	_ASSERT(hr == S_OK);
 
 	// Create the layout for the vertex shader
-	HXDeclBuildLayout(*(shader.m_decl),pShaderBlob);
+	HXDeclBuildLayout(*(shader.m_decl), bytecode, bytecodeSize);
 
-	// Compile the pixel shader
-	pShaderBlob->Release();
-	pShaderBlob = NULL;
-	hr = D3DCompile(shaderBuffer, fileSize, "Shaders\\", NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, psEntry.c_str(), psProfile.c_str(), dwShaderFlags, 0, &pShaderBlob, &errorBlob);
-	//hr = D3DX11CompileFromFile(fxPath.c_str(), NULL, NULL, psEntry.c_str(), psProfile.c_str(), dwShaderFlags, 0, NULL, &pShaderBlob, &errorBlob, NULL);
-	if(hr != S_OK)	
+	// Compile the instanced vertex shader if there is one
+	obj = shaderObj["InstancedVSEntry"];
+	if(obj.IsString())
 	{
-		// Display any errors that occurred
-		OutputDebugString(static_cast<char *>(errorBlob->GetBufferPointer()) );
+		std::string instancedVSEntry = obj.GetString();
+
+		obj = shaderObj["InstancedDeclaration"];
+		_ASSERT(obj.IsString());
+		shader.m_instanceDecl = HXLoadVertexDecl(obj.GetString());
+		_ASSERT(shader.m_instanceDecl);
+		_ASSERT(shader.m_instanceDecl->m_instanceSize > 0);
+
+		delete [] bytecode;
+		bytecode = NULL;
+		hr = pDevice->CompileShader(shaderBuffer, fileSize, instancedVSEntry.c_str(), vsProfile.c_str(), dwShaderFlags, &bytecode, &bytecodeSize);
+		_ASSERT(hr == S_OK);
+
+		hr = pDevice->CreateVertexShader(bytecode, bytecodeSize, &shader.m_instanceVShader);
+		_ASSERT(hr == S_OK);
+
+		HXDeclBuildLayout(*(shader.m_instanceDecl), bytecode, bytecodeSize);
 	}
+
+	// Compile the pixel shader
+	delete [] bytecode;
+	bytecode = NULL;
+	hr = pDevice->CompileShader(shaderBuffer, fileSize, psEntry.c_str(), psProfile.c_str(), dwShaderFlags, &bytecode, &bytecodeSize);
 	_ASSERT(hr == S_OK);
-	if(errorBlob)
-		errorBlob->Release();
-	errorBlob = NULL;
 
 	// Now create the pixel shader
-	hr = pDevice->CreatePixelShader(pShaderBlob->GetBufferPointer(), pShaderBlob->GetBufferSize(), NULL, &shader.m_pshader);
+	hr = pDevice->CreatePixelShader(bytecode, bytecodeSize, &shader.m_pshader);
 	_ASSERT(hr == S_OK);
 
-	pShaderBlob->Release();
-	pShaderBlob = NULL;
+	delete [] bytecode;
+	bytecode = NULL;
 	delete shaderBuffer;
 
 }
@@ -181,6 +191,7 @@ HXShader * HXLoadShader(const std::string &shaderName)
 	}
 
 	shader = new HXShader(shaderName);
+	shader->m_id = m_shaderState->m_nextId++;
 
 	std::string fullPath = "Shaders/";
 	fullPath += shaderName;
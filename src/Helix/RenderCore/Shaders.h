@@ -9,16 +9,23 @@ struct HXVertexDecl;
 
 struct HXShader
 {
-	HXShader(const std::string &name) : m_decl(NULL), m_vshader(NULL), m_pshader(NULL), m_loading(false), m_needsProcessing(false) 
+	HXShader(const std::string &name) : m_id(0), m_decl(NULL), m_vshader(NULL), m_pshader(NULL), m_instanceDecl(NULL), m_instanceVShader(NULL), m_loading(false), m_needsProcessing(false) 
 	{
 		m_shaderName = name;
 	}
 
 	std::string				m_shaderName;
+	unsigned int			m_id;				// Small unique id used to build draw sort keys
 	HXVertexDecl *			m_decl;
 	ID3D11VertexShader *	m_vshader;
 	ID3D11PixelShader *		m_pshader;
 
+	// Optional vertex shader that reads the world view matrix from a per
+	// instance stream, paired with the same pixel shader.  NULL if the shader
+	// can't be instanced.
+	HXVertexDecl *			m_instanceDecl;
+	ID3D11VertexShader *	m_instanceVShader;
+
 	union {
 		unsigned long	flags;
 		struct {
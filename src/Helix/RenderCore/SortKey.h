@@ -0,0 +1,73 @@
+#ifndef SORTKEY_H
+#define SORTKEY_H
+
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// Draw sort keys
+//
+// Every draw carries a 64 bit key.  Sorting the keys groups draws by the state
+// they need, most expensive state change first:
+//
+//  63..60	pass
+//  59..48	shader (also selects the input layout)
+//  47..32	material (textures)
+//  31..16	mesh (vertex/index buffers)
+//  15..0	view depth quantized between the near and far planes
+//
+// Depth is the least significant field, so within a run of identical state
+// opaque geometry is drawn front to back.
+// ****************************************************************************
+enum RenderPass
+{
+	PASS_GBUFFER = 0,
+
+	PASS_COUNT
+};
+
+const int		SORTKEY_PASS_SHIFT = 60;
+const int		SORTKEY_SHADER_SHIFT = 48;
+const int		SORTKEY_MATERIAL_SHIFT = 32;
+const int		SORTKEY_MESH_SHIFT = 16;
+
+const uint64_t	SORTKEY_PASS_MASK = 0xf;
+const uint64_t	SORTKEY_SHADER_MASK = 0xfff;
+const uint64_t	SORTKEY_MATERIAL_MASK = 0xffff;
+const uint64_t	SORTKEY_MESH_MASK = 0xffff;
+const uint64_t	SORTKEY_DEPTH_MASK = 0xffff;
+
+// ****************************************************************************
+// Builds the state portion of a key.  Depth is filled in by the render thread
+// once the frame's view matrix is known.
+// ****************************************************************************
+inline uint64_t MakeSortKey(unsigned int pass, unsigned int shaderId, unsigned int materialId, unsigned int meshId)
+{
+	_ASSERT(pass <= SORTKEY_PASS_MASK);
+	_ASSERT(shaderId <= SORTKEY_SHADER_MASK);
+	_ASSERT(materialId <= SORTKEY_MATERIAL_MASK);
+	_ASSERT(meshId <= SORTKEY_MESH_MASK);
+
+	return	(static_cast<uint64_t>(pass) << SORTKEY_PASS_SHIFT) |
+			(static_cast<uint64_t>(shaderId) << SORTKEY_SHADER_SHIFT) |
+			(static_cast<uint64_t>(materialId) << SORTKEY_MATERIAL_SHIFT) |
+			(static_cast<uint64_t>(meshId) << SORTKEY_MESH_SHIFT);
+}
+
+// ****************************************************************************
+// Quantizes a view space depth to 16 bits and merges it into the key.  Depths
+// outside [nearZ, farZ] clamp to the ends of the range.
+// ****************************************************************************
+inline uint64_t SetSortKeyDepth(uint64_t key, float viewZ, float nearZ, float farZ)
+{
+	float t = (viewZ - nearZ) / (farZ - nearZ);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+	uint64_t depth = static_cast<uint64_t>(t * static_cast<float>(SORTKEY_DEPTH_MASK));
+	return (key & ~SORTKEY_DEPTH_MASK) | depth;
+}
+
+} // namespace Helix
+
+#endif // SORTKEY_H
@@ -0,0 +1,538 @@
+#include "StateCache.h"
+
+namespace Helix {
+
+// Never a valid object, so the first bind after an invalidate always goes through
+const void * const	UNKNOWN_STATE = reinterpret_cast<const void *>(~static_cast<size_t>(0));
+const unsigned int	UNKNOWN_VALUE = 0xffffffff;
+
+// What a plain constant buffer bind leaves in the window cache
+const unsigned int	WHOLE_BUFFER = 0;
+
+// ****************************************************************************
+// ****************************************************************************
+StateCacheContext::StateCacheContext(RenderContext *context)
+: m_context(context)
+{
+	_ASSERT(context != NULL);
+
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(&m_lastStats, 0, sizeof(m_lastStats));
+	Invalidate();
+}
+
+// ****************************************************************************
+// Forget everything.  The next bind of every stage/slot goes through.
+// ****************************************************************************
+void StateCacheContext::Invalidate()
+{
+	m_inputLayout = UNKNOWN_STATE;
+	for(int i=0;i<MAX_VERTEX_BUFFERS;i++)
+	{
+		m_vertexBuffers[i] = UNKNOWN_STATE;
+		m_vertexStrides[i] = UNKNOWN_VALUE;
+		m_vertexOffsets[i] = UNKNOWN_VALUE;
+	}
+	m_indexBuffer = UNKNOWN_STATE;
+	m_indexFormat = DXGI_FORMAT_UNKNOWN;
+	m_indexOffset = UNKNOWN_VALUE;
+	m_topology = UNKNOWN_VALUE;
+
+	m_vertexShader = UNKNOWN_STATE;
+	m_pixelShader = UNKNOWN_STATE;
+	m_geometryShader = UNKNOWN_STATE;
+	m_hullShader = UNKNOWN_STATE;
+	m_domainShader = UNKNOWN_STATE;
+	for(int i=0;i<MAX_CONSTANT_BUFFERS;i++)
+	{
+		m_vsConstants[i] = UNKNOWN_STATE;
+		m_vsConstantFirst[i] = UNKNOWN_VALUE;
+		m_vsConstantNum[i] = UNKNOWN_VALUE;
+		m_psConstants[i] = UNKNOWN_STATE;
+		m_psConstantFirst[i] = UNKNOWN_VALUE;
+		m_psConstantNum[i] = UNKNOWN_VALUE;
+	}
+	for(int i=0;i<MAX_SAMPLERS;i++)
+	{
+		m_psSamplers[i] = UNKNOWN_STATE;
+	}
+	InvalidateShaderResources();
+
+	m_rasterizerState = UNKNOWN_STATE;
+	m_numViewports = UNKNOWN_VALUE;
+	m_numScissorRects = UNKNOWN_VALUE;
+	m_numRenderTargets = UNKNOWN_VALUE;
+	m_depthStencilView = UNKNOWN_STATE;
+	m_blendState = UNKNOWN_STATE;
+	m_sampleMask = UNKNOWN_VALUE;
+	m_depthStencilState = UNKNOWN_STATE;
+	m_stencilRef = UNKNOWN_VALUE;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::InvalidateShaderResources()
+{
+	for(int i=0;i<MAX_SHADER_RESOURCES;i++)
+	{
+		m_psResources[i] = UNKNOWN_STATE;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool StateCacheContext::Filter(const void *&cache, const void *value)
+{
+	if(cache == value)
+	{
+		m_stats.filtered++;
+		return false;
+	}
+
+	cache = value;
+	m_stats.issued++;
+	return true;
+}
+
+// ****************************************************************************
+// Slots that fall outside the cache are always treated as changed
+// ****************************************************************************
+bool StateCacheContext::FilterRange(const void **cache, unsigned int cacheSize, unsigned int &startSlot, unsigned int &count, const void * const *values)
+{
+	unsigned int first = count;
+	unsigned int last = 0;
+	for(unsigned int i=0;i<count;i++)
+	{
+		unsigned int slot = startSlot + i;
+		if(slot >= cacheSize || cache[slot] != values[i])
+		{
+			if(first == count)
+				first = i;
+			last = i;
+
+			if(slot < cacheSize)
+				cache[slot] = values[i];
+		}
+	}
+
+	if(first == count)
+	{
+		m_stats.filtered++;
+		return false;
+	}
+
+	startSlot += first;
+	count = last - first + 1;
+	m_stats.issued++;
+	return true;
+}
+
+// ****************************************************************************
+// Slots that fall outside the cache are always treated as changed
+// ****************************************************************************
+bool StateCacheContext::FilterConstantRange(const void **cache, unsigned int *cacheFirst, unsigned int *cacheNum, unsigned int &startSlot, unsigned int &count, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	unsigned int first = count;
+	unsigned int last = 0;
+	for(unsigned int i=0;i<count;i++)
+	{
+		unsigned int slot = startSlot + i;
+		unsigned int windowFirst = firstConstant != NULL ? firstConstant[i] : 0;
+		unsigned int windowNum = numConstants != NULL ? numConstants[i] : WHOLE_BUFFER;
+		if(slot >= MAX_CONSTANT_BUFFERS || cache[slot] != buffers[i] || cacheFirst[slot] != windowFirst || cacheNum[slot] != windowNum)
+		{
+			if(first == count)
+				first = i;
+			last = i;
+
+			if(slot < MAX_CONSTANT_BUFFERS)
+			{
+				cache[slot] = buffers[i];
+				cacheFirst[slot] = windowFirst;
+				cacheNum[slot] = windowNum;
+			}
+		}
+	}
+
+	if(first == count)
+	{
+		m_stats.filtered++;
+		return false;
+	}
+
+	startSlot += first;
+	count = last - first + 1;
+	m_stats.issued++;
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+HRESULT StateCacheContext::Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped)
+{
+	return m_context->Map(resource, subresource, mapType, flags, mapped);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::Unmap(ID3D11Resource *resource, unsigned int subresource)
+{
+	m_context->Unmap(resource, subresource);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::IASetInputLayout(ID3D11InputLayout *layout)
+{
+	if(Filter(m_inputLayout, layout))
+		m_context->IASetInputLayout(layout);
+}
+
+// ****************************************************************************
+// A vertex buffer slot only matches if the buffer, stride and offset all do
+// ****************************************************************************
+void StateCacheContext::IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets)
+{
+	unsigned int first = numBuffers;
+	unsigned int last = 0;
+	for(unsigned int i=0;i<numBuffers;i++)
+	{
+		unsigned int slot = startSlot + i;
+		if(slot >= MAX_VERTEX_BUFFERS || m_vertexBuffers[slot] != buffers[i] || m_vertexStrides[slot] != strides[i] || m_vertexOffsets[slot] != offsets[i])
+		{
+			if(first == numBuffers)
+				first = i;
+			last = i;
+
+			if(slot < MAX_VERTEX_BUFFERS)
+			{
+				m_vertexBuffers[slot] = buffers[i];
+				m_vertexStrides[slot] = strides[i];
+				m_vertexOffsets[slot] = offsets[i];
+			}
+		}
+	}
+
+	if(first == numBuffers)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_stats.issued++;
+	m_context->IASetVertexBuffers(startSlot + first, last - first + 1, buffers + first, strides + first, offsets + first);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	if(m_indexBuffer == buffer && m_indexFormat == format && m_indexOffset == offset)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_indexBuffer = buffer;
+	m_indexFormat = format;
+	m_indexOffset = offset;
+	m_stats.issued++;
+	m_context->IASetIndexBuffer(buffer, format, offset);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if(m_topology == static_cast<unsigned int>(topology))
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_topology = topology;
+	m_stats.issued++;
+	m_context->IASetPrimitiveTopology(topology);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::VSSetShader(ID3D11VertexShader *shader)
+{
+	if(Filter(m_vertexShader, shader))
+		m_context->VSSetShader(shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::PSSetShader(ID3D11PixelShader *shader)
+{
+	if(Filter(m_pixelShader, shader))
+		m_context->PSSetShader(shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::GSSetShader(ID3D11GeometryShader *shader)
+{
+	if(Filter(m_geometryShader, shader))
+		m_context->GSSetShader(shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::HSSetShader(ID3D11HullShader *shader)
+{
+	if(Filter(m_hullShader, shader))
+		m_context->HSSetShader(shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::DSSetShader(ID3D11DomainShader *shader)
+{
+	if(Filter(m_domainShader, shader))
+		m_context->DSSetShader(shader);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	unsigned int first = startSlot;
+	if(FilterConstantRange(m_vsConstants, m_vsConstantFirst, m_vsConstantNum, startSlot, numBuffers, buffers, NULL, NULL))
+		m_context->VSSetConstantBuffers(startSlot, numBuffers, buffers + (startSlot - first));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers)
+{
+	unsigned int first = startSlot;
+	if(FilterConstantRange(m_psConstants, m_psConstantFirst, m_psConstantNum, startSlot, numBuffers, buffers, NULL, NULL))
+		m_context->PSSetConstantBuffers(startSlot, numBuffers, buffers + (startSlot - first));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool StateCacheContext::ConstantBufferOffsets()
+{
+	return m_context->ConstantBufferOffsets();
+}
+
+// ****************************************************************************
+// Moving the window on the same buffer is a change like any other
+// ****************************************************************************
+void StateCacheContext::VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	unsigned int first = startSlot;
+	if(FilterConstantRange(m_vsConstants, m_vsConstantFirst, m_vsConstantNum, startSlot, numBuffers, buffers, firstConstant, numConstants))
+	{
+		unsigned int skip = startSlot - first;
+		m_context->VSSetConstantBuffers1(startSlot, numBuffers, buffers + skip, firstConstant + skip, numConstants + skip);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants)
+{
+	unsigned int first = startSlot;
+	if(FilterConstantRange(m_psConstants, m_psConstantFirst, m_psConstantNum, startSlot, numBuffers, buffers, firstConstant, numConstants))
+	{
+		unsigned int skip = startSlot - first;
+		m_context->PSSetConstantBuffers1(startSlot, numBuffers, buffers + skip, firstConstant + skip, numConstants + skip);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views)
+{
+	const void * const *values = reinterpret_cast<const void * const *>(views);
+	unsigned int first = startSlot;
+	if(FilterRange(m_psResources, MAX_SHADER_RESOURCES, startSlot, numViews, values))
+		m_context->PSSetShaderResources(startSlot, numViews, views + (startSlot - first));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers)
+{
+	const void * const *values = reinterpret_cast<const void * const *>(samplers);
+	unsigned int first = startSlot;
+	if(FilterRange(m_psSamplers, MAX_SAMPLERS, startSlot, numSamplers, values))
+		m_context->PSSetSamplers(startSlot, numSamplers, samplers + (startSlot - first));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::RSSetState(ID3D11RasterizerState *state)
+{
+	if(Filter(m_rasterizerState, state))
+		m_context->RSSetState(state);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports)
+{
+	if(numViewports == m_numViewports && memcmp(viewports, m_viewports, numViewports * sizeof(D3D11_VIEWPORT)) == 0)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	if(numViewports <= MAX_VIEWPORTS)
+	{
+		m_numViewports = numViewports;
+		memcpy(m_viewports, viewports, numViewports * sizeof(D3D11_VIEWPORT));
+	}
+	else
+	{
+		m_numViewports = UNKNOWN_VALUE;
+	}
+
+	m_stats.issued++;
+	m_context->RSSetViewports(numViewports, viewports);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects)
+{
+	if(numRects == m_numScissorRects && memcmp(rects, m_scissorRects, numRects * sizeof(D3D11_RECT)) == 0)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	if(numRects <= MAX_VIEWPORTS)
+	{
+		m_numScissorRects = numRects;
+		memcpy(m_scissorRects, rects, numRects * sizeof(D3D11_RECT));
+	}
+	else
+	{
+		m_numScissorRects = UNKNOWN_VALUE;
+	}
+
+	m_stats.issued++;
+	m_context->RSSetScissorRects(numRects, rects);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil)
+{
+	if(numViews == m_numRenderTargets && depthStencil == m_depthStencilView)
+	{
+		bool same = true;
+		for(unsigned int i=0;i<numViews && same;i++)
+		{
+			same = m_renderTargets[i] == views[i];
+		}
+
+		if(same)
+		{
+			m_stats.filtered++;
+			return;
+		}
+	}
+
+	if(numViews <= MAX_RENDER_TARGETS)
+	{
+		m_numRenderTargets = numViews;
+		for(unsigned int i=0;i<numViews;i++)
+		{
+			m_renderTargets[i] = views[i];
+		}
+	}
+	else
+	{
+		m_numRenderTargets = UNKNOWN_VALUE;
+	}
+	m_depthStencilView = depthStencil;
+
+	// D3D may have pulled shader resource views out from under us
+	InvalidateShaderResources();
+
+	m_stats.issued++;
+	m_context->OMSetRenderTargets(numViews, views, depthStencil);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask)
+{
+	if(m_blendState == state && m_sampleMask == sampleMask && memcmp(m_blendFactor, blendFactor, sizeof(m_blendFactor)) == 0)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_blendState = state;
+	m_sampleMask = sampleMask;
+	memcpy(m_blendFactor, blendFactor, sizeof(m_blendFactor));
+
+	m_stats.issued++;
+	m_context->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef)
+{
+	if(m_depthStencilState == state && m_stencilRef == stencilRef)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_depthStencilState = state;
+	m_stencilRef = stencilRef;
+
+	m_stats.issued++;
+	m_context->OMSetDepthStencilState(state, stencilRef);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4])
+{
+	m_context->ClearRenderTargetView(view, color);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil)
+{
+	m_context->ClearDepthStencilView(view, clearFlags, depth, stencil);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	m_context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void StateCacheContext::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	m_context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+// ****************************************************************************
+// Bindings survive Present, so only the counters roll over
+// ****************************************************************************
+void StateCacheContext::Present(unsigned int syncInterval, unsigned int flags)
+{
+	m_context->Present(syncInterval, flags);
+
+	m_lastStats = m_stats;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+} // namespace Helix
@@ -0,0 +1,142 @@
+#ifndef STATECACHE_H
+#define STATECACHE_H
+
+#include "RenderDevice.h"
+
+namespace Helix {
+
+// Per frame counters for the state cache
+struct StateCacheStats
+{
+	unsigned int	issued;		// State calls passed on to the context
+	unsigned int	filtered;	// State calls dropped because nothing changed
+};
+
+// ****************************************************************************
+// StateCacheContext
+//
+// Sits between the renderer and the real context and remembers what is bound
+// on each stage and slot.  A bind that matches what's already there is
+// dropped; a ranged bind is trimmed to the slots that actually change.  Maps,
+// clears and draws always go through.
+//
+// Binding a render target makes D3D quietly unbind any shader resource view of
+// the same resource, so the shader resource slots are forgotten whenever the
+// render targets change.  Call Invalidate() if anything else touches the
+// underlying context.
+// ****************************************************************************
+class StateCacheContext : public RenderContext
+{
+public:
+	explicit StateCacheContext(RenderContext *context);
+
+	void	Invalidate();
+
+	const StateCacheStats &	LastFrameStats() const	{ return m_lastStats; }
+	RenderContext *			GetContext()			{ return m_context; }
+
+	virtual HRESULT	Map(ID3D11Resource *resource, unsigned int subresource, D3D11_MAP mapType, unsigned int flags, D3D11_MAPPED_SUBRESOURCE *mapped);
+	virtual void	Unmap(ID3D11Resource *resource, unsigned int subresource);
+
+	virtual void	IASetInputLayout(ID3D11InputLayout *layout);
+	virtual void	IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *strides, const unsigned int *offsets);
+	virtual void	IASetIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format, unsigned int offset);
+	virtual void	IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	virtual void	VSSetShader(ID3D11VertexShader *shader);
+	virtual void	PSSetShader(ID3D11PixelShader *shader);
+	virtual void	GSSetShader(ID3D11GeometryShader *shader);
+	virtual void	HSSetShader(ID3D11HullShader *shader);
+	virtual void	DSSetShader(ID3D11DomainShader *shader);
+	virtual void	VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual void	PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers);
+	virtual bool	ConstantBufferOffsets();
+	virtual void	VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	virtual void	PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView * const *views);
+	virtual void	PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState * const *samplers);
+
+	virtual void	RSSetState(ID3D11RasterizerState *state);
+	virtual void	RSSetViewports(unsigned int numViewports, const D3D11_VIEWPORT *viewports);
+	virtual void	RSSetScissorRects(unsigned int numRects, const D3D11_RECT *rects);
+	virtual void	OMSetRenderTargets(unsigned int numViews, ID3D11RenderTargetView * const *views, ID3D11DepthStencilView *depthStencil);
+	virtual void	OMSetBlendState(ID3D11BlendState *state, const float blendFactor[4], unsigned int sampleMask);
+	virtual void	OMSetDepthStencilState(ID3D11DepthStencilState *state, unsigned int stencilRef);
+
+	virtual void	ClearRenderTargetView(ID3D11RenderTargetView *view, const float color[4]);
+	virtual void	ClearDepthStencilView(ID3D11DepthStencilView *view, unsigned int clearFlags, float depth, uint8_t stencil);
+
+	virtual void	DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	virtual void	DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	virtual void	Present(unsigned int syncInterval, unsigned int flags);
+
+private:
+	StateCacheContext(const StateCacheContext &other);
+	StateCacheContext & operator=(const StateCacheContext &other);
+
+	// Slots past these aren't tracked and always go through
+	enum
+	{
+		MAX_VERTEX_BUFFERS =	8,
+		MAX_CONSTANT_BUFFERS =	D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+		MAX_SHADER_RESOURCES =	16,
+		MAX_SAMPLERS =			D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+		MAX_RENDER_TARGETS =	D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT,
+		MAX_VIEWPORTS =			4,
+	};
+
+	// Trims [startSlot, startSlot+count) down to the slots whose value
+	// differs from the cache and updates the cache.  Returns false if nothing
+	// changed.
+	bool	FilterRange(const void **cache, unsigned int cacheSize, unsigned int &startSlot, unsigned int &count, const void * const *values);
+
+	// The same for constant buffers, where a slot only matches if the window
+	// does too.  NULL windows mean the whole buffer.
+	bool	FilterConstantRange(const void **cache, unsigned int *cacheFirst, unsigned int *cacheNum, unsigned int &startSlot, unsigned int &count, ID3D11Buffer * const *buffers, const unsigned int *firstConstant, const unsigned int *numConstants);
+	bool	Filter(const void *&cache, const void *value);
+	void	InvalidateShaderResources();
+
+	RenderContext *			m_context;
+
+	const void *			m_inputLayout;
+	const void *			m_vertexBuffers[MAX_VERTEX_BUFFERS];
+	unsigned int			m_vertexStrides[MAX_VERTEX_BUFFERS];
+	unsigned int			m_vertexOffsets[MAX_VERTEX_BUFFERS];
+	const void *			m_indexBuffer;
+	DXGI_FORMAT				m_indexFormat;
+	unsigned int			m_indexOffset;
+	unsigned int			m_topology;
+	const void *			m_vertexShader;
+	const void *			m_pixelShader;
+	const void *			m_geometryShader;
+	const void *			m_hullShader;
+	const void *			m_domainShader;
+	const void *			m_vsConstants[MAX_CONSTANT_BUFFERS];
+	unsigned int			m_vsConstantFirst[MAX_CONSTANT_BUFFERS];
+	unsigned int			m_vsConstantNum[MAX_CONSTANT_BUFFERS];
+	const void *			m_psConstants[MAX_CONSTANT_BUFFERS];
+	unsigned int			m_psConstantFirst[MAX_CONSTANT_BUFFERS];
+	unsigned int			m_psConstantNum[MAX_CONSTANT_BUFFERS];
+	const void *			m_psResources[MAX_SHADER_RESOURCES];
+	const void *			m_psSamplers[MAX_SAMPLERS];
+	const void *			m_rasterizerState;
+	unsigned int			m_numViewports;
+	D3D11_VIEWPORT			m_viewports[MAX_VIEWPORTS];
+	unsigned int			m_numScissorRects;
+	D3D11_RECT				m_scissorRects[MAX_VIEWPORTS];
+	unsigned int			m_numRenderTargets;
+	const void *			m_renderTargets[MAX_RENDER_TARGETS];
+	const void *			m_depthStencilView;
+	const void *			m_blendState;
+	float					m_blendFactor[4];
+	unsigned int			m_sampleMask;
+	const void *			m_depthStencilState;
+	unsigned int			m_stencilRef;
+
+	StateCacheStats			m_stats;
+	StateCacheStats			m_lastStats;
+};
+
+} // namespace Helix
+#endif // STATECACHE_H
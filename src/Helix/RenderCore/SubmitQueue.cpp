@@ -0,0 +1,265 @@
+#include "SubmitQueue.h"
+#include "Kernel/Atomic.h"
+#include "Utility/Profiler.h"
+
+namespace Helix {
+
+const int			MAX_SUBMIT_THREADS = 64;
+
+struct SubmitBucket
+{
+	SubmitBucket() : busy(0) {}
+
+	SubmissionBuffer	buffers[NUM_SUBMISSION_BUFFERS];
+	volatile long		busy;
+};
+
+// The last slot is the shared bucket, for every thread that comes after the
+// table fills up.  Threads that exit keep their buckets, so with a pool that
+// churns this is where most threads end up sooner or later.
+const int			SHARED_SUBMIT_BUCKET = MAX_SUBMIT_THREADS - 1;
+
+volatile long		m_submissionIndex = 0;
+SubmitBucket *		m_submitBuckets[MAX_SUBMIT_THREADS];
+volatile long		m_numSubmitBuckets = 0;
+SubmitBucket		m_sharedSubmitBucket;
+volatile long		m_sharedSubmitLock = 0;
+volatile long		m_sharedSubmitCreated = 0;
+HX_THREAD_LOCAL SubmitBucket *	m_threadSubmitBucket = NULL;
+
+// ****************************************************************************
+// ****************************************************************************
+int SubmissionIndex()
+{
+	return m_submissionIndex;
+}
+
+// ****************************************************************************
+// Anything that lands after this goes to the new index
+// ****************************************************************************
+void SetSubmissionIndex(int index)
+{
+	_ASSERT(index >= 0 && index < NUM_SUBMISSION_BUFFERS);
+	AtomicExchange(&m_submissionIndex, index);
+}
+
+// ****************************************************************************
+// Releases last frame's records and reserves room for at least as many draws
+// as the buffer saw last time around, so the draw array doesn't have to grow
+// mid frame.
+// ****************************************************************************
+void ResetSubmissionBuffer(SubmissionBuffer &buffer)
+{
+	unsigned int reserve = buffer.numDraws > MIN_DRAWS_PER_FRAME ? buffer.numDraws : MIN_DRAWS_PER_FRAME;
+
+	buffer.arena.Reset();
+	buffer.draws = buffer.arena.Alloc<RenderData>(reserve);
+	buffer.numDraws = 0;
+	buffer.maxDraws = reserve;
+	buffer.numTriangles = 0;
+	buffer.fullTriangles = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void InitSubmitBucket(SubmitBucket &bucket)
+{
+	for(int i=0;i<NUM_SUBMISSION_BUFFERS;i++)
+	{
+		bucket.buffers[i].numDraws = 0;
+		ResetSubmissionBuffer(bucket.buffers[i]);
+	}
+}
+
+// ****************************************************************************
+// Threads past the end of the table share one bucket, and take its lock for
+// the length of a submit.  Whoever gets the lock first sets it up.
+// ****************************************************************************
+void LockSharedSubmitBucket()
+{
+	while(AtomicCompareExchange(&m_sharedSubmitLock, 1, 0) != 0)
+	{
+		SpinPause();
+	}
+
+	if(m_sharedSubmitCreated == 0)
+	{
+		InitSubmitBucket(m_sharedSubmitBucket);
+		m_submitBuckets[SHARED_SUBMIT_BUCKET] = &m_sharedSubmitBucket;
+		AtomicStore(&m_sharedSubmitCreated, 1);
+	}
+}
+
+// ****************************************************************************
+// Returns the calling thread's submission bucket, creating and registering it
+// on the thread's first submit.  Slots are claimed with an interlocked
+// increment; a reader that sees the count before the pointer lands skips the
+// NULL slot, which is fine since the new bucket can't hold anything yet.
+// Once the private slots run out the thread gets the shared bucket instead.
+// ****************************************************************************
+SubmitBucket * GetSubmitBucket()
+{
+	SubmitBucket *bucket = m_threadSubmitBucket;
+	if(bucket != NULL)
+		return bucket;
+
+	long slot = SHARED_SUBMIT_BUCKET;
+	if(m_numSubmitBuckets < SHARED_SUBMIT_BUCKET)
+	{
+		slot = AtomicIncrement(&m_numSubmitBuckets) - 1;
+	}
+
+	if(slot < SHARED_SUBMIT_BUCKET)
+	{
+		bucket = new SubmitBucket;
+		InitSubmitBucket(*bucket);
+		m_submitBuckets[slot] = bucket;
+	}
+	else
+	{
+		bucket = &m_sharedSubmitBucket;
+	}
+
+	m_threadSubmitBucket = bucket;
+	return bucket;
+}
+
+// ****************************************************************************
+// Number of bucket slots that have been claimed so far, the shared one
+// included once the private ones are gone
+// ****************************************************************************
+inline int NumSubmitBuckets()
+{
+	long count = m_numSubmitBuckets;
+	return count < SHARED_SUBMIT_BUCKET ? count : MAX_SUBMIT_THREADS;
+}
+
+// ****************************************************************************
+// Raise our busy flag before looking at the submission index
+// ****************************************************************************
+SubmissionBuffer & BeginSubmit(int &index)
+{
+	SubmitBucket *bucket = GetSubmitBucket();
+	if(bucket == &m_sharedSubmitBucket)
+	{
+		LockSharedSubmitBucket();
+	}
+	AtomicExchange(&bucket->busy, 1);
+
+	index = m_submissionIndex;
+	return bucket->buffers[index];
+}
+
+// ****************************************************************************
+// Publishes the record
+// ****************************************************************************
+void EndSubmit()
+{
+	AtomicExchange(&m_threadSubmitBucket->busy, 0);
+	if(m_threadSubmitBucket == &m_sharedSubmitBucket)
+	{
+		AtomicExchange(&m_sharedSubmitLock, 0);
+	}
+}
+
+// ****************************************************************************
+// Called once the submission index has moved on.  Waits for any producer
+// still writing into the old index, then gathers the frame's records from
+// every bucket into one list.
+// ****************************************************************************
+unsigned int MergeSubmitBuckets(int index, LinearAllocator &arena, RenderData **&draws)
+{
+	HX_PROFILE_SCOPE("MergeSubmitBuckets");
+
+	int numBuckets = NumSubmitBuckets();
+
+	unsigned int numDraws = 0;
+	for(int i=0;i<numBuckets;i++)
+	{
+		SubmitBucket *bucket = m_submitBuckets[i];
+		if(bucket == NULL)
+			continue;
+
+		// A producer that raised its flag before the flip may still be
+		// writing into this index.  Anyone raising it after will see the
+		// new index.
+		while(bucket->busy != 0)
+		{
+			SpinPause();
+		}
+
+		numDraws += bucket->buffers[index].numDraws;
+	}
+
+	// Make sure we see everything the producers wrote before they let go
+	AtomicFence();
+
+	draws = arena.Alloc<RenderData *>(numDraws > 0 ? numDraws : 1);
+
+	unsigned int numMerged = 0;
+	for(int i=0;i<numBuckets;i++)
+	{
+		SubmitBucket *bucket = m_submitBuckets[i];
+		if(bucket == NULL)
+			continue;
+
+		SubmissionBuffer &buffer = bucket->buffers[index];
+		for(unsigned int drawIndex = 0; drawIndex < buffer.numDraws; drawIndex++)
+		{
+			draws[numMerged++] = &buffer.draws[drawIndex];
+		}
+	}
+	_ASSERT(numMerged == numDraws);
+
+	return numDraws;
+}
+
+// ****************************************************************************
+// Producers are writing another index, so this one is ours to reset
+// ****************************************************************************
+void RetireSubmitBuckets(int index, SubmittedFrameStats &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	for(int i=0;i<NumSubmitBuckets();i++)
+	{
+		SubmitBucket *bucket = m_submitBuckets[i];
+		if(bucket == NULL)
+			continue;
+
+		SubmissionBuffer &buffer = bucket->buffers[index];
+		if(buffer.numDraws > 0)
+			stats.numThreads++;
+		stats.heapAllocations += buffer.arena.HeapAllocations();
+		stats.arenaOverflows += buffer.arena.Overflows();
+		stats.arenaBytesUsed += buffer.arena.BytesUsed();
+		stats.arenaCapacity += buffer.arena.Capacity();
+		stats.numTriangles += buffer.numTriangles;
+		stats.fullTriangles += buffer.fullTriangles;
+
+		ResetSubmissionBuffer(buffer);
+	}
+}
+
+// ****************************************************************************
+// Release what the buckets hold; the bucket memory itself goes away with the
+// process.
+// ****************************************************************************
+void ReleaseSubmitBuckets()
+{
+	for(int i=0;i<NumSubmitBuckets();i++)
+	{
+		SubmitBucket *bucket = m_submitBuckets[i];
+		if(bucket == NULL)
+			continue;
+
+		_ASSERT(bucket->busy == 0);
+		for(int j=0;j<NUM_SUBMISSION_BUFFERS;j++)
+		{
+			bucket->buffers[j].numDraws = 0;
+			bucket->buffers[j].arena.Reset();
+		}
+	}
+}
+
+} // namespace Helix
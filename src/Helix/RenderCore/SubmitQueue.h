@@ -0,0 +1,123 @@
+#ifndef SUBMITQUEUE_H
+#define SUBMITQUEUE_H
+
+#include <type_traits>
+#include "Math/Matrix.h"
+#include "Utility/Memory/LinearAlloc.h"
+
+struct HXMaterial;
+struct HXShader;
+
+namespace Helix {
+
+class Mesh;
+struct MeshLod;
+
+// One per FrameFence slot
+const int			NUM_SUBMISSION_BUFFERS = 4;
+
+// Room every producer's buffer starts a frame with
+const unsigned int	MIN_DRAWS_PER_FRAME = 256;
+
+// Fixed size draw record.  Everything the renderer needs is resolved at
+// submission time so the render thread never does a name lookup.
+struct RenderData
+{
+	Helix::Matrix4x4	worldMatrix;
+	uint64_t			sortKey;
+	Mesh *				mesh;
+	const MeshLod *		lod;			// The level of mesh that's drawn
+	HXMaterial *		material;
+	HXShader *			shader;
+};
+
+// Records are moved around with memcpy when a buffer grows
+static_assert(std::is_trivially_copyable<RenderData>::value, "RenderData must be trivially copyable");
+
+// A producer thread's draw records for one frame live in one contiguous array
+// carved out of a linear allocator.  The allocator is reset when the render
+// thread retires the frame, so steady state submission never touches the heap.
+struct SubmissionBuffer
+{
+	LinearAllocator		arena;
+	RenderData *		draws;
+	unsigned int		numDraws;
+	unsigned int		maxDraws;
+	unsigned int		numTriangles;		// In the levels of detail picked
+	unsigned int		fullTriangles;		// At full detail
+};
+
+// What the producers put into one frame, added up as it's retired
+struct SubmittedFrameStats
+{
+	unsigned int	numThreads;			// Threads with at least one draw
+	unsigned int	heapAllocations;	// By their arenas, since the last retire
+	unsigned int	arenaOverflows;		// By their arenas, ever
+	size_t			arenaBytesUsed;
+	size_t			arenaCapacity;
+	unsigned int	numTriangles;
+	unsigned int	fullTriangles;
+};
+
+// ****************************************************************************
+// Submission queue
+//
+// Every thread that submits gets a bucket of its own the first time it calls
+// BeginSubmit(), with a SubmissionBuffer per frame slot, so producers never
+// contend with each other.  The submission index is the slot they write into.
+// Buckets are never freed, so there are only so many: threads that come after
+// they run out share one last bucket, behind a lock held from BeginSubmit() to
+// EndSubmit(), and their records may come out interleaved.
+//
+// The bucket's busy flag is raised from BeginSubmit() to EndSubmit(), around
+// reading the index and writing the record.  SetSubmissionIndex() and raising
+// the flag are both full barriers, so a producer either sees the new index or
+// is seen busy by MergeSubmitBuckets(), which waits for it to finish.  That is
+// the only handoff between a producer and the frame: a record is in the frame
+// whose index BeginSubmit() returned, whole, or it's in a later one.
+//
+// The thread that moves the index on is the only one that merges, and the
+// slot it merges isn't written again until RetireSubmitBuckets() has reset
+// it.
+// ****************************************************************************
+
+int		SubmissionIndex();
+void	SetSubmissionIndex(int index);
+
+// Returns the calling thread's buffer for the current submission index, and
+// the index.  The record isn't part of any frame until EndSubmit().
+SubmissionBuffer &	BeginSubmit(int &index);
+void	EndSubmit();
+
+// Waits for producers still writing into index and points draws at every
+// record submitted into it, in bucket order, in memory from arena.  Returns
+// the number of records.
+unsigned int	MergeSubmitBuckets(int index, LinearAllocator &arena, RenderData **&draws);
+
+// Adds up what was submitted into index and resets it for reuse
+void	RetireSubmitBuckets(int index, SubmittedFrameStats &stats);
+
+// Throws away everything submitted, once nobody is submitting any more
+void	ReleaseSubmitBuckets();
+
+// ****************************************************************************
+// Returns the next free draw record.  If we run out of room the array is
+// doubled inside the arena; the old array is abandoned until the next reset.
+// ****************************************************************************
+inline RenderData * AllocRenderData(SubmissionBuffer &buffer)
+{
+	if(buffer.numDraws == buffer.maxDraws)
+	{
+		unsigned int newMax = buffer.maxDraws * 2;
+		RenderData *newDraws = buffer.arena.Alloc<RenderData>(newMax);
+		memcpy(newDraws, buffer.draws, buffer.numDraws * sizeof(RenderData));
+
+		buffer.draws = newDraws;
+		buffer.maxDraws = newMax;
+	}
+
+	return &buffer.draws[buffer.numDraws++];
+}
+
+} // namespace Helix
+#endif // SUBMITQUEUE_H
@@ -1,6 +1,6 @@
 #include "Textures.h"
 #include "RenderMgr.h"
-#include "WICTextureLoader.h"
+#include "RenderDevice.h"
 
 typedef std::map<const std::string, HXTexture *>	TextureMap;
 
@@ -61,8 +61,8 @@ bool TextureLoad(HXTexture *tex, const std::string &filename)
 	_ASSERT(retVal);
 
 	// Create the texture 
-	ID3D11Device *pDevice = Helix::RenderMgr::GetInstance().GetDevice();
-	HRESULT hr = DirectX::CreateWICTextureFromMemory(pDevice, buffer, fileSize, &tex->m_resource, &tex->m_shaderView);
+	Helix::RenderDevice *pDevice = Helix::RenderMgr::GetInstance().GetRenderDevice();
+	HRESULT hr = pDevice->CreateTextureFromMemory(buffer, fileSize, &tex->m_resource, &tex->m_shaderView);
 	delete buffer;
 
 	return SUCCEEDED(hr);
@@ -1,5 +1,6 @@
 #include "VDecls.h"
 #include "RenderMgr.h"
+#include "RenderDevice.h"
 
 // Maps used to store delcaration information
 typedef std::map<const std::string, HXVertexDecl *>	DeclMap;
@@ -220,18 +221,23 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 	{
 		const D3D11_INPUT_ELEMENT_DESC &element = decl.m_desc[index];
 
+		// Per vertex and per instance elements come from separate streams.
+		// Elements may leave gaps for alignment, so a stream is as big as
+		// the end of its last element.
+		int &streamSize = element.InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA ? decl.m_instanceSize : decl.m_vertexSize;
+		int elementSize = 0;
 		switch(element.Format)
 		{
 		case DXGI_FORMAT_R32G32B32A32_FLOAT:
 		case DXGI_FORMAT_R32G32B32A32_UINT:
 		case DXGI_FORMAT_R32G32B32A32_SINT:
-			decl.m_vertexSize += 16;
+			elementSize = 16;
 			break;
 
 		case DXGI_FORMAT_R32G32B32_FLOAT:
 		case DXGI_FORMAT_R32G32B32_UINT:
 		case DXGI_FORMAT_R32G32B32_SINT:
-			decl.m_vertexSize += 12;
+			elementSize = 12;
 			break;
 
 		case DXGI_FORMAT_R16G16B16A16_FLOAT:
@@ -242,7 +248,7 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 		case DXGI_FORMAT_R32G32_FLOAT:
 		case DXGI_FORMAT_R32G32_UINT:
 		case DXGI_FORMAT_R32G32_SINT:
-			decl.m_vertexSize += 8;
+			elementSize = 8;
 			break;
 
 		case DXGI_FORMAT_R10G10B10A2_UNORM:
@@ -264,7 +270,7 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 		case DXGI_FORMAT_R32_SINT:
 		case DXGI_FORMAT_D24_UNORM_S8_UINT:
 		case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
-			decl.m_vertexSize += 4;
+			elementSize = 4;
 			break;
 
 		case DXGI_FORMAT_R8G8_UNORM:
@@ -277,7 +283,7 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 		case DXGI_FORMAT_R16_UINT:
 		case DXGI_FORMAT_R16_SNORM:
 		case DXGI_FORMAT_R16_SINT:
-			decl.m_vertexSize += 2;
+			elementSize = 2;
 			break;
 
 		case DXGI_FORMAT_R8_UNORM:
@@ -285,7 +291,7 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 		case DXGI_FORMAT_R8_SNORM:
 		case DXGI_FORMAT_R8_SINT:
 		case DXGI_FORMAT_A8_UNORM:
-			decl.m_vertexSize += 1;
+			elementSize = 1;
 			break;
 
 		case DXGI_FORMAT_R1_UNORM:
@@ -310,6 +316,9 @@ bool HXLoadVertexDecl(HXVertexDecl &decl, LuaPlus::LuaObject &declObj)
 			_ASSERT(0);
 			break;
 		}
+
+		int elementEnd = static_cast<int>(element.AlignedByteOffset) + elementSize;
+		streamSize = elementEnd > streamSize ? elementEnd : streamSize;
 	}
 
 	//HRESULT hr = RenderMgr::GetInstance().GetDevice()->CreateVertexDeclaration(decl,&m_decl);
@@ -326,6 +335,7 @@ HXVertexDecl * HXLoadVertexDecl(const std::string &name)
 		return vdecl;
 
 	vdecl = new HXVertexDecl;
+	vdecl->m_name = name;
 
 	std::string fullPath = "Shaders/";
 	fullPath += name;
@@ -348,18 +358,18 @@ HXVertexDecl * HXLoadVertexDecl(const std::string &name)
 
 // ****************************************************************************
 // ****************************************************************************
-ID3D11InputLayout * HXDeclBuildLayout(HXVertexDecl &decl, ID3DBlob *vshader)
+ID3D11InputLayout * HXDeclBuildLayout(HXVertexDecl &decl, const void *bytecode, size_t bytecodeSize)
 {
 	if(decl.m_layout != NULL)
 	{
 		return decl.m_layout;
 	}
 
-	HRESULT hr = Helix::RenderMgr::GetInstance().GetDevice()->CreateInputLayout(
+	HRESULT hr = Helix::RenderMgr::GetInstance().GetRenderDevice()->CreateInputLayout(
 		decl.m_desc, 
 		decl.m_numElements, 
-		vshader->GetBufferPointer(), 
-		vshader->GetBufferSize(), 
+		bytecode, 
+		bytecodeSize, 
 		&decl.m_layout);
 	_ASSERT(hr == S_OK);
 
@@ -369,6 +379,14 @@ ID3D11InputLayout * HXDeclBuildLayout(HXVertexDecl &decl, ID3DBlob *vshader)
 // ****************************************************************************
 // ****************************************************************************
 bool HXDeclHasSemantic(HXVertexDecl &decl, const char *semanticName, int &offset)
+{
+	DXGI_FORMAT format;
+	return HXDeclHasSemantic(decl, semanticName, offset, format);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool HXDeclHasSemantic(HXVertexDecl &decl, const char *semanticName, int &offset, DXGI_FORMAT &format)
 {
 	for(int elementIndex=0;elementIndex < decl.m_numElements; elementIndex++)
 	{
@@ -376,6 +394,7 @@ bool HXDeclHasSemantic(HXVertexDecl &decl, const char *semanticName, int &offset
 		if( _stricmp(semanticName,element.SemanticName) == 0)
 		{
 			offset = element.AlignedByteOffset;
+			format = element.Format;
 			return true;
 		}
 	}
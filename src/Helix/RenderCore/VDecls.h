@@ -7,9 +7,11 @@ struct HXShader;
 
 struct HXVertexDecl
 {
-	HXVertexDecl() : m_numElements(0), m_vertexSize(0), m_desc(NULL), m_layout(NULL) {}
+	HXVertexDecl() : m_numElements(0), m_vertexSize(0), m_instanceSize(0), m_desc(NULL), m_layout(NULL) {}
+	std::string					m_name;				// Of its Lua file, which cooked meshes refer to it by
 	int							m_numElements;
-	int							m_vertexSize;
+	int							m_vertexSize;		// Stride of the per vertex stream
+	int							m_instanceSize;		// Stride of the per instance stream, 0 if there isn't one
 	D3D11_INPUT_ELEMENT_DESC *	m_desc;
 	ID3D11InputLayout *			m_layout;
 };
@@ -17,8 +19,9 @@ struct HXVertexDecl
 void							HXInitializeVertexDecls();
 HXVertexDecl *					HXGetVertexDecl(const std::string &declName);
 HXVertexDecl *					HXLoadVertexDecl(const std::string &declName);
-ID3D11InputLayout *				HXDeclBuildLayout(HXVertexDecl &decl, ID3DBlob *vshader);
+ID3D11InputLayout *				HXDeclBuildLayout(HXVertexDecl &decl, const void *bytecode, size_t bytecodeSize);
 bool							HXDeclHasSemantic(HXVertexDecl &decl, const char *semanticName, int &offset);
+bool							HXDeclHasSemantic(HXVertexDecl &decl, const char *semanticName, int &offset, DXGI_FORMAT &format);
 
 	//ID3D10InputLayout *			GetLayout() { return m_layout; }
 	//D3D10_INPUT_ELEMENT_DESC *	GetDecl() { return m_desc; }
@@ -1,6 +1,7 @@
 #include <process.h>
 #include "Kernel/Callback.h"
 #include "ThreadLoad.h"
+#include "Utility/Profiler.h"
 
 // ****************************************************************************
 // ****************************************************************************
@@ -89,6 +90,8 @@ bool LoadFileAsync(const std::string &file, void (*callbackFn)(void *,long,void
 // ****************************************************************************
 void LoadThreadFunc(void *data)
 {
+	HX_PROFILE_THREAD("Load");
+
 	while(!GetLoadThreadShutdown())
 	{
 		DWORD result = WaitForSingleObject(m_hStartLoading,INFINITE);
@@ -106,6 +109,8 @@ void LoadThreadFunc(void *data)
 			result = ReleaseMutex(m_hLoadList);
 			_ASSERT(result != 0);
 
+			HX_PROFILE_SCOPE("LoadFile");
+
 			HANDLE hFile = CreateFile(loadObject->filename.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
 			if(hFile != INVALID_HANDLE_VALUE)
 			{
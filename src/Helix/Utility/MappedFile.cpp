@@ -0,0 +1,167 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "MappedFile.h"
+
+namespace Helix {
+
+// ****************************************************************************
+// ****************************************************************************
+MappedFile::MappedFile()
+: m_data(NULL)
+, m_size(0)
+#ifdef _WIN32
+, m_file(INVALID_HANDLE_VALUE)
+, m_mapping(NULL)
+#else
+, m_file(-1)
+#endif
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+// ****************************************************************************
+// Empty files can't be mapped, so they fail to open like missing ones
+// ****************************************************************************
+bool MappedFile::Open(const char *filename)
+{
+	Close();
+
+	m_file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if(m_data == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MappedFile::Close()
+{
+	if(m_data != NULL)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+	}
+	if(m_mapping != NULL)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+uint64_t FileWriteTime(const char *filename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesEx(filename, GetFileExInfoStandard, &attributes))
+		return 0;
+
+	return (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+#else
+
+// ****************************************************************************
+// Empty files can't be mapped, so they fail to open like missing ones
+// ****************************************************************************
+bool MappedFile::Open(const char *filename)
+{
+	Close();
+
+	m_file = open(filename, O_RDONLY);
+	if(m_file == -1)
+		return false;
+
+	struct stat info;
+	if(fstat(m_file, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void *data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+	if(data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t *>(data);
+	m_size = static_cast<size_t>(info.st_size);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void MappedFile::Close()
+{
+	if(m_data != NULL)
+	{
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+		m_data = NULL;
+	}
+	if(m_file != -1)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+	m_size = 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+uint64_t FileWriteTime(const char *filename)
+{
+	struct stat info;
+	if(stat(filename, &info) != 0)
+		return 0;
+
+	return static_cast<uint64_t>(info.st_mtime) * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+#endif // _WIN32
+
+} // namespace Helix
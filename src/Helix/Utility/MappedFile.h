@@ -0,0 +1,48 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// MappedFile
+//
+// A whole file mapped read only into the address space.  Pages come in from
+// the file cache as they're touched, so nothing is read up front and nothing
+// is copied; the data stays valid until Close().
+// ****************************************************************************
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool	Open(const char *filename);
+	void	Close();
+
+	bool			IsOpen() const	{ return m_data != NULL; }
+	const uint8_t *	Data() const	{ return m_data; }
+	size_t			Size() const	{ return m_size; }
+
+private:
+	MappedFile(const MappedFile &other);
+	MappedFile & operator=(const MappedFile &other);
+
+	const uint8_t *	m_data;
+	size_t			m_size;
+#ifdef _WIN32
+	void *			m_file;
+	void *			m_mapping;
+#else
+	int				m_file;
+#endif
+};
+
+// Last write time of a file in the OS's units, or 0 if it doesn't exist.
+// Only good for comparing against another file's.
+uint64_t	FileWriteTime(const char *filename);
+
+} // namespace Helix
+#endif // MAPPEDFILE_H
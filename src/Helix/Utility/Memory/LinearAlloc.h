@@ -0,0 +1,178 @@
+#ifndef LINEARALLOC_H
+#define LINEARALLOC_H
+
+namespace Helix
+{
+
+// ****************************************************************************
+// LinearAllocator
+//
+// Bump allocator for data that only lives for a single frame.  Allocations are
+// carved off the front of a block and are never freed individually; Reset()
+// releases everything in one step.
+//
+// If a frame needs more memory than the current block holds, overflow blocks
+// are chained on behind it.  The next Reset() throws the chain away and
+// replaces it with one block big enough for the high water mark, so once the
+// working set has been seen the allocator stops touching the heap.
+// ****************************************************************************
+class LinearAllocator
+{
+public:
+	LinearAllocator(size_t initialSize = 64*1024)
+	: m_blocks(NULL)
+	, m_initialSize(initialSize)
+	, m_bytesUsed(0)
+	, m_heapAllocations(0)
+	, m_overflows(0)
+	{
+		_ASSERT(initialSize > 0);
+	}
+
+	~LinearAllocator()
+	{
+		FreeBlocks();
+	}
+
+	// Returns a chunk of memory of at least size bytes.  Alignment must be a
+	// power of 2.
+	void * Alloc(size_t size, size_t alignment = 16)
+	{
+		_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+		if(m_blocks == NULL)
+		{
+			AddBlock(size + alignment > m_initialSize ? size + alignment : m_initialSize);
+		}
+
+		size_t offset = (m_blocks->m_used + (alignment - 1)) & ~(alignment - 1);
+		if(offset + size > m_blocks->m_size)
+		{
+			// Overflow block.  Make it at least as big as everything we've
+			// handed out so far so a runaway frame doesn't chain hundreds.
+			size_t blockSize = m_blocks->m_size * 2;
+			if(blockSize < size + alignment)
+			{
+				blockSize = size + alignment;
+			}
+
+			AddBlock(blockSize);
+			m_overflows++;
+			offset = (m_blocks->m_used + (alignment - 1)) & ~(alignment - 1);
+		}
+
+		void *ptr = m_blocks->Data() + offset;
+		m_bytesUsed += (offset - m_blocks->m_used) + size;
+		m_blocks->m_used = offset + size;
+		return ptr;
+	}
+
+	template<typename T>
+	T * Alloc(size_t count)
+	{
+		return static_cast<T *>(Alloc(count * sizeof(T), __alignof(T) > 16 ? __alignof(T) : 16));
+	}
+
+	// Releases every allocation made since the last reset.  Any pointers
+	// handed out before this call are invalid afterwards.
+	void Reset()
+	{
+		m_bytesUsed = 0;
+		m_heapAllocations = 0;
+
+		if(m_blocks != NULL && m_blocks->m_next != NULL)
+		{
+			// We overflowed last frame.  Collapse the chain into a single
+			// block that can hold the whole frame.  The allocation is charged
+			// to the coming frame.
+			size_t highWater = 0;
+			for(Block *block = m_blocks; block != NULL; block = block->m_next)
+			{
+				highWater += block->m_size;
+			}
+
+			FreeBlocks();
+			AddBlock(highWater);
+		}
+		else if(m_blocks != NULL)
+		{
+			m_blocks->m_used = 0;
+		}
+	}
+
+	// Bytes handed out since the last Reset (including alignment padding)
+	size_t			BytesUsed() const		{ return m_bytesUsed; }
+
+	// Number of trips to the heap since the last Reset.  Zero in steady state.
+	unsigned int	HeapAllocations() const	{ return m_heapAllocations; }
+
+	// Overflow blocks chained on over the allocator's whole life.  Never
+	// reset, so a caller can tell a frame outgrew the arena without having
+	// to look before every Reset().
+	unsigned int	Overflows() const		{ return m_overflows; }
+
+	size_t Capacity() const
+	{
+		size_t capacity = 0;
+		for(Block *block = m_blocks; block != NULL; block = block->m_next)
+		{
+			capacity += block->m_size;
+		}
+		return capacity;
+	}
+
+private:
+	LinearAllocator(const LinearAllocator &other);
+	LinearAllocator & operator=(const LinearAllocator &other);
+
+	struct Block
+	{
+		Block *		m_next;
+		size_t		m_size;
+		size_t		m_used;
+
+		// Block header is padded so the data that follows starts 16 byte aligned
+		char *	Data() { return reinterpret_cast<char *>(this) + HEADER_SIZE; }
+	};
+
+	static const size_t	HEADER_SIZE = (sizeof(Block) + 15) & ~15;
+
+	void AddBlock(size_t size)
+	{
+		// new[] only guarantees 8 byte alignment on 32 bit, so over-allocate
+		// enough to align the block header ourselves
+		char *raw = new char[HEADER_SIZE + size + 16 + sizeof(char *)];
+		size_t aligned = (reinterpret_cast<size_t>(raw) + sizeof(char *) + 15) & ~static_cast<size_t>(15);
+		Block *block = reinterpret_cast<Block *>(aligned);
+		reinterpret_cast<char **>(block)[-1] = raw;
+
+		block->m_next = m_blocks;
+		block->m_size = size;
+		block->m_used = 0;
+		m_blocks = block;
+
+		m_heapAllocations++;
+	}
+
+	void FreeBlocks()
+	{
+		Block *block = m_blocks;
+		while(block != NULL)
+		{
+			Block *next = block->m_next;
+			delete [] reinterpret_cast<char **>(block)[-1];
+			block = next;
+		}
+		m_blocks = NULL;
+	}
+
+	Block *			m_blocks;			// Current block is at the head
+	size_t			m_initialSize;
+	size_t			m_bytesUsed;
+	unsigned int	m_heapAllocations;
+	unsigned int	m_overflows;
+};
+
+} // namespace Helix
+
+#endif // LINEARALLOC_H
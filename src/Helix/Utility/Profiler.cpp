@@ -0,0 +1,330 @@
+#include <windows.h>
+#include <stdio.h>
+#include "Profiler.h"
+
+#if HX_PROFILE
+
+namespace Helix {
+
+enum ProfileEventType
+{
+	PROFILE_ZONE = 0,
+	PROFILE_COUNTER,
+	PROFILE_FRAME,
+};
+
+struct ProfileEvent
+{
+	const char *	name;
+	uint64_t		start;		// Ticks
+	uint64_t		end;		// Ticks for a zone, the value for a counter or frame
+	uint32_t		type;
+};
+
+const LONG			MAX_PROFILE_THREADS = 64;
+const LONG			PROFILE_EVENTS_PER_THREAD = 64*1024;
+
+// Every thread that records gets one of these the first time it does.  Only
+// the owning thread ever writes to it.  The event count is bumped after the
+// event is written, so whoever writes the capture out never sees half an
+// event.  A buffer that fills up drops events until the next capture.
+struct ProfileThreadBuffer
+{
+	ProfileEvent *		events;
+	volatile LONG		numEvents;
+	volatile LONG		captureId;		// The capture the events belong to
+	unsigned int		dropped;
+	DWORD				threadId;
+	const char *		name;
+};
+
+volatile long				m_profileCapturing = 0;
+volatile LONG				m_profileCaptureId = 0;
+ProfileThreadBuffer *		m_profileThreads[MAX_PROFILE_THREADS];
+volatile LONG				m_numProfileThreads = 0;
+__declspec(thread) ProfileThreadBuffer *	m_profileThreadBuffer = NULL;
+
+// Ticks are converted to microseconds against QueryPerformanceCounter() over
+// the length of the capture
+uint64_t					m_captureStartTicks = 0;
+LARGE_INTEGER				m_captureStartTime;
+
+// ProfilerCaptureFrames()
+unsigned int				m_captureFramesPending = 0;
+unsigned int				m_captureFramesLeft = 0;
+char						m_captureFilename[MAX_PATH];
+uint64_t					m_frameNumber = 0;
+
+// ****************************************************************************
+// ****************************************************************************
+inline ProfileThreadBuffer * GetThreadBuffer()
+{
+	ProfileThreadBuffer *buffer = m_profileThreadBuffer;
+	if(buffer == NULL)
+	{
+		buffer = new ProfileThreadBuffer;
+		buffer->events = NULL;
+		buffer->numEvents = 0;
+		buffer->captureId = -1;
+		buffer->dropped = 0;
+		buffer->threadId = GetCurrentThreadId();
+		buffer->name = NULL;
+		m_profileThreadBuffer = buffer;
+
+		// Past the last slot a thread still records, but nobody reads it
+		LONG slot = InterlockedIncrement(&m_numProfileThreads) - 1;
+		if(slot < MAX_PROFILE_THREADS)
+		{
+			InterlockedExchangePointer(reinterpret_cast<void * volatile *>(&m_profileThreads[slot]), buffer);
+		}
+	}
+	return buffer;
+}
+
+// ****************************************************************************
+// The first event of a new capture throws away whatever the thread had from
+// the last one
+// ****************************************************************************
+inline void RecordEvent(ProfileEventType type, const char *name, uint64_t start, uint64_t end)
+{
+	ProfileThreadBuffer *buffer = GetThreadBuffer();
+
+	LONG captureId = m_profileCaptureId;
+	if(buffer->captureId != captureId)
+	{
+		if(buffer->events == NULL)
+		{
+			buffer->events = new ProfileEvent[PROFILE_EVENTS_PER_THREAD];
+		}
+		buffer->numEvents = 0;
+		buffer->dropped = 0;
+		buffer->captureId = captureId;
+	}
+
+	LONG count = buffer->numEvents;
+	if(count == PROFILE_EVENTS_PER_THREAD)
+	{
+		buffer->dropped++;
+		return;
+	}
+
+	ProfileEvent &event = buffer->events[count];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	event.type = type;
+
+	// Publish
+	buffer->numEvents = count + 1;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ProfileThreadName(const char *name)
+{
+	GetThreadBuffer()->name = name;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ProfileZone(const char *name, uint64_t start, uint64_t end)
+{
+	RecordEvent(PROFILE_ZONE, name, start, end);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ProfileCounter(const char *name, int64_t value)
+{
+	RecordEvent(PROFILE_COUNTER, name, __rdtsc(), static_cast<uint64_t>(value));
+}
+
+// ****************************************************************************
+// Also drives ProfilerCaptureFrames(), so only call it from one thread
+// ****************************************************************************
+void ProfileFrame()
+{
+	if(m_captureFramesPending > 0 && m_profileCapturing == 0)
+	{
+		unsigned int numFrames = m_captureFramesPending;
+		m_captureFramesPending = 0;
+		if(ProfilerBeginCapture())
+		{
+			m_captureFramesLeft = numFrames;
+		}
+	}
+	else if(m_captureFramesLeft > 0 && m_profileCapturing != 0)
+	{
+		if(--m_captureFramesLeft == 0)
+		{
+			ProfilerEndCapture(m_captureFilename);
+		}
+	}
+
+	if(m_profileCapturing != 0)
+	{
+		RecordEvent(PROFILE_FRAME, "Frame", __rdtsc(), m_frameNumber);
+	}
+	m_frameNumber++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ProfilerBeginCapture()
+{
+	if(m_profileCapturing != 0)
+		return false;
+
+	InterlockedIncrement(&m_profileCaptureId);
+	QueryPerformanceCounter(&m_captureStartTime);
+	m_captureStartTicks = __rdtsc();
+	InterlockedExchange(&m_profileCapturing, 1);
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ProfilerCaptureFrames(unsigned int numFrames, const char *filename)
+{
+	if(numFrames == 0 || m_profileCapturing != 0 || m_captureFramesPending != 0)
+		return false;
+
+	strncpy(m_captureFilename, filename, MAX_PATH - 1);
+	m_captureFilename[MAX_PATH - 1] = 0;
+	m_captureFramesPending = numFrames;
+	return true;
+}
+
+// ****************************************************************************
+// Names come from the code, but a stray quote or backslash would still
+// break the file
+// ****************************************************************************
+inline void WriteJsonString(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for(; *str != 0; str++)
+	{
+		char c = *str;
+		if(c == '"' || c == '\\')
+		{
+			fputc('\\', file);
+			fputc(c, file);
+		}
+		else if(static_cast<unsigned char>(c) < 0x20)
+		{
+			fprintf(file, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+// ****************************************************************************
+// Each thread's events go out as Chrome trace events: zones are complete
+// ("X") events, counters are "C" events and frames are global instant events.
+// ****************************************************************************
+bool WriteTrace(const char *filename, LONG captureId, uint64_t startTicks, double ticksPerMicrosecond)
+{
+	FILE *file = fopen(filename, "w");
+	if(file == NULL)
+		return false;
+
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	bool first = true;
+	unsigned int dropped = 0;
+	LONG numThreads = m_numProfileThreads < MAX_PROFILE_THREADS ? m_numProfileThreads : MAX_PROFILE_THREADS;
+	for(LONG threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		// A thread that just registered may not have filled its slot yet
+		ProfileThreadBuffer *buffer = m_profileThreads[threadIndex];
+		if(buffer == NULL)
+			continue;
+
+		DWORD tid = buffer->threadId;
+		if(buffer->name != NULL)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":", first ? "" : ",\n", tid);
+			WriteJsonString(file, buffer->name);
+			fprintf(file, "}}");
+			first = false;
+		}
+
+		if(buffer->captureId != captureId)
+			continue;
+
+		LONG numEvents = buffer->numEvents;
+		MemoryBarrier();
+		dropped += buffer->dropped;
+
+		for(LONG eventIndex = 0; eventIndex < numEvents; eventIndex++)
+		{
+			const ProfileEvent &event = buffer->events[eventIndex];
+
+			// Zones that straddled the start of the capture
+			if(event.start < startTicks)
+				continue;
+
+			double ts = static_cast<double>(event.start - startTicks) / ticksPerMicrosecond;
+			fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+			WriteJsonString(file, event.name);
+
+			switch(event.type)
+			{
+			case PROFILE_ZONE:
+				{
+					double dur = static_cast<double>(event.end - event.start) / ticksPerMicrosecond;
+					fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}", ts, dur, tid);
+				}
+				break;
+			case PROFILE_COUNTER:
+				fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"value\":%lld}}", ts, tid, static_cast<int64_t>(event.end));
+				break;
+			case PROFILE_FRAME:
+				fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"frame\":%llu}}", ts, tid, event.end);
+				break;
+			}
+			first = false;
+		}
+	}
+
+	fprintf(file, "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":%u}}\n", dropped);
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+// ****************************************************************************
+// Threads that are in the middle of recording an event when the flag drops
+// either publish it in time or don't; either way they never touch what's
+// already been published.
+// ****************************************************************************
+bool ProfilerEndCapture(const char *filename)
+{
+	if(m_profileCapturing == 0)
+		return false;
+
+	InterlockedExchange(&m_profileCapturing, 0);
+	m_captureFramesLeft = 0;
+
+	uint64_t endTicks = __rdtsc();
+	LARGE_INTEGER endTime;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&endTime);
+	QueryPerformanceFrequency(&frequency);
+
+	double microseconds = static_cast<double>(endTime.QuadPart - m_captureStartTime.QuadPart) * 1000000.0 / static_cast<double>(frequency.QuadPart);
+	double ticksPerMicrosecond = microseconds > 0.0 ? static_cast<double>(endTicks - m_captureStartTicks) / microseconds : 1.0;
+	if(ticksPerMicrosecond <= 0.0)
+		ticksPerMicrosecond = 1.0;
+
+	return WriteTrace(filename, m_profileCaptureId, m_captureStartTicks, ticksPerMicrosecond);
+}
+
+} // namespace Helix
+
+#endif // HX_PROFILE
@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// ****************************************************************************
+// CPU profiler
+//
+// Instrument code with the macros below, then bracket the frames you're
+// interested in with ProfilerBeginCapture()/ProfilerEndCapture() (or let
+// ProfilerCaptureFrames() do it) to get a Chrome trace JSON file that loads
+// in chrome://tracing or Perfetto.
+//
+//	HX_PROFILE_THREAD("Render");			Names the calling thread in the trace
+//	HX_PROFILE_SCOPE("FillGBuffer");		Times the rest of the enclosing block
+//	HX_PROFILE_COUNTER("Draw calls", n);	Plots a value over time
+//	HX_PROFILE_FRAME();						Marks the start of a frame
+//
+// Every thread records into its own fixed size buffer that only it writes
+// to, so recording never takes a lock.  When nothing is being captured a
+// zone costs a flag test.  Names must be string literals or otherwise live
+// until the capture is written out.
+//
+// Build with HX_PROFILE=0 and the macros compile to nothing.
+// ****************************************************************************
+
+#ifndef HX_PROFILE
+#define HX_PROFILE 1
+#endif
+
+#if HX_PROFILE
+#include <intrin.h>
+#endif
+
+namespace Helix {
+
+#if HX_PROFILE
+
+extern volatile long	m_profileCapturing;
+
+// Starts recording on every thread.  Returns false if a capture is already
+// running.
+bool	ProfilerBeginCapture();
+
+// Stops recording and writes everything captured to filename.  Returns false
+// if there wasn't a capture or the file couldn't be written.
+bool	ProfilerEndCapture(const char *filename);
+
+// Captures the next numFrames frames, as counted by HX_PROFILE_FRAME(), and
+// writes them to filename.  The name is copied.
+bool	ProfilerCaptureFrames(unsigned int numFrames, const char *filename);
+
+inline bool	ProfilerCapturing()		{ return m_profileCapturing != 0; }
+
+void	ProfileThreadName(const char *name);
+void	ProfileZone(const char *name, uint64_t start, uint64_t end);
+void	ProfileCounter(const char *name, int64_t value);
+void	ProfileFrame();
+
+// ****************************************************************************
+// Times its own lifetime.  A zone that started before the capture did is
+// dropped.
+// ****************************************************************************
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char *name)
+	: m_name(name)
+	, m_start(m_profileCapturing != 0 ? __rdtsc() : 0)
+	{
+	}
+
+	~ProfileScope()
+	{
+		if(m_start != 0)
+			ProfileZone(m_name, m_start, __rdtsc());
+	}
+
+private:
+	ProfileScope(const ProfileScope &other);
+	ProfileScope & operator=(const ProfileScope &other);
+
+	const char *	m_name;
+	uint64_t		m_start;
+};
+
+#define HX_PROFILE_CONCAT2(a, b)		a##b
+#define HX_PROFILE_CONCAT(a, b)			HX_PROFILE_CONCAT2(a, b)
+#define HX_PROFILE_SCOPE(name)			Helix::ProfileScope HX_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define HX_PROFILE_COUNTER(name, value)	do { if(Helix::m_profileCapturing != 0) Helix::ProfileCounter(name, static_cast<int64_t>(value)); } while(0)
+#define HX_PROFILE_FRAME()				Helix::ProfileFrame()
+#define HX_PROFILE_THREAD(name)			Helix::ProfileThreadName(name)
+
+#else
+
+inline bool	ProfilerBeginCapture()										{ return false; }
+inline bool	ProfilerEndCapture(const char *filename)					{ return false; }
+inline bool	ProfilerCaptureFrames(unsigned int numFrames, const char *filename)	{ return false; }
+inline bool	ProfilerCapturing()											{ return false; }
+
+#define HX_PROFILE_SCOPE(name)			((void)0)
+#define HX_PROFILE_COUNTER(name, value)	((void)0)
+#define HX_PROFILE_FRAME()				((void)0)
+#define HX_PROFILE_THREAD(name)			((void)0)
+
+#endif // HX_PROFILE
+
+} // namespace Helix
+#endif // PROFILER_H
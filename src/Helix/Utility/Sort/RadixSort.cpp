@@ -0,0 +1,84 @@
+#include <string.h>
+#include "RadixSort.h"
+
+namespace Helix {
+
+const int	RADIX_BITS = 8;
+const int	RADIX_SIZE = 1 << RADIX_BITS;
+const int	RADIX_PASSES = 64 / RADIX_BITS;
+
+// ****************************************************************************
+// ****************************************************************************
+void RadixSort64(uint64_t *keys, uint32_t *values, uint64_t *tmpKeys, uint32_t *tmpValues, unsigned int count)
+{
+	if(count < 2)
+	{
+		return;
+	}
+
+	// Build the histograms for every pass at once
+	unsigned int histograms[RADIX_PASSES][RADIX_SIZE];
+	memset(histograms, 0, sizeof(histograms));
+
+	for(unsigned int index = 0; index < count; index++)
+	{
+		uint64_t key = keys[index];
+		for(int pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+		}
+	}
+
+	uint64_t *srcKeys = keys;
+	uint32_t *srcValues = values;
+	uint64_t *dstKeys = tmpKeys;
+	uint32_t *dstValues = tmpValues;
+
+	for(int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		unsigned int *histogram = histograms[pass];
+		int shift = pass * RADIX_BITS;
+
+		// If every key has the same digit this pass can't change the order
+		unsigned int digit = static_cast<unsigned int>((srcKeys[0] >> shift) & (RADIX_SIZE - 1));
+		if(histogram[digit] == count)
+		{
+			continue;
+		}
+
+		// Turn the counts into starting offsets
+		unsigned int offset = 0;
+		for(int bucket = 0; bucket < RADIX_SIZE; bucket++)
+		{
+			unsigned int bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		// Scatter
+		for(unsigned int index = 0; index < count; index++)
+		{
+			uint64_t key = srcKeys[index];
+			unsigned int dst = histogram[(key >> shift) & (RADIX_SIZE - 1)]++;
+			dstKeys[dst] = key;
+			dstValues[dst] = srcValues[index];
+		}
+
+		// Ping pong
+		uint64_t *swapKeys = srcKeys;
+		uint32_t *swapValues = srcValues;
+		srcKeys = dstKeys;
+		srcValues = dstValues;
+		dstKeys = swapKeys;
+		dstValues = swapValues;
+	}
+
+	// Odd number of passes leaves the result in the temp buffers
+	if(srcKeys != keys)
+	{
+		memcpy(keys, srcKeys, count * sizeof(uint64_t));
+		memcpy(values, srcValues, count * sizeof(uint32_t));
+	}
+}
+
+} // namespace Helix
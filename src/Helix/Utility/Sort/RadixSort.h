@@ -0,0 +1,24 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stdint.h>
+
+namespace Helix {
+
+// ****************************************************************************
+// LSD radix sort of 64 bit keys with a 32 bit payload (usually an index into
+// the array the keys were built from).
+//
+// Sorts 8 bits per pass.  All eight histograms are built in a single read of
+// the keys and any pass where every key lands in the same bucket is skipped,
+// so keys that only use the low bits (or share their high bits) cost fewer
+// passes.  The sort is stable and linear in count.
+//
+// tmpKeys/tmpValues must hold count entries.  The sorted result is always
+// left in keys/values.
+// ****************************************************************************
+void	RadixSort64(uint64_t *keys, uint32_t *values, uint64_t *tmpKeys, uint32_t *tmpValues, unsigned int count);
+
+} // namespace Helix
+
+#endif // RADIXSORT_H
@@ -0,0 +1,25 @@
+#ifndef LOOKUP3_H
+#define LOOKUP3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ****************************************************************************
+// Bob Jenkins' lookup3 hashes, from lookup3.c.  hashlittle2() gives two
+// 32 bit hashes for the price of one, primary in *pc; seed both with the
+// initial values wanted, or a previous result to hash more on the end.
+// ****************************************************************************
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t	hashword(const uint32_t *k, size_t length, uint32_t initval);
+uint32_t	hashlittle(const void *key, size_t length, uint32_t initval);
+void		hashlittle2(const void *key, size_t length, uint32_t *pc, uint32_t *pb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOOKUP3_H
@@ -0,0 +1,223 @@
+#include "Math/AABB.h"
+#include "Math/AABBTree.h"
+#include "Math/Frustum.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Culls a field of boxes against a few cameras three ways: FrustumCull(),
+// FrustumCullScalar() and AABBTree::QueryFrustum().  The two batch cullers must
+// keep exactly the boxes Frustum::TestAABB() keeps, and the tree exactly the
+// fat boxes it keeps, then each is timed.  The tree is queried once before
+// AABBTree::Flatten() as well, to check and time the walk it falls back to.
+//
+//	CullBenchmark [boxes] [iterations]
+// ****************************************************************************
+
+const float		FIELD_SIZE = 2000.0f;
+const float		MAX_EXTENT = 4.0f;
+const float		TREE_MARGIN = 0.1f;
+const int		NUM_CAMERAS = 4;
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline float RandomFloat(uint32_t &seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ****************************************************************************
+// Camera in the middle of the field looking out along yaw, so some of the
+// field is in front, some behind and a lot straddles the sides
+// ****************************************************************************
+Matrix4x4 CameraViewProj(int camera)
+{
+	Matrix4x4 proj;
+	proj.SetProjectionFOV(1.0f, 16.0f / 9.0f, 1.0f, FIELD_SIZE * 0.5f);
+
+	Matrix4x4 rotate;
+	rotate.SetYRotation(camera * 1.7f);
+
+	Matrix4x4 translate;
+	translate.SetTranslation(-FIELD_SIZE * 0.5f, -FIELD_SIZE * 0.125f, -FIELD_SIZE * 0.5f);
+
+	return proj * rotate * translate;
+}
+
+// ****************************************************************************
+// The tree keeps every fat box TestAABB() keeps, once each.  expected is 1
+// for those going in, and found ones are marked 2.
+// ****************************************************************************
+void CheckTreeResults(void * const *results, unsigned int numResults, unsigned char *expected, unsigned int numBoxes)
+{
+	for(unsigned int i=0;i<numResults;i++)
+	{
+		size_t index = reinterpret_cast<size_t>(results[i]);
+		if(TEST_CHECK(index < numBoxes) && TEST_CHECK(expected[index] == 1))
+			expected[index] = 2;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numBoxes = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 1000000;
+	int iterations = argc > 2 ? atoi(argv[2]) : 4;
+	if(numBoxes < 1 || iterations < 1)
+	{
+		fprintf(stderr, "Usage: CullBenchmark [boxes] [iterations]\n");
+		return 2;
+	}
+
+	unsigned int padded = (numBoxes + FRUSTUM_CULL_WIDTH - 1) & ~(FRUSTUM_CULL_WIDTH - 1);
+	float *streams = static_cast<float *>(_aligned_malloc(6 * padded * sizeof(float), FRUSTUM_CULL_ALIGN));
+	memset(streams, 0, 6 * padded * sizeof(float));
+
+	BoundsStream bounds;
+	bounds.centerX = streams;
+	bounds.centerY = streams + padded;
+	bounds.centerZ = streams + 2 * padded;
+	bounds.extentX = streams + 3 * padded;
+	bounds.extentY = streams + 4 * padded;
+	bounds.extentZ = streams + 5 * padded;
+	bounds.count = numBoxes;
+
+	// Each box's index is its user data in the tree
+	AABBTree tree(TREE_MARGIN);
+	uint32_t seed = 12345;
+	double start = TestSeconds();
+	for(unsigned int i=0;i<numBoxes;i++)
+	{
+		Vector3 center(RandomFloat(seed, 0.0f, FIELD_SIZE), RandomFloat(seed, 0.0f, FIELD_SIZE * 0.25f), RandomFloat(seed, 0.0f, FIELD_SIZE));
+		Vector3 extents(RandomFloat(seed, 0.1f, MAX_EXTENT), RandomFloat(seed, 0.1f, MAX_EXTENT), RandomFloat(seed, 0.1f, MAX_EXTENT));
+		bounds.centerX[i] = center.x;
+		bounds.centerY[i] = center.y;
+		bounds.centerZ[i] = center.z;
+		bounds.extentX[i] = extents.x;
+		bounds.extentY[i] = extents.y;
+		bounds.extentZ[i] = extents.z;
+
+		tree.CreateProxy(AABB(Vector3(center.x - extents.x, center.y - extents.y, center.z - extents.z), Vector3(center.x + extents.x, center.y + extents.y, center.z + extents.z)), reinterpret_cast<void *>(static_cast<size_t>(i)));
+	}
+	double buildSeconds = TestSeconds() - start;
+
+	void **treeVisible = new void *[numBoxes];
+	void **walkVisible = new void *[numBoxes];
+	Frustum firstFrustum;
+	firstFrustum.SetFromViewProj(CameraViewProj(0));
+	start = TestSeconds();
+	unsigned int numWalked = tree.QueryFrustum(firstFrustum, walkVisible);
+	double walkSeconds = TestSeconds() - start;
+
+	start = TestSeconds();
+	tree.Flatten();
+	double flattenSeconds = TestSeconds() - start;
+
+	// Fat boxes by index, to check the tree against
+	AABB *fatBoxes = new AABB[numBoxes];
+	for(unsigned int i=0;i<numBoxes;i++)
+	{
+		Vector3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		Vector3 extents(bounds.extentX[i] + TREE_MARGIN, bounds.extentY[i] + TREE_MARGIN, bounds.extentZ[i] + TREE_MARGIN);
+		fatBoxes[i] = AABB(Vector3(center.x - extents.x, center.y - extents.y, center.z - extents.z), Vector3(center.x + extents.x, center.y + extents.y, center.z + extents.z));
+	}
+
+	uint32_t *visible = new uint32_t[padded];
+	uint32_t *visibleScalar = new uint32_t[padded];
+	unsigned char *expected = new unsigned char[numBoxes];
+
+	double simdSeconds = 0.0;
+	double scalarSeconds = 0.0;
+	double treeSeconds = 0.0;
+	unsigned int totalVisible = 0;
+	unsigned int totalTreeVisible = 0;
+	for(int camera=0;camera<NUM_CAMERAS;camera++)
+	{
+		Frustum frustum;
+		frustum.SetFromViewProj(CameraViewProj(camera));
+
+		unsigned int numVisible = 0;
+		unsigned int numScalar = 0;
+		unsigned int numTree = 0;
+		for(int iteration=0;iteration<iterations;iteration++)
+		{
+			double t0 = TestSeconds();
+			numVisible = FrustumCull(frustum, bounds, visible);
+			double t1 = TestSeconds();
+			numScalar = FrustumCullScalar(frustum, bounds, visibleScalar);
+			double t2 = TestSeconds();
+			numTree = tree.QueryFrustum(frustum, treeVisible);
+			double t3 = TestSeconds();
+
+			simdSeconds += t1 - t0;
+			scalarSeconds += t2 - t1;
+			treeSeconds += t3 - t2;
+		}
+		totalVisible += numVisible;
+		totalTreeVisible += numTree;
+
+		// The batch cullers keep the same boxes, in order, as TestAABB()
+		unsigned int numExpected = 0;
+		for(unsigned int i=0;i<numBoxes;i++)
+		{
+			Vector3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+			Vector3 extents(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+			if(frustum.TestAABB(center, extents))
+			{
+				if(numExpected < numVisible)
+					TEST_CHECK(visible[numExpected] == i);
+				if(numExpected < numScalar)
+					TEST_CHECK(visibleScalar[numExpected] == i);
+				numExpected++;
+			}
+		}
+		TEST_CHECK(numVisible == numExpected);
+		TEST_CHECK(numScalar == numExpected);
+
+		unsigned int numTreeExpected = 0;
+		for(unsigned int i=0;i<numBoxes;i++)
+		{
+			expected[i] = frustum.TestAABB(fatBoxes[i]) ? 1 : 0;
+			numTreeExpected += expected[i];
+		}
+
+		if(camera == 0)
+		{
+			TEST_CHECK(numWalked == numTreeExpected);
+			CheckTreeResults(walkVisible, numWalked, expected, numBoxes);
+			for(unsigned int i=0;i<numBoxes;i++)
+			{
+				expected[i] = expected[i] != 0 ? 1 : 0;
+			}
+		}
+
+		TEST_CHECK(numTree == numTreeExpected);
+		CheckTreeResults(treeVisible, numTree, expected, numBoxes);
+	}
+
+	double perCull = 1.0 / (NUM_CAMERAS * iterations);
+	printf("%u boxes, tree height %d built in %.0f ms, flattened in %.1f ms, %d cameras\n", numBoxes, tree.GetHeight(), buildSeconds * 1000.0, flattenSeconds * 1000.0, NUM_CAMERAS);
+	printf("FrustumCull:       %.3f ms, %.2f ns per box (%u wide)\n", simdSeconds * perCull * 1000.0, simdSeconds * perCull * 1e9 / numBoxes,
+#if defined(__AVX__)
+		8u
+#else
+		4u
+#endif
+		);
+	printf("FrustumCullScalar: %.3f ms, %.2f ns per box\n", scalarSeconds * perCull * 1000.0, scalarSeconds * perCull * 1e9 / numBoxes);
+	printf("QueryFrustum:      %.3f ms, %.3f ms before Flatten()\n", treeSeconds * perCull * 1000.0, walkSeconds * 1000.0);
+	printf("Visible:           %.1f%% of boxes, %.1f%% of fat boxes\n", 100.0 * totalVisible / (static_cast<double>(numBoxes) * NUM_CAMERAS), 100.0 * totalTreeVisible / (static_cast<double>(numBoxes) * NUM_CAMERAS));
+
+	delete [] expected;
+	delete [] walkVisible;
+	delete [] treeVisible;
+	delete [] visibleScalar;
+	delete [] visible;
+	delete [] fatBoxes;
+	_aligned_free(streams);
+
+	return TestResult("CullBenchmark");
+}
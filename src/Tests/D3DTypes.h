@@ -0,0 +1,233 @@
+#pragma once
+
+// ****************************************************************************
+// The Win32 and D3D11 declarations the engine sources here use, for when
+// there's no <d3d11.h>.  Only types and the constants the sources spell out;
+// nothing is implemented, and the only device a test may call into is the
+// null one.  Values match the real headers so descs built here mean the same
+// thing on both.
+// ****************************************************************************
+
+typedef int32_t	LONG;
+typedef int32_t	HRESULT;
+#define S_OK						0
+#define SUCCEEDED(hr)				((hr) >= 0)
+#define ZeroMemory(dest, size)		memset((dest), 0, (size))
+
+#define D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT			8
+#define D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT	14
+#define D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT			16
+#define D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT			4096
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN =					0,
+	DXGI_FORMAT_R32G32B32A32_TYPELESS =		1,
+	DXGI_FORMAT_R32G32B32A32_FLOAT =		2,
+	DXGI_FORMAT_R16G16B16A16_TYPELESS =		9,
+	DXGI_FORMAT_R16G16B16A16_FLOAT =		10,
+	DXGI_FORMAT_R16G16B16A16_UNORM =		11,
+	DXGI_FORMAT_R16G16B16A16_SNORM =		13,
+	DXGI_FORMAT_R32G32_TYPELESS =			15,
+	DXGI_FORMAT_R32G32_FLOAT =				16,
+	DXGI_FORMAT_R8G8B8A8_UNORM =			28,
+	DXGI_FORMAT_R32_TYPELESS =				39,
+	DXGI_FORMAT_D32_FLOAT =					40,
+	DXGI_FORMAT_R32_FLOAT =					41,
+	DXGI_FORMAT_R32_UINT =					42,
+	DXGI_FORMAT_R24G8_TYPELESS =			44,
+	DXGI_FORMAT_D24_UNORM_S8_UINT =			45,
+	DXGI_FORMAT_R16_TYPELESS =				53,
+	DXGI_FORMAT_R16_FLOAT =					54,
+	DXGI_FORMAT_D16_UNORM =					55,
+	DXGI_FORMAT_R16_UNORM =					56,
+	DXGI_FORMAT_R16_UINT =					57,
+	DXGI_FORMAT_R16_SNORM =					58,
+	DXGI_FORMAT_R8_TYPELESS =				60,
+	DXGI_FORMAT_R8_UNORM =					61,
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT =					0,
+	D3D11_USAGE_IMMUTABLE =					1,
+	D3D11_USAGE_DYNAMIC =					2,
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER =				0x1,
+	D3D11_BIND_INDEX_BUFFER =				0x2,
+	D3D11_BIND_CONSTANT_BUFFER =			0x4,
+	D3D11_BIND_SHADER_RESOURCE =			0x8,
+	D3D11_BIND_RENDER_TARGET =				0x20,
+	D3D11_BIND_DEPTH_STENCIL =				0x40,
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE =				0x10000,
+};
+
+enum D3D11_CLEAR_FLAG
+{
+	D3D11_CLEAR_DEPTH =						0x1,
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_WRITE_DISCARD =				4,
+	D3D11_MAP_WRITE_NO_OVERWRITE =			5,
+};
+
+enum D3D11_DSV_DIMENSION
+{
+	D3D11_DSV_DIMENSION_TEXTURE2D =			3,
+};
+
+enum D3D11_RTV_DIMENSION
+{
+	D3D11_RTV_DIMENSION_TEXTURE2D =			4,
+};
+
+enum D3D11_SRV_DIMENSION
+{
+	D3D11_SRV_DIMENSION_TEXTURE2D =			4,
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+	D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED =	0,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST =	4,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP =	5,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA =			0,
+	D3D11_INPUT_PER_INSTANCE_DATA =			1,
+};
+
+struct D3D11_RECT
+{
+	LONG	left;
+	LONG	top;
+	LONG	right;
+	LONG	bottom;
+};
+
+struct D3D11_VIEWPORT
+{
+	float	TopLeftX;
+	float	TopLeftY;
+	float	Width;
+	float	Height;
+	float	MinDepth;
+	float	MaxDepth;
+};
+
+struct D3D11_BUFFER_DESC
+{
+	unsigned int	ByteWidth;
+	D3D11_USAGE		Usage;
+	unsigned int	BindFlags;
+	unsigned int	CPUAccessFlags;
+	unsigned int	MiscFlags;
+	unsigned int	StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void *	pSysMem;
+	unsigned int	SysMemPitch;
+	unsigned int	SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void *			pData;
+	unsigned int	RowPitch;
+	unsigned int	DepthPitch;
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	unsigned int	Count;
+	unsigned int	Quality;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+	unsigned int		Width;
+	unsigned int		Height;
+	unsigned int		MipLevels;
+	unsigned int		ArraySize;
+	DXGI_FORMAT			Format;
+	DXGI_SAMPLE_DESC	SampleDesc;
+	D3D11_USAGE			Usage;
+	unsigned int		BindFlags;
+	unsigned int		CPUAccessFlags;
+	unsigned int		MiscFlags;
+};
+
+struct D3D11_TEX2D_DSV		{ unsigned int MipSlice; };
+struct D3D11_TEX2D_RTV		{ unsigned int MipSlice; };
+struct D3D11_TEX2D_SRV		{ unsigned int MostDetailedMip; unsigned int MipLevels; };
+
+struct D3D11_DEPTH_STENCIL_VIEW_DESC
+{
+	DXGI_FORMAT				Format;
+	D3D11_DSV_DIMENSION		ViewDimension;
+	unsigned int			Flags;
+	D3D11_TEX2D_DSV			Texture2D;
+};
+
+struct D3D11_RENDER_TARGET_VIEW_DESC
+{
+	DXGI_FORMAT				Format;
+	D3D11_RTV_DIMENSION		ViewDimension;
+	D3D11_TEX2D_RTV			Texture2D;
+};
+
+struct D3D11_SHADER_RESOURCE_VIEW_DESC
+{
+	DXGI_FORMAT				Format;
+	D3D11_SRV_DIMENSION		ViewDimension;
+	D3D11_TEX2D_SRV			Texture2D;
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char *				SemanticName;
+	unsigned int				SemanticIndex;
+	DXGI_FORMAT					Format;
+	unsigned int				InputSlot;
+	unsigned int				AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION	InputSlotClass;
+	unsigned int				InstanceDataStepRate;
+};
+
+// Only ever passed by pointer
+struct D3D11_BLEND_DESC;
+struct D3D11_DEPTH_STENCIL_DESC;
+struct D3D11_RASTERIZER_DESC;
+struct D3D11_SAMPLER_DESC;
+
+// Interfaces, with the inheritance the engine converts along
+struct ID3D11DeviceChild						{};
+struct ID3D11Resource : ID3D11DeviceChild		{};
+struct ID3D11Buffer : ID3D11Resource			{};
+struct ID3D11Texture2D : ID3D11Resource			{};
+struct ID3D11DepthStencilView : ID3D11DeviceChild	{};
+struct ID3D11RenderTargetView : ID3D11DeviceChild	{};
+struct ID3D11ShaderResourceView : ID3D11DeviceChild	{};
+struct ID3D11VertexShader : ID3D11DeviceChild	{};
+struct ID3D11PixelShader : ID3D11DeviceChild	{};
+struct ID3D11GeometryShader : ID3D11DeviceChild	{};
+struct ID3D11HullShader : ID3D11DeviceChild		{};
+struct ID3D11DomainShader : ID3D11DeviceChild	{};
+struct ID3D11InputLayout : ID3D11DeviceChild	{};
+struct ID3D11BlendState : ID3D11DeviceChild		{};
+struct ID3D11DepthStencilState : ID3D11DeviceChild	{};
+struct ID3D11RasterizerState : ID3D11DeviceChild	{};
+struct ID3D11SamplerState : ID3D11DeviceChild	{};
@@ -0,0 +1,332 @@
+#include "Math/Matrix.h"
+#include "RenderCore/LightBounds.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Checks ComputeLightScreenBounds() against ComputeLightScreenBoundsScalar(),
+// and both against the sphere itself: points on each light's outer sphere in
+// front of the near plane are projected one by one, and the rectangle must
+// cover them, clamped to the screen, without being much bigger.  The lights are placed in view space so that plenty
+// of them are cut by the near plane, have the eye inside them, or are behind
+// the camera altogether.
+//
+//	LightBoundsTest [lights]
+// ****************************************************************************
+
+const float		IMAGE_WIDTH = 1280.0f;
+const float		IMAGE_HEIGHT = 720.0f;
+const float		NEAR_Z = 0.5f;
+const float		FAR_Z = 500.0f;
+
+const int		NUM_SPHERE_SAMPLES = 16384;
+const int		NUM_CIRCLE_SAMPLES = 1024;
+
+// A rectangle may be this much bigger than the samples, in pixels, since the
+// samples never land exactly on the extremes
+const float		TIGHTNESS = 2.0f;
+
+// And a sample this far outside it, for the difference between projecting a
+// point and the closed form
+const float		SAMPLE_EPSILON = 0.05f;
+
+enum Placement
+{
+	PLACE_IN_FRONT = 0,
+	PLACE_NEAR_PLANE,		// Center within a radius of the near plane
+	PLACE_AROUND_EYE,		// The eye is inside the sphere
+	PLACE_BEHIND,			// Entirely behind the near plane
+	NUM_PLACEMENTS
+};
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline float RandomFloat(uint32_t &seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ****************************************************************************
+// A view space sphere for the placement
+// ****************************************************************************
+void PlaceLight(uint32_t &seed, int placement, Vector3 &center, float &radius)
+{
+	radius = RandomFloat(seed, 0.25f, 20.0f);
+	switch(placement)
+	{
+	case PLACE_IN_FRONT:
+		center.z = RandomFloat(seed, NEAR_Z + radius, FAR_Z);
+		center.x = RandomFloat(seed, -1.2f, 1.2f) * center.z;
+		center.y = RandomFloat(seed, -0.8f, 0.8f) * center.z;
+		break;
+	case PLACE_NEAR_PLANE:
+		center.z = NEAR_Z + RandomFloat(seed, -0.95f, 0.95f) * radius;
+		center.x = RandomFloat(seed, -2.0f, 2.0f) * radius;
+		center.y = RandomFloat(seed, -2.0f, 2.0f) * radius;
+		break;
+	case PLACE_AROUND_EYE:
+		radius = RandomFloat(seed, 4.0f * NEAR_Z, 20.0f);
+		center.x = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		center.y = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		center.z = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		break;
+	default:
+		center.z = NEAR_Z - radius - RandomFloat(seed, 0.001f, 100.0f);
+		center.x = RandomFloat(seed, -100.0f, 100.0f);
+		center.y = RandomFloat(seed, -100.0f, 100.0f);
+		break;
+	}
+}
+
+// ****************************************************************************
+// Where a view space point lands in pixels
+// ****************************************************************************
+inline void ProjectPoint(const Matrix4x4 &proj, const Vector3 &point, float &x, float &y)
+{
+	Vector4 clip = proj * Vector4(point.x, point.y, point.z, 1.0f);
+	x = (clip.x / clip.w + 1.0f) * 0.5f * IMAGE_WIDTH;
+	y = (1.0f - clip.y / clip.w) * 0.5f * IMAGE_HEIGHT;
+}
+
+// ****************************************************************************
+// Extremes of the projected samples of the sphere, clamped to the screen once
+// they're all in
+// ****************************************************************************
+struct SampleBounds
+{
+	float	minX;
+	float	maxX;
+	float	minY;
+	float	maxY;
+	int		numSamples;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+inline void AddSample(const Matrix4x4 &proj, const Vector3 &point, SampleBounds &samples)
+{
+	float x, y;
+	ProjectPoint(proj, point, x, y);
+
+	samples.minX = x < samples.minX ? x : samples.minX;
+	samples.maxX = x > samples.maxX ? x : samples.maxX;
+	samples.minY = y < samples.minY ? y : samples.minY;
+	samples.maxY = y > samples.maxY ? y : samples.maxY;
+	samples.numSamples++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline float Clamp(float value, float high)
+{
+	return value < 0.0f ? 0.0f : (value > high ? high : value);
+}
+
+// ****************************************************************************
+// Points over the sphere in front of the near plane, plus the circle where it
+// crosses the near plane, which bounds the clipped part
+// ****************************************************************************
+SampleBounds SampleSphere(const Matrix4x4 &proj, const Vector3 &center, float radius)
+{
+	SampleBounds samples;
+	samples.minX = samples.minY = FLT_MAX;
+	samples.maxX = samples.maxY = -FLT_MAX;
+	samples.numSamples = 0;
+
+	// Fibonacci sphere
+	const float goldenAngle = 2.39996323f;
+	for(int i=0;i<NUM_SPHERE_SAMPLES;i++)
+	{
+		float z = 1.0f - (2.0f * i + 1.0f) / NUM_SPHERE_SAMPLES;
+		float ring = sqrtf(1.0f - z * z);
+		float angle = goldenAngle * i;
+		Vector3 point(center.x + radius * ring * cosf(angle), center.y + radius * ring * sinf(angle), center.z + radius * z);
+		if(point.z >= NEAR_Z)
+			AddSample(proj, point, samples);
+	}
+
+	float dz = NEAR_Z - center.z;
+	if(dz * dz < radius * radius)
+	{
+		float circle = sqrtf(radius * radius - dz * dz);
+		for(int i=0;i<NUM_CIRCLE_SAMPLES;i++)
+		{
+			float angle = 6.28318531f * i / NUM_CIRCLE_SAMPLES;
+			AddSample(proj, Vector3(center.x + circle * cosf(angle), center.y + circle * sinf(angle), NEAR_Z), samples);
+		}
+	}
+
+	samples.minX = Clamp(samples.minX, IMAGE_WIDTH);
+	samples.maxX = Clamp(samples.maxX, IMAGE_WIDTH);
+	samples.minY = Clamp(samples.minY, IMAGE_HEIGHT);
+	samples.maxY = Clamp(samples.maxY, IMAGE_HEIGHT);
+	return samples;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool IsEmpty(const LightScreenBounds &bounds)
+{
+	return bounds.rect.left >= bounds.rect.right || bounds.rect.top >= bounds.rect.bottom;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numPointLights = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 4000;
+	if(numPointLights < 1)
+	{
+		fprintf(stderr, "Usage: LightBoundsTest [lights]\n");
+		return 2;
+	}
+
+	Matrix4x4 proj;
+	proj.SetProjectionFOV(1.0f, IMAGE_WIDTH / IMAGE_HEIGHT, NEAR_Z, FAR_Z);
+
+	// Any camera will do, as long as it isn't the identity
+	Matrix4x4 rotate;
+	rotate.SetYRotation(0.7f);
+	Matrix4x4 translate;
+	translate.SetTranslation(-30.0f, -4.0f, 12.0f);
+	Matrix4x4 view = rotate * translate;
+
+	Matrix4x4 invView = view;
+	TEST_CHECK(invView.Invert());
+
+	// Point lights go in by placement, then a directional and a spot light,
+	// which cover the whole screen
+	uint32_t seed = 2024;
+	Vector3 *viewCenters = new Vector3[numPointLights];
+	int *placements = new int[numPointLights];
+	LightList lights;
+	for(unsigned int i=0;i<numPointLights;i++)
+	{
+		float radius;
+		placements[i] = i % NUM_PLACEMENTS;
+		PlaceLight(seed, placements[i], viewCenters[i], radius);
+
+		Vector4 world = invView * Vector4(viewCenters[i].x, viewCenters[i].y, viewCenters[i].z, 1.0f);
+		lights.AddPointLight(Vector3(world.x, world.y, world.z), Color(1.0f, 1.0f, 1.0f, 1.0f), radius * 0.5f, radius);
+	}
+
+	Light others[2];
+	others[0].m_type = Light::DIRECTIONAL;
+	others[0].dir.m_dir[0] = 0.0f;
+	others[0].dir.m_dir[1] = 0.0f;
+	others[0].dir.m_dir[2] = 1.0f;
+	others[0].m_color = Color(1.0f, 1.0f, 1.0f, 1.0f);
+	others[1].m_type = Light::SPOT;
+	others[1].cone.m_position[0] = 0.0f;
+	others[1].cone.m_position[1] = 0.0f;
+	others[1].cone.m_position[2] = 0.0f;
+	others[1].cone.m_dir[0] = 0.0f;
+	others[1].cone.m_dir[1] = -1.0f;
+	others[1].cone.m_dir[2] = 0.0f;
+	others[1].m_color = Color(1.0f, 1.0f, 1.0f, 1.0f);
+	lights.AddLights(others, 2);
+
+	unsigned int numLights = lights.Count();
+	LightScreenBounds *bounds = new LightScreenBounds[numLights];
+	LightScreenBounds *boundsScalar = new LightScreenBounds[numLights];
+
+	double start = TestSeconds();
+	unsigned int numVisible = ComputeLightScreenBounds(lights, view, proj, IMAGE_WIDTH, IMAGE_HEIGHT, bounds);
+	double simd = TestSeconds();
+	unsigned int numVisibleScalar = ComputeLightScreenBoundsScalar(lights, view, proj, IMAGE_WIDTH, IMAGE_HEIGHT, boundsScalar);
+	double scalar = TestSeconds();
+
+	// SIMD against scalar.  The view transform adds up in a different order,
+	// so an edge may round to the next pixel.
+	TEST_CHECK(numVisible == numVisibleScalar);
+	for(unsigned int i=0;i<numLights;i++)
+	{
+		const LightScreenBounds &a = bounds[i];
+		const LightScreenBounds &b = boundsScalar[i];
+		TEST_CHECK(IsEmpty(a) == IsEmpty(b));
+		if(IsEmpty(a) || IsEmpty(b))
+			continue;
+
+		TEST_CHECK(abs(a.rect.left - b.rect.left) <= 1 && abs(a.rect.right - b.rect.right) <= 1);
+		TEST_CHECK(abs(a.rect.top - b.rect.top) <= 1 && abs(a.rect.bottom - b.rect.bottom) <= 1);
+		TEST_CHECK(fabsf(a.minZ - b.minZ) <= 1e-4f * (1.0f + fabsf(b.minZ)));
+		TEST_CHECK(fabsf(a.maxZ - b.maxZ) <= 1e-4f * (1.0f + fabsf(b.maxZ)));
+	}
+
+	// Both against the sampled sphere
+	unsigned int numPlaced[NUM_PLACEMENTS];
+	unsigned int numPlacedVisible[NUM_PLACEMENTS];
+	memset(numPlaced, 0, sizeof(numPlaced));
+	memset(numPlacedVisible, 0, sizeof(numPlacedVisible));
+	unsigned int numCounted = 0;
+	for(unsigned int i=0;i<numPointLights;i++)
+	{
+		const Vector3 &center = viewCenters[i];
+		float radius = lights.OuterRadius()[i];
+		SampleBounds samples = SampleSphere(proj, center, radius);
+
+		numPlaced[placements[i]]++;
+		numPlacedVisible[placements[i]] += IsEmpty(bounds[i]) ? 0 : 1;
+		numCounted += IsEmpty(bounds[i]) ? 0 : 1;
+
+		if(placements[i] == PLACE_BEHIND)
+		{
+			TEST_CHECK(IsEmpty(bounds[i]) && IsEmpty(boundsScalar[i]));
+			TEST_CHECK(samples.numSamples == 0);
+			continue;
+		}
+
+		const LightScreenBounds *both[2] = { &bounds[i], &boundsScalar[i] };
+		for(int which=0;which<2;which++)
+		{
+			const LightScreenBounds &b = *both[which];
+			// Off screen, or too close to an edge to say which pixel
+			if(samples.maxX - samples.minX < 1.0f || samples.maxY - samples.minY < 1.0f)
+				continue;
+
+			// Every sample on screen is covered, which also means the light
+			// can't have been thrown away
+			if(!TEST_CHECK(!IsEmpty(b)))
+				continue;
+
+			bool covered =	samples.minX >= b.rect.left - SAMPLE_EPSILON && samples.maxX <= b.rect.right + SAMPLE_EPSILON &&
+							samples.minY >= b.rect.top - SAMPLE_EPSILON && samples.maxY <= b.rect.bottom + SAMPLE_EPSILON;
+			bool tight =	b.rect.left >= floorf(samples.minX) - TIGHTNESS && b.rect.right <= ceilf(samples.maxX) + TIGHTNESS &&
+							b.rect.top >= floorf(samples.minY) - TIGHTNESS && b.rect.bottom <= ceilf(samples.maxY) + TIGHTNESS;
+			if(!TEST_CHECK(covered && tight))
+			{
+				fprintf(stderr, "Light %u, placement %d, view (%g %g %g) r %g: rect [%d %d]x[%d %d], samples [%g %g]x[%g %g]\n", i, placements[i],
+					center.x, center.y, center.z, radius, b.rect.left, b.rect.right, b.rect.top, b.rect.bottom, samples.minX, samples.maxX, samples.minY, samples.maxY);
+			}
+
+			float minZ = center.z - radius > NEAR_Z ? center.z - radius : NEAR_Z;
+			float maxZ = center.z + radius < FAR_Z ? center.z + radius : FAR_Z;
+			TEST_CHECK(fabsf(b.minZ - minZ) <= 1e-3f * (1.0f + minZ) && fabsf(b.maxZ - maxZ) <= 1e-3f * (1.0f + maxZ));
+		}
+	}
+
+	// Lights that aren't point lights cover the whole screen
+	for(unsigned int i=numPointLights;i<numLights;i++)
+	{
+		TEST_CHECK(bounds[i].rect.left == 0 && bounds[i].rect.top == 0);
+		TEST_CHECK(bounds[i].rect.right == static_cast<LONG>(IMAGE_WIDTH) && bounds[i].rect.bottom == static_cast<LONG>(IMAGE_HEIGHT));
+		numCounted++;
+	}
+	TEST_CHECK(numVisible == numCounted);
+
+	// Every eye inside a light sees it over the whole screen
+	TEST_CHECK(numPlacedVisible[PLACE_AROUND_EYE] == numPlaced[PLACE_AROUND_EYE]);
+
+	printf("%u lights: %u visible, near plane %u of %u, around the eye %u of %u, behind %u of %u\n", numLights, numVisible,
+		numPlacedVisible[PLACE_NEAR_PLANE], numPlaced[PLACE_NEAR_PLANE], numPlacedVisible[PLACE_AROUND_EYE], numPlaced[PLACE_AROUND_EYE], numPlacedVisible[PLACE_BEHIND], numPlaced[PLACE_BEHIND]);
+	printf("SIMD %.1f us, scalar %.1f us\n", (simd - start) * 1e6, (scalar - simd) * 1e6);
+
+	delete [] boundsScalar;
+	delete [] bounds;
+	delete [] placements;
+	delete [] viewCenters;
+
+	return TestResult("LightBoundsTest");
+}
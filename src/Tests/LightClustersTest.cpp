@@ -0,0 +1,405 @@
+#include "Kernel/JobSystem.h"
+#include "Math/Matrix.h"
+#include "RenderCore/LightClusters.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Checks LightClusters::Build() against a brute force test of every light's
+// sphere against every cluster.  A cluster is the part of the view frustum
+// between its tile's four side planes and its slice's two depths:
+//  - If a point of the cluster can be found inside the sphere, the light has
+//    to be in the cluster's list.
+//  - If the light is in the list, its sphere grown to the box Build() works
+//    with can't be wholly outside any of the cluster's six planes.
+// The lights are placed in view space so plenty of them are behind the
+// camera, straddle the near plane or have the eye inside them.  A directional
+// and a spot light, and the padding after them, have negative radii and must
+// never be binned.  Then the lists are checked for packing and order, and
+// for coming out the same inline and on the job workers.
+//
+//	LightClustersTest [lights]
+// ****************************************************************************
+
+const float		IMAGE_WIDTH = 1280.0f;
+const float		IMAGE_HEIGHT = 720.0f;
+const float		FOV_Y = 1.0f;
+const float		NEAR_Z = 0.5f;
+const float		FAR_Z = 500.0f;
+
+// Depths tried across a cluster when looking for a point inside a sphere
+const int		NUM_DEPTH_SAMPLES = 8;
+
+// Slack for the view transform and the kernel rounding differently from here
+const float		EPSILON = 1e-3f;
+
+const float		SQRT_3 = 1.7320508f;
+
+enum Placement
+{
+	PLACE_IN_FRONT = 0,
+	PLACE_NEAR_PLANE,		// Center within a radius of the near plane
+	PLACE_AROUND_EYE,		// The eye is inside the sphere
+	PLACE_BEHIND,			// Entirely behind the near plane
+	NUM_PLACEMENTS
+};
+
+// One cluster's bounds in view space.  x/z and y/z are scaled by the
+// projection, so they run -1 to 1 across the screen.
+struct ClusterCell
+{
+	float	minX;
+	float	maxX;
+	float	minY;
+	float	maxY;
+	float	nearZ;
+	float	farZ;
+};
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline float RandomFloat(uint32_t &seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ****************************************************************************
+// A view space sphere for the placement
+// ****************************************************************************
+void PlaceLight(uint32_t &seed, int placement, Vector3 &center, float &radius)
+{
+	radius = RandomFloat(seed, 0.25f, 20.0f);
+	switch(placement)
+	{
+	case PLACE_IN_FRONT:
+		center.z = RandomFloat(seed, NEAR_Z + radius, FAR_Z);
+		center.x = RandomFloat(seed, -1.2f, 1.2f) * center.z;
+		center.y = RandomFloat(seed, -0.8f, 0.8f) * center.z;
+		break;
+	case PLACE_NEAR_PLANE:
+		center.z = NEAR_Z + RandomFloat(seed, -0.95f, 0.95f) * radius;
+		center.x = RandomFloat(seed, -2.0f, 2.0f) * radius;
+		center.y = RandomFloat(seed, -2.0f, 2.0f) * radius;
+		break;
+	case PLACE_AROUND_EYE:
+		radius = RandomFloat(seed, 4.0f * NEAR_Z, 20.0f);
+		center.x = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		center.y = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		center.z = RandomFloat(seed, -0.5f, 0.5f) * radius;
+		break;
+	default:
+		center.z = NEAR_Z - radius - RandomFloat(seed, 0.001f, 100.0f);
+		center.x = RandomFloat(seed, -100.0f, 100.0f);
+		center.y = RandomFloat(seed, -100.0f, 100.0f);
+		break;
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline float Clamp(float value, float low, float high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+// ****************************************************************************
+// Worked out from the grid's size and the camera, not from Build()'s tables
+// ****************************************************************************
+ClusterCell GetCell(unsigned int tileX, unsigned int tileY, unsigned int slice)
+{
+	float tilesAcrossX = 0.5f * IMAGE_WIDTH / LightClusters::TILE_SIZE;
+	float tilesAcrossY = 0.5f * IMAGE_HEIGHT / LightClusters::TILE_SIZE;
+	float depthRatio = FAR_Z / NEAR_Z;
+
+	ClusterCell cell;
+	cell.minX = tileX / tilesAcrossX - 1.0f;
+	cell.maxX = Clamp((tileX + 1) / tilesAcrossX - 1.0f, -1.0f, 1.0f);
+	cell.maxY = 1.0f - tileY / tilesAcrossY;
+	cell.minY = Clamp(1.0f - (tileY + 1) / tilesAcrossY, -1.0f, 1.0f);
+	cell.nearZ = NEAR_Z * powf(depthRatio, static_cast<float>(slice) / LightClusters::DEPTH_SLICES);
+	cell.farZ = slice + 1 < LightClusters::DEPTH_SLICES ? NEAR_Z * powf(depthRatio, static_cast<float>(slice + 1) / LightClusters::DEPTH_SLICES) : FAR_Z;
+	return cell;
+}
+
+// ****************************************************************************
+// Whether some point of the cell is inside the sphere.  Tries the point of
+// each of a few depths across the cell nearest the center.  Every point
+// tried is in the cell, so a hit is certain; a miss might not be.
+// ****************************************************************************
+bool TouchesCell(const ClusterCell &cell, float xScale, float yScale, const Vector3 &center, float radius)
+{
+	float depths[NUM_DEPTH_SAMPLES + 1];
+	depths[0] = Clamp(center.z, cell.nearZ, cell.farZ);
+	for(int i=0;i<NUM_DEPTH_SAMPLES;i++)
+	{
+		depths[i + 1] = cell.nearZ + (cell.farZ - cell.nearZ) * i / (NUM_DEPTH_SAMPLES - 1);
+	}
+
+	float limit = radius * (1.0f - EPSILON) - EPSILON;
+	for(int i=0;i<=NUM_DEPTH_SAMPLES;i++)
+	{
+		float z = depths[i];
+		float x = Clamp(center.x, cell.minX * z / xScale, cell.maxX * z / xScale);
+		float y = Clamp(center.y, cell.minY * z / yScale, cell.maxY * z / yScale);
+		float dx = x - center.x;
+		float dy = y - center.y;
+		float dz = z - center.z;
+		if(dx * dx + dy * dy + dz * dz <= limit * limit)
+			return true;
+	}
+	return false;
+}
+
+// ****************************************************************************
+// Whether the sphere is wholly outside one of the cell's planes
+// ****************************************************************************
+bool OutsideCell(const ClusterCell &cell, float xScale, float yScale, const Vector3 &center, float radius)
+{
+	// Side planes go through the eye; scaled x/z = n is x*xScale - n*z = 0
+	float distances[6];
+	distances[0] = (center.x * xScale - cell.minX * center.z) / sqrtf(xScale * xScale + cell.minX * cell.minX);
+	distances[1] = (cell.maxX * center.z - center.x * xScale) / sqrtf(xScale * xScale + cell.maxX * cell.maxX);
+	distances[2] = (center.y * yScale - cell.minY * center.z) / sqrtf(yScale * yScale + cell.minY * cell.minY);
+	distances[3] = (cell.maxY * center.z - center.y * yScale) / sqrtf(yScale * yScale + cell.maxY * cell.maxY);
+	distances[4] = center.z - cell.nearZ;
+	distances[5] = cell.farZ - center.z;
+
+	for(int i=0;i<6;i++)
+	{
+		if(distances[i] < -radius)
+			return true;
+	}
+	return false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool SameClusters(const LightClusters &a, const LightClusters &b)
+{
+	return a.NumClusters() == b.NumClusters() && a.NumLightIndices() == b.NumLightIndices() && a.NumBinnedLights() == b.NumBinnedLights() &&
+		memcmp(a.ClusterOffsets(), b.ClusterOffsets(), a.NumClusters() * sizeof(uint32_t)) == 0 &&
+		memcmp(a.ClusterCounts(), b.ClusterCounts(), a.NumClusters() * sizeof(uint32_t)) == 0 &&
+		memcmp(a.LightIndices(), b.LightIndices(), a.NumLightIndices() * sizeof(uint32_t)) == 0;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numPointLights = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 2001;
+	if(numPointLights < 1)
+	{
+		fprintf(stderr, "Usage: LightClustersTest [lights]\n");
+		return 2;
+	}
+
+	ClusterCamera camera;
+	camera.fovY = FOV_Y;
+	camera.aspect = IMAGE_WIDTH / IMAGE_HEIGHT;
+	camera.nearZ = NEAR_Z;
+	camera.farZ = FAR_Z;
+	camera.imageWidth = IMAGE_WIDTH;
+	camera.imageHeight = IMAGE_HEIGHT;
+
+	float yScale = 1.0f / tanf(FOV_Y / 2.0f);
+	float xScale = yScale / camera.aspect;
+
+	// Any camera will do, as long as it isn't the identity
+	Matrix4x4 rotate;
+	rotate.SetYRotation(0.7f);
+	Matrix4x4 translate;
+	translate.SetTranslation(-30.0f, -4.0f, 12.0f);
+	Matrix4x4 view = rotate * translate;
+
+	Matrix4x4 invView = view;
+	TEST_CHECK(invView.Invert());
+
+	// Point lights go in by placement, then a directional and a spot light.
+	// The default count leaves the padding one lane.
+	uint32_t seed = 2025;
+	Vector3 *viewCenters = new Vector3[numPointLights];
+	int *placements = new int[numPointLights];
+	LightList lights;
+	for(unsigned int i=0;i<numPointLights;i++)
+	{
+		float radius;
+		placements[i] = i % NUM_PLACEMENTS;
+		PlaceLight(seed, placements[i], viewCenters[i], radius);
+
+		Vector4 world = invView * Vector4(viewCenters[i].x, viewCenters[i].y, viewCenters[i].z, 1.0f);
+		lights.AddPointLight(Vector3(world.x, world.y, world.z), Color(1.0f, 1.0f, 1.0f, 1.0f), radius * 0.5f, radius);
+	}
+
+	Light others[2];
+	others[0].m_type = Light::DIRECTIONAL;
+	others[0].dir.m_dir[0] = 0.0f;
+	others[0].dir.m_dir[1] = 0.0f;
+	others[0].dir.m_dir[2] = 1.0f;
+	others[0].m_color = Color(1.0f, 1.0f, 1.0f, 1.0f);
+	others[1].m_type = Light::SPOT;
+	others[1].cone.m_position[0] = 0.0f;
+	others[1].cone.m_position[1] = 0.0f;
+	others[1].cone.m_position[2] = 0.0f;
+	others[1].cone.m_dir[0] = 0.0f;
+	others[1].cone.m_dir[1] = -1.0f;
+	others[1].cone.m_dir[2] = 0.0f;
+	others[1].m_color = Color(1.0f, 1.0f, 1.0f, 1.0f);
+	lights.AddLights(others, 2);
+
+	unsigned int numLights = lights.Count();
+	unsigned int numPadded = lights.PaddedCount();
+
+	LightClusters clusters;
+	double start = TestSeconds();
+	clusters.Build(lights, view, camera);
+	double inlineSeconds = TestSeconds() - start;
+
+	unsigned int tilesX = clusters.NumTilesX();
+	unsigned int tilesY = clusters.NumTilesY();
+	unsigned int numClusters = clusters.NumClusters();
+	TEST_CHECK(tilesX == (static_cast<unsigned int>(IMAGE_WIDTH) + LightClusters::TILE_SIZE - 1) / LightClusters::TILE_SIZE);
+	TEST_CHECK(tilesY == (static_cast<unsigned int>(IMAGE_HEIGHT) + LightClusters::TILE_SIZE - 1) / LightClusters::TILE_SIZE);
+	TEST_CHECK(numClusters == tilesX * tilesY * LightClusters::DEPTH_SLICES);
+
+	// Slices begin where the camera says they do
+	for(unsigned int slice=0;slice<LightClusters::DEPTH_SLICES;slice++)
+	{
+		ClusterCell cell = GetCell(0, 0, slice);
+		float middle = 0.5f * (cell.nearZ + cell.farZ);
+		TEST_CHECK(clusters.DepthSlice(middle) == slice);
+		TEST_CHECK(clusters.DepthSlice(cell.nearZ * (1.0f + EPSILON)) == slice);
+		TEST_CHECK(clusters.DepthSlice(cell.farZ * (1.0f - EPSILON)) == slice);
+	}
+
+	// Packed back to back, each list in ascending order, with nothing but
+	// point lights in them
+	const uint32_t *offsets = clusters.ClusterOffsets();
+	const uint32_t *counts = clusters.ClusterCounts();
+	const uint32_t *indices = clusters.LightIndices();
+	unsigned int total = 0;
+	bool packed = true;
+	bool sorted = true;
+	bool pointLightsOnly = true;
+	bool *binned = new bool[numPadded];
+	memset(binned, 0, numPadded * sizeof(bool));
+	for(unsigned int c=0;c<numClusters;c++)
+	{
+		packed = packed && offsets[c] == total;
+		total += counts[c];
+		for(unsigned int i=0;i<counts[c];i++)
+		{
+			uint32_t light = indices[offsets[c] + i];
+			sorted = sorted && (i == 0 || light > indices[offsets[c] + i - 1]);
+			pointLightsOnly = pointLightsOnly && light < numPointLights;
+			if(light < numPadded)
+			{
+				binned[light] = true;
+			}
+		}
+	}
+	TEST_CHECK(packed && total == clusters.NumLightIndices());
+	TEST_CHECK(sorted);
+	TEST_CHECK(pointLightsOnly);
+
+	unsigned int numBinned = 0;
+	for(unsigned int i=0;i<numPadded;i++)
+	{
+		numBinned += binned[i] ? 1 : 0;
+	}
+	TEST_CHECK(numBinned == clusters.NumBinnedLights());
+
+	// Brute force, every light against every cluster
+	bool *inCluster = new bool[numPointLights];
+	unsigned int numMissing = 0;
+	unsigned int numLoose = 0;
+	unsigned int numTouching = 0;
+	unsigned int numPlacedBinned[NUM_PLACEMENTS];
+	unsigned int numPlaced[NUM_PLACEMENTS];
+	memset(numPlacedBinned, 0, sizeof(numPlacedBinned));
+	memset(numPlaced, 0, sizeof(numPlaced));
+	for(unsigned int slice=0;slice<LightClusters::DEPTH_SLICES;slice++)
+	{
+		for(unsigned int tileY=0;tileY<tilesY;tileY++)
+		{
+			for(unsigned int tileX=0;tileX<tilesX;tileX++)
+			{
+				unsigned int c = clusters.ClusterIndex(tileX, tileY, slice);
+				ClusterCell cell = GetCell(tileX, tileY, slice);
+
+				memset(inCluster, 0, numPointLights * sizeof(bool));
+				for(unsigned int i=0;i<counts[c];i++)
+				{
+					uint32_t light = indices[offsets[c] + i];
+					if(light < numPointLights)
+					{
+						inCluster[light] = true;
+					}
+				}
+
+				for(unsigned int light=0;light<numPointLights;light++)
+				{
+					float radius = lights.OuterRadius()[light];
+					bool touches = TouchesCell(cell, xScale, yScale, viewCenters[light], radius);
+					numTouching += touches ? 1 : 0;
+					if(touches && !inCluster[light])
+					{
+						if(numMissing++ < 10)
+						{
+							fprintf(stderr, "Light %u, placement %d, view (%g %g %g) r %g missing from cluster %u %u %u\n", light, placements[light],
+								viewCenters[light].x, viewCenters[light].y, viewCenters[light].z, radius, tileX, tileY, slice);
+						}
+					}
+
+					float grown = radius * SQRT_3 * (1.0f + EPSILON) + EPSILON;
+					if(inCluster[light] && OutsideCell(cell, xScale, yScale, viewCenters[light], grown))
+					{
+						if(numLoose++ < 10)
+						{
+							fprintf(stderr, "Light %u, placement %d, view (%g %g %g) r %g can't reach cluster %u %u %u\n", light, placements[light],
+								viewCenters[light].x, viewCenters[light].y, viewCenters[light].z, radius, tileX, tileY, slice);
+						}
+					}
+				}
+			}
+		}
+	}
+	TEST_CHECK(numMissing == 0);
+	TEST_CHECK(numLoose == 0);
+
+	for(unsigned int i=0;i<numPointLights;i++)
+	{
+		numPlaced[placements[i]]++;
+		numPlacedBinned[placements[i]] += binned[i] ? 1 : 0;
+	}
+
+	// Behind the camera is nowhere, and the eye inside a light puts it in
+	// the nearest slice of every tile.  Lights across the near plane are
+	// left to the brute force; some of them are off to the side.
+	TEST_CHECK(numPlacedBinned[PLACE_BEHIND] == 0);
+	TEST_CHECK(numPlacedBinned[PLACE_AROUND_EYE] == numPlaced[PLACE_AROUND_EYE]);
+
+	// The same lists from the workers
+	InitializeJobSystem(3);
+	LightClusters workerClusters;
+	workerClusters.Build(lights, view, camera);
+	start = TestSeconds();
+	workerClusters.Build(lights, view, camera);
+	double workerSeconds = TestSeconds() - start;
+	TEST_CHECK(SameClusters(clusters, workerClusters));
+	ShutdownJobSystem();
+
+	printf("%u lights in %ux%ux%u clusters: %u binned, %u list entries, %u light/cluster pairs touching\n", numLights, tilesX, tilesY,
+		LightClusters::DEPTH_SLICES, clusters.NumBinnedLights(), clusters.NumLightIndices(), numTouching);
+	printf("Near plane %u of %u binned, around the eye %u of %u, behind %u of %u\n", numPlacedBinned[PLACE_NEAR_PLANE], numPlaced[PLACE_NEAR_PLANE],
+		numPlacedBinned[PLACE_AROUND_EYE], numPlaced[PLACE_AROUND_EYE], numPlacedBinned[PLACE_BEHIND], numPlaced[PLACE_BEHIND]);
+	printf("Build %.1f us inline, %.1f us with 3 workers\n", inlineSeconds * 1e6, workerSeconds * 1e6);
+
+	delete [] inCluster;
+	delete [] binned;
+	delete [] placements;
+	delete [] viewCenters;
+
+	return TestResult("LightClustersTest");
+}
@@ -0,0 +1,325 @@
+#include "RenderCore/MeshBuild.h"
+#include "RenderCore/MeshFile.h"
+#include "RenderCore/MeshListParser.h"
+#include "Utility/MappedFile.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Cooks the holodeck's meshes into an .hxmesh the way the Cooker does, maps
+// it back and checks that everything handed to MeshFileWriter comes out of
+// MeshFileMeshes() as it went in: the table's names, bounds and counts, and
+// every vertex, index and occluder blob byte for byte, aligned and inside
+// the file.  The packed positions have to land back on the exported ones.
+// Cooking again has to give the same bytes, and copies of the file broken
+// one field at a time have to be refused.
+//
+// Run it from the root of the repository, or pass the MeshList.  The file
+// is written to the working directory and removed afterwards.
+//
+//	MeshFileTest [meshlist]
+// ****************************************************************************
+
+const char *	COOKED_FILE = "MeshFileTest.hxmesh";
+const char *	VERTEX_DECL = "pos3q_normoct_tex1h";
+
+// ****************************************************************************
+// pos3q_normoct_tex1h: quantized position, octahedral normal, half UVs
+// ****************************************************************************
+VertexLayout PackedLayout()
+{
+	VertexLayout layout;
+	layout.positionFormat = VERTEX_FORMAT_UNORM16;
+	layout.positionOffset = 0;
+	layout.normalFormat = VERTEX_FORMAT_OCT_SNORM16;
+	layout.normalOffset = 8;
+	layout.uvFormat = VERTEX_FORMAT_FLOAT16;
+	layout.uvOffset = 12;
+	layout.numUVSets = 1;
+	layout.vertexSize = 16;
+	return layout;
+}
+
+// ****************************************************************************
+// The first level's position indices, as CookMesh() gives the occluder
+// ****************************************************************************
+uint32_t * OccluderIndices(const MeshSourceLod &lod)
+{
+	unsigned int cornerSize = MeshSourceCornerSize(lod);
+	uint32_t *indices = new uint32_t[lod.numTriangles * 3];
+	for(unsigned int i=0;i<lod.numTriangles * 3;i++)
+	{
+		indices[i] = lod.corners[i * cornerSize];
+	}
+	return indices;
+}
+
+// ****************************************************************************
+// Every mesh of the list through BuildMeshLod() into writer
+// ****************************************************************************
+void CookMeshes(const MeshListParser &parser, MeshFileWriter &writer)
+{
+	VertexLayout layout = PackedLayout();
+	for(unsigned int i=0;i<parser.NumMeshes();i++)
+	{
+		const MeshSource &source = parser.GetMesh(i);
+		float boundsMin[3];
+		float boundsMax[3];
+		MeshSourceBounds(source.lods[0], boundsMin, boundsMax);
+
+		writer.BeginMesh(source.name.c_str(), source.material.c_str(), VERTEX_DECL, layout.vertexSize, boundsMin, boundsMax);
+		if(source.occluder)
+		{
+			uint32_t *indices = OccluderIndices(source.lods[0]);
+			writer.SetOccluder(source.lods[0].positions, source.lods[0].numPositions, indices, source.lods[0].numTriangles);
+			delete [] indices;
+		}
+
+		VertexQuantizeError error = { 0.0f, 0.0f, 0.0f };
+		for(unsigned int l=0;l<source.numLods;l++)
+		{
+			MeshBuildLod built;
+			BuildMeshLod(source.lods[l], layout, boundsMin, boundsMax, built, error);
+			writer.AddLod(l > 0 ? source.lods[l].error : 0.0f, built.vertices, built.numVertices, built.indices, built.numIndices, built.indices32 ? 4 : 2);
+			ReleaseMeshBuildLod(built);
+		}
+		writer.EndMesh();
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline bool Aligned(uint32_t offset)
+{
+	return offset % MESH_FILE_ALIGNMENT == 0;
+}
+
+// ****************************************************************************
+// Whether every packed position of the level is one of the exported ones,
+// give or take a quantization step
+// ****************************************************************************
+bool PositionsLandBack(const MeshFileMesh &mesh, const uint8_t *vertices, unsigned int numVertices, const MeshSourceLod &source)
+{
+	float scale[3];
+	float offset[3];
+	PositionDequantize(mesh.boundsMin, mesh.boundsMax, scale, offset);
+
+	for(unsigned int v=0;v<numVertices;v++)
+	{
+		uint16_t packed[4];
+		memcpy(packed, vertices + v * mesh.vertexSize, sizeof(packed));
+		if(packed[3] != 0xffff)
+			return false;
+
+		float position[3];
+		for(int axis=0;axis<3;axis++)
+		{
+			position[axis] = offset[axis] + scale[axis] * packed[axis] / 65535.0f;
+		}
+
+		bool found = false;
+		for(unsigned int p=0;p<source.numPositions && !found;p++)
+		{
+			const float *exported = source.positions + 3 * p;
+			found = true;
+			for(int axis=0;axis<3;axis++)
+			{
+				found = found && fabsf(position[axis] - exported[axis]) <= scale[axis] / 65535.0f + 1e-5f;
+			}
+		}
+		if(!found)
+			return false;
+	}
+	return true;
+}
+
+// ****************************************************************************
+// The mapped table and blobs against the source and a fresh build of it
+// ****************************************************************************
+void CheckMesh(const MeshFileMesh &mesh, const uint8_t *data, size_t size, const MeshSource &source)
+{
+	VertexLayout layout = PackedLayout();
+	TEST_CHECK(strcmp(mesh.name, source.name.c_str()) == 0);
+	TEST_CHECK(strcmp(mesh.material, source.material.c_str()) == 0);
+	TEST_CHECK(strcmp(mesh.vertexDecl, VERTEX_DECL) == 0);
+	TEST_CHECK(mesh.vertexSize == layout.vertexSize);
+	TEST_CHECK(((mesh.flags & MESH_FILE_OCCLUDER) != 0) == source.occluder);
+	TEST_CHECK(mesh.numLods == source.numLods);
+
+	float boundsMin[3];
+	float boundsMax[3];
+	MeshSourceBounds(source.lods[0], boundsMin, boundsMax);
+	TEST_CHECK(memcmp(mesh.boundsMin, boundsMin, sizeof(boundsMin)) == 0 && memcmp(mesh.boundsMax, boundsMax, sizeof(boundsMax)) == 0);
+
+	if(source.occluder)
+	{
+		const MeshSourceLod &lod = source.lods[0];
+		TEST_CHECK(Aligned(mesh.occluderPositionOffset) && Aligned(mesh.occluderIndexOffset));
+		TEST_CHECK(mesh.numOccluderPositions == lod.numPositions && mesh.numOccluderTriangles == lod.numTriangles);
+		TEST_CHECK(memcmp(data + mesh.occluderPositionOffset, lod.positions, lod.numPositions * 3 * sizeof(float)) == 0);
+
+		uint32_t *indices = OccluderIndices(lod);
+		TEST_CHECK(memcmp(data + mesh.occluderIndexOffset, indices, lod.numTriangles * 3 * sizeof(uint32_t)) == 0);
+		delete [] indices;
+	}
+
+	VertexQuantizeError error = { 0.0f, 0.0f, 0.0f };
+	for(unsigned int l=0;l<mesh.numLods && l<source.numLods;l++)
+	{
+		const MeshFileLod &lod = mesh.lods[l];
+		MeshBuildLod built;
+		BuildMeshLod(source.lods[l], layout, boundsMin, boundsMax, built, error);
+
+		TEST_CHECK(Aligned(lod.vertexOffset) && Aligned(lod.indexOffset));
+		TEST_CHECK(lod.vertexOffset + lod.numVertices * mesh.vertexSize <= size && lod.indexOffset + lod.numIndices * lod.indexSize <= size);
+		TEST_CHECK(lod.numVertices == built.numVertices && lod.numIndices == built.numIndices);
+		TEST_CHECK(lod.indexSize == (built.indices32 ? 4u : 2u));
+		TEST_CHECK(lod.error == (l > 0 ? source.lods[l].error : 0.0f));
+		TEST_CHECK(memcmp(data + lod.vertexOffset, built.vertices, built.numVertices * layout.vertexSize) == 0);
+		TEST_CHECK(memcmp(data + lod.indexOffset, built.indices, built.numIndices * lod.indexSize) == 0);
+		TEST_CHECK(PositionsLandBack(mesh, data + lod.vertexOffset, lod.numVertices, source.lods[l]));
+
+		ReleaseMeshBuildLod(built);
+	}
+}
+
+// ****************************************************************************
+// A copy of the file with one thing broken must be refused.  Each is made so
+// only the check it's named for can catch it.
+// ****************************************************************************
+enum Breakage
+{
+	BREAK_MAGIC = 0,
+	BREAK_VERSION,
+	BREAK_SIZE,					// More mapped than the header says
+	BREAK_TRUNCATED,			// Both agree, but the last blob is cut off
+	BREAK_MESH_COUNT,			// One more than the file has room for
+	BREAK_NAME,					// Not terminated
+	BREAK_LOD_COUNT,
+	BREAK_INDEX_SIZE,
+	BREAK_VERTEX_ALIGNMENT,
+	BREAK_INDEX_RANGE,			// Wraps if the size is worked out in 32 bits
+	BREAK_OCCLUDER_RANGE,
+	NUM_BREAKAGES
+};
+
+// ****************************************************************************
+// ****************************************************************************
+bool Refused(const uint8_t *data, size_t size, int breakage, unsigned int occluderMesh)
+{
+	uint8_t *copy = new uint8_t[size + MESH_FILE_ALIGNMENT];
+	memcpy(copy, data, size);
+	memset(copy + size, 0, MESH_FILE_ALIGNMENT);
+
+	MeshFileHeader *header = reinterpret_cast<MeshFileHeader *>(copy);
+	MeshFileMesh *meshes = reinterpret_cast<MeshFileMesh *>(copy + sizeof(MeshFileHeader));
+	MeshFileMesh &first = meshes[0];
+	size_t brokenSize = size;
+	switch(breakage)
+	{
+	case BREAK_MAGIC:				header->magic ^= 1;											break;
+	case BREAK_VERSION:				header->version++;											break;
+	case BREAK_SIZE:				brokenSize += MESH_FILE_ALIGNMENT;							break;
+	case BREAK_TRUNCATED:			brokenSize -= MESH_FILE_ALIGNMENT;	header->fileSize -= MESH_FILE_ALIGNMENT;	break;
+	case BREAK_MESH_COUNT:			header->numMeshes = static_cast<uint32_t>((size - sizeof(MeshFileHeader)) / sizeof(MeshFileMesh) + 1);	break;
+	case BREAK_NAME:				memset(first.name, 'x', MESH_FILE_NAME_SIZE);				break;
+	case BREAK_LOD_COUNT:			first.numLods = 0;											break;
+	case BREAK_INDEX_SIZE:			first.lods[0].indexSize = 1;								break;
+	case BREAK_VERTEX_ALIGNMENT:	first.lods[0].vertexOffset += 4;							break;
+	case BREAK_INDEX_RANGE:			first.lods[0].numIndices = 0x80000000u / first.lods[0].indexSize * 2;	break;
+	default:						meshes[occluderMesh].numOccluderTriangles = 0x10000000;		break;
+	}
+
+	unsigned int numMeshes = 1;
+	bool refused = MeshFileMeshes(copy, brokenSize, numMeshes) == NULL && numMeshes == 0;
+	delete [] copy;
+	return refused;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : "Content/Scenes/holodeck/holodeck.lua";
+
+	size_t size = 0;
+	char *text = TestReadFile(path, size);
+	if(!TEST_CHECK(text != NULL))
+		return TestResult("MeshFileTest");
+
+	MeshListParser parser;
+	bool parsed = TEST_CHECK(parser.Parse(text, size));
+	delete [] text;
+	if(!parsed || !TEST_CHECK(parser.NumMeshes() > 0))
+		return TestResult("MeshFileTest");
+
+	// Written twice from one writer, which puts its offsets back after each
+	MeshFileWriter writer;
+	CookMeshes(parser, writer);
+	TEST_CHECK(writer.NumMeshes() == parser.NumMeshes());
+	if(!TEST_CHECK(writer.Write(COOKED_FILE)))
+		return TestResult("MeshFileTest");
+
+	size_t firstSize = 0;
+	char *first = TestReadFile(COOKED_FILE, firstSize);
+	TEST_CHECK(writer.Write(COOKED_FILE));
+
+	size_t secondSize = 0;
+	char *second = TestReadFile(COOKED_FILE, secondSize);
+	TEST_CHECK(first != NULL && second != NULL && firstSize == secondSize && memcmp(first, second, firstSize) == 0);
+	delete [] second;
+
+	// And again from scratch: the same meshes always cook to the same bytes
+	MeshFileWriter again;
+	CookMeshes(parser, again);
+	TEST_CHECK(again.Write(COOKED_FILE));
+
+	MappedFile file;
+	if(!TEST_CHECK(file.Open(COOKED_FILE)))
+	{
+		delete [] first;
+		remove(COOKED_FILE);
+		return TestResult("MeshFileTest");
+	}
+	TEST_CHECK(first != NULL && firstSize == file.Size() && memcmp(first, file.Data(), firstSize) == 0);
+	delete [] first;
+
+	unsigned int numMeshes = 0;
+	const MeshFileMesh *meshes = MeshFileMeshes(file.Data(), file.Size(), numMeshes);
+	if(TEST_CHECK(meshes != NULL && numMeshes == parser.NumMeshes()))
+	{
+		const MeshFileHeader *header = reinterpret_cast<const MeshFileHeader *>(file.Data());
+		TEST_CHECK(header->magic == MESH_FILE_MAGIC && header->version == MESH_FILE_VERSION && header->fileSize == file.Size());
+
+		unsigned int occluderMesh = 0;
+		for(unsigned int i=0;i<numMeshes;i++)
+		{
+			CheckMesh(meshes[i], file.Data(), file.Size(), parser.GetMesh(i));
+			occluderMesh = parser.GetMesh(i).occluder ? i : occluderMesh;
+		}
+
+		unsigned int numRefused = 0;
+		for(int breakage=0;breakage<NUM_BREAKAGES;breakage++)
+		{
+			if(breakage == BREAK_OCCLUDER_RANGE && !parser.GetMesh(occluderMesh).occluder)
+			{
+				numRefused++;
+				continue;
+			}
+
+			if(!TEST_CHECK(Refused(file.Data(), file.Size(), breakage, occluderMesh)))
+			{
+				fprintf(stderr, "Breakage %d was let through\n", breakage);
+				continue;
+			}
+			numRefused++;
+		}
+
+		printf("%s: %u meshes, %zu bytes, %u of %u broken copies refused\n", COOKED_FILE, numMeshes, file.Size(), numRefused, static_cast<unsigned int>(NUM_BREAKAGES));
+	}
+
+	file.Close();
+	remove(COOKED_FILE);
+
+	return TestResult("MeshFileTest");
+}
@@ -0,0 +1,231 @@
+#include "RenderCore/MeshListParser.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Parses the holodeck's MeshList over and over and reports the throughput.
+// Every parse has to find the meshes the exporter wrote, with the counts it
+// wrote for them, unit normals and every corner indexing inside its arrays,
+// and has to come out the same as the first.  Half the file has to fail,
+// saying where.
+//
+// Run it from the root of the repository, or pass the MeshList.  The
+// expected counts are the holodeck's, so another file only gets timed.
+//
+//	MeshListParserBenchmark [meshlist] [iterations]
+// ****************************************************************************
+
+const char *	HOLODECK = "Content/Scenes/holodeck/holodeck.lua";
+
+// What the exporter wrote for each of the holodeck's meshes
+struct ExpectedMesh
+{
+	const char *	name;
+	const char *	material;
+	bool			occluder;
+	unsigned int	numPositions;
+	unsigned int	numNormals;
+	unsigned int	numUVs;
+	unsigned int	numTriangles;
+};
+
+const ExpectedMesh	HOLODECK_MESHES[] =
+{
+	{ "pCubeShape1",	"Grid",			false,	8,		24,		14,		12 },
+	{ "pSphereShape1",	"Grid",			true,	382,	382,	401,	760 },
+	{ "pTorusShape1",	"woodgrain",	true,	400,	400,	420,	800 },
+};
+const unsigned int	NUM_HOLODECK_MESHES = sizeof(HOLODECK_MESHES) / sizeof(HOLODECK_MESHES[0]);
+
+// ****************************************************************************
+// FNV-1a over every array the parse filled, to tell one parse from another
+// ****************************************************************************
+inline uint32_t HashBytes(uint32_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	for(size_t i=0;i<size;i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+uint32_t HashMeshes(const MeshListParser &parser)
+{
+	uint32_t hash = 2166136261u;
+	for(unsigned int i=0;i<parser.NumMeshes();i++)
+	{
+		const MeshSource &mesh = parser.GetMesh(i);
+		hash = HashBytes(hash, mesh.name.c_str(), mesh.name.size());
+		hash = HashBytes(hash, mesh.material.c_str(), mesh.material.size());
+		hash = HashBytes(hash, &mesh.occluder, sizeof(mesh.occluder));
+		for(unsigned int l=0;l<mesh.numLods;l++)
+		{
+			const MeshSourceLod &lod = mesh.lods[l];
+			hash = HashBytes(hash, &lod.error, sizeof(lod.error));
+			hash = HashBytes(hash, lod.positions, 3 * lod.numPositions * sizeof(float));
+			hash = HashBytes(hash, lod.normals, 3 * lod.numNormals * sizeof(float));
+			for(unsigned int set=0;set<lod.numUVSets;set++)
+			{
+				hash = HashBytes(hash, lod.uvs[set], 2 * lod.numUVs[set] * sizeof(float));
+			}
+			hash = HashBytes(hash, lod.corners, 3 * lod.numTriangles * MeshSourceCornerSize(lod) * sizeof(uint32_t));
+		}
+	}
+	return hash;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool CornersInRange(const MeshSourceLod &lod)
+{
+	unsigned int cornerSize = MeshSourceCornerSize(lod);
+	for(unsigned int c=0;c<3 * lod.numTriangles;c++)
+	{
+		const uint32_t *corner = lod.corners + c * cornerSize;
+		if(corner[0] >= lod.numPositions || corner[1] >= lod.numNormals)
+			return false;
+
+		for(unsigned int set=0;set<lod.numUVSets;set++)
+		{
+			if(corner[2 + set] >= lod.numUVs[set])
+				return false;
+		}
+	}
+	return true;
+}
+
+// ****************************************************************************
+// The exporter writes unit normals to 14 or so digits, so a float that was
+// read wrong shows up as one that isn't
+// ****************************************************************************
+bool NormalsUnitLength(const MeshSourceLod &lod)
+{
+	for(unsigned int i=0;i<lod.numNormals;i++)
+	{
+		const float *n = lod.normals + 3 * i;
+		if(fabsf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] - 1.0f) > 1e-4f)
+			return false;
+	}
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CheckHolodeck(const MeshListParser &parser)
+{
+	if(!TEST_CHECK(parser.NumMeshes() == NUM_HOLODECK_MESHES))
+		return;
+
+	for(unsigned int i=0;i<NUM_HOLODECK_MESHES;i++)
+	{
+		const ExpectedMesh &expected = HOLODECK_MESHES[i];
+		const MeshSource &mesh = parser.GetMesh(i);
+		const MeshSourceLod &lod = mesh.lods[0];
+		TEST_CHECK(mesh.name == expected.name);
+		TEST_CHECK(mesh.material == expected.material);
+		TEST_CHECK(mesh.occluder == expected.occluder);
+		TEST_CHECK(mesh.numLods == 1);
+		TEST_CHECK(lod.numUVSets == 1);
+		TEST_CHECK(lod.numPositions == expected.numPositions);
+		TEST_CHECK(lod.numNormals == expected.numNormals);
+		TEST_CHECK(lod.numUVs[0] == expected.numUVs);
+		TEST_CHECK(lod.numTriangles == expected.numTriangles);
+		TEST_CHECK(CornersInRange(lod));
+		TEST_CHECK(NormalsUnitLength(lod));
+	}
+
+	// The cube is 20 units on a side, around the origin, so each axis has
+	// four corners at -10 and four at 10
+	const MeshSourceLod &cube = parser.GetMesh(0).lods[0];
+	for(unsigned int axis=0;axis<3;axis++)
+	{
+		unsigned int low = 0;
+		unsigned int high = 0;
+		for(unsigned int i=0;i<cube.numPositions;i++)
+		{
+			low += cube.positions[3 * i + axis] == -10.0f ? 1 : 0;
+			high += cube.positions[3 * i + axis] == 10.0f ? 1 : 0;
+		}
+		TEST_CHECK(low == 4 && high == 4);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : HOLODECK;
+	int iterations = argc > 2 ? atoi(argv[2]) : 50;
+	if(iterations < 1)
+	{
+		fprintf(stderr, "Usage: MeshListParserBenchmark [meshlist] [iterations]\n");
+		return 2;
+	}
+
+	size_t size = 0;
+	char *text = TestReadFile(path, size);
+	if(!TEST_CHECK(text != NULL))
+		return TestResult("MeshListParserBenchmark");
+
+	MeshListParser parser;
+	if(!TEST_CHECK(parser.Parse(text, size)))
+	{
+		fprintf(stderr, "%s(%u): parse failed\n", path, parser.ErrorLine());
+		delete [] text;
+		return TestResult("MeshListParserBenchmark");
+	}
+	TEST_CHECK(parser.ErrorLine() == 0);
+
+	size_t pathLength = strlen(path);
+	size_t holodeckLength = strlen(HOLODECK);
+	bool isHolodeck = pathLength >= holodeckLength && strcmp(path + pathLength - holodeckLength, HOLODECK) == 0;
+	if(isHolodeck)
+	{
+		CheckHolodeck(parser);
+	}
+
+	uint32_t firstHash = HashMeshes(parser);
+	unsigned int numMeshes = parser.NumMeshes();
+	unsigned int numTriangles = 0;
+	for(unsigned int i=0;i<numMeshes;i++)
+	{
+		for(unsigned int l=0;l<parser.GetMesh(i).numLods;l++)
+		{
+			numTriangles += parser.GetMesh(i).lods[l].numTriangles;
+		}
+	}
+
+	// A file cut short fails, and takes the meshes it got to with it
+	MeshListParser cut;
+	TEST_CHECK(!cut.Parse(text, size / 2));
+	TEST_CHECK(cut.ErrorLine() > 0);
+	TEST_CHECK(cut.NumMeshes() == 0);
+
+	// Parsing into the same parser again releases the last parse first
+	double best = 1e30;
+	double total = 0.0;
+	bool same = true;
+	for(int i=0;i<iterations;i++)
+	{
+		double start = TestSeconds();
+		bool parsed = parser.Parse(text, size);
+		double seconds = TestSeconds() - start;
+
+		same = same && parsed && HashMeshes(parser) == firstHash;
+		best = seconds < best ? seconds : best;
+		total += seconds;
+	}
+	TEST_CHECK(same);
+
+	double megabytes = static_cast<double>(size) / (1024.0 * 1024.0);
+	printf("%s: %.2f MB, %u meshes, %u triangles\n", path, megabytes, numMeshes, numTriangles);
+	printf("Parse: best %.2f ms (%.1f MB/s), average %.2f ms (%.1f MB/s) over %d\n", best * 1e3, megabytes / best,
+		total * 1e3 / iterations, megabytes * iterations / total, iterations);
+
+	delete [] text;
+
+	return TestResult("MeshListParserBenchmark");
+}
@@ -0,0 +1,225 @@
+#include "RenderCore/MeshListParser.h"
+#include "RenderCore/MeshWeld.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// WeldCorners() against a brute force numbering of the distinct tuples, on
+// the holodeck's corners and on random tuples of one to six indices drawn
+// from a handful of values, so most corners repeat an earlier one.  Every
+// corner has to get the vertex of the first corner with its tuple, vertices
+// have to be numbered in the order they first appear, and each has to point
+// back at that first corner.  Tuples that are all different and all the
+// same are checked without the brute force; the all different ones are then
+// timed.
+//
+// Run it from the root of the repository, or pass the MeshList.
+//
+//	MeshWeldTest [meshlist] [corners]
+// ****************************************************************************
+
+const char *		HOLODECK = "Content/Scenes/holodeck/holodeck.lua";
+const unsigned int	MAX_KEY_SIZE = 6;
+const int			TIMING_ITERATIONS = 5;
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline uint32_t RandomIndex(uint32_t &seed, uint32_t range)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) % range;
+}
+
+// ****************************************************************************
+// The first corner before this one with the same tuple, or corner itself
+// ****************************************************************************
+unsigned int FirstCorner(const uint32_t *keys, unsigned int corner, unsigned int keySize, const uint32_t *vertexCorner, unsigned int numVertices)
+{
+	const uint32_t *key = keys + corner * keySize;
+	for(unsigned int v=0;v<numVertices;v++)
+	{
+		if(memcmp(key, keys + vertexCorner[v] * keySize, keySize * sizeof(uint32_t)) == 0)
+			return vertexCorner[v];
+	}
+	return corner;
+}
+
+// ****************************************************************************
+// Welds keys and checks the result against a brute force numbering.  Returns
+// the number of vertices.
+// ****************************************************************************
+unsigned int CheckWeld(const uint32_t *keys, unsigned int numCorners, unsigned int keySize)
+{
+	uint32_t *cornerVertex = new uint32_t[numCorners + 1];
+	uint32_t *vertexCorner = new uint32_t[numCorners + 1];
+	uint32_t *expectedVertex = new uint32_t[numCorners + 1];
+	uint32_t *expectedCorner = new uint32_t[numCorners + 1];
+
+	unsigned int numVertices = WeldCorners(keys, numCorners, keySize, cornerVertex, vertexCorner);
+
+	// The brute force keeps the first corner of each tuple, in order
+	unsigned int expectedVertices = 0;
+	for(unsigned int corner=0;corner<numCorners;corner++)
+	{
+		unsigned int first = FirstCorner(keys, corner, keySize, expectedCorner, expectedVertices);
+		if(first == corner)
+		{
+			expectedCorner[expectedVertices++] = corner;
+		}
+		expectedVertex[corner] = first == corner ? expectedVertices - 1 : expectedVertex[first];
+	}
+
+	TEST_CHECK(numVertices == expectedVertices);
+	if(numVertices == expectedVertices)
+	{
+		TEST_CHECK(memcmp(cornerVertex, expectedVertex, numCorners * sizeof(uint32_t)) == 0);
+		TEST_CHECK(memcmp(vertexCorner, expectedCorner, numVertices * sizeof(uint32_t)) == 0);
+	}
+
+	delete [] expectedCorner;
+	delete [] expectedVertex;
+	delete [] vertexCorner;
+	delete [] cornerVertex;
+	return numVertices;
+}
+
+// ****************************************************************************
+// The parser's corners are already the tuples BuildMeshLod() welds when a
+// layout has positions, normals and every UV set
+// ****************************************************************************
+void CheckHolodeck(const char *path)
+{
+	size_t size = 0;
+	char *text = TestReadFile(path, size);
+	if(!TEST_CHECK(text != NULL))
+		return;
+
+	MeshListParser parser;
+	if(TEST_CHECK(parser.Parse(text, size)))
+	{
+		for(unsigned int i=0;i<parser.NumMeshes();i++)
+		{
+			const MeshSource &mesh = parser.GetMesh(i);
+			for(unsigned int l=0;l<mesh.numLods;l++)
+			{
+				const MeshSourceLod &lod = mesh.lods[l];
+				unsigned int numCorners = lod.numTriangles * 3;
+				unsigned int numVertices = CheckWeld(lod.corners, numCorners, MeshSourceCornerSize(lod));
+				printf("%s lod %u: %u corners, %u vertices\n", mesh.name.c_str(), l, numCorners, numVertices);
+			}
+		}
+	}
+	else
+	{
+		fprintf(stderr, "%s(%u): parse failed\n", path, parser.ErrorLine());
+	}
+
+	delete [] text;
+}
+
+// ****************************************************************************
+// Few enough values per index that most tuples repeat, and tuples that only
+// differ in their last index
+// ****************************************************************************
+void CheckRandom(unsigned int numCorners)
+{
+	uint32_t seed = 12345;
+	uint32_t *keys = new uint32_t[numCorners * MAX_KEY_SIZE];
+	for(unsigned int keySize=1;keySize<=MAX_KEY_SIZE;keySize++)
+	{
+		for(uint32_t range=1;range<=16;range*=4)
+		{
+			for(unsigned int i=0;i<numCorners * keySize;i++)
+			{
+				keys[i] = RandomIndex(seed, range);
+			}
+			CheckWeld(keys, numCorners, keySize);
+		}
+
+		for(unsigned int corner=0;corner<numCorners;corner++)
+		{
+			for(unsigned int k=0;k<keySize;k++)
+			{
+				keys[corner * keySize + k] = k + 1 < keySize ? 7 : RandomIndex(seed, 64);
+			}
+		}
+		CheckWeld(keys, numCorners, keySize);
+	}
+
+	// Nothing at all
+	TEST_CHECK(CheckWeld(keys, 0, 1) == 0);
+
+	delete [] keys;
+}
+
+// ****************************************************************************
+// Every corner its own vertex, too many for the brute force, then timed
+// ****************************************************************************
+void CheckDistinct(unsigned int numCorners)
+{
+	const unsigned int keySize = 3;
+	uint32_t *keys = new uint32_t[numCorners * keySize];
+	uint32_t *cornerVertex = new uint32_t[numCorners];
+	uint32_t *vertexCorner = new uint32_t[numCorners];
+
+	// Sequential like an exporter's, so the hash has to spread them
+	for(unsigned int corner=0;corner<numCorners;corner++)
+	{
+		keys[corner * keySize + 0] = corner;
+		keys[corner * keySize + 1] = corner / 3;
+		keys[corner * keySize + 2] = 0;
+	}
+
+	double best = 1e30;
+	bool identity = true;
+	for(int i=0;i<TIMING_ITERATIONS;i++)
+	{
+		double start = TestSeconds();
+		unsigned int numVertices = WeldCorners(keys, numCorners, keySize, cornerVertex, vertexCorner);
+		double seconds = TestSeconds() - start;
+		best = seconds < best ? seconds : best;
+
+		identity = identity && numVertices == numCorners;
+		for(unsigned int corner=0;identity && corner<numCorners;corner++)
+		{
+			identity = cornerVertex[corner] == corner && vertexCorner[corner] == corner;
+		}
+	}
+	TEST_CHECK(identity);
+	printf("%u distinct corners: best %.2f ms (%.1f M corners/s)\n", numCorners, best * 1e3, numCorners / best * 1e-6);
+
+	// And every corner the same vertex
+	memset(keys, 0, numCorners * keySize * sizeof(uint32_t));
+	TEST_CHECK(WeldCorners(keys, numCorners, keySize, cornerVertex, vertexCorner) == 1);
+	TEST_CHECK(vertexCorner[0] == 0);
+	bool single = true;
+	for(unsigned int corner=0;corner<numCorners;corner++)
+	{
+		single = single && cornerVertex[corner] == 0;
+	}
+	TEST_CHECK(single);
+
+	delete [] vertexCorner;
+	delete [] cornerVertex;
+	delete [] keys;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : HOLODECK;
+	int numCorners = argc > 2 ? atoi(argv[2]) : 1000000;
+	if(numCorners < 1)
+	{
+		fprintf(stderr, "Usage: MeshWeldTest [meshlist] [corners]\n");
+		return 2;
+	}
+
+	CheckHolodeck(path);
+	CheckRandom(numCorners < 5000 ? numCorners : 5000);
+	CheckDistinct(numCorners);
+
+	return TestResult("MeshWeldTest");
+}
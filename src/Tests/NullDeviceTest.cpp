@@ -0,0 +1,279 @@
+#include "RenderCore/ConstantRing.h"
+#include "RenderCore/NullDevice.h"
+#include "RenderCore/RenderGraph.h"
+#include "RenderCore/StateCache.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Drives the RenderCore code that needs a device through the null backend
+// and checks what reached the context: the binds, clears and unbinds the
+// frame graph issues around its passes, how many maps and constant buffer
+// binds the constant ring takes on both of its paths, and that everything
+// created is released again.
+//
+// The passes here only draw a marker.  ScenePassesTest runs the real
+// FillGBuffer() and DoLighting().
+//
+//	NullDeviceTest [draws]
+// ****************************************************************************
+
+const unsigned int	WIDTH = 1280;
+const unsigned int	HEIGHT = 720;
+const unsigned int	BLOCK_SIZE = 192;		// What RenderThread's object blocks take
+const unsigned int	NUM_FRAMES = 4;
+
+// Draws its index count so it shows up in the log
+struct MarkerPass
+{
+	RenderContext *	context;
+	unsigned int	marker;
+};
+
+// One expected log entry
+struct ExpectedCommand
+{
+	RenderCommand::Op	op;
+	unsigned int		slot;
+	unsigned int		count;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+void DrawMarker(void *data)
+{
+	MarkerPass *pass = reinterpret_cast<MarkerPass *>(data);
+	pass->context->DrawIndexed(pass->marker, 0, 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+RenderGraphTextureDesc TextureDesc(DXGI_FORMAT format)
+{
+	RenderGraphTextureDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.width = WIDTH;
+	desc.height = HEIGHT;
+	desc.format = format;
+	desc.targetFormat = format;
+	desc.shaderFormat = format;
+	desc.clear = true;
+	return desc;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool CheckCommands(const NullRenderContext &context, const ExpectedCommand *expected, unsigned int numExpected)
+{
+	if(!TEST_CHECK(context.LastFrameNumCommands() == numExpected))
+		return false;
+
+	const RenderCommand *commands = context.LastFrameCommands();
+	bool matched = true;
+	for(unsigned int i=0;i<numExpected;i++)
+	{
+		matched = TEST_CHECK(commands[i].op == expected[i].op) && matched;
+		matched = TEST_CHECK(commands[i].slot == expected[i].slot) && matched;
+		matched = TEST_CHECK(commands[i].count == expected[i].count) && matched;
+	}
+	return matched;
+}
+
+// ****************************************************************************
+// The frame CreateFrameGraph() declares, realized on the null device and run
+// for a few frames.  Every frame should issue exactly the same calls, and
+// the textures made on the first frame should be the only ones.
+// ****************************************************************************
+void TestFrameGraph()
+{
+	NullRenderDevice device(WIDTH, HEIGHT);
+	NullRenderContext context;
+
+	ID3D11Texture2D *backBufferTexture = NULL;
+	D3D11_TEXTURE2D_DESC backBufferDesc;
+	device.GetBackBuffer(&backBufferTexture, &backBufferDesc);
+	ID3D11RenderTargetView *backBufferView = NULL;
+	device.CreateRenderTargetView(backBufferTexture, NULL, &backBufferView);
+	unsigned int baseObjects = device.NumLiveObjects();
+
+	RenderGraph graph;
+	graph.Initialize(&device, &context);
+
+	MarkerPass gbufferPass = { &context, 1 };
+	MarkerPass lightingPass = { &context, 2 };
+
+	for(unsigned int frame=0;frame<NUM_FRAMES;frame++)
+	{
+		graph.Reset();
+
+		RenderGraphTextureDesc depthStencilDesc = TextureDesc(DXGI_FORMAT_R24G8_TYPELESS);
+		depthStencilDesc.targetFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		depthStencilDesc.shaderFormat = DXGI_FORMAT_R32_FLOAT;
+		depthStencilDesc.depthStencil = true;
+		depthStencilDesc.clearDepth = 1.0f;
+
+		RenderGraphResource backBuffer = graph.ImportTexture("BackBuffer", TextureDesc(backBufferDesc.Format), backBufferView, NULL, NULL);
+		RenderGraphResource albedo = graph.CreateTexture("Albedo", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+		RenderGraphResource normal = graph.CreateTexture("Normal", TextureDesc(DXGI_FORMAT_R16G16B16A16_SNORM));
+		RenderGraphResource depth = graph.CreateTexture("Depth", TextureDesc(DXGI_FORMAT_R32_FLOAT));
+		RenderGraphResource depthStencil = graph.CreateTexture("DepthStencil", depthStencilDesc);
+
+		RenderGraphPass gbuffer = graph.AddPass("FillGBuffer", DrawMarker, &gbufferPass);
+		graph.WriteTarget(gbuffer, albedo);
+		graph.WriteTarget(gbuffer, normal);
+		graph.WriteTarget(gbuffer, depth);
+		graph.WriteDepth(gbuffer, depthStencil);
+
+		RenderGraphPass lighting = graph.AddPass("DoLighting", DrawMarker, &lightingPass);
+		graph.ReadTexture(lighting, albedo, 0);
+		graph.ReadTexture(lighting, normal, 1);
+		graph.ReadTexture(lighting, depth, 2);
+		graph.ReadDepth(lighting, depthStencil);
+		graph.WriteTarget(lighting, backBuffer);
+
+		graph.MarkOutput(backBuffer);
+		if(!TEST_CHECK(graph.Compile()))
+		{
+			fprintf(stderr, "%s\n", graph.CompileError());
+			break;
+		}
+		graph.Realize();
+		graph.Execute();
+		context.Present(0, 0);
+
+		// A texture, a shader view and a target or depth view for each of
+		// the four transients
+		TEST_CHECK(device.NumLiveObjects() == baseObjects + 12);
+
+		const ExpectedCommand expected[] =
+		{
+			{ RenderCommand::SET_RENDER_TARGETS,	0, 3 },
+			{ RenderCommand::CLEAR_RENDER_TARGET,	0, 0 },
+			{ RenderCommand::CLEAR_RENDER_TARGET,	0, 0 },
+			{ RenderCommand::CLEAR_RENDER_TARGET,	0, 0 },
+			{ RenderCommand::CLEAR_DEPTH_STENCIL,	0, 0 },
+			{ RenderCommand::DRAW_INDEXED,			0, 0 },
+			{ RenderCommand::SET_RENDER_TARGETS,	0, 1 },
+			{ RenderCommand::CLEAR_RENDER_TARGET,	0, 0 },
+			{ RenderCommand::SET_PS_RESOURCES,		0, 1 },
+			{ RenderCommand::SET_PS_RESOURCES,		1, 1 },
+			{ RenderCommand::SET_PS_RESOURCES,		2, 1 },
+			{ RenderCommand::DRAW_INDEXED,			0, 0 },
+			{ RenderCommand::SET_PS_RESOURCES,		0, 1 },
+			{ RenderCommand::SET_PS_RESOURCES,		1, 1 },
+			{ RenderCommand::SET_PS_RESOURCES,		2, 1 },
+			{ RenderCommand::PRESENT,				0, 0 },
+		};
+		const unsigned int numExpected = sizeof(expected) / sizeof(expected[0]);
+		if(!CheckCommands(context, expected, numExpected))
+			break;
+
+		// The markers say which pass drew, the lighting inputs are real views
+		// going in, and NULL coming back out
+		const RenderCommand *commands = context.LastFrameCommands();
+		TEST_CHECK(commands[5].arg == 1);
+		TEST_CHECK(commands[11].arg == 2);
+		for(unsigned int i=8;i<11;i++)
+		{
+			TEST_CHECK(commands[i].arg != 0);
+			TEST_CHECK(commands[i + 4].arg == 0);
+		}
+	}
+
+	graph.Release();
+	TEST_CHECK(device.NumLiveObjects() == baseObjects);
+
+	device.Release(backBufferView);
+	device.Release(backBufferTexture);
+	TEST_CHECK(device.NumLiveObjects() == 0);
+}
+
+// ****************************************************************************
+// A frame's worth of object blocks through the ring and the state cache, the
+// way FillGBuffer() binds them: every block is written up front, then each
+// draw binds its own and passes where it is as the start instance.
+// ****************************************************************************
+void TestConstantRing(bool constantBufferOffsets, unsigned int numDraws)
+{
+	NullRenderDevice device(WIDTH, HEIGHT);
+	NullRenderContext nullContext(constantBufferOffsets);
+	StateCacheContext context(&nullContext);
+
+	ConstantRing ring;
+	ring.Initialize(&device, &context, BLOCK_SIZE, numDraws);
+	TEST_CHECK(ring.UsesOffsets() == constantBufferOffsets);
+	unsigned int numObjects = device.NumLiveObjects();
+
+	const unsigned int blocksPerBuffer = ring.BlocksPerBuffer();
+	const unsigned int numBuffers = (numDraws + blocksPerBuffer - 1) / blocksPerBuffer;
+	if(constantBufferOffsets)
+	{
+		TEST_CHECK(blocksPerBuffer == 1);
+	}
+	else
+	{
+		TEST_CHECK(blocksPerBuffer == D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 / BLOCK_SIZE);
+	}
+
+	uint8_t block[BLOCK_SIZE];
+	for(unsigned int frame=0;frame<NUM_FRAMES;frame++)
+	{
+		ring.BeginFrame(numDraws);
+		for(unsigned int i=0;i<numDraws;i++)
+		{
+			memset(block, i & 0xff, sizeof(block));
+			ring.WriteBlock(i, block);
+		}
+		ring.EndFrame();
+
+		bool inPlace = true;
+		for(unsigned int i=0;i<numDraws;i++)
+		{
+			unsigned int index = ring.Bind(i, 1);
+			inPlace = TEST_CHECK(index == i % blocksPerBuffer) && inPlace;
+			context.DrawIndexedInstanced(36, 1, 0, 0, index);
+		}
+		TEST_CHECK(inPlace);
+
+		const ConstantRingStats &ringStats = ring.FrameStats();
+		TEST_CHECK(ringStats.blocks == numDraws);
+		TEST_CHECK(ringStats.mapCalls == (constantBufferOffsets ? 1 : numBuffers));
+
+		context.Present(0, 0);
+		const RenderContextStats &stats = nullContext.LastFrameStats();
+		TEST_CHECK(stats.draws == numDraws);
+
+		// One map for the whole ring, or one for each buffer of the pool.
+		// Offset binds all differ, while pool binds only change between
+		// buffers and the state cache drops the rest.  After the first
+		// frame, the first bind may match what the last frame left bound,
+		// and is dropped too.
+		unsigned int maps = constantBufferOffsets ? 1 : numBuffers;
+		unsigned int binds = constantBufferOffsets ? numDraws : numBuffers;
+		unsigned int vsBinds = stats.opCounts[RenderCommand::SET_VS_CONSTANTS];
+		TEST_CHECK(stats.maps == maps);
+		TEST_CHECK(stats.opCounts[RenderCommand::UNMAP] == maps);
+		TEST_CHECK(vsBinds == binds || (frame > 0 && vsBinds == binds - 1));
+		TEST_CHECK(stats.opCounts[RenderCommand::SET_PS_CONSTANTS] == vsBinds);
+		TEST_CHECK(context.LastFrameStats().filtered == 2 * (numDraws - vsBinds));
+
+		// Nothing new is made once the ring has been sized
+		TEST_CHECK(device.NumLiveObjects() == numObjects);
+	}
+
+	ring.Release();
+	TEST_CHECK(device.NumLiveObjects() == 0);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numDraws = argc > 1 ? atoi(argv[1]) : 1000;
+
+	TestFrameGraph();
+	TestConstantRing(true, numDraws);
+	TestConstantRing(false, numDraws);
+
+	return TestResult("NullDeviceTest");
+}
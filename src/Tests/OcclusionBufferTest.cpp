@@ -0,0 +1,356 @@
+#include "Kernel/JobSystem.h"
+#include "Math/AABB.h"
+#include "Math/Matrix.h"
+#include "RenderCore/MeshListParser.h"
+#include "RenderCore/OcclusionBuffer.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Rasterizes the holodeck's occluders, the sphere and the torus, read from
+// its MeshList the way the engine would, and checks the occlusion buffer
+// with them:
+//  - The depth and max depth buffers come out bit for bit the same frame
+//    after frame, with the occluders added in either order, and with the
+//    tiles rasterized inline or spread over the job workers.
+//  - Boxes placed behind the sphere and behind the torus's ring are hidden,
+//    and boxes in front of them, beside them, through the torus's hole and
+//    across the near plane are not.
+// Then it times drawing the occluders and testing boxes against them.
+//
+// Run it from the root of the repository, or pass the MeshList.
+//
+//	OcclusionBufferTest [meshlist] [iterations]
+// ****************************************************************************
+
+const float			FOV_Y = 1.0f;
+const float			ASPECT = static_cast<float>(OcclusionBuffer::WIDTH) / static_cast<float>(OcclusionBuffer::HEIGHT);
+const float			NEAR_Z = 0.5f;
+const float			FAR_Z = 500.0f;
+const unsigned int	NUM_TIMED_BOXES = 4096;
+
+// Where the camera, at the origin looking down +z, sees them
+const float			SPHERE_RADIUS = 5.0f;
+const Vector3		SPHERE_CENTER(0.0f, 0.0f, 20.0f);
+const float			TORUS_RADIUS = 9.0f;			// Outer
+const Vector3		TORUS_CENTER(-14.0f, 0.0f, 30.0f);
+
+// One occluder the way Mesh keeps it: shared positions and indexed triangles
+struct TestOccluder
+{
+	const float *	positions;
+	unsigned int	numPositions;
+	uint32_t *		indices;
+	unsigned int	numTriangles;
+	Matrix4x4		world;
+	float			innerRadius;	// Distance from the axis of the nearest and
+	float			outerRadius;	// farthest positions, in world units
+};
+
+// A box and whether it should be hidden
+struct ExpectedBox
+{
+	const char *	name;
+	AABB			box;
+	bool			visible;
+};
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline float RandomFloat(uint32_t &seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ****************************************************************************
+// What Mesh::CreateOccluderData() keeps of the mesh's first level, scaled so
+// its farthest position from its y axis is radius away, turned about x by
+// rotateX and moved to center
+// ****************************************************************************
+void MakeOccluder(const MeshSource &mesh, float radius, float rotateX, const Vector3 &center, TestOccluder &occluder)
+{
+	const MeshSourceLod &lod = mesh.lods[0];
+	occluder.positions = lod.positions;
+	occluder.numPositions = lod.numPositions;
+	occluder.numTriangles = lod.numTriangles;
+	occluder.indices = new uint32_t[lod.numTriangles * 3];
+
+	unsigned int cornerSize = MeshSourceCornerSize(lod);
+	for(unsigned int i=0;i<lod.numTriangles * 3;i++)
+	{
+		occluder.indices[i] = lod.corners[i * cornerSize];
+	}
+
+	// The exported positions are where the mesh sat in the scene, so it's
+	// centered on its bounds first
+	AABB bounds;
+	bounds.SetEmpty();
+	for(unsigned int i=0;i<lod.numPositions;i++)
+	{
+		bounds.Add(Vector3(lod.positions[3 * i], lod.positions[3 * i + 1], lod.positions[3 * i + 2]));
+	}
+	Vector3 meshCenter = bounds.Center();
+
+	float inner = FLT_MAX;
+	float outer = 0.0f;
+	for(unsigned int i=0;i<lod.numPositions;i++)
+	{
+		const float *p = lod.positions + 3 * i;
+		float dx = p[0] - meshCenter.x;
+		float dz = p[2] - meshCenter.z;
+		float distance = sqrtf(dx * dx + dz * dz);
+		inner = distance < inner ? distance : inner;
+		outer = distance > outer ? distance : outer;
+	}
+
+	float scale = radius / outer;
+	occluder.innerRadius = inner * scale;
+	occluder.outerRadius = radius;
+
+	Matrix4x4 centerMat;
+	centerMat.SetTranslation(-meshCenter.x, -meshCenter.y, -meshCenter.z);
+	Matrix4x4 scaleMat;
+	scaleMat.SetScale(scale, scale, scale);
+	Matrix4x4 rotateMat;
+	rotateMat.SetXRotation(rotateX);
+	Matrix4x4 translateMat;
+	translateMat.SetTranslation(center.x, center.y, center.z);
+	occluder.world = translateMat * rotateMat * scaleMat * centerMat;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline AABB BoxAt(float x, float y, float z, float halfSize)
+{
+	return AABB(Vector3(x - halfSize, y - halfSize, z - halfSize), Vector3(x + halfSize, y + halfSize, z + halfSize));
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void DrawOccluders(OcclusionBuffer &buffer, const Matrix4x4 &viewProj, const TestOccluder *occluders, unsigned int numOccluders, bool reverse)
+{
+	buffer.BeginFrame(viewProj);
+	for(unsigned int i=0;i<numOccluders;i++)
+	{
+		const TestOccluder &occluder = occluders[reverse ? numOccluders - 1 - i : i];
+		buffer.AddOccluder(occluder.positions, occluder.numPositions, occluder.indices, occluder.numTriangles, occluder.world);
+	}
+	buffer.Rasterize();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool SameDepth(const OcclusionBuffer &a, const OcclusionBuffer &b)
+{
+	return memcmp(a.Depth(), b.Depth(), OcclusionBuffer::WIDTH * OcclusionBuffer::HEIGHT * sizeof(float)) == 0 &&
+		memcmp(a.MaxDepth(), b.MaxDepth(), OcclusionBuffer::HIZ_WIDTH * OcclusionBuffer::HIZ_HEIGHT * sizeof(float)) == 0;
+}
+
+// ****************************************************************************
+// Whether every max depth block holds the farthest depth of its pixels
+// ****************************************************************************
+bool MaxDepthMatches(const OcclusionBuffer &buffer)
+{
+	const float *depth = buffer.Depth();
+	const float *maxDepth = buffer.MaxDepth();
+	for(unsigned int by=0;by<OcclusionBuffer::HIZ_HEIGHT;by++)
+	{
+		for(unsigned int bx=0;bx<OcclusionBuffer::HIZ_WIDTH;bx++)
+		{
+			float farthest = 0.0f;
+			for(unsigned int y=0;y<OcclusionBuffer::HIZ_BLOCK;y++)
+			{
+				const float *row = depth + (by * OcclusionBuffer::HIZ_BLOCK + y) * OcclusionBuffer::WIDTH + bx * OcclusionBuffer::HIZ_BLOCK;
+				for(unsigned int x=0;x<OcclusionBuffer::HIZ_BLOCK;x++)
+				{
+					farthest = row[x] > farthest ? row[x] : farthest;
+				}
+			}
+
+			if(maxDepth[by * OcclusionBuffer::HIZ_WIDTH + bx] != farthest)
+				return false;
+		}
+	}
+	return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+unsigned int CountCovered(const OcclusionBuffer &buffer)
+{
+	unsigned int covered = 0;
+	const float *depth = buffer.Depth();
+	for(unsigned int i=0;i<OcclusionBuffer::WIDTH * OcclusionBuffer::HEIGHT;i++)
+	{
+		covered += depth[i] < 1.0f ? 1 : 0;
+	}
+	return covered;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : "Content/Scenes/holodeck/holodeck.lua";
+	unsigned int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+	iterations = iterations > 0 ? iterations : 1;
+
+	size_t size = 0;
+	char *text = TestReadFile(path, size);
+	if(!TEST_CHECK(text != NULL))
+		return TestResult("OcclusionBufferTest");
+
+	MeshListParser parser;
+	bool parsed = TEST_CHECK(parser.Parse(text, size));
+	delete [] text;
+	if(!parsed)
+	{
+		fprintf(stderr, "%s(%u): parse failed\n", path, parser.ErrorLine());
+		return TestResult("OcclusionBufferTest");
+	}
+
+	// The sphere and the torus are marked as occluders, and the cube isn't
+	const MeshSource *sphere = NULL;
+	const MeshSource *torus = NULL;
+	unsigned int numOccluderMeshes = 0;
+	for(unsigned int i=0;i<parser.NumMeshes();i++)
+	{
+		const MeshSource &mesh = parser.GetMesh(i);
+		if(!mesh.occluder)
+			continue;
+
+		numOccluderMeshes++;
+		if(mesh.name == "pSphereShape1")
+		{
+			sphere = &mesh;
+		}
+		else if(mesh.name == "pTorusShape1")
+		{
+			torus = &mesh;
+		}
+	}
+	TEST_CHECK(numOccluderMeshes == 2);
+	if(!TEST_CHECK(sphere != NULL && torus != NULL))
+		return TestResult("OcclusionBufferTest");
+
+	// The torus is turned to face the camera, so its hole can be seen through
+	TestOccluder occluders[2];
+	MakeOccluder(*sphere, SPHERE_RADIUS, 0.0f, SPHERE_CENTER, occluders[0]);
+	MakeOccluder(*torus, TORUS_RADIUS, 3.14159265f * 0.5f, TORUS_CENTER, occluders[1]);
+	TEST_CHECK(occluders[1].innerRadius > 0.2f * TORUS_RADIUS);
+
+	Matrix4x4 viewProj;
+	viewProj.SetProjectionFOV(FOV_Y, ASPECT, NEAR_Z, FAR_Z);
+
+	// Determinism.  Every tile is drawn by one job with integer edge
+	// functions, so neither the order the occluders come in nor which
+	// thread draws a tile may change a bit of the result.
+	OcclusionBuffer reference;
+	DrawOccluders(reference, viewProj, occluders, 2, false);
+	unsigned int numTriangles = reference.NumTriangles();
+	unsigned int numCovered = CountCovered(reference);
+	TEST_CHECK(numTriangles > 0);
+	TEST_CHECK(numCovered > 0);
+	TEST_CHECK(MaxDepthMatches(reference));
+
+	OcclusionBuffer buffer;
+	DrawOccluders(buffer, viewProj, occluders, 2, true);
+	TEST_CHECK(SameDepth(buffer, reference));
+	DrawOccluders(buffer, viewProj, occluders, 2, false);
+	TEST_CHECK(SameDepth(buffer, reference));
+
+	InitializeJobSystem(3);
+	for(unsigned int i=0;i<8;i++)
+	{
+		DrawOccluders(buffer, viewProj, occluders, 2, (i & 1) != 0);
+		TEST_CHECK(SameDepth(buffer, reference));
+	}
+
+	// Known boxes.  Hidden ones sit well inside the silhouette of what hides
+	// them, so rounding out to max depth blocks still lands on covered pixels.
+	// Behind the torus, boxes are moved out along the ray from the camera
+	// through the point they're hiding behind or showing through.
+	float ringRadius = 0.5f * (occluders[1].innerRadius + occluders[1].outerRadius);
+	float behindTorus = 45.0f / TORUS_CENTER.z;
+	const ExpectedBox boxes[] =
+	{
+		{ "behind the sphere",			BoxAt(SPHERE_CENTER.x, SPHERE_CENTER.y, 40.0f, 1.0f),								false },
+		{ "far behind the sphere",		BoxAt(SPHERE_CENTER.x + 1.0f, SPHERE_CENTER.y - 1.0f, 200.0f, 4.0f),				false },
+		{ "behind the torus ring",		BoxAt(TORUS_CENTER.x * behindTorus, (TORUS_CENTER.y + ringRadius) * behindTorus, 45.0f, 0.5f),	false },
+		{ "just in front of the sphere",	BoxAt(SPHERE_CENTER.x, SPHERE_CENTER.y, SPHERE_CENTER.z - SPHERE_RADIUS - 1.0f, 0.5f),	true },
+		{ "in front of the sphere",		BoxAt(SPHERE_CENTER.x, SPHERE_CENTER.y, 10.0f, 1.0f),								true },
+		{ "peeking past the sphere",	AABB(Vector3(0.0f, -1.0f, 39.0f), Vector3(3.0f * SPHERE_RADIUS, 1.0f, 41.0f)),		true },
+		{ "peeking under the sphere",	AABB(Vector3(-1.0f, -3.0f * SPHERE_RADIUS, 39.0f), Vector3(1.0f, 0.0f, 41.0f)),	true },
+		{ "beside the sphere",			BoxAt(20.0f, 0.0f, 40.0f, 1.0f),													true },
+		{ "through the torus hole",		BoxAt(TORUS_CENTER.x * behindTorus, TORUS_CENTER.y * behindTorus, 45.0f, 0.25f),		true },
+		{ "across the near plane",		AABB(Vector3(-0.5f, -0.5f, -1.0f), Vector3(0.5f, 0.5f, 2.0f)),						true },
+		{ "behind the camera",			BoxAt(0.0f, 0.0f, -20.0f, 1.0f),													true },
+		{ "around both",				AABB(Vector3(-30.0f, -10.0f, 15.0f), Vector3(10.0f, 10.0f, 60.0f)),					true },
+	};
+	const unsigned int numBoxes = sizeof(boxes) / sizeof(boxes[0]);
+	for(unsigned int i=0;i<numBoxes;i++)
+	{
+		bool visible = buffer.IsVisible(boxes[i].box);
+		if(!TEST_CHECK(visible == boxes[i].visible))
+		{
+			fprintf(stderr, "Box %s: %s, expected %s\n", boxes[i].name, visible ? "visible" : "hidden", boxes[i].visible ? "visible" : "hidden");
+		}
+	}
+
+	// Timings, with the workers
+	double start = TestSeconds();
+	for(unsigned int i=0;i<iterations;i++)
+	{
+		DrawOccluders(buffer, viewProj, occluders, 2, false);
+	}
+	double drawSeconds = (TestSeconds() - start) / iterations;
+	TEST_CHECK(SameDepth(buffer, reference));
+
+	ShutdownJobSystem();
+
+	// And inline
+	start = TestSeconds();
+	for(unsigned int i=0;i<iterations;i++)
+	{
+		DrawOccluders(buffer, viewProj, occluders, 2, false);
+	}
+	double inlineSeconds = (TestSeconds() - start) / iterations;
+
+	uint32_t seed = 99;
+	AABB *timedBoxes = new AABB[NUM_TIMED_BOXES];
+	for(unsigned int i=0;i<NUM_TIMED_BOXES;i++)
+	{
+		float z = RandomFloat(seed, NEAR_Z, 100.0f);
+		float x = RandomFloat(seed, -0.8f, 0.8f) * z;
+		float y = RandomFloat(seed, -0.4f, 0.4f) * z;
+		timedBoxes[i] = BoxAt(x, y, z, RandomFloat(seed, 0.1f, 2.0f));
+	}
+
+	unsigned int numHidden = 0;
+	unsigned int testIterations = iterations / 10 > 0 ? iterations / 10 : 1;
+	start = TestSeconds();
+	for(unsigned int iteration=0;iteration<testIterations;iteration++)
+	{
+		numHidden = 0;
+		for(unsigned int i=0;i<NUM_TIMED_BOXES;i++)
+		{
+			numHidden += buffer.IsVisible(timedBoxes[i]) ? 0 : 1;
+		}
+	}
+	double testSeconds = (TestSeconds() - start) / (static_cast<double>(testIterations) * NUM_TIMED_BOXES);
+	TEST_CHECK(numHidden > 0 && numHidden < NUM_TIMED_BOXES);
+
+	printf("%ux%u buffer, %u occluder triangles, %u pixels covered\n", OcclusionBuffer::WIDTH, OcclusionBuffer::HEIGHT, numTriangles, numCovered);
+	printf("Occluders: %.1f us with 3 workers, %.1f us inline\n", drawSeconds * 1e6, inlineSeconds * 1e6);
+	printf("IsVisible: %.1f ns a box, %u of %u random boxes hidden\n", testSeconds * 1e9, numHidden, NUM_TIMED_BOXES);
+
+	delete [] timedBoxes;
+	for(unsigned int i=0;i<2;i++)
+	{
+		delete [] occluders[i].indices;
+	}
+
+	return TestResult("OcclusionBufferTest");
+}
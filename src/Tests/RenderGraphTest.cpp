@@ -0,0 +1,302 @@
+#include "RenderCore/RenderGraph.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Runs RenderGraph::Compile() over small graphs and checks what it decided:
+// the order passes run in, which are culled, what's cleared and unbound
+// around each one, which transients share memory, and that graphs that
+// can't run are refused.  Compile() never touches the device, so none is
+// made.
+//
+//	RenderGraphTest
+// ****************************************************************************
+
+const unsigned int	WIDTH = 1280;
+const unsigned int	HEIGHT = 720;
+
+// ****************************************************************************
+// ****************************************************************************
+void NullPass(void *data)
+{
+}
+
+// ****************************************************************************
+// ****************************************************************************
+RenderGraphTextureDesc TextureDesc(DXGI_FORMAT format)
+{
+	RenderGraphTextureDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.width = WIDTH;
+	desc.height = HEIGHT;
+	desc.format = format;
+	desc.targetFormat = format;
+	desc.shaderFormat = format;
+	desc.clear = true;
+	return desc;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+RenderGraphTextureDesc DepthStencilDesc()
+{
+	RenderGraphTextureDesc desc = TextureDesc(DXGI_FORMAT_R16_TYPELESS);
+	desc.targetFormat = DXGI_FORMAT_D16_UNORM;
+	desc.shaderFormat = DXGI_FORMAT_R16_UNORM;
+	desc.depthStencil = true;
+	desc.clearDepth = 1.0f;
+	return desc;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+bool ExecutedInOrder(const RenderGraph &graph, const RenderGraphPass *passes, unsigned int numPasses)
+{
+	if(!TEST_CHECK(graph.NumExecutedPasses() == numPasses))
+		return false;
+
+	bool inOrder = true;
+	for(unsigned int i=0;i<numPasses;i++)
+	{
+		inOrder = TEST_CHECK(graph.ExecutedPass(i) == passes[i]) && inOrder;
+	}
+	return inOrder;
+}
+
+// ****************************************************************************
+// The frame CreateFrameGraph() declares, with the lighting pass added before
+// the GBuffer it reads and a debug pass nothing looks at
+// ****************************************************************************
+void TestFrame()
+{
+	RenderGraph graph;
+	RenderGraphResource backBuffer = graph.ImportTexture("BackBuffer", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM), NULL, NULL, NULL);
+	RenderGraphResource albedo = graph.CreateTexture("Albedo", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+	RenderGraphResource normal = graph.CreateTexture("Normal", TextureDesc(DXGI_FORMAT_R16G16B16A16_SNORM));
+	RenderGraphResource depth = graph.CreateTexture("Depth", TextureDesc(DXGI_FORMAT_R16_FLOAT));
+	RenderGraphResource depthStencil = graph.CreateTexture("DepthStencil", DepthStencilDesc());
+	RenderGraphResource debug = graph.CreateTexture("Debug", TextureDesc(DXGI_FORMAT_R8_UNORM));
+
+	RenderGraphPass lighting = graph.AddPass("DoLighting", NullPass, NULL);
+	graph.ReadTexture(lighting, albedo, 0);
+	graph.ReadTexture(lighting, normal, 1);
+	graph.ReadTexture(lighting, depth, 2);
+	graph.ReadDepth(lighting, depthStencil);
+	graph.WriteTarget(lighting, backBuffer);
+
+	RenderGraphPass gbuffer = graph.AddPass("FillGBuffer", NullPass, NULL);
+	graph.WriteTarget(gbuffer, albedo);
+	graph.WriteTarget(gbuffer, normal);
+	graph.WriteTarget(gbuffer, depth);
+	graph.WriteDepth(gbuffer, depthStencil);
+
+	RenderGraphPass debugPass = graph.AddPass("Debug", NullPass, NULL);
+	graph.ReadTexture(debugPass, depth, 0);
+	graph.WriteTarget(debugPass, debug);
+
+	graph.MarkOutput(backBuffer);
+	if(!TEST_CHECK(graph.Compile()))
+	{
+		fprintf(stderr, "%s\n", graph.CompileError());
+		return;
+	}
+
+	// The GBuffer goes first, wherever it was added, and the debug pass goes
+	const RenderGraphPass order[] = { gbuffer, lighting };
+	ExecutedInOrder(graph, order, 2);
+	TEST_CHECK(!graph.IsCulled(gbuffer));
+	TEST_CHECK(!graph.IsCulled(lighting));
+	TEST_CHECK(graph.IsCulled(debugPass));
+	TEST_CHECK(graph.PhysicalIndex(debug) == -1);
+
+	// Everything is cleared by its first writer, the back buffer included
+	TEST_CHECK(graph.ClearMask(gbuffer) == ((1u << albedo) | (1u << normal) | (1u << depth) | (1u << depthStencil)));
+	TEST_CHECK(graph.ClearMask(lighting) == (1u << backBuffer));
+
+	// Nothing is bound while the GBuffer is written, and the lighting inputs
+	// are unbound once the graph is done, ready for the next frame's GBuffer
+	TEST_CHECK(graph.UnbindMask(gbuffer) == 0);
+	TEST_CHECK(graph.UnbindMask(lighting) == 0);
+	TEST_CHECK(graph.FinalUnbindMask() == 0x7);
+
+	// All live at once, so nothing shares memory
+	TEST_CHECK(graph.NumPhysicalTextures() == 4);
+	TEST_CHECK(graph.PhysicalIndex(backBuffer) == -1);
+	TEST_CHECK(graph.PhysicalBytes() == graph.TransientBytes());
+}
+
+// ****************************************************************************
+// Writers of the same texture keep the order they were added in, readers
+// wait for all of them, and only the first writer clears it
+// ****************************************************************************
+void TestWriters()
+{
+	RenderGraph graph;
+	RenderGraphResource output = graph.ImportTexture("Output", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM), NULL, NULL, NULL);
+	RenderGraphResource scene = graph.CreateTexture("Scene", TextureDesc(DXGI_FORMAT_R16G16B16A16_FLOAT));
+
+	RenderGraphPass tonemap = graph.AddPass("Tonemap", NullPass, NULL);
+	graph.ReadTexture(tonemap, scene, 0);
+	graph.WriteTarget(tonemap, output);
+
+	RenderGraphPass opaque = graph.AddPass("Opaque", NullPass, NULL);
+	graph.WriteTarget(opaque, scene);
+
+	RenderGraphPass transparent = graph.AddPass("Transparent", NullPass, NULL);
+	graph.WriteTarget(transparent, scene);
+
+	graph.MarkOutput(output);
+	if(!TEST_CHECK(graph.Compile()))
+		return;
+
+	const RenderGraphPass order[] = { opaque, transparent, tonemap };
+	ExecutedInOrder(graph, order, 3);
+	TEST_CHECK(graph.ClearMask(opaque) == (1u << scene));
+	TEST_CHECK(graph.ClearMask(transparent) == 0);
+}
+
+// ****************************************************************************
+// A chain of passes where each texture is dead by the time another of the
+// same layout is written, so they share memory, and a shader input has to be
+// unbound before a pass writes the memory it's in
+// ****************************************************************************
+void TestAliasing()
+{
+	RenderGraph graph;
+	RenderGraphResource a = graph.CreateTexture("A", TextureDesc(DXGI_FORMAT_R16G16B16A16_FLOAT));
+	RenderGraphResource b = graph.CreateTexture("B", TextureDesc(DXGI_FORMAT_R16G16B16A16_FLOAT));
+	RenderGraphResource c = graph.CreateTexture("C", TextureDesc(DXGI_FORMAT_R16G16B16A16_FLOAT));
+	RenderGraphResource small = graph.CreateTexture("Small", TextureDesc(DXGI_FORMAT_R8_UNORM));
+
+	RenderGraphPass writeA = graph.AddPass("WriteA", NullPass, NULL);
+	graph.WriteTarget(writeA, a);
+
+	RenderGraphPass aToB = graph.AddPass("AToB", NullPass, NULL);
+	graph.ReadTexture(aToB, a, 0);
+	graph.WriteTarget(aToB, b);
+
+	RenderGraphPass bToC = graph.AddPass("BToC", NullPass, NULL);
+	graph.ReadTexture(bToC, b, 1);
+	graph.WriteTarget(bToC, c);
+	graph.WriteTarget(bToC, small);
+
+	graph.MarkOutput(c);
+	graph.MarkOutput(small);
+	if(!TEST_CHECK(graph.Compile()))
+		return;
+
+	const RenderGraphPass order[] = { writeA, aToB, bToC };
+	ExecutedInOrder(graph, order, 3);
+
+	// A is done with once B is written, so C goes into its memory.  B is
+	// still being read while C is written, and Small is another layout.
+	TEST_CHECK(graph.PhysicalIndex(c) == graph.PhysicalIndex(a));
+	TEST_CHECK(graph.PhysicalIndex(b) != graph.PhysicalIndex(a));
+	TEST_CHECK(graph.PhysicalIndex(small) != graph.PhysicalIndex(a));
+	TEST_CHECK(graph.PhysicalIndex(small) != graph.PhysicalIndex(b));
+	TEST_CHECK(graph.NumPhysicalTextures() == 3);
+	TEST_CHECK(graph.TransientBytes() == WIDTH * HEIGHT * (8 + 8 + 8 + 1));
+	TEST_CHECK(graph.PhysicalBytes() == WIDTH * HEIGHT * (8 + 8 + 1));
+
+	// A is still in slot 0 when BToC writes C over it.  B stays in slot 1 to
+	// the end.
+	TEST_CHECK(graph.UnbindMask(writeA) == 0);
+	TEST_CHECK(graph.UnbindMask(aToB) == 0);
+	TEST_CHECK(graph.UnbindMask(bToC) == 0x1);
+	TEST_CHECK(graph.FinalUnbindMask() == 0x2);
+
+	// Compiling again from scratch comes out the same
+	TEST_CHECK(graph.Compile());
+	TEST_CHECK(graph.NumPhysicalTextures() == 3);
+	TEST_CHECK(graph.UnbindMask(bToC) == 0x1);
+}
+
+// ****************************************************************************
+// Graphs that can't be run
+// ****************************************************************************
+void TestRefused()
+{
+	// Each reads what the other writes
+	{
+		RenderGraph graph;
+		RenderGraphResource a = graph.CreateTexture("A", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+		RenderGraphResource b = graph.CreateTexture("B", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+
+		RenderGraphPass first = graph.AddPass("First", NullPass, NULL);
+		graph.ReadTexture(first, b, 0);
+		graph.WriteTarget(first, a);
+
+		RenderGraphPass second = graph.AddPass("Second", NullPass, NULL);
+		graph.ReadTexture(second, a, 0);
+		graph.WriteTarget(second, b);
+
+		graph.MarkOutput(b);
+		TEST_CHECK(!graph.Compile());
+		TEST_CHECK(strstr(graph.CompileError(), "cycle") != NULL);
+		TEST_CHECK(graph.NumExecutedPasses() == 0);
+	}
+
+	// Nothing writes a transient that's read
+	{
+		RenderGraph graph;
+		RenderGraphResource input = graph.CreateTexture("Input", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+		RenderGraphResource output = graph.CreateTexture("Output", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+
+		RenderGraphPass pass = graph.AddPass("Pass", NullPass, NULL);
+		graph.ReadTexture(pass, input, 0);
+		graph.WriteTarget(pass, output);
+
+		graph.MarkOutput(output);
+		TEST_CHECK(!graph.Compile());
+		TEST_CHECK(strstr(graph.CompileError(), "Input") != NULL);
+	}
+
+	// Read between two writes
+	{
+		RenderGraph graph;
+		RenderGraphResource a = graph.CreateTexture("A", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+		RenderGraphResource b = graph.CreateTexture("B", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+
+		RenderGraphPass first = graph.AddPass("First", NullPass, NULL);
+		graph.WriteTarget(first, a);
+
+		RenderGraphPass copy = graph.AddPass("Copy", NullPass, NULL);
+		graph.ReadTexture(copy, a, 0);
+		graph.WriteTarget(copy, b);
+
+		RenderGraphPass again = graph.AddPass("Again", NullPass, NULL);
+		graph.WriteTarget(again, a);
+
+		graph.MarkOutput(a);
+		graph.MarkOutput(b);
+		TEST_CHECK(!graph.Compile());
+		TEST_CHECK(strstr(graph.CompileError(), "between") != NULL);
+	}
+
+	// An imported texture may be read without anyone writing it
+	{
+		RenderGraph graph;
+		RenderGraphResource input = graph.ImportTexture("Input", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM), NULL, NULL, NULL);
+		RenderGraphResource output = graph.CreateTexture("Output", TextureDesc(DXGI_FORMAT_R8G8B8A8_UNORM));
+
+		RenderGraphPass pass = graph.AddPass("Pass", NullPass, NULL);
+		graph.ReadTexture(pass, input, 0);
+		graph.WriteTarget(pass, output);
+
+		graph.MarkOutput(output);
+		TEST_CHECK(graph.Compile());
+		TEST_CHECK(graph.CompileError()[0] == 0);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	TestFrame();
+	TestWriters();
+	TestAliasing();
+	TestRefused();
+
+	return TestResult("RenderGraphTest");
+}
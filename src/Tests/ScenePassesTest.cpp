@@ -0,0 +1,528 @@
+#include "Math/Matrix.h"
+#include "RenderCore/Light.h"
+#include "RenderCore/Materials.h"
+#include "RenderCore/MeshLod.h"
+#include "RenderCore/NullDevice.h"
+#include "RenderCore/RenderGraph.h"
+#include "RenderCore/ScenePasses.h"
+#include "RenderCore/Shaders.h"
+#include "RenderCore/SortKey.h"
+#include "RenderCore/StateCache.h"
+#include "RenderCore/SubmitQueue.h"
+#include "RenderCore/Textures.h"
+#include "RenderCore/VDecls.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Runs frames through the real FillGBuffer() and DoLighting() on the null
+// device, behind the state cache the way RenderThread drives them, and
+// checks what reached the context against what the frame should cost: one
+// draw call per mesh/material pair that can be instanced and one per draw
+// otherwise, every draw's instances accounted for, one quad per light in
+// front of the camera and none for those behind it, and a known number of
+// maps.  Frames after the first have to issue exactly the same calls.
+// Both the constant buffer offset path and the pooled one are run, and the
+// per frame call, map and state change counts are printed.
+//
+// The shaders, materials and meshes are made by hand on the null device, so
+// neither LuaPlus nor a shader compiler is needed.
+//
+//	ScenePassesTest [draws] [lights]
+// ****************************************************************************
+
+const unsigned int	WIDTH = 1280;
+const unsigned int	HEIGHT = 720;
+const float			NEAR_Z = 0.5f;
+const float			FAR_Z = 500.0f;
+const unsigned int	NUM_FRAMES = 8;
+
+const unsigned int	NUM_SHADERS = 2;		// The first can be instanced, the second can't
+const unsigned int	NUM_MATERIALS = 4;
+const unsigned int	NUM_MESHES = 16;
+const unsigned int	MIN_INSTANCE_RUN = 2;	// What ScenePasses needs before it instances
+const unsigned int	INSTANCE_SIZE = 64;		// One world view matrix
+
+// ****************************************************************************
+// Repeatable from run to run and platform to platform, unlike rand()
+// ****************************************************************************
+inline float RandomFloat(uint32_t &seed, float low, float high)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline unsigned int RandomIndex(uint32_t &seed, unsigned int count)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) % count;
+}
+
+// ****************************************************************************
+// What the asset loaders would have made, made by hand
+// ****************************************************************************
+struct TestScene
+{
+	TestScene() : lightShader("lighting") {}
+
+	HXVertexDecl	decl;
+	HXVertexDecl	instanceDecl;
+	HXShader *		shaders[NUM_SHADERS];
+	HXShader		lightShader;
+	HXTexture		textures[NUM_MATERIALS];
+	HXMaterial		materials[NUM_MATERIALS];
+	MeshLod			lods[NUM_MESHES];
+	ScenePassStates	states;
+};
+
+// ****************************************************************************
+// ****************************************************************************
+ID3D11Buffer * CreateTestBuffer(NullRenderDevice &device, unsigned int bindFlags, unsigned int size)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	memset(&bufferDesc, 0, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.BindFlags = bindFlags;
+
+	ID3D11Buffer *buffer = NULL;
+	HRESULT hr = device.CreateBuffer(&bufferDesc, NULL, &buffer);
+	TEST_CHECK(SUCCEEDED(hr) && buffer != NULL);
+	return buffer;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CreateDecl(NullRenderDevice &device, HXVertexDecl &decl, unsigned int instanceSize)
+{
+	const D3D11_INPUT_ELEMENT_DESC element = { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	const uint8_t bytecode[4] = { 0 };
+	device.CreateInputLayout(&element, 1, bytecode, sizeof(bytecode), &decl.m_layout);
+	decl.m_vertexSize = 20;
+	decl.m_instanceSize = instanceSize;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CreateShader(NullRenderDevice &device, HXShader &shader, unsigned int id, HXVertexDecl *decl, HXVertexDecl *instanceDecl)
+{
+	const uint8_t bytecode[4] = { 0 };
+	shader.m_id = id;
+	shader.m_decl = decl;
+	device.CreateVertexShader(bytecode, sizeof(bytecode), &shader.m_vshader);
+	device.CreatePixelShader(bytecode, sizeof(bytecode), &shader.m_pshader);
+	if(instanceDecl != NULL)
+	{
+		shader.m_instanceDecl = instanceDecl;
+		device.CreateVertexShader(bytecode, sizeof(bytecode), &shader.m_instanceVShader);
+	}
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void CreateScene(NullRenderDevice &device, TestScene &scene)
+{
+	CreateDecl(device, scene.decl, 0);
+	CreateDecl(device, scene.instanceDecl, INSTANCE_SIZE);
+
+	for(unsigned int i=0;i<NUM_SHADERS;i++)
+	{
+		scene.shaders[i] = new HXShader("shader");
+		CreateShader(device, *scene.shaders[i], i + 1, &scene.decl, i == 0 ? &scene.instanceDecl : NULL);
+	}
+	CreateShader(device, scene.lightShader, NUM_SHADERS + 1, &scene.decl, NULL);
+
+	for(unsigned int i=0;i<NUM_MATERIALS;i++)
+	{
+		ID3D11Texture2D *texture = NULL;
+		D3D11_TEXTURE2D_DESC textureDesc;
+		memset(&textureDesc, 0, sizeof(textureDesc));
+		device.CreateTexture2D(&textureDesc, NULL, &texture);
+		scene.textures[i] = HXTexture(static_cast<ID3D11ShaderResourceView *>(NULL));
+		device.CreateShaderResourceView(texture, NULL, &scene.textures[i].m_shaderView);
+		device.Release(texture);
+
+		scene.materials[i].m_id = i + 1;
+		scene.materials[i].m_shader = scene.shaders[i % NUM_SHADERS];
+		scene.materials[i].m_texture = &scene.textures[i];
+	}
+
+	for(unsigned int i=0;i<NUM_MESHES;i++)
+	{
+		MeshLod &lod = scene.lods[i];
+		lod.numVertices = 24 * (i + 1);
+		lod.numIndices = 36 * (i + 1);
+		lod.numTriangles = lod.numIndices / 3;
+		lod.id = i + 1;
+		lod.error = 0.0f;
+		lod.indices32 = (i & 1) != 0;
+		lod.vertexBuffer = CreateTestBuffer(device, D3D11_BIND_VERTEX_BUFFER, lod.numVertices * scene.decl.m_vertexSize);
+		lod.indexBuffer = CreateTestBuffer(device, D3D11_BIND_INDEX_BUFFER, lod.numIndices * (lod.indices32 ? 4 : 2));
+	}
+
+	// The null device never looks at state descs
+	device.CreateRasterizerState(NULL, &scene.states.rasterizer);
+	device.CreateRasterizerState(NULL, &scene.states.lightRasterizer);
+	device.CreateBlendState(NULL, &scene.states.gbufferBlend);
+	device.CreateDepthStencilState(NULL, &scene.states.gbufferDepthStencil);
+	device.CreateBlendState(NULL, &scene.states.lightingBlend);
+	device.CreateDepthStencilState(NULL, &scene.states.lightingDepthStencil);
+	scene.states.lightShader = &scene.lightShader;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void ReleaseScene(NullRenderDevice &device, TestScene &scene)
+{
+	device.Release(scene.states.rasterizer);
+	device.Release(scene.states.lightRasterizer);
+	device.Release(scene.states.gbufferBlend);
+	device.Release(scene.states.gbufferDepthStencil);
+	device.Release(scene.states.lightingBlend);
+	device.Release(scene.states.lightingDepthStencil);
+
+	for(unsigned int i=0;i<NUM_MESHES;i++)
+	{
+		device.Release(scene.lods[i].vertexBuffer);
+		device.Release(scene.lods[i].indexBuffer);
+	}
+	for(unsigned int i=0;i<NUM_MATERIALS;i++)
+	{
+		device.Release(scene.textures[i].m_shaderView);
+	}
+
+	HXShader *shaders[NUM_SHADERS + 1] = { scene.shaders[0], scene.shaders[1], &scene.lightShader };
+	for(unsigned int i=0;i<NUM_SHADERS + 1;i++)
+	{
+		device.Release(shaders[i]->m_vshader);
+		device.Release(shaders[i]->m_pshader);
+		if(shaders[i]->m_instanceVShader != NULL)
+		{
+			device.Release(shaders[i]->m_instanceVShader);
+		}
+	}
+	for(unsigned int i=0;i<NUM_SHADERS;i++)
+	{
+		delete scene.shaders[i];
+	}
+
+	device.Release(scene.decl.m_layout);
+	device.Release(scene.instanceDecl.m_layout);
+}
+
+// ****************************************************************************
+// The records a frame's submission would have made, in no particular order,
+// and the world view matrices RenderScene() would have worked out for them.
+// Only the depth of each matters to the passes.
+// ****************************************************************************
+void FillDrawList(TestScene &scene, const RenderData *records, FrameDrawList &list, unsigned int numDraws, uint32_t seed)
+{
+	list.arena.Reset();
+	list.draws = list.arena.Alloc<RenderData *>(numDraws);
+	list.constants = list.arena.Alloc<CONSTANT_BUFFER_OBJECT>(numDraws);
+	list.numDraws = numDraws;
+
+	for(unsigned int i=0;i<numDraws;i++)
+	{
+		list.draws[i] = const_cast<RenderData *>(&records[i]);
+		CONSTANT_BUFFER_OBJECT &constants = list.constants[i];
+		constants.m_worldViewMatrix = Matrix4x4();
+		constants.m_worldViewMatrix.r[2][3] = RandomFloat(seed, NEAR_Z, FAR_Z);
+		constants.m_worldViewIT = constants.m_worldViewMatrix;
+		constants.m_invWorldViewProj = constants.m_worldViewMatrix;
+	}
+}
+
+// ****************************************************************************
+// Lights half in front of the camera and inside the view, and half entirely
+// behind it.  The view is the identity, so view space is world space.
+// Returns how many are in front.
+// ****************************************************************************
+unsigned int FillLights(LightList &lights, unsigned int numLights)
+{
+	uint32_t seed = 7;
+	unsigned int inFront = 0;
+	lights.Clear();
+	for(unsigned int i=0;i<numLights;i++)
+	{
+		float radius = RandomFloat(seed, 0.5f, 10.0f);
+		Vector3 position;
+		if(i & 1)
+		{
+			position.z = -radius - RandomFloat(seed, 0.01f, 100.0f);
+			position.x = RandomFloat(seed, -50.0f, 50.0f);
+			position.y = RandomFloat(seed, -50.0f, 50.0f);
+		}
+		else
+		{
+			position.z = RandomFloat(seed, NEAR_Z + radius, FAR_Z);
+			position.x = RandomFloat(seed, -0.5f, 0.5f) * position.z;
+			position.y = RandomFloat(seed, -0.3f, 0.3f) * position.z;
+			inFront++;
+		}
+		lights.AddPointLight(position, Color(1.0f, 0.5f, 0.25f, 1.0f), radius * 0.5f, radius);
+	}
+	return inFront;
+}
+
+// ****************************************************************************
+// The frame RenderThread's CreateFrameGraph() declares, with the passes
+// under test in it
+// ****************************************************************************
+void CreateFrameGraph(RenderGraph &graph, ScenePasses &passes, ID3D11RenderTargetView *backBufferView, DXGI_FORMAT backBufferFormat)
+{
+	RenderGraphTextureDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.width = WIDTH;
+	desc.height = HEIGHT;
+	desc.clear = true;
+
+	desc.format = desc.targetFormat = desc.shaderFormat = backBufferFormat;
+	RenderGraphResource backBuffer = graph.ImportTexture("BackBuffer", desc, backBufferView, NULL, NULL);
+	desc.format = desc.targetFormat = desc.shaderFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+	RenderGraphResource albedo = graph.CreateTexture("Albedo", desc);
+	desc.format = desc.targetFormat = desc.shaderFormat = DXGI_FORMAT_R16G16B16A16_SNORM;
+	RenderGraphResource normal = graph.CreateTexture("Normal", desc);
+	desc.format = desc.targetFormat = desc.shaderFormat = DXGI_FORMAT_R32_FLOAT;
+	RenderGraphResource depth = graph.CreateTexture("Depth", desc);
+
+	desc.format = DXGI_FORMAT_R24G8_TYPELESS;
+	desc.targetFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	desc.shaderFormat = DXGI_FORMAT_R32_FLOAT;
+	desc.depthStencil = true;
+	desc.clearDepth = 1.0f;
+	RenderGraphResource depthStencil = graph.CreateTexture("DepthStencil", desc);
+
+	RenderGraphPass gbuffer = graph.AddPass("FillGBuffer", ScenePasses::FillGBuffer, &passes);
+	graph.WriteTarget(gbuffer, albedo);
+	graph.WriteTarget(gbuffer, normal);
+	graph.WriteTarget(gbuffer, depth);
+	graph.WriteDepth(gbuffer, depthStencil);
+
+	RenderGraphPass lighting = graph.AddPass("DoLighting", ScenePasses::DoLighting, &passes);
+	graph.ReadTexture(lighting, albedo, 0);
+	graph.ReadTexture(lighting, normal, 1);
+	graph.ReadTexture(lighting, depth, 2);
+	graph.ReadDepth(lighting, depthStencil);
+	graph.WriteTarget(lighting, backBuffer);
+
+	graph.MarkOutput(backBuffer);
+	if(!TEST_CHECK(graph.Compile()))
+	{
+		fprintf(stderr, "%s\n", graph.CompileError());
+	}
+	graph.Realize();
+}
+
+// ****************************************************************************
+// ****************************************************************************
+void TestScenePasses(bool constantBufferOffsets, unsigned int numDraws, unsigned int numLights)
+{
+	NullRenderDevice device(WIDTH, HEIGHT);
+	NullRenderContext nullContext(constantBufferOffsets);
+	StateCacheContext context(&nullContext);
+
+	ID3D11Texture2D *backBufferTexture = NULL;
+	D3D11_TEXTURE2D_DESC backBufferDesc;
+	device.GetBackBuffer(&backBufferTexture, &backBufferDesc);
+	ID3D11RenderTargetView *backBufferView = NULL;
+	device.CreateRenderTargetView(backBufferTexture, NULL, &backBufferView);
+
+	TestScene scene;
+	CreateScene(device, scene);
+	unsigned int baseObjects = device.NumLiveObjects();
+
+	// Every draw picks a mesh and a material, and the shader comes with the
+	// material.  What the frame should cost follows from how many draws
+	// landed on each mesh/material pair.  The last mesh is drawn once and
+	// the one before it twice, both with an instanced shader, so there's
+	// always a run just too short and one just long enough to instance.
+	uint32_t seed = 12345;
+	RenderData *records = new RenderData[numDraws];
+	unsigned int pairCounts[NUM_MESHES][NUM_MATERIALS];
+	memset(pairCounts, 0, sizeof(pairCounts));
+	for(unsigned int i=0;i<numDraws;i++)
+	{
+		unsigned int mesh = RandomIndex(seed, NUM_MESHES - 2);
+		unsigned int material = RandomIndex(seed, NUM_MATERIALS);
+		if(i < 3)
+		{
+			mesh = i == 0 ? NUM_MESHES - 1 : NUM_MESHES - 2;
+			material = 0;
+		}
+		RenderData &obj = records[i];
+		obj.worldMatrix = Matrix4x4();
+		obj.mesh = NULL;
+		obj.lod = &scene.lods[mesh];
+		obj.material = &scene.materials[material];
+		obj.shader = obj.material->m_shader;
+		obj.sortKey = MakeSortKey(PASS_GBUFFER, obj.shader->m_id, obj.material->m_id, obj.lod->id);
+		pairCounts[mesh][material]++;
+	}
+
+	unsigned int expectedDrawCalls = 0;
+	unsigned int expectedBlocks = 0;
+	unsigned int expectedInstanced = 0;
+	bool shaderUsed[NUM_SHADERS] = { false };
+	for(unsigned int mesh=0;mesh<NUM_MESHES;mesh++)
+	{
+		for(unsigned int material=0;material<NUM_MATERIALS;material++)
+		{
+			unsigned int count = pairCounts[mesh][material];
+			if(count > 0)
+			{
+				shaderUsed[material % NUM_SHADERS] = true;
+			}
+			if(count >= MIN_INSTANCE_RUN && scene.materials[material].m_shader->m_instanceVShader != NULL)
+			{
+				expectedDrawCalls++;
+				expectedInstanced += count;
+			}
+			else
+			{
+				expectedDrawCalls += count;
+				expectedBlocks += count;
+			}
+		}
+	}
+
+	unsigned int numShadersUsed = 0;
+	for(unsigned int i=0;i<NUM_SHADERS;i++)
+	{
+		numShadersUsed += shaderUsed[i] ? 1 : 0;
+	}
+
+	LightList lights;
+	unsigned int expectedLights = FillLights(lights, numLights);
+
+	// Sorted by shader first, so each shader's pixel shader is bound once
+	// and the light shader once more.  With a single shader and no lights,
+	// what the last frame left bound is already right.
+	unsigned int expectedShaderBinds = numShadersUsed + (expectedLights > 0 ? 1 : 0);
+
+	ScenePasses passes;
+	passes.Initialize(&device, &context, scene.states);
+	const unsigned int blocksPerBuffer = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 / sizeof(CONSTANT_BUFFER_OBJECT);
+	unsigned int expectedRingMaps = 0;
+	if(expectedBlocks > 0)
+	{
+		expectedRingMaps = constantBufferOffsets ? 1 : (expectedBlocks + blocksPerBuffer - 1) / blocksPerBuffer;
+	}
+
+	RenderGraph graph;
+	graph.Initialize(&device, &context);
+	CreateFrameGraph(graph, passes, backBufferView, backBufferDesc.Format);
+
+	FrameDrawList list;
+	ScenePassFrame frame;
+	frame.draws = &list;
+	frame.lights = &lights;
+	frame.viewMatrix = Matrix4x4();
+	frame.projMatrix.SetProjectionFOV(1.0f, static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), NEAR_Z, FAR_Z);
+	frame.cameraNear = NEAR_Z;
+	frame.cameraFar = FAR_Z;
+	frame.imageWidth = static_cast<float>(WIDTH);
+	frame.imageHeight = static_cast<float>(HEIGHT);
+
+	RenderCommand *firstCommands = NULL;
+	unsigned int numFirstCommands = 0;
+	double totalSeconds = 0.0;
+	for(unsigned int frameIndex=0;frameIndex<NUM_FRAMES;frameIndex++)
+	{
+		FillDrawList(scene, records, list, numDraws, 1000 + frameIndex);
+
+		double start = TestSeconds();
+		passes.SetFrame(frame);
+		graph.Execute();
+		context.Present(0, 0);
+		if(frameIndex > 0)
+		{
+			totalSeconds += TestSeconds() - start;
+		}
+
+		const ScenePassStats &passStats = passes.FrameStats();
+		const RenderContextStats &stats = nullContext.LastFrameStats();
+
+		// Every draw is drawn once, in as many calls as there are runs
+		TEST_CHECK(passStats.drawCalls == expectedDrawCalls);
+		TEST_CHECK(passStats.instancedDraws == expectedInstanced);
+		TEST_CHECK(stats.opCounts[RenderCommand::DRAW_INDEXED_INSTANCED] == expectedDrawCalls);
+
+		unsigned int instancesDrawn = 0;
+		const RenderCommand *commands = nullContext.LastFrameCommands();
+		unsigned int numCommands = nullContext.LastFrameNumCommands();
+		for(unsigned int i=0;i<numCommands;i++)
+		{
+			if(commands[i].op == RenderCommand::DRAW_INDEXED_INSTANCED)
+			{
+				instancesDrawn += commands[i].count;
+			}
+		}
+		TEST_CHECK(instancesDrawn == numDraws);
+
+		// One quad per light in front of the camera
+		TEST_CHECK(passStats.pointLightsDrawn == expectedLights);
+		TEST_CHECK(stats.opCounts[RenderCommand::DRAW_INDEXED] == expectedLights);
+		TEST_CHECK(stats.draws == expectedDrawCalls + expectedLights);
+
+		// The instance buffer once, the object constant ring, and two constant
+		// buffers for each light
+		TEST_CHECK(passStats.objectConstantMaps == expectedRingMaps);
+		TEST_CHECK(stats.maps == (expectedInstanced > 0 ? 1 : 0) + expectedRingMaps + 2 * expectedLights);
+		TEST_CHECK(stats.opCounts[RenderCommand::UNMAP] == stats.maps);
+
+		unsigned int shaderBinds = stats.opCounts[RenderCommand::SET_PS];
+		TEST_CHECK(shaderBinds == expectedShaderBinds || (frameIndex > 0 && expectedShaderBinds == 1 && shaderBinds == 0));
+
+		// Anything made on the first frame is kept, and after it every
+		// frame is the same up to Present(), which logs the frame number
+		if(!TEST_CHECK(numCommands > 0 && commands[numCommands - 1].op == RenderCommand::PRESENT))
+			break;
+		numCommands--;
+		if(frameIndex == 1)
+		{
+			numFirstCommands = numCommands;
+			firstCommands = new RenderCommand[numCommands];
+			memcpy(firstCommands, commands, numCommands * sizeof(RenderCommand));
+		}
+		else if(frameIndex > 1 && TEST_CHECK(numCommands == numFirstCommands))
+		{
+			TEST_CHECK(memcmp(commands, firstCommands, numCommands * sizeof(RenderCommand)) == 0);
+		}
+
+		if(frameIndex == NUM_FRAMES - 1)
+		{
+			printf("%s: %u draws in %u calls, %u of %u lights, per frame %u context calls, %u state changes, %u maps (%.1f KB), %u binds filtered, %.3f ms\n",
+				constantBufferOffsets ? "offsets" : "pooled", numDraws, passStats.drawCalls, passStats.pointLightsDrawn, numLights,
+				stats.calls, stats.stateChanges, stats.maps, static_cast<double>(stats.bytesMapped) / 1024.0,
+				context.LastFrameStats().filtered, totalSeconds * 1000.0 / (NUM_FRAMES - 1));
+		}
+	}
+
+	delete [] firstCommands;
+	graph.Release();
+	passes.Release();
+	TEST_CHECK(device.NumLiveObjects() == baseObjects);
+
+	ReleaseScene(device, scene);
+	device.Release(backBufferView);
+	device.Release(backBufferTexture);
+	TEST_CHECK(device.NumLiveObjects() == 0);
+
+	delete [] records;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numDraws = argc > 1 ? atoi(argv[1]) : 10000;
+	unsigned int numLights = argc > 2 ? atoi(argv[2]) : 256;
+
+	TestScenePasses(true, numDraws, numLights);
+	TestScenePasses(false, numDraws, numLights);
+
+	return TestResult("ScenePassesTest");
+}
@@ -0,0 +1,140 @@
+#include "RenderCore/SubmitQueue.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Runs frames through the submission queue the way SubmitInstances(),
+// RenderScene() and the render thread do, with the number of draws moving
+// around from frame to frame.  Once the arenas have seen the busiest frame,
+// submitting, merging and retiring must never go to the heap again.
+//
+//	SubmitBenchmark [frames] [draws per frame]
+// ****************************************************************************
+
+const unsigned int	WARMUP_FRAMES = 8;
+
+// What a frame's merged list takes on top of the pointers: TransformDrawList()
+// gives every draw a CONSTANT_BUFFER_OBJECT, three matrices
+const unsigned int	CONSTANT_MATRICES_PER_DRAW = 3;
+
+// ****************************************************************************
+// ****************************************************************************
+void SubmitDraws(unsigned int frame, unsigned int numDraws)
+{
+	for(unsigned int draw=0;draw < numDraws; draw++)
+	{
+		int index;
+		SubmissionBuffer &buffer = BeginSubmit(index);
+
+		RenderData *obj = AllocRenderData(buffer);
+		obj->worldMatrix = Matrix4x4();
+		obj->worldMatrix.r[0][3] = static_cast<float>(draw);
+		obj->sortKey = (static_cast<uint64_t>(frame) << 32) | draw;
+		obj->mesh = NULL;
+		obj->lod = NULL;
+		obj->material = NULL;
+		obj->shader = NULL;
+		buffer.numTriangles += 12;
+		buffer.fullTriangles += 12;
+
+		EndSubmit();
+	}
+}
+
+// One frame built while the last is drawn, as at the default pipeline depth
+const int			NUM_SLOTS = 2;
+
+// ****************************************************************************
+// Each slot has arenas of its own, so every slot's first frame is the busiest
+// and the rest move around below it
+// ****************************************************************************
+inline unsigned int FrameDraws(unsigned int frame, unsigned int maxDraws)
+{
+	if(frame < NUM_SLOTS)
+		return maxDraws;
+
+	return maxDraws / 8 + (frame * 7919) % (maxDraws - maxDraws / 8 + 1);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	unsigned int numFrames = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 200;
+	unsigned int maxDraws = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 100000;
+	if(numFrames <= WARMUP_FRAMES || maxDraws < 2)
+	{
+		fprintf(stderr, "Usage: SubmitBenchmark [frames > %u] [draws per frame]\n", WARMUP_FRAMES);
+		return 2;
+	}
+
+	LinearAllocator frameArenas[NUM_SLOTS];
+	SetSubmissionIndex(0);
+
+	double submitSeconds = 0.0;
+	double mergeSeconds = 0.0;
+	unsigned int steadyAllocations = 0;
+	unsigned int steadyOverflows = 0;
+	unsigned int overflowsAtWarmup = 0;
+	uint64_t totalDraws = 0;
+
+	for(unsigned int frame=0;frame < numFrames; frame++)
+	{
+		unsigned int numDraws = FrameDraws(frame, maxDraws);
+
+		double start = TestSeconds();
+		SubmitDraws(frame, numDraws);
+		double submitted = TestSeconds();
+
+		// RenderScene()
+		int index = SubmissionIndex();
+		SetSubmissionIndex((index + 1) % NUM_SLOTS);
+
+		LinearAllocator &arena = frameArenas[index];
+		arena.Reset();
+		RenderData **draws = NULL;
+		unsigned int numMerged = MergeSubmitBuckets(index, arena, draws);
+		Matrix4x4 *constants = arena.Alloc<Matrix4x4>(CONSTANT_MATRICES_PER_DRAW * (numMerged > 0 ? numMerged : 1));
+		double merged = TestSeconds();
+
+		TEST_CHECK(numMerged == numDraws);
+		for(unsigned int draw=0;draw < numMerged; draw++)
+		{
+			constants[draw * CONSTANT_MATRICES_PER_DRAW] = draws[draw]->worldMatrix;
+		}
+
+		// The render thread retires it
+		SubmittedFrameStats stats;
+		RetireSubmitBuckets(index, stats);
+		unsigned int allocations = stats.heapAllocations + arena.HeapAllocations();
+		unsigned int overflows = stats.arenaOverflows + frameArenas[0].Overflows() + frameArenas[1].Overflows();
+
+		if(frame == WARMUP_FRAMES - 1)
+		{
+			overflowsAtWarmup = overflows;
+		}
+		else if(frame >= WARMUP_FRAMES)
+		{
+			submitSeconds += submitted - start;
+			mergeSeconds += merged - submitted;
+			steadyAllocations += allocations;
+			steadyOverflows = overflows - overflowsAtWarmup;
+			totalDraws += numDraws;
+
+			if(!TEST_CHECK(allocations == 0))
+			{
+				fprintf(stderr, "Frame %u, %u draws: %u heap allocations\n", frame, numDraws, allocations);
+			}
+		}
+	}
+
+	TEST_CHECK(steadyOverflows == 0);
+
+	unsigned int steadyFrames = numFrames - WARMUP_FRAMES;
+	printf("%u frames of up to %u draws, %u frames warm-up\n", numFrames, maxDraws, WARMUP_FRAMES);
+	printf("Submit:      %.1f ns per draw\n", submitSeconds * 1e9 / static_cast<double>(totalDraws));
+	printf("Merge:       %.3f ms per frame\n", mergeSeconds * 1000.0 / steadyFrames);
+	printf("Heap allocations after warm-up: %u, arena overflows: %u\n", steadyAllocations, steadyOverflows);
+
+	return TestResult("SubmitBenchmark");
+}
@@ -0,0 +1,355 @@
+#include "Kernel/Atomic.h"
+#include "RenderCore/SubmitQueue.h"
+
+using namespace Helix;
+
+// ****************************************************************************
+// Hammers the submission queue from many producer threads while the main
+// thread plays RenderScene(): flip the submission index, merge the old one,
+// retire it.  Every record carries who wrote it, its place in that
+// producer's sequence and the index BeginSubmit() gave it, and its matrix is
+// filled from the same numbers, so the merge can check that
+//	- a frame has exactly the records submitted into its index, all of them
+//	  whole, each producer's in order and carrying on where the last frame
+//	  left off
+//	- a producer that starts after the flip lands in the next frame
+//	- with more threads than there are buckets, the ones that share the last
+//	  bucket don't lose or tear anything either
+//
+//	SubmitStressTest [producers] [instances per frame] [frames]
+// ****************************************************************************
+
+const int			MAX_PRODUCERS = 32;
+const int			NUM_SLOTS = 2;
+const unsigned int	LATE_RECORDS = 1000;
+const int			NUM_CHURNERS = 96;		// More than SubmitQueue has buckets for
+const unsigned int	CHURN_RECORDS = 2000;
+
+// sortKey is producer, index, sequence from the top down
+const int			KEY_PRODUCER_SHIFT = 56;
+const int			KEY_INDEX_SHIFT = 48;
+const uint64_t		KEY_SEQUENCE_MASK = (1ull << KEY_INDEX_SHIFT) - 1;
+
+struct Producer
+{
+	TestThread		thread;
+	int				id;
+	unsigned int	perFrame;			// Lockstep frames only
+	volatile long	submitted;			// Records so far
+	uint64_t		nextExpected;		// Main thread's, the next sequence to merge
+};
+
+// The producers, then the late producer, then the churners
+Producer			m_producers[MAX_PRODUCERS + 1 + NUM_CHURNERS];
+int					m_numProducers = 0;
+int					m_numIds = 0;
+volatile long		m_frameStart = 0;		// Lockstep: frames the producers may submit
+volatile long		m_framesDone = 0;		// Lockstep: producer frames finished
+volatile long		m_racersDone = 0;		// Racing: producers finished
+volatile long		m_lateStart = 0;
+
+// ****************************************************************************
+// Distinct for every record, and exact in a float
+// ****************************************************************************
+inline float MatrixPattern(uint64_t key, int element)
+{
+	return static_cast<float>(((key * 2654435761u) + element) & 0xffffff);
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void SubmitRecord(Producer &producer, uint64_t sequence)
+{
+	int index;
+	SubmissionBuffer &buffer = BeginSubmit(index);
+
+	uint64_t key = (static_cast<uint64_t>(producer.id) << KEY_PRODUCER_SHIFT) | (static_cast<uint64_t>(index) << KEY_INDEX_SHIFT) | sequence;
+	RenderData *obj = AllocRenderData(buffer);
+	for(int element=0;element < 16; element++)
+	{
+		obj->worldMatrix.e[element] = MatrixPattern(key, element);
+	}
+	obj->mesh = NULL;
+	obj->lod = NULL;
+	obj->material = NULL;
+	obj->shader = NULL;
+	buffer.numTriangles += 1;
+	buffer.fullTriangles += 2;
+
+	// Last, so a record that's merged before it's done fails its pattern
+	obj->sortKey = key;
+
+	EndSubmit();
+}
+
+// ****************************************************************************
+// Submits its share of each frame once the main thread starts it
+// ****************************************************************************
+void LockstepProducer(void *data)
+{
+	Producer &producer = *static_cast<Producer *>(data);
+	long frame = 0;
+	for(;;)
+	{
+		long start = m_frameStart;
+		if(start < 0)
+			return;
+
+		if(start == frame)
+		{
+			TestYield();
+			continue;
+		}
+
+		for(unsigned int record=0;record < producer.perFrame; record++)
+		{
+			SubmitRecord(producer, producer.submitted);
+			AtomicIncrement(&producer.submitted);
+		}
+		frame++;
+		AtomicIncrement(&m_framesDone);
+	}
+}
+
+// ****************************************************************************
+// Submits another frame's share as fast as it can, then stops
+// ****************************************************************************
+void RacingProducer(void *data)
+{
+	Producer &producer = *static_cast<Producer *>(data);
+	for(unsigned int record=0;record < producer.perFrame; record++)
+	{
+		SubmitRecord(producer, producer.submitted);
+		AtomicIncrement(&producer.submitted);
+	}
+	AtomicIncrement(&m_racersDone);
+}
+
+// ****************************************************************************
+// Waits to be let go, then submits LATE_RECORDS
+// ****************************************************************************
+void LateProducer(void *data)
+{
+	Producer &producer = *static_cast<Producer *>(data);
+	for(;;)
+	{
+		long start = m_lateStart;
+		if(start < 0)
+			return;
+
+		if(start == 0)
+		{
+			TestYield();
+			continue;
+		}
+
+		for(unsigned int record=0;record < LATE_RECORDS; record++)
+		{
+			SubmitRecord(producer, producer.submitted);
+			AtomicIncrement(&producer.submitted);
+		}
+		AtomicStore(&m_lateStart, 0);
+	}
+}
+
+// ****************************************************************************
+// The first half of RenderScene(): moves submission on, returning the index
+// that was being submitted to
+// ****************************************************************************
+int Flip()
+{
+	int index = SubmissionIndex();
+	int next = (index + 1) % NUM_SLOTS;
+	SetSubmissionIndex(next);
+	TEST_CHECK(SubmissionIndex() == next);
+	return index;
+}
+
+// ****************************************************************************
+// The second half, and the render thread retiring the frame.  Checks every
+// record and returns how many there were from producer, or from everyone if
+// producer is negative.
+// ****************************************************************************
+unsigned int Merge(LinearAllocator &arena, int index, int producer)
+{
+	arena.Reset();
+	RenderData **draws = NULL;
+	unsigned int numDraws = MergeSubmitBuckets(index, arena, draws);
+
+	unsigned int numCounted = 0;
+	bool finished[MAX_PRODUCERS + 1 + NUM_CHURNERS];
+	memset(finished, 0, sizeof(finished));
+	int lastProducer = -1;
+	for(unsigned int draw=0;draw < numDraws; draw++)
+	{
+		const RenderData &obj = *draws[draw];
+		uint64_t key = obj.sortKey;
+		int id = static_cast<int>(key >> KEY_PRODUCER_SHIFT);
+		int keyIndex = static_cast<int>((key >> KEY_INDEX_SHIFT) & 0xff);
+		uint64_t sequence = key & KEY_SEQUENCE_MASK;
+
+		bool whole = true;
+		for(int element=0;element < 16; element++)
+		{
+			whole = whole && obj.worldMatrix.e[element] == MatrixPattern(key, element);
+		}
+		TEST_CHECK(whole);
+		TEST_CHECK(keyIndex == index);
+
+		if(!TEST_CHECK(id >= 0 && id < m_numIds))
+			continue;
+
+		// Each producer's records come out together, in the order they went
+		// in.  Churners may share a bucket, so only their order holds.
+		if(id != lastProducer && id <= m_numProducers)
+		{
+			TEST_CHECK(!finished[id]);
+			if(lastProducer >= 0)
+				finished[lastProducer] = true;
+			lastProducer = id;
+		}
+
+		Producer &owner = m_producers[id];
+		TEST_CHECK(sequence == owner.nextExpected);
+		owner.nextExpected = sequence + 1;
+
+		if(producer < 0 || id == producer)
+			numCounted++;
+	}
+
+	SubmittedFrameStats stats;
+	RetireSubmitBuckets(index, stats);
+	TEST_CHECK(stats.numTriangles == numDraws);
+	TEST_CHECK(stats.fullTriangles == 2 * numDraws);
+
+	return numCounted;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+int main(int argc, char *argv[])
+{
+	m_numProducers = argc > 1 ? atoi(argv[1]) : 8;
+	unsigned int perFrame = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 1000000;
+	int numFrames = argc > 3 ? atoi(argv[3]) : 4;
+	if(m_numProducers < 1 || m_numProducers > MAX_PRODUCERS || perFrame < static_cast<unsigned int>(m_numProducers) || numFrames < 1)
+	{
+		fprintf(stderr, "Usage: SubmitStressTest [producers <= %d] [instances per frame] [frames]\n", MAX_PRODUCERS);
+		return 2;
+	}
+
+	// Every producer gets the same share
+	perFrame -= perFrame % m_numProducers;
+	m_numIds = m_numProducers + 1 + NUM_CHURNERS;
+	for(int id=0;id < m_numIds; id++)
+	{
+		m_producers[id].id = id;
+		m_producers[id].perFrame = id <= m_numProducers ? perFrame / m_numProducers : CHURN_RECORDS;
+		m_producers[id].submitted = 0;
+		m_producers[id].nextExpected = 0;
+	}
+
+	LinearAllocator arena;
+	SetSubmissionIndex(0);
+
+	// Lockstep: each frame is every producer's share, exactly
+	double start = TestSeconds();
+	for(int id=0;id < m_numProducers; id++)
+	{
+		StartTestThread(m_producers[id].thread, LockstepProducer, &m_producers[id]);
+	}
+	for(int frame=1;frame <= numFrames; frame++)
+	{
+		AtomicStore(&m_frameStart, frame);
+		while(m_framesDone < frame * m_numProducers)
+		{
+			TestYield();
+		}
+		TEST_CHECK(Merge(arena, Flip(), -1) == perFrame);
+	}
+	AtomicStore(&m_frameStart, -1);
+	for(int id=0;id < m_numProducers; id++)
+	{
+		JoinTestThread(m_producers[id].thread);
+	}
+	double lockstepSeconds = TestSeconds() - start;
+
+	// Racing: the index flips as fast as it can under producers that don't
+	// wait for it, so records land on both sides of every flip.  Nothing may
+	// be lost or doubled.
+	unsigned int numRaced = 0;
+	int numFlips = 0;
+	for(int id=0;id < m_numProducers; id++)
+	{
+		StartTestThread(m_producers[id].thread, RacingProducer, &m_producers[id]);
+	}
+	while(m_racersDone < m_numProducers)
+	{
+		numRaced += Merge(arena, Flip(), -1);
+		numFlips++;
+	}
+	for(int id=0;id < m_numProducers; id++)
+	{
+		JoinTestThread(m_producers[id].thread);
+	}
+	numRaced += Merge(arena, Flip(), -1);
+	numFlips++;
+
+	unsigned int numSubmitted = 0;
+	for(int id=0;id < m_numProducers; id++)
+	{
+		numSubmitted += static_cast<unsigned int>(m_producers[id].submitted);
+		TEST_CHECK(m_producers[id].nextExpected == static_cast<uint64_t>(m_producers[id].submitted));
+	}
+	TEST_CHECK(numRaced == perFrame);
+	TEST_CHECK(numRaced + numFrames * perFrame == numSubmitted);
+
+	// Late: a producer that starts after the flip is in the next frame, not
+	// the one being merged
+	Producer &late = m_producers[m_numProducers];
+	StartTestThread(late.thread, LateProducer, &late);
+	for(int round=0;round < numFrames; round++)
+	{
+		int index = Flip();
+		AtomicStore(&m_lateStart, 1);
+		while(m_lateStart != 0)
+		{
+			TestYield();
+		}
+
+		TEST_CHECK(Merge(arena, index, late.id) == 0);
+		TEST_CHECK(Merge(arena, Flip(), late.id) == LATE_RECORDS);
+	}
+	AtomicStore(&m_lateStart, -1);
+	JoinTestThread(late.thread);
+
+	// Churn: more threads at once than there are buckets, on top of the ones
+	// the phases above left behind, racing the flips like before
+	Producer *churners = &m_producers[m_numProducers + 1];
+	unsigned int numChurned = 0;
+	AtomicStore(&m_racersDone, 0);
+	for(int i=0;i < NUM_CHURNERS; i++)
+	{
+		StartTestThread(churners[i].thread, RacingProducer, &churners[i]);
+	}
+	while(m_racersDone < NUM_CHURNERS)
+	{
+		numChurned += Merge(arena, Flip(), -1);
+	}
+	for(int i=0;i < NUM_CHURNERS; i++)
+	{
+		JoinTestThread(churners[i].thread);
+	}
+	numChurned += Merge(arena, Flip(), -1);
+
+	TEST_CHECK(numChurned == NUM_CHURNERS * CHURN_RECORDS);
+	for(int i=0;i < NUM_CHURNERS; i++)
+	{
+		TEST_CHECK(churners[i].submitted == static_cast<long>(CHURN_RECORDS));
+		TEST_CHECK(churners[i].nextExpected == CHURN_RECORDS);
+	}
+
+	printf("%d producers, %u instances a frame: %.1f ms a lockstep frame, %u records raced over %d flips, %u from %d churning threads\n", m_numProducers, perFrame, lockstepSeconds * 1000.0 / numFrames, numRaced, numFlips, numChurned, NUM_CHURNERS);
+
+	return TestResult("SubmitStressTest");
+}
@@ -0,0 +1,170 @@
+#ifndef TEST_H
+#define TEST_H
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+// ****************************************************************************
+// What the tests and benchmarks here share.  TEST_CHECK holds in release
+// builds too, unlike _ASSERT, and counts its failures; main() returns
+// TestResult() so whatever runs the test sees them in the exit code.
+// ****************************************************************************
+
+#define TEST_CHECK(expr)	TestCheck((expr) != 0, #expr, __FILE__, __LINE__)
+
+// ****************************************************************************
+// ****************************************************************************
+inline unsigned int & TestFailures()
+{
+	static unsigned int failures = 0;
+	return failures;
+}
+
+// ****************************************************************************
+// Only the first few failures of a run are printed
+// ****************************************************************************
+inline bool TestCheck(bool passed, const char *expr, const char *file, int line)
+{
+	if(passed)
+		return true;
+
+	if(TestFailures() < 20)
+	{
+		fprintf(stderr, "%s(%d): failed: %s\n", file, line, expr);
+	}
+	TestFailures()++;
+	return false;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline int TestResult(const char *name)
+{
+	if(TestFailures() == 0)
+	{
+		printf("%s: passed\n", name);
+		return 0;
+	}
+
+	printf("%s: %u checks failed\n", name, TestFailures());
+	return 1;
+}
+
+// ****************************************************************************
+// Seconds on a clock that only goes forward, for timing
+// ****************************************************************************
+inline double TestSeconds()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return static_cast<double>(now.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+#endif
+}
+
+// ****************************************************************************
+// Gives up the rest of the time slice, for waits that spin
+// ****************************************************************************
+inline void TestYield()
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+// ****************************************************************************
+// The whole of a content file, for the tests that read one.  NULL if it
+// can't be read; otherwise the caller delete[]s it.
+// ****************************************************************************
+inline char * TestReadFile(const char *path, size_t &size)
+{
+	size = 0;
+	FILE *file = fopen(path, "rb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Can't open %s\n", path);
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *data = length > 0 ? new char[length] : NULL;
+	if(data == NULL || fread(data, 1, length, file) != static_cast<size_t>(length))
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		delete [] data;
+		fclose(file);
+		return NULL;
+	}
+
+	fclose(file);
+	size = static_cast<size_t>(length);
+	return data;
+}
+
+// ****************************************************************************
+// Threads for the tests that need more than one
+// ****************************************************************************
+typedef void (*TestThreadFn)(void *data);
+
+struct TestThread
+{
+	TestThreadFn	fn;
+	void *			data;
+#ifdef _WIN32
+	HANDLE			handle;
+#else
+	pthread_t		handle;
+#endif
+};
+
+#ifdef _WIN32
+inline unsigned int __stdcall TestThreadEntry(void *thread)		{ static_cast<TestThread *>(thread)->fn(static_cast<TestThread *>(thread)->data); return 0; }
+#else
+inline void *		TestThreadEntry(void *thread)				{ static_cast<TestThread *>(thread)->fn(static_cast<TestThread *>(thread)->data); return NULL; }
+#endif
+
+// ****************************************************************************
+// thread has to stay put until JoinTestThread()
+// ****************************************************************************
+inline void StartTestThread(TestThread &thread, TestThreadFn fn, void *data)
+{
+	thread.fn = fn;
+	thread.data = data;
+#ifdef _WIN32
+	thread.handle = reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, TestThreadEntry, &thread, 0, NULL));
+	_ASSERT(thread.handle != NULL);
+#else
+	int result = pthread_create(&thread.handle, NULL, TestThreadEntry, &thread);
+	_ASSERT(result == 0);
+	(void)result;
+#endif
+}
+
+// ****************************************************************************
+// ****************************************************************************
+inline void JoinTestThread(TestThread &thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread.handle, INFINITE);
+	CloseHandle(thread.handle);
+#else
+	pthread_join(thread.handle, NULL);
+#endif
+}
+
+#endif // TEST_H
@@ -0,0 +1,4 @@
+// TestsPCH.cpp : source file that includes just the standard includes
+// Each test's .pch will be the pre-compiled header
+
+#include "TestsPCH.h"
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <crtdbg.h>
+#include <d3d11.h>			// Types only; nothing here links against D3D
+#else
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#define _ASSERT(expr)	assert(expr)
+
+// The MSVC runtime calls the engine sources here use
+inline void *	_aligned_malloc(size_t size, size_t alignment)	{ void *ptr = NULL; return posix_memalign(&ptr, alignment, size) == 0 ? ptr : NULL; }
+inline void		_aligned_free(void *ptr)						{ free(ptr); }
+#endif
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#ifndef _WIN32
+#include "D3DTypes.h"			// Stands in for <d3d11.h>
+#endif
+#include "Test.h"
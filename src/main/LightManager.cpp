@@ -139,12 +139,16 @@ void LightManager::CreateNewLights()
 // ****************************************************************************
 void LightManager::SubmitLights()
 {
+	float innerRadii[NUM_LIGHTS];
+	float outerRadii[NUM_LIGHTS];
 	for(int iLightIndex=0;iLightIndex<m_numLights;iLightIndex++)
 	{
-		Helix::Vector3 &pos = m_lightPositions[iLightIndex];
-		Helix::Color &color = m_lightColors[iLightIndex];
-		Helix::AddPointLight(pos,color,1.0f,5.0f);
+		innerRadii[iLightIndex] = 1.0f;
+		outerRadii[iLightIndex] = 5.0f;
 	}
+
+	Helix::AddPointLights(m_lightPositions, m_lightColors, innerRadii, outerRadii, m_numLights);
+	Helix::PublishLights();
 }
 // ****************************************************************************
 // ****************************************************************************
@@ -17,6 +17,7 @@
 #include "RenderCore/RenderMgr.h"
 #include "RenderCore/SceneLoader.h"
 #include "RenderCore/Light.h"
+#include "Utility/Profiler.h"
 #include "Kernel/Callback.h"
 #include "Camera.h"
 #include "LightManager.h"
@@ -225,6 +226,12 @@ void TheGame::ProcessMouseMBUp(LPARAM lParam, WPARAM wParam)
 // ****************************************************************************
 void TheGame::ProcessKeyDown(LPARAM lParam, WPARAM wParam)
 {
+	// F11 writes the next couple of seconds out for chrome://tracing
+	if(wParam == VK_F11 && !m_keyboardState[wParam])
+	{
+		Helix::ProfilerCaptureFrames(120, "profile.json");
+	}
+
 	m_keyboardState[wParam] = true;
 }
 
@@ -269,8 +276,17 @@ void TheGame::Update(void)
 // ****************************************************************************
 void TheGame::Render(void)
 {
+	// Cull against this frame's camera before anything is submitted
+	TheGame *game = TheGame::Instance();
+	Helix::Matrix4x4 viewProj = game->CurrentCamera()->GetProjectionMatrix() * game->CurrentCamera()->GetViewMatrix();
+
+	// Set our camera information.  Instances pick their level of detail
+	// from it as they're submitted.
+	Helix::SubmitViewMatrix(game->CurrentCamera()->GetViewMatrix());
+	Helix::SubmitProjMatrix(game->CurrentCamera()->GetProjectionMatrix());
+
 	LightManager::GetInstance().SubmitLights();
-	Helix::InstanceManager::GetInstance().SubmitInstances();
+	Helix::InstanceManager::GetInstance().SubmitInstances(viewProj);
 	Helix::RenderThreadReady();
 
 	WinApp::Render();
@@ -281,11 +297,6 @@ void TheGame::Render(void)
 		return;
 	}
 
-	// Set our camera information
-	TheGame *game = TheGame::Instance();
-	Helix::SubmitViewMatrix(game->CurrentCamera()->GetViewMatrix());
-	Helix::SubmitProjMatrix(game->CurrentCamera()->GetProjectionMatrix());
-
 	Helix::RenderScene();
 }
 